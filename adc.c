@@ -10,6 +10,7 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 
 #include "esp_err.h"
 #include "esp_log.h"
@@ -17,6 +18,7 @@
 #include "esp_rom_sys.h"
 
 #include "app_config.h"
+#include "capture_trigger.h"
 
 static const char *gTag = "ADC";
 
@@ -24,9 +26,46 @@ static const char *gTag = "ADC";
 static adc_oneshot_unit_handle_t gsAdcHandleUnit1 = NULL;
 static SemaphoreHandle_t gsAdcMutex = NULL;
 
+// Per-stage timing of Adc_MeasureNow, guarded by gsAdcMutex
+static adc_stage_stats_t gasStageStats[ADC_STAGE_COUNT];
+
+static const char *const gasStageNames[ADC_STAGE_COUNT] = {
+    [ADC_STAGE_AUTORANGE] = "autorange",
+    [ADC_STAGE_CAPTURE] = "capture",
+    [ADC_STAGE_FILTER] = "filter",
+    [ADC_STAGE_DC_REMOVE] = "dc_remove",
+    [ADC_STAGE_RMS] = "rms",
+    [ADC_STAGE_CONVERT] = "convert",
+    [ADC_STAGE_PUBLISH] = "publish",
+};
+
+// Serializes use of the ADC hardware between measurements and stream captures
+static SemaphoreHandle_t gsAdcCaptureMutex = NULL;
+
+// Set while no capture window is open; lets expensive work wait for the gap
+static EventGroupHandle_t gsAcquireEvents = NULL;
+#define iAdcIdleBit                     BIT0
+static adc_atten_t geConfiguredAttenChA = ADC_ATTEN_DB_12;
+static adc_atten_t geConfiguredAttenChB = ADC_ATTEN_DB_12;
+
 static adc_result_t gsLatestResult;
 static bool gbHasLatest = false;
 
+// ======================== Publish hooks ========================
+#define iAdcMaxPublishHooks             8
+
+typedef struct
+{
+    adc_publish_hook_t pfnHook;
+    void *pvCtx;
+} adc_publish_slot_t;
+
+static adc_publish_slot_t gasPublishHooks[iAdcMaxPublishHooks];
+static int giPublishHookCount = 0;
+
+// Held while hooks run, so each hook sees every result once and in order
+static SemaphoreHandle_t gsPublishMutex = NULL;
+
 
 // ======================== Last captured waveform cache (AC, mV) ========================
 static int16_t gaiLastAcMilliVoltsChA[iSamples_PerCh];
@@ -38,12 +77,27 @@ static adc_atten_t geLastSamplesAttenChB = ADC_ATTEN_DB_12;
 static bool gbHasLastSamples = false;
 
 
+// ======================== Extra capture state (guarded by gsAdcCaptureMutex) ========================
+// DC level of the last measurement in raw counts, used to place trigger levels
+static float gfDcCountsChA = 0.0f;
+static float gfDcCountsChB = 0.0f;
+static bool gbHasDcCounts = false;
+
+// Working buffers shared by the streaming and triggered capture paths
+static uint16_t gauScratchRawChA[iSamples_PerCh];
+static uint16_t gauScratchRawChB[iSamples_PerCh];
+static uint16_t gauScratchFiltChA[iSamples_PerCh];
+static uint16_t gauScratchFiltChB[iSamples_PerCh];
+static int32_t gaiScratchAcCountsChA[iSamples_PerCh];
+static int32_t gaiScratchAcCountsChB[iSamples_PerCh];
+
+
 
-static void Dc_Remove(const uint16_t *puInput, int32_t *piOutput, int iCount)
+static float Dc_Remove(const uint16_t *puInput, int32_t *piOutput, int iCount)
 {
     // Removes DC component from samples by subtracting the mean value
     // Produces signed, zero-centered samples for waveform display and RMS compute
-    // Keeps units in ADC counts so conversion can be applied later
+    // Keeps units in ADC counts and returns the removed mean for trigger placement
 
     // Compute mean value
     int64_t liSum = 0;
@@ -56,6 +110,8 @@ static void Dc_Remove(const uint16_t *puInput, int32_t *piOutput, int iCount)
     for (int iIndex = 0; iIndex < iCount; iIndex++) {
         piOutput[iIndex] = (int32_t)((float)puInput[iIndex] - fMean);
     }
+
+    return fMean;
 }
 
 
@@ -112,6 +168,58 @@ static float Adc_CountsToVolts(adc_atten_t eAttenChannel, int32_t iCounts)
 
 
 
+static int32_t Adc_MilliVoltsToCounts(adc_atten_t eAttenChannel, int iMilliVolts)
+{
+    // Converts a signed millivolt offset to ADC counts for the given attenuation
+    // Inverse of Adc_CountsToVolts, so trigger levels match the reported waveform
+    // Rounds to the nearest count
+
+    float fCountsPerVolt = (float)iAdcFullScaleCounts / Adc_CountsToVolts(eAttenChannel, iAdcFullScaleCounts);
+    return (int32_t)lroundf(((float)iMilliVolts / 1000.0f) * fCountsPerVolt);
+}
+
+
+
+static void Convert_AcCountsToMilliVolts(const int32_t *piAcCounts, int16_t *piMilliVolts, int iCount,
+                                         adc_atten_t eAtten)
+{
+    // Converts zero-centered ADC counts to signed millivolts
+    // Rounds to the nearest millivolt and clamps to the int16 range
+    // Produces the representation used by waveform caches and streams
+
+    for (int iIndex = 0; iIndex < iCount; iIndex++) {
+
+        float fVolts = Adc_CountsToVolts(eAtten, piAcCounts[iIndex]);
+        int32_t iMilliVolts = (int32_t)lroundf(fVolts * 1000.0f);
+
+        if (iMilliVolts > INT16_MAX) iMilliVolts = INT16_MAX;
+        if (iMilliVolts < INT16_MIN) iMilliVolts = INT16_MIN;
+
+        piMilliVolts[iIndex] = (int16_t)iMilliVolts;
+    }
+}
+
+
+
+static void Adc_RecordStageLocked(adc_stage_t eStage, int64_t liDurationUs)
+{
+    // Accumulates one stage duration into the timing statistics
+    // Keeps last, maximum, running total and count for rate calculations
+    // Must be called with the result mutex held
+
+    adc_stage_stats_t *psStats = &gasStageStats[eStage];
+    uint32_t uiDurationUs = (liDurationUs > 0) ? (uint32_t)liDurationUs : 0;
+
+    psStats->uiLastUs = uiDurationUs;
+    if (uiDurationUs > psStats->uiMaxUs) {
+        psStats->uiMaxUs = uiDurationUs;
+    }
+    psStats->uliTotalUs += uiDurationUs;
+    psStats->uiCount++;
+}
+
+
+
 static float Compute_RmsVolts(const int32_t *piAcCounts, int iCount, adc_atten_t eAtten)
 {
     // Computes RMS value from zero-centered ADC counts
@@ -133,6 +241,61 @@ static float Compute_RmsVolts(const int32_t *piAcCounts, int iCount, adc_atten_t
 
 
 
+static void Adc_BeginAcquisition(bool bHoldOffHttp)
+{
+    // Takes the capture mutex and marks an acquisition as in progress
+    // Clears the idle bit when deferred HTTP work should wait for the window to close
+    // Must be paired with Adc_EndAcquisition on every path
+
+    xSemaphoreTake(gsAdcCaptureMutex, portMAX_DELAY);
+    if (bHoldOffHttp) {
+        xEventGroupClearBits(gsAcquireEvents, iAdcIdleBit);
+    }
+}
+
+
+
+static void Adc_EndAcquisition(void)
+{
+    // Marks the acquisition as finished and releases the capture mutex
+    // Wakes every task waiting in Adc_WaitAcquisitionIdle
+    // Called once per Adc_BeginAcquisition
+
+    xEventGroupSetBits(gsAcquireEvents, iAdcIdleBit);
+    xSemaphoreGive(gsAdcCaptureMutex);
+}
+
+
+
+static bool Capture_ReadPair(uint16_t *puChA, uint16_t *puChB)
+{
+    // Reads CH_A then CH_B once from ADC1
+    // Logs the failing channel so capture loops can simply abort
+    // Returns false if either read fails
+
+    // Read CH_A from ADC1
+    int iRawChA = 0;
+    esp_err_t eErrA = adc_oneshot_read(gsAdcHandleUnit1, iChA_AdcChannel, &iRawChA);
+    if (eErrA != ESP_OK) {
+        ESP_LOGE(gTag, "adc_oneshot_read CH_A failed: %s", esp_err_to_name(eErrA));
+        return false;
+    }
+
+    // Read CH_B from ADC1
+    int iRawChB = 0;
+    esp_err_t eErrB = adc_oneshot_read(gsAdcHandleUnit1, iChB_AdcChannel, &iRawChB);
+    if (eErrB != ESP_OK) {
+        ESP_LOGE(gTag, "adc_oneshot_read CH_B failed: %s", esp_err_to_name(eErrB));
+        return false;
+    }
+
+    *puChA = (uint16_t)iRawChA;
+    *puChB = (uint16_t)iRawChB;
+    return true;
+}
+
+
+
 static bool Capture_PairedSamples(uint16_t *puChA, uint16_t *puChB, int iCount)
 {
     // Captures paired samples from ADC1 channels with a fixed time base
@@ -155,28 +318,55 @@ static bool Capture_PairedSamples(uint16_t *puChA, uint16_t *puChB, int iCount)
             esp_rom_delay_us((uint32_t)(liNextSampleTimeUs - liNowUs));
         }
 
-        // Read CH_A from ADC1
-        int iRawChA = 0;
-        esp_err_t eErrA = adc_oneshot_read(gsAdcHandleUnit1, iChA_AdcChannel, &iRawChA);
-        if (eErrA != ESP_OK) {
-            ESP_LOGE(gTag, "adc_oneshot_read CH_A failed: %s", esp_err_to_name(eErrA));
+        // Read and store the paired samples
+        if (!Capture_ReadPair(&puChA[iSampleIndex], &puChB[iSampleIndex])) {
             return false;
         }
 
-        // Read CH_B from ADC1
-        int iRawChB = 0;
-        esp_err_t eErrB = adc_oneshot_read(gsAdcHandleUnit1, iChB_AdcChannel, &iRawChB);
-        if (eErrB != ESP_OK) {
-            ESP_LOGE(gTag, "adc_oneshot_read CH_B failed: %s", esp_err_to_name(eErrB));
+        // Advance to the next index and time slot
+        iSampleIndex++;
+        liNextSampleTimeUs += liSamplePeriodUs;
+    }
+
+    return true;
+}
+
+
+
+static bool Capture_TriggeredSamples(uint16_t *puRingA, uint16_t *puRingB, const uint16_t *puTriggerRing,
+                                     capture_trigger_t *psTrigger, int64_t *pliTriggerUsOut)
+{
+    // Samples into ring buffers at the fixed time base and tests the trigger on every new sample
+    // Detection and ring indexing live in capture_trigger.c; this loop only owns the ADC and the clock
+    // Stops once the detector reports a complete window
+
+    const int64_t liSamplePeriodUs = (1000000LL / (int64_t)iPerChSampleRate_Hz);
+
+    bool bDone = false;
+    int64_t liNextSampleTimeUs = esp_timer_get_time();
+
+    *pliTriggerUsOut = 0;
+
+    while (!bDone) {
+
+        // Wait until the next scheduled sample time
+        int64_t liNowUs = esp_timer_get_time();
+        if (liNowUs < liNextSampleTimeUs) {
+            esp_rom_delay_us((uint32_t)(liNextSampleTimeUs - liNowUs));
+            liNowUs = liNextSampleTimeUs;
+        }
+
+        int iSlot = CaptureTrigger_NextSlot(psTrigger);
+        if (!Capture_ReadPair(&puRingA[iSlot], &puRingB[iSlot])) {
             return false;
         }
 
-        // Store paired samples
-        puChA[iSampleIndex] = (uint16_t)iRawChA;
-        puChB[iSampleIndex] = (uint16_t)iRawChB;
+        // Evaluate the edge on the sample just read and stamp the trigger as soon as it fires
+        bDone = CaptureTrigger_Push(psTrigger, (int32_t)puTriggerRing[iSlot], liNowUs);
+        if (psTrigger->bTriggered && *pliTriggerUsOut == 0) {
+            *pliTriggerUsOut = esp_timer_get_time();
+        }
 
-        // Advance to the next index and time slot
-        iSampleIndex++;
         liNextSampleTimeUs += liSamplePeriodUs;
     }
 
@@ -185,6 +375,24 @@ static bool Capture_PairedSamples(uint16_t *puChA, uint16_t *puChB, int iCount)
 
 
 
+static void Process_RawToMilliVolts(const uint16_t *puRawChA, const uint16_t *puRawChB, int iCount,
+                                    adc_atten_t eAttenA, adc_atten_t eAttenB,
+                                    int16_t *piChannelA_mV, int16_t *piChannelB_mV)
+{
+    // Applies the same filtering, DC removal and mV conversion as Adc_MeasureNow
+    // Works in the shared scratch buffers, so the capture mutex must be held
+    // Leaves cached results untouched
+
+    Moving_Average_Filter(puRawChA, gauScratchFiltChA, iCount);
+    Moving_Average_Filter(puRawChB, gauScratchFiltChB, iCount);
+    (void)Dc_Remove(gauScratchFiltChA, gaiScratchAcCountsChA, iCount);
+    (void)Dc_Remove(gauScratchFiltChB, gaiScratchAcCountsChB, iCount);
+    Convert_AcCountsToMilliVolts(gaiScratchAcCountsChA, piChannelA_mV, iCount, eAttenA);
+    Convert_AcCountsToMilliVolts(gaiScratchAcCountsChB, piChannelB_mV, iCount, eAttenB);
+}
+
+
+
 static adc_atten_t Step_AttenuationMoreSensitive(adc_atten_t eCurrent)
 {
     // Steps attenuation one level toward more sensitivity
@@ -305,6 +513,31 @@ esp_err_t Adc_Init(void)
         return ESP_ERR_NO_MEM;
     }
 
+    // Create the mutex that orders publishing and late hook registration
+    if (gsPublishMutex == NULL) {
+        gsPublishMutex = xSemaphoreCreateMutex();
+    }
+    if (gsPublishMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Create capture mutex guarding the ADC hardware
+    if (gsAdcCaptureMutex == NULL) {
+        gsAdcCaptureMutex = xSemaphoreCreateMutex();
+    }
+    if (gsAdcCaptureMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Create the acquisition state flags, idle until the first capture
+    if (gsAcquireEvents == NULL) {
+        gsAcquireEvents = xEventGroupCreate();
+    }
+    if (gsAcquireEvents == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    xEventGroupSetBits(gsAcquireEvents, iAdcIdleBit);
+
     // Create ADC oneshot unit
     adc_oneshot_unit_init_cfg_t sInitCfg = {
         .unit_id = ADC_UNIT_1
@@ -325,6 +558,50 @@ esp_err_t Adc_Init(void)
 
 
 
+esp_err_t Adc_RegisterPublishHook(adc_publish_hook_t pfnHook, void *pvCtx)
+{
+    // Registers a callback invoked each time a new measurement is published
+    // Lets caches and push transports render once per result instead of per request
+    // Replays the latest result to a hook registered after the first measurement
+
+    // Validate arguments and module state
+    if (pfnHook == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gsAdcMutex == NULL || gsPublishMutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Hold off publishing so the replay cannot overtake a newer result
+    xSemaphoreTake(gsPublishMutex, portMAX_DELAY);
+
+    // Append hook under mutex so publishers see a consistent count
+    esp_err_t eErr = ESP_OK;
+    bool bReplay = false;
+    adc_result_t sLatest;
+    xSemaphoreTake(gsAdcMutex, portMAX_DELAY);
+    if (giPublishHookCount < iAdcMaxPublishHooks) {
+        gasPublishHooks[giPublishHookCount].pfnHook = pfnHook;
+        gasPublishHooks[giPublishHookCount].pvCtx = pvCtx;
+        giPublishHookCount++;
+        bReplay = gbHasLatest;
+        sLatest = gsLatestResult;
+    } else {
+        eErr = ESP_ERR_NO_MEM;
+    }
+    xSemaphoreGive(gsAdcMutex);
+
+    // Subsystems started in parallel with the first capture still see its result
+    if (bReplay) {
+        pfnHook(&sLatest, pvCtx);
+    }
+
+    xSemaphoreGive(gsPublishMutex);
+    return eErr;
+}
+
+
+
 esp_err_t Adc_MeasureNow(void)
 {
     // Captures one window, computes RMS, and caches last waveform in volts
@@ -332,10 +609,17 @@ esp_err_t Adc_MeasureNow(void)
     // Stores results under mutex so API reads are consistent
 
     // Validate initialization state
-    if (gsAdcHandleUnit1 == NULL || gsAdcMutex == NULL) {
+    if (gsAdcHandleUnit1 == NULL || gsAdcMutex == NULL || gsAdcCaptureMutex == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
 
+    // Own the ADC hardware for auto-ranging, capture and processing
+    Adc_BeginAcquisition(true);
+
+    // Stage boundaries for timing statistics
+    int64_t aliStageUs[ADC_STAGE_COUNT];
+    int64_t liStageStartUs = esp_timer_get_time();
+
     // Choose attenuations using auto-ranging
     adc_atten_t eChosenAttenA = ADC_ATTEN_DB_12;
     adc_atten_t eChosenAttenB = ADC_ATTEN_DB_12;
@@ -346,54 +630,55 @@ esp_err_t Adc_MeasureNow(void)
     adc_oneshot_chan_cfg_t sChanCfgB = { .atten = eChosenAttenB, .bitwidth = ADC_BITWIDTH_12 };
     ESP_ERROR_CHECK(adc_oneshot_config_channel(gsAdcHandleUnit1, iChA_AdcChannel, &sChanCfgA));
     ESP_ERROR_CHECK(adc_oneshot_config_channel(gsAdcHandleUnit1, iChB_AdcChannel, &sChanCfgB));
+    geConfiguredAttenChA = eChosenAttenA;
+    geConfiguredAttenChB = eChosenAttenB;
+    aliStageUs[ADC_STAGE_AUTORANGE] = esp_timer_get_time() - liStageStartUs;
 
     // Capture paired raw samples
+    liStageStartUs = esp_timer_get_time();
     static uint16_t auRawChA[iSamples_PerCh];
     static uint16_t auRawChB[iSamples_PerCh];
     if (!Capture_PairedSamples(auRawChA, auRawChB, iSamples_PerCh)) {
+        Adc_EndAcquisition();
         return ESP_FAIL;
     }
+    aliStageUs[ADC_STAGE_CAPTURE] = esp_timer_get_time() - liStageStartUs;
 
     // Filter raw samples for stable waveform and RMS
+    liStageStartUs = esp_timer_get_time();
     static uint16_t auFiltChA[iSamples_PerCh];
     static uint16_t auFiltChB[iSamples_PerCh];
     Moving_Average_Filter(auRawChA, auFiltChA, iSamples_PerCh);
     Moving_Average_Filter(auRawChB, auFiltChB, iSamples_PerCh);
+    aliStageUs[ADC_STAGE_FILTER] = esp_timer_get_time() - liStageStartUs;
 
     // Remove DC component per channel to get AC counts around 0
+    liStageStartUs = esp_timer_get_time();
     static int32_t aiAcCountsChA[iSamples_PerCh];
     static int32_t aiAcCountsChB[iSamples_PerCh];
-    Dc_Remove(auFiltChA, aiAcCountsChA, iSamples_PerCh);
-    Dc_Remove(auFiltChB, aiAcCountsChB, iSamples_PerCh);
+    gfDcCountsChA = Dc_Remove(auFiltChA, aiAcCountsChA, iSamples_PerCh);
+    gfDcCountsChB = Dc_Remove(auFiltChB, aiAcCountsChB, iSamples_PerCh);
+    gbHasDcCounts = true;
+    aliStageUs[ADC_STAGE_DC_REMOVE] = esp_timer_get_time() - liStageStartUs;
 
     // Compute RMS values in volts from DC-removed waveform
+    liStageStartUs = esp_timer_get_time();
     float fRmsA = Compute_RmsVolts(aiAcCountsChA, iSamples_PerCh, eChosenAttenA);
     float fRmsB = Compute_RmsVolts(aiAcCountsChB, iSamples_PerCh, eChosenAttenB);
+    aliStageUs[ADC_STAGE_RMS] = esp_timer_get_time() - liStageStartUs;
 
     // Convert AC counts to signed millivolts for caching and plotting
+    liStageStartUs = esp_timer_get_time();
     static int16_t aiAcMilliVoltsChA[iSamples_PerCh];
     static int16_t aiAcMilliVoltsChB[iSamples_PerCh];
-
-    for (int iIndex = 0; iIndex < iSamples_PerCh; iIndex++) {
-
-        float fVoltsA = Adc_CountsToVolts(eChosenAttenA, aiAcCountsChA[iIndex]);
-        float fVoltsB = Adc_CountsToVolts(eChosenAttenB, aiAcCountsChB[iIndex]);
-
-        int32_t iMilliVoltsA = (int32_t)lroundf(fVoltsA * 1000.0f);
-        int32_t iMilliVoltsB = (int32_t)lroundf(fVoltsB * 1000.0f);
-
-        if (iMilliVoltsA > INT16_MAX) iMilliVoltsA = INT16_MAX;
-        if (iMilliVoltsA < INT16_MIN) iMilliVoltsA = INT16_MIN;
-        if (iMilliVoltsB > INT16_MAX) iMilliVoltsB = INT16_MAX;
-        if (iMilliVoltsB < INT16_MIN) iMilliVoltsB = INT16_MIN;
-
-        aiAcMilliVoltsChA[iIndex] = (int16_t)iMilliVoltsA;
-        aiAcMilliVoltsChB[iIndex] = (int16_t)iMilliVoltsB;
-    }
+    Convert_AcCountsToMilliVolts(aiAcCountsChA, aiAcMilliVoltsChA, iSamples_PerCh, eChosenAttenA);
+    Convert_AcCountsToMilliVolts(aiAcCountsChB, aiAcMilliVoltsChB, iSamples_PerCh, eChosenAttenB);
+    aliStageUs[ADC_STAGE_CONVERT] = esp_timer_get_time() - liStageStartUs;
 
     // Store latest results and last waveform atomically
     int64_t liNowTimestampUs = esp_timer_get_time();
 
+    xSemaphoreTake(gsPublishMutex, portMAX_DELAY);
     xSemaphoreTake(gsAdcMutex, portMAX_DELAY);
 
     gsLatestResult.fRmsVoltsChA = fRmsA;
@@ -412,6 +697,26 @@ esp_err_t Adc_MeasureNow(void)
     geLastSamplesAttenChB = eChosenAttenB;
     gbHasLastSamples = true;
 
+    for (int iStage = 0; iStage < ADC_STAGE_PUBLISH; iStage++) {
+        Adc_RecordStageLocked((adc_stage_t)iStage, aliStageUs[iStage]);
+    }
+
+    adc_result_t sPublished = gsLatestResult;
+    int iHookCount = giPublishHookCount;
+
+    xSemaphoreGive(gsAdcMutex);
+    Adc_EndAcquisition();
+
+    // Notify consumers outside the mutex so slow hooks never block API reads
+    liStageStartUs = esp_timer_get_time();
+    for (int iIndex = 0; iIndex < iHookCount; iIndex++) {
+        gasPublishHooks[iIndex].pfnHook(&sPublished, gasPublishHooks[iIndex].pvCtx);
+    }
+    int64_t liPublishUs = esp_timer_get_time() - liStageStartUs;
+    xSemaphoreGive(gsPublishMutex);
+
+    xSemaphoreTake(gsAdcMutex, portMAX_DELAY);
+    Adc_RecordStageLocked(ADC_STAGE_PUBLISH, liPublishUs);
     xSemaphoreGive(gsAdcMutex);
 
     ESP_LOGI(gTag, "RMS A=%.6f V, B=%.6f V (atten %d,%d)", fRmsA, fRmsB, (int)eChosenAttenA, (int)eChosenAttenB);
@@ -420,6 +725,126 @@ esp_err_t Adc_MeasureNow(void)
 
 
 
+esp_err_t Adc_CaptureWindowMilliVolts(int16_t *piChannelA_mV, int16_t *piChannelB_mV, int iCount,
+                                      int64_t *pliTimestampUs)
+{
+    // Captures one extra window with the attenuations chosen by the last measurement
+    // Applies the same filtering, DC removal and mV conversion as Adc_MeasureNow
+    // Leaves cached results untouched so streaming never disturbs the API snapshot
+
+    // Validate arguments and module state
+    if (piChannelA_mV == NULL || piChannelB_mV == NULL || iCount <= 0 || iCount > iSamples_PerCh) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gsAdcHandleUnit1 == NULL || gsAdcCaptureMutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Streaming windows only feed live plots, so HTTP work is not held off for them;
+    // a continuous stream would otherwise stall every deferred response
+    Adc_BeginAcquisition(false);
+
+    // Capture with the currently configured attenuations
+    adc_atten_t eAttenA = geConfiguredAttenChA;
+    adc_atten_t eAttenB = geConfiguredAttenChB;
+    if (!Capture_PairedSamples(gauScratchRawChA, gauScratchRawChB, iCount)) {
+        Adc_EndAcquisition();
+        return ESP_FAIL;
+    }
+    int64_t liCaptureTimestampUs = esp_timer_get_time();
+
+    // Filter, remove DC and convert to millivolts
+    Process_RawToMilliVolts(gauScratchRawChA, gauScratchRawChB, iCount, eAttenA, eAttenB,
+                            piChannelA_mV, piChannelB_mV);
+
+    Adc_EndAcquisition();
+
+    if (pliTimestampUs != NULL) {
+        *pliTimestampUs = liCaptureTimestampUs;
+    }
+    return ESP_OK;
+}
+
+
+
+esp_err_t Adc_CaptureTriggered(const adc_trigger_t *psTrigger, int16_t *piChannelA_mV, int16_t *piChannelB_mV,
+                               int iCount, adc_capture_info_t *psInfoOut)
+{
+    // Captures one window whose trigger sample sits at the requested pre-trigger position
+    // Places the level on the DC bias of the last measurement and tests raw samples as they arrive
+    // Returns a free-running window with bTriggered false when no edge arrives before the timeout
+
+    // Validate arguments and module state
+    if (psTrigger == NULL || piChannelA_mV == NULL || piChannelB_mV == NULL || psInfoOut == NULL ||
+        iCount <= 1 || iCount > iSamples_PerCh || psTrigger->iChannel < 0 || psTrigger->iChannel > 1 ||
+        psTrigger->iPreTriggerPercent < 0 || psTrigger->iPreTriggerPercent > 100) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gsAdcHandleUnit1 == NULL || gsAdcCaptureMutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t uiTimeoutMs = psTrigger->uiTimeoutMs;
+    if (uiTimeoutMs > iCaptureMaxTimeoutMs) {
+        uiTimeoutMs = iCaptureMaxTimeoutMs;
+    }
+
+    Adc_BeginAcquisition(true);
+
+    adc_atten_t eAttenA = geConfiguredAttenChA;
+    adc_atten_t eAttenB = geConfiguredAttenChB;
+
+    // Before the first measurement, learn the DC bias from one free-running window
+    if (!gbHasDcCounts) {
+        if (!Capture_PairedSamples(gauScratchRawChA, gauScratchRawChB, iCount)) {
+            Adc_EndAcquisition();
+            return ESP_FAIL;
+        }
+        gfDcCountsChA = Dc_Remove(gauScratchRawChA, gaiScratchAcCountsChA, iCount);
+        gfDcCountsChB = Dc_Remove(gauScratchRawChB, gaiScratchAcCountsChB, iCount);
+        gbHasDcCounts = true;
+    }
+
+    // Translate the AC level and hysteresis to raw counts on the trigger channel
+    bool bChannelB = (psTrigger->iChannel == 1);
+    adc_atten_t eTriggerAtten = bChannelB ? eAttenB : eAttenA;
+    float fDcCounts = bChannelB ? gfDcCountsChB : gfDcCountsChA;
+    int32_t iLevelCounts = (int32_t)lroundf(fDcCounts) + Adc_MilliVoltsToCounts(eTriggerAtten, psTrigger->iLevel_mV);
+    int32_t iHysteresisCounts = Adc_MilliVoltsToCounts(eTriggerAtten, iCaptureHysteresis_mV);
+    int iPreSamples = CaptureTrigger_PreSamples(iCount, psTrigger->iPreTriggerPercent);
+
+    // Sample into the filter buffers as rings; they are free until processing
+    capture_trigger_t sDetector;
+    CaptureTrigger_Init(&sDetector, iCount, iPreSamples, iLevelCounts, iHysteresisCounts,
+                        psTrigger->eEdge == ADC_TRIGGER_EDGE_RISING,
+                        esp_timer_get_time() + (int64_t)uiTimeoutMs * 1000LL);
+    int64_t liTriggerUs = 0;
+    if (!Capture_TriggeredSamples(gauScratchFiltChA, gauScratchFiltChB,
+                                  bChannelB ? gauScratchFiltChB : gauScratchFiltChA, &sDetector, &liTriggerUs)) {
+        Adc_EndAcquisition();
+        return ESP_FAIL;
+    }
+    int64_t liCaptureTimestampUs = esp_timer_get_time();
+
+    // Put the rings in time order, then filter, remove DC and convert like every other window
+    CaptureTrigger_Linearize(gauScratchFiltChA, gauScratchRawChA, iCount, sDetector.iStart);
+    CaptureTrigger_Linearize(gauScratchFiltChB, gauScratchRawChB, iCount, sDetector.iStart);
+    Process_RawToMilliVolts(gauScratchRawChA, gauScratchRawChB, iCount, eAttenA, eAttenB,
+                            piChannelA_mV, piChannelB_mV);
+
+    Adc_EndAcquisition();
+
+    psInfoOut->bTriggered = sDetector.bTriggered;
+    psInfoOut->iTriggerIndex = psInfoOut->bTriggered ? iPreSamples : -1;
+    psInfoOut->liTimestampUs = liCaptureTimestampUs;
+    psInfoOut->liTriggerUs = liTriggerUs;
+    psInfoOut->eAttenChA = eAttenA;
+    psInfoOut->eAttenChB = eAttenB;
+    return ESP_OK;
+}
+
+
+
 bool Adc_GetLatest(adc_result_t *psResultOut)
 {
     // Copies latest ADC result into caller buffer safely
@@ -496,3 +921,116 @@ bool Adc_GetLastSamplesMilliVolts(int16_t *piChannelA_mV, int16_t *piChannelB_mV
 
     return (bHasValue && iCopyCount > 0);
 }
+
+
+
+bool Adc_GetLastSamplesTimestamp(int64_t *pliTimestampUs)
+{
+    // Reads the capture timestamp of the cached waveform without copying samples
+    // Lets HTTP handlers answer revalidation requests cheaply
+    // Returns false if no waveform has been captured yet
+
+    // Validate module state
+    if (pliTimestampUs == NULL || gsAdcMutex == NULL) {
+        return false;
+    }
+
+    // Read timestamp under mutex
+    xSemaphoreTake(gsAdcMutex, portMAX_DELAY);
+    bool bHasValue = gbHasLastSamples;
+    if (bHasValue) {
+        *pliTimestampUs = gliLastSamplesTimestampUs;
+    }
+    xSemaphoreGive(gsAdcMutex);
+
+    return bHasValue;
+}
+
+
+
+bool Adc_GetSnapshot(adc_snapshot_t *psSnapshotOut, int16_t *piChannelA_mV, int16_t *piChannelB_mV,
+                     int iMaxSamples)
+{
+    // Copies the latest result and its waveform in a single mutex acquisition
+    // Guarantees that RMS values and samples belong to the same measurement
+    // Skips the waveform copy when either channel pointer is NULL
+
+    // Validate arguments and module state
+    if (psSnapshotOut == NULL || gsAdcMutex == NULL) {
+        return false;
+    }
+    bool bCopySamples = (piChannelA_mV != NULL && piChannelB_mV != NULL && iMaxSamples > 0);
+
+    memset(psSnapshotOut, 0, sizeof(*psSnapshotOut));
+
+    // Copy everything under one lock
+    xSemaphoreTake(gsAdcMutex, portMAX_DELAY);
+
+    psSnapshotOut->bHasResult = gbHasLatest;
+    if (gbHasLatest) {
+        psSnapshotOut->sResult = gsLatestResult;
+    }
+
+    psSnapshotOut->bHasSamples = gbHasLastSamples;
+    psSnapshotOut->liSamplesTimestampUs = gliLastSamplesTimestampUs;
+    if (gbHasLastSamples && bCopySamples) {
+        int iCopyCount = (giLastSamplesCount < iMaxSamples) ? giLastSamplesCount : iMaxSamples;
+        memcpy(piChannelA_mV, gaiLastAcMilliVoltsChA, (size_t)iCopyCount * sizeof(int16_t));
+        memcpy(piChannelB_mV, gaiLastAcMilliVoltsChB, (size_t)iCopyCount * sizeof(int16_t));
+        psSnapshotOut->iSamples = iCopyCount;
+    }
+
+    xSemaphoreGive(gsAdcMutex);
+
+    return true;
+}
+
+
+
+bool Adc_GetStageStats(adc_stage_stats_t *pasStatsOut)
+{
+    // Copies the timing statistics of every Adc_MeasureNow stage
+    // Expects an array of ADC_STAGE_COUNT entries indexed by adc_stage_t
+    // Returns false before initialization
+
+    if (pasStatsOut == NULL || gsAdcMutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(gsAdcMutex, portMAX_DELAY);
+    memcpy(pasStatsOut, gasStageStats, sizeof(gasStageStats));
+    xSemaphoreGive(gsAdcMutex);
+
+    return true;
+}
+
+
+
+const char *Adc_GetStageName(adc_stage_t eStage)
+{
+    // Returns a short lowercase name for one measurement stage
+    // Used as a label value by diagnostics and metrics output
+    // Returns "unknown" for out-of-range values
+
+    if ((int)eStage < 0 || eStage >= ADC_STAGE_COUNT) {
+        return "unknown";
+    }
+    return gasStageNames[eStage];
+}
+
+
+
+bool Adc_WaitAcquisitionIdle(uint32_t uiTimeoutMs)
+{
+    // Blocks until no capture window is open or the timeout expires
+    // Lets heavy network work start in the gap between acquisitions
+    // Returns true when the ADC is idle, false on timeout or before Adc_Init
+
+    if (gsAcquireEvents == NULL) {
+        return false;
+    }
+
+    EventBits_t uiBits = xEventGroupWaitBits(gsAcquireEvents, iAdcIdleBit, pdFALSE, pdTRUE,
+                                             pdMS_TO_TICKS(uiTimeoutMs));
+    return (uiBits & iAdcIdleBit) != 0;
+}
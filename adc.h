@@ -19,15 +19,108 @@ typedef struct
     int iSamplesPerChannel;
 } adc_result_t;
 
+// Result and waveform metadata copied together under one lock
+typedef struct
+{
+    bool bHasResult;
+    adc_result_t sResult;
+    bool bHasSamples;
+    int iSamples;
+    int64_t liSamplesTimestampUs;
+} adc_snapshot_t;
+
+// Processing stages of Adc_MeasureNow, timed on every measurement
+typedef enum
+{
+    ADC_STAGE_AUTORANGE = 0,
+    ADC_STAGE_CAPTURE,
+    ADC_STAGE_FILTER,
+    ADC_STAGE_DC_REMOVE,
+    ADC_STAGE_RMS,
+    ADC_STAGE_CONVERT,
+    ADC_STAGE_PUBLISH,
+    ADC_STAGE_COUNT
+} adc_stage_t;
+
+typedef struct
+{
+    uint32_t uiLastUs;
+    uint32_t uiMaxUs;
+    uint64_t uliTotalUs;
+    uint32_t uiCount;
+} adc_stage_stats_t;
+
+// Edge trigger for Adc_CaptureTriggered; the level is relative to the AC (DC-removed) waveform
+typedef enum
+{
+    ADC_TRIGGER_EDGE_RISING = 0,
+    ADC_TRIGGER_EDGE_FALLING
+} adc_trigger_edge_t;
+
+typedef struct
+{
+    int iChannel;                   // 0 = CH_A, 1 = CH_B
+    int iLevel_mV;
+    adc_trigger_edge_t eEdge;
+    int iPreTriggerPercent;         // Share of the window placed before the trigger sample
+    uint32_t uiTimeoutMs;           // Free-running window is returned when no edge arrives in time
+} adc_trigger_t;
+
+typedef struct
+{
+    bool bTriggered;
+    int iTriggerIndex;              // Trigger sample within the window, -1 when not triggered
+    int64_t liTimestampUs;          // End of the window, like the cached waveform timestamp
+    int64_t liTriggerUs;            // Time of the trigger sample, 0 when not triggered
+    adc_atten_t eAttenChA;
+    adc_atten_t eAttenChB;
+} adc_capture_info_t;
+
+// Called after each published measurement, outside the ADC mutex; calls never overlap
+// and arrive in measurement order. A hook registered late first gets the latest result.
+typedef void (*adc_publish_hook_t)(const adc_result_t *psResult, void *pvCtx);
+
 esp_err_t Adc_Init(void);
 
 
+esp_err_t Adc_RegisterPublishHook(adc_publish_hook_t pfnHook, void *pvCtx);
+
+
 esp_err_t Adc_MeasureNow(void);
 
 
+// Captures one additional filtered AC window (mV) for streaming without updating caches
+esp_err_t Adc_CaptureWindowMilliVolts(int16_t *piChannelA_mV, int16_t *piChannelB_mV, int iCount,
+                                      int64_t *pliTimestampUs);
+
+
+// Captures one window aligned on an edge; the trigger is tested on each sample as it is read
+esp_err_t Adc_CaptureTriggered(const adc_trigger_t *psTrigger, int16_t *piChannelA_mV, int16_t *piChannelB_mV,
+                               int iCount, adc_capture_info_t *psInfoOut);
+
+
 bool Adc_GetLatest(adc_result_t *psResultOut);
 
 
 bool Adc_GetLastSamplesMilliVolts(int16_t *piChannelA_mV, int16_t *piChannelB_mV, int iMaxSamples,
                                   int *piSamplesReturned, int64_t *pliTimestampUs,
                                   adc_atten_t *peAttenChannelA, adc_atten_t *peAttenChannelB);
+
+
+bool Adc_GetLastSamplesTimestamp(int64_t *pliTimestampUs);
+
+
+// Copies result and waveform atomically; waveform pointers may be NULL to skip samples
+bool Adc_GetSnapshot(adc_snapshot_t *psSnapshotOut, int16_t *piChannelA_mV, int16_t *piChannelB_mV,
+                     int iMaxSamples);
+
+
+// Copies ADC_STAGE_COUNT timing entries indexed by adc_stage_t
+bool Adc_GetStageStats(adc_stage_stats_t *pasStatsOut);
+
+
+const char *Adc_GetStageName(adc_stage_t eStage);
+
+
+// Waits until no capture window is open; returns false if the timeout expired first
+bool Adc_WaitAcquisitionIdle(uint32_t uiTimeoutMs);
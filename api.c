@@ -4,9 +4,8 @@
 
 #include "api.h"
 
+#include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
-#include <inttypes.h>
 
 #include "esp_log.h"
 #include "esp_http_server.h"
@@ -14,7 +13,15 @@
 
 #include "adc.h"
 #include "wifi_mgr.h"
+#include "json_writer.h"
 #include "proto.h"
+#include "rms_cache.h"
+#include "long_poll.h"
+#include "envelope.h"
+#include "history.h"
+#include "http_workers.h"
+#include "rate_limit.h"
+#include "web_assets.h"
 #include "app_config.h"
 
 static const char *gTag = "API";
@@ -22,409 +29,412 @@ static httpd_handle_t gsHttpServer = NULL;
 
 
 
-static esp_err_t Api_HandleRoot(httpd_req_t *psReq)
+static bool Api_SendChunk(void *pvCtx, const char *psData, size_t szLen)
+{
+    // Forwards one block from the JSON writer as an HTTP chunk
+    // Skips empty blocks since a zero-length chunk ends the response
+    // Returns false so the writer stops producing output after socket errors
+
+    httpd_req_t *psReq = (httpd_req_t *)pvCtx;
+
+    if (szLen == 0) {
+        return true;
+    }
+
+    return (httpd_resp_send_chunk(psReq, psData, (ssize_t)szLen) == ESP_OK);
+}
+
+
+
+static bool Api_GetQueryValue(httpd_req_t *psReq, const char *sKey, char *psOut, size_t szOut)
 {
-    // Serves a responsive dashboard page with RMS values and waveform plot
-    // Plots DC-removed samples in volts so both channels oscillate around 0 V
-    // Uses DPR-aware canvas rendering for readable text on phones
-
-    // Build a responsive single-page UI
-    const char *sHtml =
-        "<!doctype html><html><head>"
-        "<meta name='viewport' contenttext/html; charset=utf-8' content='width=device-width,initial-scale=1'>"
-        "<meta charset='utf-8'>"
-        "<title>ADC Node</title>"
-        "<style>"
-        "html,body{height:100%;margin:0;font-family:system-ui,-apple-system,Segoe UI,Roboto,sans-serif;}"
-        "body{background:radial-gradient(circle at 30% 10%,#172033,#0b0f16);color:#e9edf5;}"
-        ".wrap{max-width:760px;margin:0 auto;padding:24px 16px;}"
-        "h1{margin:6px 0 18px;font-size:clamp(22px,4vw,34px);letter-spacing:.2px;}"
-        ".card{background:rgba(13,18,28,.75);border:1px solid rgba(255,255,255,.08);"
-        "border-radius:16px;padding:18px 18px;box-shadow:0 12px 40px rgba(0,0,0,.35);}"
-        ".grid{display:grid;grid-template-columns:1fr 1fr;gap:18px;}"
-        ".k{opacity:.75;font-size:clamp(12px,2.2vw,14px);text-transform:uppercase;letter-spacing:.12em;}"
-        ".v{margin-top:6px;font-size:clamp(26px,6vw,42px);font-weight:700;}"
-        ".u{margin-top:10px;opacity:.8;font-size:clamp(12px,2.4vw,14px);}"
-        ".row{display:flex;gap:12px;flex-wrap:wrap;align-items:center;justify-content:space-between;}"
-        ".btn{appearance:none;border:1px solid rgba(255,255,255,.14);background:rgba(255,255,255,.06);"
-        "color:#e9edf5;border-radius:12px;padding:10px 12px;font-weight:600;cursor:pointer;}"
-        ".btn:active{transform:translateY(1px);}"
-        "a{color:#b7d3ff;text-decoration:none;}a:hover{text-decoration:underline;}"
-        "code{background:rgba(255,255,255,.06);padding:2px 6px;border-radius:8px;}"
-        ".chartWrap{margin-top:12px;height:clamp(220px,35vh,360px);}"
-        "canvas{width:100%;height:100%;display:block;border-radius:14px;"
-        "background:rgba(8,12,18,.55);border:1px solid rgba(255,255,255,.08);}"
-        "</style></head><body><div class='wrap'>"
-        "<h1>ADC Node</h1>"
-
-        "<div class='card'><div class='grid'>"
-        "<div><div class='k'>RMS A</div><div id='rmsa' class='v'>-</div></div>"
-        "<div><div class='k'>RMS B</div><div id='rmsb' class='v'>-</div></div>"
-        "</div><div id='upd' class='u'>Updated: -</div></div>"
-
-        "<div style='height:16px'></div>"
-
-        "<div class='card'>"
-        "<div class='row'>"
-        "<div>"
-        "<div class='k'>Last ADC Capture (AC)</div>"
-        "<div class='u' id='waveInfo'>-</div>"
-        "</div>"
-        "<button class='btn' id='btnWave' type='button'>Refresh</button>"
-        "</div>"
-        "<div class='chartWrap'><canvas id='waveCanvas' aria-label='Waveform plot' role='img'></canvas></div>"
-        "</div>"
-
-        "<div style='height:16px'></div>"
-
-        "<div class='card'>"
-        "<div class='k'>API</div><div class='u'>"
-        "<a href='/api/rms'><code>/api/rms</code></a> &nbsp;"
-        "<a href='/api/samples'><code>/api/samples</code></a> &nbsp;"
-        "<a href='/api/status'><code>/api/status</code></a> &nbsp;"
-        "<a href='/provision'><code>/provision</code></a>"
-        "</div></div>"
-
-        "</div>"
-        "<script>"
-        "const sIdRmsA=document.getElementById('rmsa');"
-        "const sIdRmsB=document.getElementById('rmsb');"
-        "const sIdUpd=document.getElementById('upd');"
-        "const sIdWaveInfo=document.getElementById('waveInfo');"
-        "const sCanvas=document.getElementById('waveCanvas');"
-        "const sBtnWave=document.getElementById('btnWave');"
-
-        "function Clamp(dVal,dMin,dMax){"
-        "  if(dVal<dMin)return dMin;"
-        "  if(dVal>dMax)return dMax;"
-        "  return dVal;"
-        "}"
-
-        "function GetCanvasDpr(){"
-        "  const dCssWidth=Math.max(1,sCanvas.clientWidth);"
-        "  return sCanvas.width/dCssWidth;"
-        "}"
-
-        "function ResizeCanvasToDisplay(){"
-        "  const dDpr=window.devicePixelRatio||1;"
-        "  const iCssWidth=Math.max(1,Math.floor(sCanvas.clientWidth));"
-        "  const iCssHeight=Math.max(1,Math.floor(sCanvas.clientHeight));"
-        "  const iNewWidth=Math.floor(iCssWidth*dDpr);"
-        "  const iNewHeight=Math.floor(iCssHeight*dDpr);"
-        "  if(sCanvas.width!==iNewWidth||sCanvas.height!==iNewHeight){"
-        "    sCanvas.width=iNewWidth; sCanvas.height=iNewHeight;"
-        "  }"
-        "}"
-
-        "function DrawWaveformVolts(sContext,afVoltsA,afVoltsB){"
-        "  const iWidth=sCanvas.width, iHeight=sCanvas.height;"
-        "  sContext.clearRect(0,0,iWidth,iHeight);"
-
-        "  const dDpr=GetCanvasDpr();"
-        "  const bIsMobile=window.matchMedia('(max-width:520px)').matches;"
-        "  const dFontCss=bIsMobile?14:12;"
-        "  const dFontPx=Math.round(dFontCss*dDpr);"
-        "  const dLineThin=Math.max(1,Math.round(1*dDpr));"
-        "  const dLineBold=Math.max(1,Math.round(2*dDpr));"
-
-        "  const iPadLeft=Math.round(iWidth*0.14);"
-        "  const iPadRight=Math.round(iWidth*0.04);"
-        "  const iPadTop=Math.round(iHeight*0.10);"
-        "  const iPadBottom=Math.round(iHeight*0.20);"
-        "  const iPlotLeft=iPadLeft, iPlotRight=iWidth-iPadRight;"
-        "  const iPlotTop=iPadTop, iPlotBottom=iHeight-iPadBottom;"
-        "  const iPlotWidth=Math.max(1,iPlotRight-iPlotLeft);"
-        "  const iPlotHeight=Math.max(1,iPlotBottom-iPlotTop);"
-
-        "  let dMin=Number.POSITIVE_INFINITY;"
-        "  let dMax=Number.NEGATIVE_INFINITY;"
-        "  for(let iIndex=0;iIndex<afVoltsA.length;iIndex++){"
-        "    const dValA=afVoltsA[iIndex];"
-        "    const dValB=afVoltsB[iIndex];"
-        "    if(dValA<dMin)dMin=dValA; if(dValA>dMax)dMax=dValA;"
-        "    if(dValB<dMin)dMin=dValB; if(dValB>dMax)dMax=dValB;"
-        "  }"
-        "  if(!isFinite(dMin)||!isFinite(dMax)){return;}"
-        "  if(dMax===dMin){dMax=dMin+0.001;}"
-        "  const dRange=dMax-dMin;"
-        "  const dPad=Math.max(0.002,dRange*0.10);"
-        "  let dScaleMin=dMin-dPad;"
-        "  let dScaleMax=dMax+dPad;"
-        "  if(dScaleMin>0.0)dScaleMin=0.0-dPad;"
-        "  if(dScaleMax<0.0)dScaleMax=0.0+dPad;"
-        "  const dScaleRange=dScaleMax-dScaleMin;"
-
-        "  sContext.save();"
-        "  sContext.fillStyle='rgba(255,255,255,.04)';"
-        "  sContext.fillRect(iPlotLeft,iPlotTop,iPlotWidth,iPlotHeight);"
-
-        "  sContext.strokeStyle='rgba(255,255,255,.10)';"
-        "  sContext.lineWidth=dLineThin;"
-        "  const iGridX=5, iGridY=4;"
-        "  for(let iG=0;iG<=iGridX;iG++){"
-        "    const dX=iPlotLeft+(iPlotWidth*iG/iGridX);"
-        "    sContext.beginPath(); sContext.moveTo(dX,iPlotTop); sContext.lineTo(dX,iPlotBottom); sContext.stroke();"
-        "  }"
-        "  for(let iG=0;iG<=iGridY;iG++){"
-        "    const dY=iPlotTop+(iPlotHeight*iG/iGridY);"
-        "    sContext.beginPath(); sContext.moveTo(iPlotLeft,dY); sContext.lineTo(iPlotRight,dY); sContext.stroke();"
-        "  }"
-
-        "  sContext.strokeStyle='rgba(255,255,255,.22)';"
-        "  sContext.lineWidth=dLineThin;"
-        "  sContext.beginPath();"
-        "  sContext.moveTo(iPlotLeft,iPlotTop);"
-        "  sContext.lineTo(iPlotLeft,iPlotBottom);"
-        "  sContext.lineTo(iPlotRight,iPlotBottom);"
-        "  sContext.stroke();"
-
-        "  function MapX(iIndex,iCount){"
-        "    if(iCount<=1)return iPlotLeft;"
-        "    return iPlotLeft+(iPlotWidth*iIndex/(iCount-1));"
-        "  }"
-        "  function MapY(dVal){"
-        "    return iPlotTop + (iPlotHeight*(1-((dVal-dScaleMin)/dScaleRange)));"
-        "  }"
-
-        "  const dZeroY=MapY(0.0);"
-        "  sContext.strokeStyle='rgba(255,255,255,.30)';"
-        "  sContext.lineWidth=dLineThin;"
-        "  sContext.beginPath(); sContext.moveTo(iPlotLeft,dZeroY); sContext.lineTo(iPlotRight,dZeroY); sContext.stroke();"
-
-        "  sContext.fillStyle='rgba(233,237,245,.80)';"
-        "  sContext.font=dFontPx+'px system-ui,-apple-system,Segoe UI,Roboto,sans-serif';"
-        "  sContext.textAlign='right'; sContext.textBaseline='middle';"
-
-        "  const dTopVal=dScaleMax;"
-        "  const dBotVal=dScaleMin;"
-        "  const dTopY=iPlotTop;"
-        "  const dBotY=iPlotBottom;"
-        "  sContext.fillText(dTopVal.toFixed(3), iPlotLeft-10, dTopY);"
-        "  sContext.fillText(dBotVal.toFixed(3), iPlotLeft-10, dBotY);"
-
-        "  const dMinLabelSeparation=Math.max(14*dDpr, dFontPx*1.25);"
-        "  if(Math.abs(dZeroY-dTopY)>dMinLabelSeparation && Math.abs(dZeroY-dBotY)>dMinLabelSeparation){"
-        "    sContext.fillText('0.000', iPlotLeft-10, dZeroY);"
-        "  }"
-
-        "  sContext.textAlign='center'; sContext.textBaseline='top';"
-        "  sContext.fillText('sample index', iPlotLeft+iPlotWidth/2, iPlotBottom+10*dDpr);"
-
-        "  sContext.save();"
-        "  sContext.translate(iPlotLeft-80*dDpr, iPlotTop+iPlotHeight/2);"
-        "  sContext.rotate(-Math.PI/2);"
-        "  sContext.textAlign='center'; sContext.textBaseline='top';"
-        "  sContext.fillText('volts', 0, 0);"
-        "  sContext.restore();"
-
-        "  function DrawSeries(afSeries,sStroke){"
-        "    sContext.strokeStyle=sStroke;"
-        "    sContext.lineWidth=dLineBold;"
-        "    sContext.beginPath();"
-        "    for(let iIndex=0;iIndex<afSeries.length;iIndex++){"
-        "      const dX=MapX(iIndex,afSeries.length);"
-        "      const dY=MapY(afSeries[iIndex]);"
-        "      if(iIndex===0)sContext.moveTo(dX,dY); else sContext.lineTo(dX,dY);"
-        "    }"
-        "    sContext.stroke();"
-        "  }"
-
-        "  DrawSeries(afVoltsA,'rgba(120,200,255,.95)');"
-        "  DrawSeries(afVoltsB,'rgba(255,165,90,.95)');"
-
-        "  sContext.textAlign='left'; sContext.textBaseline='middle';"
-        "  const dLegendX=iPlotLeft+10*dDpr;"
-        "  const dLegendY=iPlotTop+16*dDpr;"
-        "  sContext.fillStyle='rgba(120,200,255,.95)'; sContext.fillRect(dLegendX,dLegendY-7*dDpr,12*dDpr,3*dDpr);"
-        "  sContext.fillStyle='rgba(233,237,245,.82)'; sContext.fillText('Ch A', dLegendX+18*dDpr, dLegendY-6*dDpr);"
-        "  sContext.fillStyle='rgba(255,165,90,.95)'; sContext.fillRect(dLegendX+64*dDpr,dLegendY-7*dDpr,12*dDpr,3*dDpr);"
-        "  sContext.fillStyle='rgba(233,237,245,.82)'; sContext.fillText('Ch B', dLegendX+82*dDpr, dLegendY-6*dDpr);"
-        "  sContext.restore();"
-        "}"
-
-        "async function FetchJson(sUrl){"
-        "  const sResp=await fetch(sUrl,{cache:'no-store'});"
-        "  if(!sResp.ok){throw new Error('HTTP '+sResp.status);}"
-        "  return await sResp.json();"
-        "}"
-
-        "function FormatAgeSeconds(dAgeSec){"
-        "  if(!isFinite(dAgeSec)){return '-';}"
-        "  if(dAgeSec<0.0)dAgeSec=0.0;"
-        "  if(dAgeSec<1.0)return (dAgeSec*1000.0).toFixed(0)+' ms ago';"
-        "  return dAgeSec.toFixed(2)+' s ago';"
-        "}"
-
-        "async function UpdateRms(){"
-        "  const sRms=await FetchJson('/api/rms');"
-        "  if(!sRms||!sRms.hasValue){return;}"
-        "  sIdRmsA.textContent=(sRms.rmsA?sRms.rmsA:0).toFixed(3)+' V';"
-        "  sIdRmsB.textContent=(sRms.rmsB?sRms.rmsB:0).toFixed(3)+' V';"
-        "  sIdUpd.textContent='Updated: '+(new Date()).toLocaleTimeString();"
-        "}"
-
-        "async function UpdateWaveform(){"
-        "  ResizeCanvasToDisplay();"
-        "  const sSamples=await FetchJson('/api/samples');"
-        "  if(!sSamples||!sSamples.hasValue){sIdWaveInfo.textContent='No capture yet';return;}"
-        "  const iCount=sSamples.samples||0;"
-        "  const dAgeSec=(sSamples.serverNowUs && sSamples.timestampUs) ? ((sSamples.serverNowUs-sSamples.timestampUs)/1000000.0) : NaN;"
-        "  sIdWaveInfo.innerHTML='Samples: '+iCount+' &middot; Units: V (AC) &middot; '+FormatAgeSeconds(dAgeSec);"
-        "  const afVoltsA=sSamples.chA.map(iMilliVolts=>iMilliVolts/1000.0);"
-        "  const afVoltsB=sSamples.chB.map(iMilliVolts=>iMilliVolts/1000.0);"
-        "  const sContext=sCanvas.getContext('2d');"
-        "  DrawWaveformVolts(sContext, afVoltsA, afVoltsB);"
-        "}"
-
-        "async function Tick(){"
-        "  try{await UpdateRms();}catch(eVal){}"
-        "  try{await UpdateWaveform();}catch(eVal){}"
-        "}"
-
-        "sBtnWave.addEventListener('click',()=>{UpdateWaveform();});"
-        "window.addEventListener('resize',()=>{UpdateWaveform();});"
-        "Tick();"
-        "setInterval(Tick,1000);"
-        "</script></body></html>";
-
-    // Send HTML response
-    httpd_resp_set_type(psReq, "text/html");
-    httpd_resp_send(psReq, sHtml, HTTPD_RESP_USE_STRLEN);
+    // Reads one query string parameter into a caller buffer
+    // Keeps the query copy on the stack since API queries are short
+    // Returns false when the query or the key is missing
+
+    char sQuery[128];
+
+    if (httpd_req_get_url_query_len(psReq) >= sizeof(sQuery)) {
+        return false;
+    }
+    if (httpd_req_get_url_query_str(psReq, sQuery, sizeof(sQuery)) != ESP_OK) {
+        return false;
+    }
+
+    return (httpd_query_key_value(sQuery, sKey, psOut, szOut) == ESP_OK);
+}
+
+
+
+static bool Api_WantsCbor(httpd_req_t *psReq)
+{
+    // Selects CBOR when the query has fmt=cbor or the Accept header names application/cbor
+    // Keeps JSON as the default so browsers and existing clients are unaffected
+    // Long Accept headers, as browsers send, are not inspected and mean JSON
+
+    char sValue[64];
+
+    if (Api_GetQueryValue(psReq, "fmt", sValue, sizeof(sValue))) {
+        return (strcmp(sValue, "cbor") == 0);
+    }
+    if (httpd_req_get_hdr_value_len(psReq, "Accept") >= sizeof(sValue)) {
+        return false;
+    }
+    if (httpd_req_get_hdr_value_str(psReq, "Accept", sValue, sizeof(sValue)) != ESP_OK) {
+        return false;
+    }
+
+    return (strstr(sValue, "application/cbor") != NULL);
+}
+
+
+
+static esp_err_t Api_SendPayload(httpd_req_t *psReq, const void *pvPayload, size_t szBuffer, int iLen, bool bCbor)
+{
+    // Sends a payload built by a Proto buffer wrapper with the matching media type
+    // Answers 500 when the builder failed or the buffer was too small
+    // iLen is the untruncated wrapper length; the wrapper reserves one byte for its terminator
+
+    if (iLen < 0 || (size_t)iLen >= szBuffer) {
+        httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Encoding failed");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(psReq, bCbor ? "application/cbor" : "application/json");
+    httpd_resp_send(psReq, (const char *)pvPayload, (ssize_t)iLen);
     return ESP_OK;
 }
 
 
 
+static esp_err_t Api_SendNoValue(httpd_req_t *psReq, bool bCbor)
+{
+    // Replies {"hasValue":false} in the requested encoding
+    // Used before the first capture exists
+    // Builds the tiny payload with the writer so both encodings stay in step
+
+    char acPayload[24];
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, acPayload, sizeof(acPayload));
+    JsonWriter_SetEncoding(&sWriter, bCbor ? JSON_WRITER_ENCODING_CBOR : JSON_WRITER_ENCODING_JSON);
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, "hasValue");
+    JsonWriter_Bool(&sWriter, false);
+    JsonWriter_EndObject(&sWriter);
+
+    return Api_SendPayload(psReq, acPayload, sizeof(acPayload), JsonWriter_Finish(&sWriter), bCbor);
+}
+
+
+
+static size_t Api_WriteHex(char *psOut, uint64_t uliValue)
+{
+    // Writes uliValue as lowercase hex without leading zeros or a terminator
+    // Shared by the ETag helpers so no tag needs printf
+    // Returns the number of digits written, at most 16
+
+    static const char acHex[] = "0123456789abcdef";
+    char acDigits[16];
+    size_t szDigits = 0;
+    do {
+        acDigits[szDigits++] = acHex[uliValue & 0x0F];
+        uliValue >>= 4;
+    } while (uliValue != 0 && szDigits < sizeof(acDigits));
+
+    for (size_t szIndex = 0; szIndex < szDigits; szIndex++) {
+        psOut[szIndex] = acDigits[szDigits - 1 - szIndex];
+    }
+    return szDigits;
+}
+
+
+
+static void Api_FormatEtagKind(char *psOut, size_t szOut, char cKind, const uint32_t *pauParts, int iParts)
+{
+    // Builds an ETag kind prefix "<letter><hex>-<hex>-" from request options
+    // Ends every part with '-' so different options can never run together
+    // Leaves out parts that would not fit the output buffer
+
+    size_t szPos = 0;
+    psOut[szPos++] = cKind;
+    for (int iIndex = 0; iIndex < iParts && szPos + 10 <= szOut; iIndex++) {
+        szPos += Api_WriteHex(psOut + szPos, pauParts[iIndex]);
+        psOut[szPos++] = '-';
+    }
+    psOut[szPos] = '\0';
+}
+
+
+
+static void Api_FormatEtag(char *psOut, size_t szOut, const char *sKind, int64_t liTimestampUs)
+{
+    // Builds a weak ETag from the measurement timestamp and a payload kind prefix
+    // Uses hex digits so the tag stays short and needs no printf
+    // Writes an empty string when the output buffer is too small
+
+    // Weak tag: W/"<kind><hex timestamp>" needs up to 21 bytes plus the kind
+    size_t szKind = strlen(sKind);
+    if (szOut < szKind + 21) {
+        if (szOut > 0) psOut[0] = '\0';
+        return;
+    }
+
+    size_t szPos = 0;
+    psOut[szPos++] = 'W';
+    psOut[szPos++] = '/';
+    psOut[szPos++] = '"';
+    memcpy(psOut + szPos, sKind, szKind);
+    szPos += szKind;
+    szPos += Api_WriteHex(psOut + szPos, (uint64_t)liTimestampUs);
+    psOut[szPos++] = '"';
+    psOut[szPos] = '\0';
+}
+
+
+
+static bool Api_SendNotModifiedIfMatch(httpd_req_t *psReq, const char *sEtag)
+{
+    // Compares the request If-None-Match header against the current ETag
+    // Sends an empty 304 response when the client already has this capture
+    // Returns true when the 304 was sent and the handler should stop
+
+    char sIfNoneMatch[64];
+
+    if (sEtag[0] == '\0') {
+        return false;
+    }
+    if (httpd_req_get_hdr_value_len(psReq, "If-None-Match") >= sizeof(sIfNoneMatch)) {
+        return false;
+    }
+    if (httpd_req_get_hdr_value_str(psReq, "If-None-Match", sIfNoneMatch, sizeof(sIfNoneMatch)) != ESP_OK) {
+        return false;
+    }
+
+    // Weak comparison ignores the W/ prefix on either side
+    const char *sOpaqueTag = (strncmp(sEtag, "W/", 2) == 0) ? (sEtag + 2) : sEtag;
+    if (strstr(sIfNoneMatch, sOpaqueTag) == NULL && strcmp(sIfNoneMatch, "*") != 0) {
+        return false;
+    }
+
+    // Reply with headers only
+    httpd_resp_set_status(psReq, "304 Not Modified");
+    httpd_resp_set_hdr(psReq, "ETag", sEtag);
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-cache");
+    httpd_resp_send(psReq, NULL, 0);
+    return true;
+}
+
+
+
+static bool Api_ParkUntilNewer(httpd_req_t *psReq, http_work_class_t eClass, long_poll_reply_fn_t pfnReply)
+{
+    // Parks the request when the query carries "after=<timestampUs>"
+    // Uses the optional "timeout" query value in milliseconds
+    // Returns true when the reply will be sent later by a worker or the long-poll timeout
+
+    char sValue[24];
+
+    if (!Api_GetQueryValue(psReq, "after", sValue, sizeof(sValue))) {
+        return false;
+    }
+    int64_t liAfterUs = (int64_t)strtoll(sValue, NULL, 10);
+
+    int iTimeoutMs = 0;
+    if (Api_GetQueryValue(psReq, "timeout", sValue, sizeof(sValue))) {
+        iTimeoutMs = (int)strtol(sValue, NULL, 10);
+    }
+
+    return LongPoll_Park(psReq, liAfterUs, iTimeoutMs, eClass, pfnReply);
+}
+
+
+
+static int Api_GetPointsParam(httpd_req_t *psReq)
+{
+    // Reads the optional "points" query value for waveform reduction
+    // Returns 0 when absent or invalid so callers send full resolution
+    // Values below two are treated as absent
+
+    char sValue[12];
+
+    if (!Api_GetQueryValue(psReq, "points", sValue, sizeof(sValue))) {
+        return 0;
+    }
+
+    long lPoints = strtol(sValue, NULL, 10);
+    return (lPoints >= 2 && lPoints <= 65535) ? (int)lPoints : 0;
+}
+
+
+
+static void Api_WriteWaveform(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                              int iSamples, int64_t liTimestampUs, int iPoints)
+{
+    // Writes a waveform object at full resolution or as a cached min/max envelope
+    // Reduces only when the caller asked for fewer points than the capture holds
+    // Keeps both variants in the same JSON layout for plotting clients
+
+    int64_t liServerNowUs = esp_timer_get_time();
+
+    if (iPoints > 0 && iPoints < iSamples) {
+        int16_t aiEnvelopeA_mV[iSamples_PerCh];
+        int16_t aiEnvelopeB_mV[iSamples_PerCh];
+        int iCount = Envelope_GetMinMax(liTimestampUs, iPoints, piChannelA_mV, piChannelB_mV, iSamples,
+                                        aiEnvelopeA_mV, aiEnvelopeB_mV);
+        if (iCount > 0) {
+            Proto_WriteEnvelopeJson(psWriter, aiEnvelopeA_mV, aiEnvelopeB_mV, iCount, iSamples,
+                                    liTimestampUs, liServerNowUs);
+            return;
+        }
+    }
+
+    Proto_WriteSamplesJson(psWriter, piChannelA_mV, piChannelB_mV, iSamples, liTimestampUs, liServerNowUs);
+}
+
+
+
+static esp_err_t Api_HandleRoot(httpd_req_t *psReq)
+{
+    // Serves the dashboard page embedded from www/dashboard.html
+    // Receives updates over /api/stream and falls back to polling /api/snapshot
+    // Sends precompressed gzip with an ETag so reloads are revalidated cheaply
+
+    return WebAssets_Send(psReq, WEB_ASSET_DASHBOARD);
+}
+
+
+
 static esp_err_t Api_HandleStatus(httpd_req_t *psReq)
 {
-    // Serves JSON for current Wi-Fi manager state
+    // Serves JSON or CBOR for current Wi-Fi manager state
     // Keeps output small so it is easy to parse on any client
     // Uses Proto serializer to keep formatting consistent
 
-    // Build JSON into buffer
-    char sJson[128];
-    (void)Proto_BuildStatusJson(sJson, sizeof(sJson), WifiMgr_GetState());
+    // Charge the client's cheap budget
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_CHEAP)) {
+        return ESP_OK;
+    }
 
-    // Send JSON response
-    httpd_resp_set_type(psReq, "application/json");
-    httpd_resp_send(psReq, sJson, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    // Build payload into buffer
+    bool bCbor = Api_WantsCbor(psReq);
+    char acPayload[128];
+    int iLen = bCbor ? Proto_BuildStatusCbor((uint8_t *)acPayload, sizeof(acPayload), WifiMgr_GetState())
+                     : Proto_BuildStatusJson(acPayload, sizeof(acPayload), WifiMgr_GetState());
+
+    return Api_SendPayload(psReq, acPayload, sizeof(acPayload), iLen, bCbor);
 }
 
 
 
 static esp_err_t Api_HandleStaIp(httpd_req_t *psReq)
 {
-    // Serves the current STA IPv4 address (if any) as JSON.
+    // Serves the current STA IPv4 address (if any) as JSON, or CBOR when the client asks for it.
     // Backwards compatible with v1 provisioning page which expects {"sta_ip":"x"}.
     // Also keeps v2 fields {"hasValue":true,"ip":"x"} for newer clients.
 
+    // Charge the client's cheap budget
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_CHEAP)) {
+        return ESP_OK;
+    }
+
     // Read cached IP from Wi-Fi manager
     char sIp[32] = {0};
     bool bHas = WifiMgr_GetStaIp(sIp, sizeof(sIp));
 
-    // Build JSON payload
-    char sJson[128];
-    if (bHas) {
-        (void)snprintf(sJson, sizeof(sJson),
-                       "{\"hasValue\":true,\"ip\":\"%s\",\"sta_ip\":\"%s\"}",
-                       sIp, sIp);
-    } else {
-        (void)snprintf(sJson, sizeof(sJson),
-                       "{\"hasValue\":false,\"ip\":\"\",\"sta_ip\":\"\"}");
-    }
+    // Build payload
+    bool bCbor = Api_WantsCbor(psReq);
+    char acPayload[128];
+    int iLen = bCbor ? Proto_BuildStaIpCbor((uint8_t *)acPayload, sizeof(acPayload), sIp, bHas)
+                     : Proto_BuildStaIpJson(acPayload, sizeof(acPayload), sIp, bHas);
 
-    // Send JSON response (no-cache so browsers see updates)
-    httpd_resp_set_type(psReq, "application/json");
+    // Send response (no-store so browsers see updates)
     httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
-    httpd_resp_send(psReq, sJson, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return Api_SendPayload(psReq, acPayload, sizeof(acPayload), iLen, bCbor);
 }
 
 
 
 static esp_err_t Api_HandleIps(httpd_req_t *psReq)
 {
-    // Serves the provisioning IP status page on the AP interface.
+    // Serves the provisioning IP status page embedded from www/ips.html
     // Polls the cached STA DHCP IP and turns it into a clickable link.
     // Keeps refresh on this page to avoid resubmitting provisioning forms.
 
-    // Build HTML response
-    const char *sHtml =
-        "<!doctype html><html><head>"
-        "<meta charset='utf-8'>"
-        "<meta name='viewport' content='width=device-width,initial-scale=1'>"
-        "<title>Device IP</title>"
-        "<style>"
-        "body{margin:0;font-family:system-ui,-apple-system,Segoe UI,Roboto,Arial;"
-        "background:#0b0f14;color:#e9eef6;display:flex;min-height:100vh;align-items:center;"
-        "justify-content:center;padding:24px}"
-        ".card{width:min(520px,100%);background:#121a24;border:1px solid #1f2b3a;"
-        "border-radius:18px;box-shadow:0 12px 30px rgba(0,0,0,.35);padding:22px}"
-        "h1{font-size:clamp(20px,4.5vw,28px);margin:0 0 10px}"
-        ".muted{color:#a9b4c2;font-size:clamp(13px,3.4vw,14px);line-height:1.35}"
-        "a{color:#7dd3fc;text-decoration:none}a:hover{text-decoration:underline}"
-        ".pill{display:inline-block;padding:6px 10px;border-radius:999px;"
-        "border:1px solid #2a3a50;background:#0f1620;font-size:13px}"
-        "small{display:block;margin-top:14px;color:#9fb0c6;line-height:1.35}"
-        "</style></head><body><div class='card'>"
-        "<h1>WiFi saved</h1>"
-        "<div class='muted'>Select your <b>home router WiFi</b> for the link below to work.</div>"
-        "<div style='height:14px'></div>"
-        "<div class='muted'>Device IP on your router: <span class='pill'><a id='ipLink' href='#'>detecting...</a></span></div>"
-        "<small>If your phone disconnects from this AP during setup, reconnect and refresh this page.</small>"
-        "<script>"
-        "async function poll(){"
-        " try{"
-        "  const r=await fetch('/api/sta_ip?t='+Date.now(),{cache:'no-store'});"
-        "  if(!r.ok) return;"
-        "  const j=await r.json();"
-        "  const a=document.getElementById('ipLink');"
-        "  if(j.sta_ip){a.textContent=j.sta_ip; a.href='http://'+j.sta_ip+'/';}"
-        "  else{a.textContent='detecting...'; a.href='#';}"
-        " }catch(e){}"
-        "}"
-        "poll();"
-        "setInterval(poll,5000);"
-        "</script>"
-        "</div></body></html>";
-
-    // Send HTML response
-    httpd_resp_set_type(psReq, "text/html; charset=utf-8");
-    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
-    httpd_resp_send(psReq, sHtml, HTTPD_RESP_USE_STRLEN);
+    return WebAssets_Send(psReq, WEB_ASSET_IPS);
+}
+
+
+static esp_err_t Api_SendRms(httpd_req_t *psReq)
+{
+    // Serves the latest RMS measurement pre-rendered at publish time
+    // Copies cached bytes so polling cost does not depend on formatting
+    // Returns the compact binary record for fmt=bin and CBOR for fmt=cbor or Accept
+
+    // Select encoding from the query string and Accept header
+    char sFormat[8] = {0};
+    bool bBinary = Api_GetQueryValue(psReq, "fmt", sFormat, sizeof(sFormat)) &&
+                   (strcmp(sFormat, "bin") == 0);
+    bool bCbor = !bBinary && Api_WantsCbor(psReq);
+    rms_cache_format_t eFormat = bBinary ? RMS_CACHE_FORMAT_BINARY :
+                                 (bCbor ? RMS_CACHE_FORMAT_CBOR : RMS_CACHE_FORMAT_JSON);
+
+    // Copy cached payload
+    uint8_t auPayload[iRmsCacheMaxBytes];
+    rms_cache_info_t sInfo;
+    if (!RmsCache_Copy(eFormat, auPayload, sizeof(auPayload), &sInfo)) {
+        httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "No cached payload");
+        return ESP_OK;
+    }
+
+    // Skip the body when the client already holds this measurement
+    char sEtag[40];
+    Api_FormatEtag(sEtag, sizeof(sEtag), bBinary ? "b" : (bCbor ? "c" : "r"), sInfo.liTimestampUs);
+    if (Api_SendNotModifiedIfMatch(psReq, sEtag)) {
+        return ESP_OK;
+    }
+
+    // Send cached response
+    httpd_resp_set_type(psReq, bBinary ? "application/octet-stream" : (bCbor ? "application/cbor" : "application/json"));
+    httpd_resp_set_hdr(psReq, "ETag", sEtag);
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(psReq, "Vary", "Accept");
+    httpd_resp_send(psReq, (const char *)auPayload, (ssize_t)sInfo.szLength);
     return ESP_OK;
 }
 
 
+
 static esp_err_t Api_HandleRms(httpd_req_t *psReq)
 {
-    // Serves latest RMS measurement JSON from ADC module cache
-    // Avoids blocking by returning cached values immediately
-    // Allows clients to poll periodically for updated results
+    // Handles GET /api/rms, optionally as a long-poll with "after"
+    // Parks the request until a newer measurement when asked to
+    // Otherwise replies immediately from the RMS cache
 
-    // Get latest result
-    adc_result_t sResult;
-    bool bHas = Adc_GetLatest(&sResult);
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_CHEAP)) {
+        return ESP_OK;
+    }
 
-    // Build JSON
-    char sJson[256];
-    (void)Proto_BuildRmsJson(sJson, sizeof(sJson), &sResult, bHas);
+    if (Api_ParkUntilNewer(psReq, HTTP_WORK_RMS, Api_SendRms)) {
+        return ESP_OK;
+    }
 
-    // Send JSON response
-    httpd_resp_set_type(psReq, "application/json");
-    httpd_resp_send(psReq, sJson, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    return Api_SendRms(psReq);
 }
 
 
 
-static esp_err_t Api_HandleSamples(httpd_req_t *psReq)
+static esp_err_t Api_SendSamples(httpd_req_t *psReq)
 {
     // Serves the last cached AC waveform window as signed millivolts
     // Adds server-side time so UI can show "age" without epoch-time confusion
     // Uses chunked responses to keep peak RAM usage low on the device
 
+    int iPoints = Api_GetPointsParam(psReq);
+    bool bCbor = Api_WantsCbor(psReq);
+    char sEtagKind[12];
+    uint32_t uiEtagPoints = (uint32_t)iPoints;
+    Api_FormatEtagKind(sEtagKind, sizeof(sEtagKind), bCbor ? 'S' : 's', &uiEtagPoints, 1);
+
     int16_t aiChannelA_mV[iSamples_PerCh];
     int16_t aiChannelB_mV[iSamples_PerCh];
     int iSamplesReturned = 0;
@@ -432,67 +442,447 @@ static esp_err_t Api_HandleSamples(httpd_req_t *psReq)
     adc_atten_t eAttenChannelA = ADC_ATTEN_DB_12;
     adc_atten_t eAttenChannelB = ADC_ATTEN_DB_12;
 
+    // Answer revalidation requests before copying the waveform
+    char sEtag[40];
+    int64_t liCachedTimestampUs = 0;
+    if (Adc_GetLastSamplesTimestamp(&liCachedTimestampUs)) {
+        Api_FormatEtag(sEtag, sizeof(sEtag), sEtagKind, liCachedTimestampUs);
+        if (Api_SendNotModifiedIfMatch(psReq, sEtag)) {
+            return ESP_OK;
+        }
+    }
+
     // Read the last cached capture window
     bool bHasValue = Adc_GetLastSamplesMilliVolts(aiChannelA_mV, aiChannelB_mV, iSamples_PerCh,
                                                   &iSamplesReturned, &liTimestampUs,
                                                   &eAttenChannelA, &eAttenChannelB);
 
-    httpd_resp_set_type(psReq, "application/json");
-
     // Return quickly if no samples are available yet
     if (!bHasValue) {
-        httpd_resp_sendstr(psReq, "{\"hasValue\":false}");
+        return Api_SendNoValue(psReq, bCbor);
+    }
+
+    // Tag the response with the timestamp of the copied capture
+    Api_FormatEtag(sEtag, sizeof(sEtag), sEtagKind, liTimestampUs);
+    httpd_resp_set_type(psReq, bCbor ? "application/cbor" : "application/json");
+    httpd_resp_set_hdr(psReq, "ETag", sEtag);
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(psReq, "Vary", "Accept");
+
+    // Stream through the chunked response writer
+    char acChunk[iHttpChunkBufferBytes];
+    json_writer_t sWriter;
+    JsonWriter_InitStream(&sWriter, acChunk, sizeof(acChunk), Api_SendChunk, psReq);
+    JsonWriter_SetEncoding(&sWriter, bCbor ? JSON_WRITER_ENCODING_CBOR : JSON_WRITER_ENCODING_JSON);
+    Api_WriteWaveform(&sWriter, aiChannelA_mV, aiChannelB_mV, iSamplesReturned, liTimestampUs, iPoints);
+    if (JsonWriter_Finish(&sWriter) < 0) {
+        return ESP_FAIL;
+    }
+
+    // Terminate the chunked response
+    httpd_resp_send_chunk(psReq, NULL, 0);
+    return ESP_OK;
+}
+
+
+
+static esp_err_t Api_HandleSamples(httpd_req_t *psReq)
+{
+    // Handles GET /api/samples, optionally as a long-poll with "after"
+    // Parks the request until a newer capture when asked to
+    // Otherwise streams the cached waveform from a worker task
+
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_EXPENSIVE)) {
         return ESP_OK;
     }
 
-    // Capture current device time for age computation
-    int64_t liServerNowUs = esp_timer_get_time();
+    if (Api_ParkUntilNewer(psReq, HTTP_WORK_SAMPLES, Api_SendSamples)) {
+        return ESP_OK;
+    }
+
+    return HttpWorkers_Dispatch(psReq, HTTP_WORK_SAMPLES, Api_SendSamples);
+}
+
+
+
+static bool Api_HasField(const char *sFields, const char *sName)
+{
+    // Checks whether a comma-separated field list contains one name
+    // Matches whole tokens so "rms" does not match "rmsx"
+    // Treats an empty list as a request for no fields
+
+    size_t szName = strlen(sName);
+    const char *psToken = sFields;
+
+    while (*psToken != '\0') {
+        const char *psEnd = strchr(psToken, ',');
+        size_t szToken = (psEnd != NULL) ? (size_t)(psEnd - psToken) : strlen(psToken);
+        if (szToken == szName && strncmp(psToken, sName, szName) == 0) {
+            return true;
+        }
+        if (psEnd == NULL) {
+            break;
+        }
+        psToken = psEnd + 1;
+    }
+    return false;
+}
+
+
+
+static esp_err_t Api_SendSnapshot(httpd_req_t *psReq)
+{
+    // Serves status, STA IP, RMS result and waveform in one chunked JSON or CBOR reply
+    // Copies result and waveform under a single ADC lock so they always match
+    // Honors "fields=status,sta_ip,rms,samples" to trim the response
+
+    enum { API_SNAP_STATUS = 1, API_SNAP_STA_IP = 2, API_SNAP_RMS = 4, API_SNAP_SAMPLES = 8 };
+
+    int iPoints = Api_GetPointsParam(psReq);
+    bool bCbor = Api_WantsCbor(psReq);
+
+    // Select fields, default to everything
+    int iFieldMask = API_SNAP_STATUS | API_SNAP_STA_IP | API_SNAP_RMS | API_SNAP_SAMPLES;
+    char sFields[64];
+    if (Api_GetQueryValue(psReq, "fields", sFields, sizeof(sFields))) {
+        iFieldMask = 0;
+        if (Api_HasField(sFields, "status"))  iFieldMask |= API_SNAP_STATUS;
+        if (Api_HasField(sFields, "sta_ip"))  iFieldMask |= API_SNAP_STA_IP;
+        if (Api_HasField(sFields, "rms"))     iFieldMask |= API_SNAP_RMS;
+        if (Api_HasField(sFields, "samples")) iFieldMask |= API_SNAP_SAMPLES;
+    }
+
+    // Take one consistent ADC snapshot
+    int16_t aiChannelA_mV[iSamples_PerCh];
+    int16_t aiChannelB_mV[iSamples_PerCh];
+    adc_snapshot_t sSnapshot;
+    bool bWantSamples = (iFieldMask & API_SNAP_SAMPLES) != 0;
+    if (!Adc_GetSnapshot(&sSnapshot, bWantSamples ? aiChannelA_mV : NULL,
+                         bWantSamples ? aiChannelB_mV : NULL, iSamples_PerCh)) {
+        httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "ADC not ready");
+        return ESP_OK;
+    }
+
+    // Measurement-only selections are tagged by timestamp; the kind spells out encoding, fields and points
+    char sEtag[40] = {0};
+    if ((iFieldMask & (API_SNAP_STATUS | API_SNAP_STA_IP)) == 0 && sSnapshot.bHasSamples) {
+        char sEtagKind[20];
+        uint32_t auEtagParts[2] = { (uint32_t)iFieldMask, (uint32_t)iPoints };
+        Api_FormatEtagKind(sEtagKind, sizeof(sEtagKind), bCbor ? 'A' : 'a', auEtagParts, 2);
+        Api_FormatEtag(sEtag, sizeof(sEtag), sEtagKind, sSnapshot.liSamplesTimestampUs);
+        if (Api_SendNotModifiedIfMatch(psReq, sEtag)) {
+            return ESP_OK;
+        }
+    }
+
+    httpd_resp_set_type(psReq, bCbor ? "application/cbor" : "application/json");
+    if (sEtag[0] != '\0') {
+        httpd_resp_set_hdr(psReq, "ETag", sEtag);
+        httpd_resp_set_hdr(psReq, "Cache-Control", "no-cache");
+        httpd_resp_set_hdr(psReq, "Vary", "Accept");
+    } else {
+        httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+    }
+
+    // Stream the combined object
+    char acChunk[iHttpChunkBufferBytes];
+    json_writer_t sWriter;
+    JsonWriter_InitStream(&sWriter, acChunk, sizeof(acChunk), Api_SendChunk, psReq);
+    JsonWriter_SetEncoding(&sWriter, bCbor ? JSON_WRITER_ENCODING_CBOR : JSON_WRITER_ENCODING_JSON);
+    JsonWriter_BeginObject(&sWriter);
+
+    if (iFieldMask & API_SNAP_STATUS) {
+        JsonWriter_Key(&sWriter, "status");
+        Proto_WriteStatusJson(&sWriter, WifiMgr_GetState());
+    }
+
+    if (iFieldMask & API_SNAP_STA_IP) {
+        char sIp[32] = {0};
+        bool bHasIp = WifiMgr_GetStaIp(sIp, sizeof(sIp));
+        JsonWriter_Key(&sWriter, "sta_ip");
+        Proto_WriteStaIpJson(&sWriter, sIp, bHasIp);
+    }
+
+    if (iFieldMask & API_SNAP_RMS) {
+        JsonWriter_Key(&sWriter, "rms");
+        Proto_WriteRmsJson(&sWriter, &sSnapshot.sResult, sSnapshot.bHasResult);
+    }
+
+    if (iFieldMask & API_SNAP_SAMPLES) {
+        JsonWriter_Key(&sWriter, "samples");
+        if (sSnapshot.bHasSamples) {
+            Api_WriteWaveform(&sWriter, aiChannelA_mV, aiChannelB_mV, sSnapshot.iSamples,
+                              sSnapshot.liSamplesTimestampUs, iPoints);
+        } else {
+            JsonWriter_BeginObject(&sWriter);
+            JsonWriter_Key(&sWriter, "hasValue");
+            JsonWriter_Bool(&sWriter, false);
+            JsonWriter_EndObject(&sWriter);
+        }
+    }
+
+    JsonWriter_EndObject(&sWriter);
+    if (JsonWriter_Finish(&sWriter) < 0) {
+        return ESP_FAIL;
+    }
+
+    // Terminate the chunked response
+    httpd_resp_send_chunk(psReq, NULL, 0);
+    return ESP_OK;
+}
+
+
+
+static esp_err_t Api_HandleSnapshot(httpd_req_t *psReq)
+{
+    // Handles GET /api/snapshot, optionally as a long-poll with "after"
+    // Parks the request until a newer measurement when asked to
+    // Otherwise streams the combined snapshot from a worker task
+
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_EXPENSIVE)) {
+        return ESP_OK;
+    }
+
+    if (Api_ParkUntilNewer(psReq, HTTP_WORK_SNAPSHOT, Api_SendSnapshot)) {
+        return ESP_OK;
+    }
+
+    return HttpWorkers_Dispatch(psReq, HTTP_WORK_SNAPSHOT, Api_SendSnapshot);
+}
+
+
+
+static esp_err_t Api_SendExport(httpd_req_t *psReq)
+{
+    // Streams history rows as CSV, NDJSON or CBOR between "from" and "to" (timestampUs, inclusive)
+    // Resumes at "cursor", the seq after the last row received, instead of "from"
+    // Copies small batches from the ring and sends fixed-size chunks, so memory is constant
+
+    char sValue[24];
+
+    history_format_t eFormat = HISTORY_FORMAT_CSV;
+    if (Api_GetQueryValue(psReq, "format", sValue, sizeof(sValue))) {
+        (void)HistoryFormat_Parse(sValue, &eFormat);
+    } else if (Api_WantsCbor(psReq)) {
+        eFormat = HISTORY_FORMAT_CBOR;
+    }
 
-    // Send JSON header metadata
-    httpd_resp_sendstr_chunk(psReq, "{");
-    httpd_resp_sendstr_chunk(psReq, "\"hasValue\":true,");
+    // Resolve the sequence range; fixing the end now keeps the download finite
+    history_stats_t sStats;
+    History_GetStats(&sStats);
+    uint32_t uiSeq = sStats.uiOldestSeq;
+    uint32_t uiEndSeq = sStats.uiNextSeq;
+    if (Api_GetQueryValue(psReq, "cursor", sValue, sizeof(sValue))) {
+        uiSeq = (uint32_t)strtoul(sValue, NULL, 10);
+    } else if (Api_GetQueryValue(psReq, "from", sValue, sizeof(sValue))) {
+        uiSeq = History_FindSeq((int64_t)strtoll(sValue, NULL, 10));
+    }
+    if (Api_GetQueryValue(psReq, "to", sValue, sizeof(sValue))) {
+        uint32_t uiToSeq = History_FindSeq((int64_t)strtoll(sValue, NULL, 10) + 1);
+        if ((int32_t)(uiToSeq - uiEndSeq) < 0) {
+            uiEndSeq = uiToSeq;
+        }
+    }
+
+    // Read the first batch so the headers can report where the rows start
+    history_record_t asBatch[iHistoryExportBatch];
+    uint32_t uiFirstSeq = uiSeq;
+    int iCount = History_Read(uiSeq, uiEndSeq, asBatch, iHistoryExportBatch, &uiFirstSeq);
+
+    // First is above the cursor when older records were already overwritten
+    char sFirst[iJsonWriterNumberMax + 1];
+    char sEnd[iJsonWriterNumberMax + 1];
+    sFirst[JsonWriter_FormatInt(sFirst, uiFirstSeq)] = '\0';
+    sEnd[JsonWriter_FormatInt(sEnd, uiEndSeq)] = '\0';
+    httpd_resp_set_type(psReq, HistoryFormat_GetContentType(eFormat));
+    static const char *const asDisposition[HISTORY_FORMAT_COUNT] = {
+        [HISTORY_FORMAT_CSV] = "attachment; filename=\"history.csv\"",
+        [HISTORY_FORMAT_NDJSON] = "attachment; filename=\"history.ndjson\"",
+        [HISTORY_FORMAT_CBOR] = "attachment; filename=\"history.cbor\"",
+    };
+    httpd_resp_set_hdr(psReq, "Content-Disposition", asDisposition[eFormat]);
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+    httpd_resp_set_hdr(psReq, "X-History-First", sFirst);
+    httpd_resp_set_hdr(psReq, "X-History-End", sEnd);
+
+    // Stream rows batch by batch; a failed send ends the loop
+    char acChunk[iHistoryExportChunkBytes];
+    json_writer_t sWriter;
+    JsonWriter_InitStream(&sWriter, acChunk, sizeof(acChunk), Api_SendChunk, psReq);
+    HistoryFormat_WriteHeader(&sWriter, eFormat);
+    while (iCount > 0 && !sWriter.bFailed) {
+        for (int iIndex = 0; iIndex < iCount; iIndex++) {
+            HistoryFormat_WriteRow(&sWriter, eFormat, uiFirstSeq + (uint32_t)iIndex, &asBatch[iIndex]);
+        }
+        uiSeq = uiFirstSeq + (uint32_t)iCount;
+
+        // Let a capture window finish before the next chunks go out
+        RateLimit_DeferForAcquisition();
+        iCount = History_Read(uiSeq, uiEndSeq, asBatch, iHistoryExportBatch, &uiFirstSeq);
+    }
+    if (JsonWriter_Finish(&sWriter) < 0) {
+        return ESP_FAIL;
+    }
+
+    // Terminate the chunked response
+    httpd_resp_send_chunk(psReq, NULL, 0);
+    return ESP_OK;
+}
 
-    char sHeader[256];
-    snprintf(sHeader, sizeof(sHeader),
-             "\"timestampUs\":%" PRId64 ",\"serverNowUs\":%" PRId64 ",\"samples\":%d,\"units\":\"mV\",",
-             liTimestampUs, liServerNowUs, iSamplesReturned);
-    httpd_resp_sendstr_chunk(psReq, sHeader);
 
-    // Serialize channel A samples (signed mV)
-    httpd_resp_sendstr_chunk(psReq, "\"chA\":[");
-    for (int iIndex = 0; iIndex < iSamplesReturned; iIndex++) {
 
-        char sNumber[20];
-        snprintf(sNumber, sizeof(sNumber), "%d%s",
-                 (int)aiChannelA_mV[iIndex], (iIndex == iSamplesReturned - 1) ? "" : ",");
-        httpd_resp_sendstr_chunk(psReq, sNumber);
+static esp_err_t Api_HandleExport(httpd_req_t *psReq)
+{
+    // Handles GET /api/export?format=csv|ndjson|cbor&from=&to=&cursor=
+    // Rejects unknown formats on the httpd task before taking a worker
+    // Streams the rows from a worker since a full export takes seconds
+
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_EXPENSIVE)) {
+        return ESP_OK;
     }
-    httpd_resp_sendstr_chunk(psReq, "],");
 
-    // Serialize channel B samples (signed mV)
-    httpd_resp_sendstr_chunk(psReq, "\"chB\":[");
-    for (int iIndex = 0; iIndex < iSamplesReturned; iIndex++) {
+    char sFormat[12];
+    history_format_t eFormat;
+    if (Api_GetQueryValue(psReq, "format", sFormat, sizeof(sFormat)) && !HistoryFormat_Parse(sFormat, &eFormat)) {
+        httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "format must be csv, ndjson or cbor");
+        return ESP_OK;
+    }
+
+    return HttpWorkers_Dispatch(psReq, HTTP_WORK_EXPORT, Api_SendExport);
+}
+
+
 
-        char sNumber[20];
-        snprintf(sNumber, sizeof(sNumber), "%d%s",
-                 (int)aiChannelB_mV[iIndex], (iIndex == iSamplesReturned - 1) ? "" : ",");
-        httpd_resp_sendstr_chunk(psReq, sNumber);
+static const char *Api_ParseTrigger(httpd_req_t *psReq, adc_trigger_t *psTriggerOut)
+{
+    // Reads ch, level, edge, pre and timeout from the query into a trigger
+    // Missing values take the defaults: ch=a, level=0 mV, rising, iCaptureDefaultPrePercent, iCaptureDefaultTimeoutMs
+    // Returns NULL when valid, otherwise the message for a 400 reply
+
+    char sValue[16];
+    char *psEnd = NULL;
+
+    psTriggerOut->iChannel = 0;
+    psTriggerOut->iLevel_mV = 0;
+    psTriggerOut->eEdge = ADC_TRIGGER_EDGE_RISING;
+    psTriggerOut->iPreTriggerPercent = iCaptureDefaultPrePercent;
+    psTriggerOut->uiTimeoutMs = iCaptureDefaultTimeoutMs;
+
+    if (Api_GetQueryValue(psReq, "ch", sValue, sizeof(sValue))) {
+        if (strcmp(sValue, "a") == 0) {
+            psTriggerOut->iChannel = 0;
+        } else if (strcmp(sValue, "b") == 0) {
+            psTriggerOut->iChannel = 1;
+        } else {
+            return "ch must be a or b";
+        }
+    }
+    if (Api_GetQueryValue(psReq, "level", sValue, sizeof(sValue))) {
+        long lLevel = strtol(sValue, &psEnd, 10);
+        if (psEnd == sValue || *psEnd != '\0' || lLevel < INT16_MIN || lLevel > INT16_MAX) {
+            return "level must be millivolts";
+        }
+        psTriggerOut->iLevel_mV = (int)lLevel;
+    }
+    if (Api_GetQueryValue(psReq, "edge", sValue, sizeof(sValue))) {
+        if (strcmp(sValue, "rising") == 0) {
+            psTriggerOut->eEdge = ADC_TRIGGER_EDGE_RISING;
+        } else if (strcmp(sValue, "falling") == 0) {
+            psTriggerOut->eEdge = ADC_TRIGGER_EDGE_FALLING;
+        } else {
+            return "edge must be rising or falling";
+        }
+    }
+    if (Api_GetQueryValue(psReq, "pre", sValue, sizeof(sValue))) {
+        long lPre = strtol(sValue, &psEnd, 10);
+        if (psEnd == sValue || *psEnd != '\0' || lPre < 0 || lPre > 100) {
+            return "pre must be 0..100";
+        }
+        psTriggerOut->iPreTriggerPercent = (int)lPre;
+    }
+    if (Api_GetQueryValue(psReq, "timeout", sValue, sizeof(sValue))) {
+        long lTimeout = strtol(sValue, &psEnd, 10);
+        if (psEnd == sValue || *psEnd != '\0' || lTimeout < 0 || lTimeout > iCaptureMaxTimeoutMs) {
+            return "timeout out of range";
+        }
+        psTriggerOut->uiTimeoutMs = (uint32_t)lTimeout;
+    }
+
+    return NULL;
+}
+
+
+
+static esp_err_t Api_SendCapture(httpd_req_t *psReq)
+{
+    // Captures a fresh window aligned on the requested edge and streams it
+    // Blocks this worker for at most the trigger timeout plus one window
+    // Never touches the cached waveform, so /api/samples keeps serving the last measurement
+
+    adc_trigger_t sTrigger;
+    const char *sError = Api_ParseTrigger(psReq, &sTrigger);
+    if (sError != NULL) {
+        httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, sError);
+        return ESP_OK;
     }
-    httpd_resp_sendstr_chunk(psReq, "]");
+    bool bCbor = Api_WantsCbor(psReq);
+
+    // Worker-owned buffers; the capture class cap keeps this to one request at a time
+    static int16_t aiChannelA_mV[iSamples_PerCh];
+    static int16_t aiChannelB_mV[iSamples_PerCh];
+    adc_capture_info_t sInfo;
+    if (Adc_CaptureTriggered(&sTrigger, aiChannelA_mV, aiChannelB_mV, iSamples_PerCh, &sInfo) != ESP_OK) {
+        httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Capture failed");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(psReq, bCbor ? "application/cbor" : "application/json");
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
 
-    // Close the JSON object
-    httpd_resp_sendstr_chunk(psReq, "}");
-    httpd_resp_sendstr_chunk(psReq, NULL);
+    // Stream through the chunked response writer
+    char acChunk[iHttpChunkBufferBytes];
+    json_writer_t sWriter;
+    JsonWriter_InitStream(&sWriter, acChunk, sizeof(acChunk), Api_SendChunk, psReq);
+    JsonWriter_SetEncoding(&sWriter, bCbor ? JSON_WRITER_ENCODING_CBOR : JSON_WRITER_ENCODING_JSON);
+    Proto_WriteCaptureJson(&sWriter, aiChannelA_mV, aiChannelB_mV, iSamples_PerCh, &sTrigger, &sInfo,
+                           esp_timer_get_time());
+    if (JsonWriter_Finish(&sWriter) < 0) {
+        return ESP_FAIL;
+    }
 
+    // Terminate the chunked response
+    httpd_resp_send_chunk(psReq, NULL, 0);
     return ESP_OK;
 }
 
 
 
+static esp_err_t Api_HandleCapture(httpd_req_t *psReq)
+{
+    // Handles GET /api/capture?ch=a|b&level=<mV>&edge=rising|falling&pre=<%>&timeout=<ms>
+    // Rejects bad trigger settings on the httpd task before taking a worker
+    // Runs the capture on a worker since it busy-waits on the ADC time base
+
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_EXPENSIVE)) {
+        return ESP_OK;
+    }
+
+    adc_trigger_t sTrigger;
+    const char *sError = Api_ParseTrigger(psReq, &sTrigger);
+    if (sError != NULL) {
+        httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, sError);
+        return ESP_OK;
+    }
+
+    return HttpWorkers_Dispatch(psReq, HTTP_WORK_CAPTURE, Api_SendCapture);
+}
+
+
+
 static esp_err_t Api_HandleCmd(httpd_req_t *psReq)
 {
     // Accepts simple commands for future extension
-    // Currently supports "measureNow" command to trigger ADC measurement
+    // Supports "measureNow" to trigger an ADC measurement and "apOn"/"apOff" for the provisioning AP
     // Responds with status JSON to confirm command acceptance
 
     // Read body into buffer
@@ -509,6 +899,15 @@ static esp_err_t Api_HandleCmd(httpd_req_t *psReq)
         (void)Adc_MeasureNow();
     }
 
+    // Switch the provisioning AP; turning it off needs the station link to stay reachable
+    bool bApOn = (strstr(sBody, "apOn") != NULL);
+    if ((bApOn || strstr(sBody, "apOff") != NULL) && WifiMgr_RequestAp(bApOn) != ESP_OK) {
+        httpd_resp_set_status(psReq, "409 Conflict");
+        httpd_resp_set_type(psReq, "application/json");
+        httpd_resp_sendstr(psReq, "{\"error\":\"AP stays on without a station IP\"}");
+        return ESP_OK;
+    }
+
     // Reply with status
     char sJson[128];
     (void)Proto_BuildStatusJson(sJson, sizeof(sJson), WifiMgr_GetState());
@@ -519,21 +918,62 @@ static esp_err_t Api_HandleCmd(httpd_req_t *psReq)
 
 
 
+static int Api_GetSocketBudget(void)
+{
+    // Returns how many client sockets the HTTP server may hold open
+    // Takes what lwIP has left after httpd internals and the other services
+    // Never returns less than four so the dashboard keeps working
+
+    int iBudget = iHttpMaxOpenSockets;
+
+#ifdef CONFIG_LWIP_MAX_SOCKETS
+    int iAvailable = CONFIG_LWIP_MAX_SOCKETS - 3 - iNonHttpSockets;
+    if (iAvailable < iBudget) {
+        ESP_LOGW(gTag, "CONFIG_LWIP_MAX_SOCKETS=%d limits HTTP to %d sockets, raise it to %d",
+                 CONFIG_LWIP_MAX_SOCKETS, (iAvailable < 4) ? 4 : iAvailable,
+                 iHttpMaxOpenSockets + 3 + iNonHttpSockets);
+        iBudget = iAvailable;
+    }
+#endif
+
+    return (iBudget < 4) ? 4 : iBudget;
+}
+
+
+
 esp_err_t Api_Start(void)
 {
     // Starts HTTP API server for status, RMS readings, and commands
     // Registers endpoints that work in browser on mobile and desktop
-    // Increases handler slots so provisioning pages can register without abort
+    // Tunes sockets so many pollers and slow phones share the server fairly
 
     // Configure HTTP server
     httpd_config_t sCfg = HTTPD_DEFAULT_CONFIG();
     sCfg.server_port = iHttpServerPort;
-
-    // Increase handler slots for API + provisioning pages
-    sCfg.max_uri_handlers = 16;
+    sCfg.max_uri_handlers = iHttpMaxUriHandlers;
+    sCfg.task_priority = iHttpTaskPriority;
+
+    // Hold many keep-alive clients and recycle the least recently used socket when full
+    sCfg.max_open_sockets = (uint16_t)Api_GetSocketBudget();
+    sCfg.lru_purge_enable = true;
+    sCfg.backlog_conn = iHttpBacklog;
+
+    // Bound the time a stalled client can hold a socket
+    sCfg.recv_wait_timeout = iHttpRecvTimeoutSeconds;
+    sCfg.send_wait_timeout = iHttpSendTimeoutSeconds;
+    sCfg.keep_alive_enable = true;
+    sCfg.keep_alive_idle = iHttpTcpKeepAliveIdleSeconds;
+    sCfg.keep_alive_interval = iHttpTcpKeepAliveIntervalSeconds;
+    sCfg.keep_alive_count = iHttpTcpKeepAliveCount;
+
+    // Start the worker pool for large responses
+    esp_err_t eErr = HttpWorkers_Init();
+    if (eErr != ESP_OK) {
+        ESP_LOGW(gTag, "Worker pool unavailable, serving inline: %s", esp_err_to_name(eErr));
+    }
 
     // Start server
-    esp_err_t eErr = httpd_start(&gsHttpServer, &sCfg);
+    eErr = httpd_start(&gsHttpServer, &sCfg);
     if (eErr != ESP_OK) {
         ESP_LOGE(gTag, "httpd_start failed: %s", esp_err_to_name(eErr));
         return eErr;
@@ -593,6 +1033,33 @@ esp_err_t Api_Start(void)
     };
     ESP_ERROR_CHECK(httpd_register_uri_handler(gsHttpServer, &sSamplesUri));
 
+    // Register /api/snapshot
+    httpd_uri_t sSnapshotUri = {
+        .uri = "/api/snapshot",
+        .method = HTTP_GET,
+        .handler = Api_HandleSnapshot,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(gsHttpServer, &sSnapshotUri));
+
+    // Register /api/export
+    httpd_uri_t sExportUri = {
+        .uri = "/api/export",
+        .method = HTTP_GET,
+        .handler = Api_HandleExport,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(gsHttpServer, &sExportUri));
+
+    // Register /api/capture
+    httpd_uri_t sCaptureUri = {
+        .uri = "/api/capture",
+        .method = HTTP_GET,
+        .handler = Api_HandleCapture,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(gsHttpServer, &sCaptureUri));
+
     // Register /api/cmd
     httpd_uri_t sCmdUri = {
         .uri = "/api/cmd",
@@ -602,7 +1069,7 @@ esp_err_t Api_Start(void)
     };
     ESP_ERROR_CHECK(httpd_register_uri_handler(gsHttpServer, &sCmdUri));
 
-    ESP_LOGI(gTag, "API started on port %d", iHttpServerPort);
+    ESP_LOGI(gTag, "API started on port %d (%d sockets)", iHttpServerPort, sCfg.max_open_sockets);
     return ESP_OK;
 }
 
@@ -31,19 +31,146 @@
 // ADC full scale for 12-bit
 #define iAdcFullScaleCounts             4095
 
+// ======================== Triggered capture (/api/capture) ========================
+#define iCaptureDefaultTimeoutMs        100     // Two mains periods; auto mode after that
+#define iCaptureMaxTimeoutMs            1000    // Sampling busy-waits, so keep the worker hold short
+#define iCaptureDefaultPrePercent       25
+#define iCaptureHysteresis_mV           20      // Signal must leave the level by this much to re-arm
+
 // ======================== Measurement schedule ========================
 #define iMeasurePeriodSeconds           10
 
+// ======================== Startup ========================
+#define iBootInitTaskStackBytes         4096    // Per init phase task; the tasks exit once their phase is done
+
 // ======================== Wi-Fi provisioning SoftAP ========================
 #define sProvApSsidPrefix               "JAK_DEVICE"
 #define sProvApPassword                 "configureme" // Default provisioning password – change before deployment
 #define iProvApChannel                  6
 #define PROV_AP_IP_ADDR                 "192.168.4.1"
+#define iProvApStopAfterConnectedMs     0       // STA up this long with no AP clients switches to STA-only mode; 0 keeps the AP on
+#define iProvApRestoreAfterOutageMs     30000   // STA down this long with the AP off brings the AP back; 0 disables
+#define iProvApManualHoldMs             600000  // An AP turned on by API or button stays on at least this long
+#define iProvApButtonGpio               -1      // Active-low button that turns the AP on; 0 is BOOT on most dev boards; -1 disables
 
 // ======================== Wi-Fi retry behavior ========================
-#define iWifiConnectTimeoutMs           45000
-#define iWifiRetryBackoffMinMs          500
+#define iWifiConnectTimeoutMs           45000   // Per attempt; no IP by then drops the link and retries
+#define iWifiRetryBackoffMinMs          500     // Decorrelated jitter: next delay is random in [min, 3 x previous], capped at max
 #define iWifiRetryBackoffMaxMs          10000
+#define iWifiTargetedConnectAttempts    2       // Single-channel tries on the cached AP before a full scan; 0 disables
+#define iWifiStaticIpGatewayProbes      3       // Pings to the gateway after a static IP comes up; no reply falls back to DHCP; 0 disables
+#define iWifiStaticIpProbeTimeoutMs     1000
+
+// ======================== Wi-Fi power save ========================
+// Modem sleep only acts in STA-only mode; the driver keeps the radio awake while the provisioning AP runs
+#define iWifiPsDefaultProfile           1       // 0 none, 1 min-modem (IDF default), 2 max-modem; until one is set at /api/wifi/power
+#define iWifiPsListenInterval           3       // Beacon intervals between wake-ups in max-modem; applied at the next association
+#define bWifiPsLowLatencyWhileStreaming true    // SSE or WebSocket subscribers switch to no power save while attached
+#define iWifiPsStreamCheckMs            1000    // How often subscriber counts are looked at
+#define iWifiPsBenchMaxPings            100     // Most pings per profile in one benchmark run
+#define iWifiPsBenchIntervalMs          200
+#define iWifiPsBenchTimeoutMs           1000
+#define iWifiPsBenchSettleMs            2000    // Pause after switching profile before the first ping
 
 // ======================== HTTP server ========================
 #define iHttpServerPort                 80
+
+// Socket pool; lwIP needs CONFIG_LWIP_MAX_SOCKETS >= iHttpMaxOpenSockets + 3 + iNonHttpSockets.
+// Api_Start shrinks the pool to what lwIP can provide and purges the least recently used socket
+#define iHttpMaxOpenSockets             12
+#define iNonHttpSockets                 (4 + iModbusMaxClients) // DNS, UDP, MQTT, Modbus listener + clients
+#define iHttpBacklog                    8
+#define iHttpRecvTimeoutSeconds         5
+#define iHttpSendTimeoutSeconds         5
+#define iHttpTcpKeepAliveIdleSeconds    10      // Detects phones that left the SoftAP
+#define iHttpTcpKeepAliveIntervalSeconds 5
+#define iHttpTcpKeepAliveCount          3
+#define iHttpMaxUriHandlers             28
+
+// Worker pool for large responses, with per-endpoint concurrency caps
+// HTTP tasks run below adc_sched so a capture window preempts response work
+#define iHttpTaskPriority               4
+#define iHttpWorkerCount                2
+#define iHttpWorkerStackBytes           6144
+#define iHttpWorkQueueDepth             8
+#define iHttpCapSamples                 4
+#define iHttpCapSnapshot                4
+#define iHttpCapMetrics                 1       // Shares one static chunk buffer
+#define iHttpCapExport                  1       // Long downloads; keeps a worker free for samples
+#define iHttpCapCapture                 1       // Holds the ADC for up to iCaptureMaxTimeoutMs
+#define iHttpCapRms                     4       // Woken /api/rms long polls; plain /api/rms stays on the httpd task
+
+// Browser caching of embedded pages; ETag revalidation once max-age expires
+#define sWebAssetCacheControl           "public, max-age=86400"
+
+// Staging buffer for chunked responses written through the JSON writer
+#define iHttpChunkBufferBytes           512
+
+// Cached min/max envelopes for /api/samples?points=N
+#define iEnvelopeCacheEntries           4
+
+// ======================== Measurement history ========================
+// One 16-byte record per measurement; exported by /api/export
+#define iHistoryCapacity                25920   // 3 days at iMeasurePeriodSeconds 10, used with PSRAM
+#define iHistoryCapacityInternal        2160    // 6 hours (34 KB) when the ring must live in internal RAM
+#define iHistoryExportBatch             16      // Records copied per mutex hold
+#define iHistoryExportChunkBytes        1024    // Chunk size of export responses
+
+// ======================== Request rate limiting ========================
+// Token buckets per client IP, in requests per second and burst size
+#define iRateLimitClients               16
+#define iRateLimitCheapPerSec           20      // /api/rms, /api/status, /api/sta_ip, /api/boot, GET /api/wifi/power
+#define iRateLimitCheapBurst            40
+#define iRateLimitExpensivePerSec       2       // /api/samples, /api/snapshot, /api/capture, /api/export
+#define iRateLimitExpensiveBurst        6
+#define iRateLimitDeferMaxMs            150     // Longest wait for a capture window to close
+
+// ======================== Server-Sent Events stream ========================
+#define iSseMaxClients                  4
+#define iSseClientBufferBytes           3072
+#define iSseKeepAliveMs                 15000
+#define iSseSendRetryMs                 50      // Retry delay for a subscriber whose socket would block
+
+// ======================== Long-poll measurement requests ========================
+#define iLongPollMaxClients             4
+#define iLongPollDefaultTimeoutMs       15000
+#define iLongPollMaxTimeoutMs           30000
+
+// ======================== UDP telemetry publisher ========================
+// Sends one datagram per measurement to a multicast group or broadcast address
+#define bUdpTelemetryEnabled            false
+#define sUdpTelemetryAddress            "239.255.42.1"
+#define iUdpTelemetryPort               5005
+#define iUdpTelemetryTtl                1
+#define bUdpTelemetryIncludeWaveform    true
+
+// ======================== MQTT publisher ========================
+// Broker settings are stored in NVS via POST /api/mqtt; an empty URI disables publishing
+#define sMqttDefaultTopic               sDeviceName "/rms"
+#define iMqttDefaultBatchSize           1
+#define iMqttMaxBatchSize               16
+#define iMqttBatchMaxWaitMs             2000    // Partial batches are sent after this delay
+#define iMqttQueueDepth                 32      // Oldest results are dropped when full
+#define iMqttKeepAliveSeconds           30
+#define iMqttReconnectMs                5000
+
+// ======================== Modbus TCP server ========================
+// Read-only measurement registers; map in modbus_tcp.h
+#define bModbusEnabled                  true
+#define iModbusPort                     502
+#define iModbusMaxClients               2
+#define iModbusIdleTimeoutMs            60000
+#define iModbusSendTimeoutMs            2000    // A master that stops reading is dropped instead of stalling the others
+
+// ======================== WebSocket waveform stream ========================
+// Requires CONFIG_HTTPD_WS_SUPPORT in sdkconfig
+#define iWsMaxClients                   4
+#define iWsFrameIntervalMs              100
+// Share of wall time the stream may spend in capture windows, which busy-wait and hold the
+// capture mutex. A 60 ms window at 100 ms would block Adc_MeasureNow and /api/capture 60% of
+// the time; at 50% the period stretches to 120 ms (about 8 frames/s) instead. Stream windows
+// do not hold off deferred HTTP responses, so exports and samples may be sent during one at
+// the cost of some sample timing jitter in the streamed frames only.
+#define iWsMaxCaptureDutyPercent        50
+#define iWsFramePoolSize                (iWsMaxClients + 2)
+#define iWsMaxDecimation                16
@@ -0,0 +1,118 @@
+// Runs startup phases on short-lived tasks, each gated on event group bits of its dependencies.
+// Independent phases such as ADC calibration and Wi-Fi association overlap instead of queuing.
+// A failed phase sets a shared failure bit so nothing that depends on it starts.
+
+#include "boot_init.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "app_config.h"
+
+static const char *gTag = "BOOT_INIT";
+
+#define uiBootInitFailedBit             (1UL << iBootInitMaxPhases)
+
+typedef struct
+{
+    const boot_init_phase_t *psPhase;
+    uint32_t uiDoneBit;
+} boot_init_job_t;
+
+// One run per boot; the group is kept since finished tasks may still touch it on their way out
+static EventGroupHandle_t gsPhaseEvents = NULL;
+static boot_init_job_t gasJobs[iBootInitMaxPhases];
+static volatile esp_err_t geFirstError = ESP_OK;
+
+
+static void BootInit_PhaseTask(void *pvArg)
+{
+    // Waits for the phase's dependencies, runs it and publishes its done bit
+    // Gives up without running when any other phase failed
+    // Deletes itself; the runner only looks at the event group
+
+    boot_init_job_t *psJob = (boot_init_job_t *)pvArg;
+    const boot_init_phase_t *psPhase = psJob->psPhase;
+
+    // Wake on each outstanding dependency or a failure until all dependencies are done
+    EventBits_t uiBits = xEventGroupGetBits(gsPhaseEvents);
+    while ((uiBits & psPhase->uiAfterMask) != psPhase->uiAfterMask && (uiBits & uiBootInitFailedBit) == 0) {
+        uint32_t uiPending = psPhase->uiAfterMask & ~uiBits;
+        uiBits = xEventGroupWaitBits(gsPhaseEvents, uiPending | uiBootInitFailedBit, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+
+    if ((uiBits & uiBootInitFailedBit) == 0) {
+        BootTimeline_MarkStart(psPhase->eStep);
+        esp_err_t eErr = psPhase->pfnInit();
+        if (eErr == ESP_OK) {
+            BootTimeline_Mark(psPhase->eStep);
+            xEventGroupSetBits(gsPhaseEvents, psJob->uiDoneBit);
+        } else {
+            ESP_LOGE(gTag, "%s failed (%s)", psPhase->sName, esp_err_to_name(eErr));
+            if (geFirstError == ESP_OK) {
+                geFirstError = eErr;
+            }
+            xEventGroupSetBits(gsPhaseEvents, uiBootInitFailedBit);
+        }
+    }
+
+    vTaskDelete(NULL);
+}
+
+
+esp_err_t BootInit_Run(const boot_init_phase_t *pasPhases, int iPhaseCount)
+{
+    // Starts one task per phase and blocks until all are done or one failed
+    // Dependencies may only name earlier table entries, which rules out cycles
+    // Tasks run at the caller's priority, as the phases did when app_main ran them in turn
+
+    if (pasPhases == NULL || iPhaseCount <= 0 || iPhaseCount > iBootInitMaxPhases) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gsPhaseEvents != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Reject forward or self references before anything runs
+    for (int iIndex = 0; iIndex < iPhaseCount; iIndex++) {
+        uint32_t uiEarlier = BOOT_INIT_AFTER(iIndex) - 1;
+        if ((pasPhases[iIndex].uiAfterMask & ~uiEarlier) != 0 || pasPhases[iIndex].pfnInit == NULL) {
+            ESP_LOGE(gTag, "%s: bad phase entry", pasPhases[iIndex].sName);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    gsPhaseEvents = xEventGroupCreate();
+    if (gsPhaseEvents == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Start every phase; each blocks on its own dependencies
+    UBaseType_t uiPriority = uxTaskPriorityGet(NULL);
+    uint32_t uiAllDone = 0;
+    for (int iIndex = 0; iIndex < iPhaseCount; iIndex++) {
+        gasJobs[iIndex].psPhase = &pasPhases[iIndex];
+        gasJobs[iIndex].uiDoneBit = BOOT_INIT_AFTER(iIndex);
+        uiAllDone |= gasJobs[iIndex].uiDoneBit;
+
+        if (xTaskCreate(BootInit_PhaseTask, pasPhases[iIndex].sName, iBootInitTaskStackBytes, &gasJobs[iIndex],
+                        uiPriority, NULL) != pdPASS) {
+            ESP_LOGE(gTag, "No task for %s", pasPhases[iIndex].sName);
+            geFirstError = ESP_ERR_NO_MEM;
+            xEventGroupSetBits(gsPhaseEvents, uiBootInitFailedBit);
+            break;
+        }
+    }
+
+    // Wait until everything finished or something failed
+    EventBits_t uiBits = xEventGroupGetBits(gsPhaseEvents);
+    while ((uiBits & uiAllDone) != uiAllDone && (uiBits & uiBootInitFailedBit) == 0) {
+        uint32_t uiPending = uiAllDone & ~uiBits;
+        uiBits = xEventGroupWaitBits(gsPhaseEvents, uiPending | uiBootInitFailedBit, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+
+    return ((uiBits & uiBootInitFailedBit) != 0) ? geFirstError : ESP_OK;
+}
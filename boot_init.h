@@ -0,0 +1,30 @@
+// Declares the startup runner that brings subsystems up in dependency order.
+// Each phase names the phases it needs; phases whose needs are met run in parallel.
+// Start and end of every phase go to the boot timeline.
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "boot_timeline.h"
+
+// Most phases one run can hold; one event group bit each plus a failure bit
+#define iBootInitMaxPhases              23
+
+// Dependency mask entry for the phase at index iPhase of the same table
+#define BOOT_INIT_AFTER(iPhase)         (1UL << (iPhase))
+
+typedef esp_err_t (*boot_init_fn_t)(void);
+
+typedef struct
+{
+    const char *sName;              // Task name while the phase runs
+    boot_init_fn_t pfnInit;
+    uint32_t uiAfterMask;           // BOOT_INIT_AFTER() of every phase that must finish first
+    boot_step_t eStep;              // Timeline step marked around pfnInit
+} boot_init_phase_t;
+
+// Runs every phase on its own short-lived task as soon as its dependencies finished.
+// Returns after all phases finished, or with the first error; later phases are then skipped.
+// The table must stay valid until the call returns.
+esp_err_t BootInit_Run(const boot_init_phase_t *pasPhases, int iPhaseCount);
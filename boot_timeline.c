@@ -0,0 +1,316 @@
+// Records when each startup phase finishes and when the first IP and measurement arrive.
+// The record sits in RTC_NOINIT memory, so after a software reset, panic or watchdog the
+// previous boot is still readable; a magic and checksum reject power-on garbage.
+
+#include "boot_timeline.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "json_writer.h"
+#include "rate_limit.h"
+
+static const char *gTag = "BOOT";
+
+#define uiBootTimelineMagic             0x424F4F55u     // "BOOT" + layout version
+
+// The RTC layout; bump the magic when it changes so old records are dropped
+typedef struct
+{
+    uint32_t uiMagic;
+    boot_timeline_t sTimeline;
+    uint32_t uiChecksum;
+} boot_timeline_record_t;
+
+static RTC_NOINIT_ATTR boot_timeline_record_t gsRtcRecord;
+
+static boot_timeline_t gsPrevious;
+static bool gbHasPrevious = false;
+static portMUX_TYPE gsTimelineLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Rendered on the httpd task only, so one static buffer is enough
+static char gacBootJson[2560];
+
+static const char *const gasStepNames[BOOT_STEP_COUNT] = {
+    "app_main", "storage", "netif", "adc", "caches", "publishers", "wifi", "http", "scheduler", "ready",
+    "first_capture", "first_measurement", "first_ip",
+};
+
+
+static uint32_t BootTimeline_Checksum(const boot_timeline_t *psTimeline)
+{
+    // FNV-1a over the timeline bytes
+    // Catches records torn by a reset in the middle of a mark
+    // The struct has no padding, so only field bytes are hashed
+
+    const uint8_t *puiData = (const uint8_t *)psTimeline;
+    uint32_t uiHash = 2166136261u;
+    for (size_t szIndex = 0; szIndex < sizeof(*psTimeline); szIndex++) {
+        uiHash = (uiHash ^ puiData[szIndex]) * 16777619u;
+    }
+    return uiHash;
+}
+
+
+void BootTimeline_Begin(void)
+{
+    // Moves the record left by the last boot aside and starts a fresh one
+    // A valid record means a warm reset, so the boot count carries over
+    // Marks app_main, which shows how long ROM, bootloader and IDF startup took
+
+    uint32_t uiBootCount = 1;
+    if (gsRtcRecord.uiMagic == uiBootTimelineMagic &&
+        gsRtcRecord.uiChecksum == BootTimeline_Checksum(&gsRtcRecord.sTimeline)) {
+        gsPrevious = gsRtcRecord.sTimeline;
+        gbHasPrevious = true;
+        uiBootCount = gsPrevious.uiBootCount + 1;
+    }
+
+    // Start this boot's record
+    memset(&gsRtcRecord, 0, sizeof(gsRtcRecord));
+    gsRtcRecord.uiMagic = uiBootTimelineMagic;
+    gsRtcRecord.sTimeline.uiBootCount = uiBootCount;
+    gsRtcRecord.sTimeline.iResetReason = (int)esp_reset_reason();
+    gsRtcRecord.uiChecksum = BootTimeline_Checksum(&gsRtcRecord.sTimeline);
+
+    BootTimeline_Mark(BOOT_STEP_APP_MAIN);
+}
+
+
+void BootTimeline_MarkStart(boot_step_t eStep)
+{
+    // Stores the time a phase starts, for phases that run in parallel
+    // Called by the init runner right before each phase function
+    // Ignored for milestones and for phases that already started
+
+    if ((unsigned)eStep > BOOT_STEP_READY) {
+        return;
+    }
+
+    int64_t liNowUs = esp_timer_get_time();
+
+    portENTER_CRITICAL(&gsTimelineLock);
+    if (gsRtcRecord.uiMagic == uiBootTimelineMagic && gsRtcRecord.sTimeline.aliStartUs[eStep] == 0) {
+        gsRtcRecord.sTimeline.aliStartUs[eStep] = liNowUs;
+        gsRtcRecord.uiChecksum = BootTimeline_Checksum(&gsRtcRecord.sTimeline);
+    }
+    portEXIT_CRITICAL(&gsTimelineLock);
+}
+
+
+void BootTimeline_Mark(boot_step_t eStep)
+{
+    // Stores the current time for a step the first time it is reached
+    // Called from app_main, the measurement task and the Wi-Fi event loop
+    // Updates the checksum in the same critical section as the step
+
+    if ((unsigned)eStep >= BOOT_STEP_COUNT) {
+        return;
+    }
+
+    int64_t liNowUs = esp_timer_get_time();
+    bool bFirst = false;
+
+    portENTER_CRITICAL(&gsTimelineLock);
+    if (gsRtcRecord.uiMagic == uiBootTimelineMagic && gsRtcRecord.sTimeline.aliStepUs[eStep] == 0) {
+        gsRtcRecord.sTimeline.aliStepUs[eStep] = liNowUs;
+        gsRtcRecord.uiChecksum = BootTimeline_Checksum(&gsRtcRecord.sTimeline);
+        bFirst = true;
+    }
+    portEXIT_CRITICAL(&gsTimelineLock);
+
+    if (bFirst) {
+        ESP_LOGI(gTag, "%s at %lld ms", gasStepNames[eStep], (long long)(liNowUs / 1000));
+    }
+}
+
+
+void BootTimeline_GetCurrent(boot_timeline_t *psTimelineOut)
+{
+    // Copies this boot's record under the lock
+    // Steps not reached yet read as 0
+    // Safe to call before BootTimeline_Begin; everything reads as 0 then
+
+    if (psTimelineOut == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&gsTimelineLock);
+    if (gsRtcRecord.uiMagic == uiBootTimelineMagic) {
+        *psTimelineOut = gsRtcRecord.sTimeline;
+    } else {
+        memset(psTimelineOut, 0, sizeof(*psTimelineOut));
+    }
+    portEXIT_CRITICAL(&gsTimelineLock);
+}
+
+
+bool BootTimeline_GetPrevious(boot_timeline_t *psTimelineOut)
+{
+    // Copies the boot before this one when it survived the reset
+    // Returns false after a power-on, brownout or any reset that clears RTC memory
+    // The copy is taken once in BootTimeline_Begin and never changes afterwards
+
+    if (psTimelineOut == NULL || !gbHasPrevious) {
+        return false;
+    }
+
+    *psTimelineOut = gsPrevious;
+    return true;
+}
+
+
+const char *BootTimeline_GetStepName(boot_step_t eStep)
+{
+    // Returns the snake_case name used in /api/boot and /metrics
+    // Names never change so dashboards can key on them
+    // Returns "unknown" for out-of-range values
+
+    if ((unsigned)eStep >= BOOT_STEP_COUNT) {
+        return "unknown";
+    }
+    return gasStepNames[eStep];
+}
+
+
+static const char *BootTimeline_GetResetName(int iResetReason)
+{
+    // Maps esp_reset_reason_t to a short lower-case name
+    // Only the reasons a deployed node can see are named
+    // Everything else reads as "unknown"
+
+    switch ((esp_reset_reason_t)iResetReason) {
+        case ESP_RST_POWERON:
+            return "poweron";
+        case ESP_RST_EXT:
+            return "ext";
+        case ESP_RST_SW:
+            return "sw";
+        case ESP_RST_PANIC:
+            return "panic";
+        case ESP_RST_INT_WDT:
+            return "int_wdt";
+        case ESP_RST_TASK_WDT:
+            return "task_wdt";
+        case ESP_RST_WDT:
+            return "wdt";
+        case ESP_RST_DEEPSLEEP:
+            return "deepsleep";
+        case ESP_RST_BROWNOUT:
+            return "brownout";
+        default:
+            return "unknown";
+    }
+}
+
+
+static void BootTimeline_WriteTimeline(json_writer_t *psWriter, const boot_timeline_t *psTimeline)
+{
+    // Writes one boot as an object with its steps in boot order
+    // Phases carry startUs and tookUs; parallel phases overlap, so tookUs values do not add up
+    // Steps that were never reached are left out
+
+    JsonWriter_BeginObject(psWriter);
+    JsonWriter_Key(psWriter, "boot");
+    JsonWriter_Uint(psWriter, psTimeline->uiBootCount);
+    JsonWriter_Key(psWriter, "resetReason");
+    JsonWriter_String(psWriter, BootTimeline_GetResetName(psTimeline->iResetReason));
+    JsonWriter_Key(psWriter, "steps");
+    JsonWriter_BeginArray(psWriter);
+
+    int64_t liPhaseEndUs = 0;
+    for (int iStep = 0; iStep < BOOT_STEP_COUNT; iStep++) {
+        int64_t liAtUs = psTimeline->aliStepUs[iStep];
+        if (liAtUs == 0) {
+            continue;
+        }
+
+        JsonWriter_BeginObject(psWriter);
+        JsonWriter_Key(psWriter, "name");
+        JsonWriter_String(psWriter, gasStepNames[iStep]);
+        JsonWriter_Key(psWriter, "atUs");
+        JsonWriter_Int(psWriter, liAtUs);
+        if (iStep <= BOOT_STEP_READY) {
+            int64_t liStartUs = (psTimeline->aliStartUs[iStep] != 0) ? psTimeline->aliStartUs[iStep] : liPhaseEndUs;
+            JsonWriter_Key(psWriter, "startUs");
+            JsonWriter_Int(psWriter, liStartUs);
+            JsonWriter_Key(psWriter, "tookUs");
+            JsonWriter_Int(psWriter, liAtUs - liStartUs);
+            liPhaseEndUs = liAtUs;
+        }
+        JsonWriter_EndObject(psWriter);
+    }
+
+    JsonWriter_EndArray(psWriter);
+    JsonWriter_EndObject(psWriter);
+}
+
+
+static esp_err_t BootTimeline_HandleGet(httpd_req_t *psReq)
+{
+    // Returns this boot's timeline and the previous boot's, or null after a power-on
+    // The previous record shows where a boot that crashed or hung got to
+    // Small and cheap, so it is charged to the cheap rate-limit class
+
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_CHEAP)) {
+        return ESP_OK;
+    }
+
+    boot_timeline_t sCurrent;
+    boot_timeline_t sPrevious;
+    BootTimeline_GetCurrent(&sCurrent);
+    bool bHasPrevious = BootTimeline_GetPrevious(&sPrevious);
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, gacBootJson, sizeof(gacBootJson));
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, "uptimeUs");
+    JsonWriter_Int(&sWriter, esp_timer_get_time());
+    JsonWriter_Key(&sWriter, "current");
+    BootTimeline_WriteTimeline(&sWriter, &sCurrent);
+    JsonWriter_Key(&sWriter, "previous");
+    if (bHasPrevious) {
+        BootTimeline_WriteTimeline(&sWriter, &sPrevious);
+    } else {
+        JsonWriter_Null(&sWriter);
+    }
+    JsonWriter_EndObject(&sWriter);
+
+    int iLen = JsonWriter_Finish(&sWriter);
+    if (iLen < 0 || iLen >= (int)sizeof(gacBootJson)) {
+        return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Render failed");
+    }
+
+    httpd_resp_set_type(psReq, "application/json");
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+    return httpd_resp_send(psReq, gacBootJson, iLen);
+}
+
+
+esp_err_t BootTimeline_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Registers GET /api/boot on the shared HTTP server
+    // Works in AP and STA mode so a node that never got an IP can still be inspected
+    // Requires BootTimeline_Begin to have run for meaningful output
+
+    if (sHttpServer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Register GET /api/boot
+    httpd_uri_t sBootUri = {
+        .uri = "/api/boot",
+        .method = HTTP_GET,
+        .handler = BootTimeline_HandleGet,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sBootUri));
+
+    return ESP_OK;
+}
@@ -0,0 +1,55 @@
+// Declares the boot timeline recorder for startup phases and first milestones.
+// Timestamps come from esp_timer_get_time and live in RTC memory that survives warm resets.
+// The current and the previous boot are served as JSON at /api/boot.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Steps in boot order; phases record when they start and finish, milestones when first reached
+typedef enum
+{
+    BOOT_STEP_APP_MAIN = 0,         // app_main entered; ROM, bootloader and IDF startup come before
+    BOOT_STEP_STORAGE,              // NVS ready
+    BOOT_STEP_NETIF,                // TCP/IP stack and default event loop ready
+    BOOT_STEP_ADC,                  // ADC units, channels and calibration ready
+    BOOT_STEP_CACHES,               // RMS cache, long-poll, envelope and history
+    BOOT_STEP_PUBLISHERS,           // UDP, MQTT and Modbus
+    BOOT_STEP_WIFI,                 // Wi-Fi driver started, STA connect issued
+    BOOT_STEP_HTTP,                 // HTTP server running with every handler registered
+    BOOT_STEP_SCHEDULER,            // Measurement task created
+    BOOT_STEP_READY,                // Every init phase finished; app_main returns
+    BOOT_STEP_FIRST_CAPTURE,        // Scheduler starts its first capture
+    BOOT_STEP_FIRST_MEASUREMENT,    // First RMS result published
+    BOOT_STEP_FIRST_IP,             // First STA IPv4 address
+    BOOT_STEP_COUNT
+} boot_step_t;
+
+// Copy of one boot; times are microseconds since reset, 0 when never reached
+typedef struct
+{
+    uint32_t uiBootCount;           // Warm boots since the last power-on, starting at 1
+    int iResetReason;               // esp_reset_reason_t that started this boot
+    int64_t aliStartUs[BOOT_STEP_COUNT];    // Phase start; phases may overlap
+    int64_t aliStepUs[BOOT_STEP_COUNT];     // Phase end or milestone
+} boot_timeline_t;
+
+// Starts a new timeline and keeps the previous one; call first in app_main
+void BootTimeline_Begin(void);
+
+// Records when a phase starts; without it the phase is taken to start where the previous one ended
+void BootTimeline_MarkStart(boot_step_t eStep);
+
+// Records the time a step was reached; later calls for the same step are ignored
+void BootTimeline_Mark(boot_step_t eStep);
+
+// Copies the current boot, or the previous one when it survived in RTC memory
+void BootTimeline_GetCurrent(boot_timeline_t *psTimelineOut);
+bool BootTimeline_GetPrevious(boot_timeline_t *psTimelineOut);
+
+const char *BootTimeline_GetStepName(boot_step_t eStep);
+
+esp_err_t BootTimeline_RegisterHandlers(httpd_handle_t sHttpServer);
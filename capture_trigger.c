@@ -0,0 +1,94 @@
+// Implements the edge detector and ring indexing used by triggered captures.
+// The ADC loop stores each sample in the ring and pushes it here before taking the next one.
+// Pure arithmetic on counts and times, so it is tested on a host without the ADC.
+
+#include "capture_trigger.h"
+
+#include <string.h>
+
+
+int CaptureTrigger_PreSamples(int iCount, int iPreTriggerPercent)
+{
+    // Converts the pre-trigger share of the window to a sample count
+    // Keeps the trigger sample inside the window even at 100 %
+    // Rounds down like the documented percentage
+
+    int iPreSamples = (iCount * iPreTriggerPercent) / 100;
+    if (iPreSamples >= iCount) {
+        iPreSamples = iCount - 1;
+    }
+    return (iPreSamples < 0) ? 0 : iPreSamples;
+}
+
+
+void CaptureTrigger_Init(capture_trigger_t *psTrigger, int iCount, int iPreSamples, int32_t iLevelCounts,
+                         int32_t iHysteresisCounts, bool bRising, int64_t liDeadlineUs)
+{
+    // Prepares a detector for one window; the ring starts empty and unarmed
+    // A hysteresis below one count is raised to one so noise on the level cannot fire
+    // The deadline is absolute, in the same time base as the pushed times
+
+    memset(psTrigger, 0, sizeof(*psTrigger));
+    psTrigger->iCount = iCount;
+    psTrigger->iPreSamples = iPreSamples;
+    psTrigger->iLevelCounts = iLevelCounts;
+    psTrigger->iHysteresisCounts = (iHysteresisCounts < 1) ? 1 : iHysteresisCounts;
+    psTrigger->bRising = bRising;
+    psTrigger->liDeadlineUs = liDeadlineUs;
+    psTrigger->iStopAt = -1;
+}
+
+
+int CaptureTrigger_NextSlot(const capture_trigger_t *psTrigger)
+{
+    // Returns the ring slot the next sample must be stored in
+    // Counts every sample pushed so far, so the ring wraps every iCount samples
+    // The caller stores the sample there before CaptureTrigger_Push tests it
+
+    return psTrigger->iTotal % psTrigger->iCount;
+}
+
+
+bool CaptureTrigger_Push(capture_trigger_t *psTrigger, int32_t iValue, int64_t liNowUs)
+{
+    // Arms once the signal is past the level by the hysteresis, then fires on the crossing
+    // After a trigger, stops iCount - iPreSamples samples later so the trigger lands at iPreSamples
+    // Without one, stops on a full ring once the deadline passed
+
+    if (psTrigger->iStopAt < 0) {
+        int32_t iFromLevel = psTrigger->bRising ? (psTrigger->iLevelCounts - iValue)
+                                                : (iValue - psTrigger->iLevelCounts);
+        if (iFromLevel >= psTrigger->iHysteresisCounts) {
+            psTrigger->bArmed = true;
+        } else if (psTrigger->bArmed && iFromLevel <= 0) {
+
+            // An edge before the pre-trigger history is full only re-arms for the next one
+            psTrigger->bArmed = false;
+            if (psTrigger->iTotal >= psTrigger->iPreSamples) {
+                psTrigger->iStopAt = psTrigger->iTotal - psTrigger->iPreSamples + psTrigger->iCount;
+                psTrigger->iStart = (psTrigger->iTotal - psTrigger->iPreSamples) % psTrigger->iCount;
+                psTrigger->bTriggered = true;
+            }
+        }
+    }
+
+    // Auto mode: hand back the latest full ring once the deadline passed
+    if (psTrigger->iStopAt < 0 && psTrigger->iTotal >= psTrigger->iCount - 1 && liNowUs >= psTrigger->liDeadlineUs) {
+        psTrigger->iStopAt = psTrigger->iTotal + 1;
+        psTrigger->iStart = psTrigger->iStopAt % psTrigger->iCount;
+    }
+
+    psTrigger->iTotal++;
+    return (psTrigger->iStopAt >= 0 && psTrigger->iTotal >= psTrigger->iStopAt);
+}
+
+
+void CaptureTrigger_Linearize(const uint16_t *puRing, uint16_t *puOut, int iCount, int iStart)
+{
+    // Copies a ring buffer into time order starting at iStart
+    // Uses two block copies around the wrap point
+    // Output must not overlap the ring
+
+    memcpy(puOut, &puRing[iStart], (size_t)(iCount - iStart) * sizeof(uint16_t));
+    memcpy(&puOut[iCount - iStart], puRing, (size_t)iStart * sizeof(uint16_t));
+}
@@ -0,0 +1,38 @@
+// Declares the edge detector and ring indexing used by triggered captures.
+// Works on one sample at a time so the ADC loop can test each value as it is read.
+// Has no ESP-IDF dependencies so tools/capture_trigger_test.c can check it on a host.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct
+{
+    int iCount;                     // Ring and window length in samples
+    int iPreSamples;                // Samples kept before the trigger sample
+    int32_t iLevelCounts;
+    int32_t iHysteresisCounts;      // Distance past the level that arms the detector, at least 1
+    bool bRising;
+    int64_t liDeadlineUs;           // Auto mode returns the latest full ring after this time
+    int iTotal;                     // Samples pushed so far; the next one goes to slot iTotal % iCount
+    int iStopAt;                    // Total at which the window is complete, -1 while waiting
+    bool bArmed;
+    bool bTriggered;
+    int iStart;                     // Ring slot of the first sample in time order once complete
+} capture_trigger_t;
+
+// Samples before the trigger for a pre-trigger share; kept below iCount so the trigger sample fits
+int CaptureTrigger_PreSamples(int iCount, int iPreTriggerPercent);
+
+void CaptureTrigger_Init(capture_trigger_t *psTrigger, int iCount, int iPreSamples, int32_t iLevelCounts,
+                         int32_t iHysteresisCounts, bool bRising, int64_t liDeadlineUs);
+
+// Ring slot the next sample must be stored in before it is pushed
+int CaptureTrigger_NextSlot(const capture_trigger_t *psTrigger);
+
+// Tests the sample just stored at CaptureTrigger_NextSlot; returns true once the window is complete
+bool CaptureTrigger_Push(capture_trigger_t *psTrigger, int32_t iValue, int64_t liNowUs);
+
+// Copies a ring into time order starting at iStart; output must not overlap the ring
+void CaptureTrigger_Linearize(const uint16_t *puRing, uint16_t *puOut, int iCount, int iStart);
@@ -0,0 +1,136 @@
+// Computes min/max envelopes of capture windows for bandwidth-limited clients.
+// Splits the window into buckets and keeps each bucket's minimum and maximum in time order.
+// Remembers the last few envelopes so repeated polls for the same capture cost a memcpy.
+
+#include "envelope.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "app_config.h"
+
+typedef struct
+{
+    int64_t liTimestampUs;
+    int iPoints;
+    int iSourceSamples;
+    int iCount;
+    int16_t aiChannelA_mV[iSamples_PerCh];
+    int16_t aiChannelB_mV[iSamples_PerCh];
+} envelope_entry_t;
+
+static SemaphoreHandle_t gsEnvelopeMutex = NULL;
+static envelope_entry_t gasEntries[iEnvelopeCacheEntries];
+static int giNextEntry = 0;
+
+
+static int Envelope_ReduceChannel(const int16_t *piIn, int iSamples, int iBuckets, int16_t *piOut)
+{
+    // Reduces one channel to a min and max per bucket in a single pass
+    // Emits the two extremes in the order they occur so the trace keeps its shape
+    // Returns the number of samples written
+
+    int iOut = 0;
+
+    for (int iBucket = 0; iBucket < iBuckets; iBucket++) {
+        int iStart = (int)(((int64_t)iBucket * iSamples) / iBuckets);
+        int iEnd = (int)(((int64_t)(iBucket + 1) * iSamples) / iBuckets);
+
+        int iMinIndex = iStart;
+        int iMaxIndex = iStart;
+        for (int iIndex = iStart + 1; iIndex < iEnd; iIndex++) {
+            if (piIn[iIndex] < piIn[iMinIndex]) iMinIndex = iIndex;
+            if (piIn[iIndex] > piIn[iMaxIndex]) iMaxIndex = iIndex;
+        }
+
+        if (iMinIndex <= iMaxIndex) {
+            piOut[iOut++] = piIn[iMinIndex];
+            piOut[iOut++] = piIn[iMaxIndex];
+        } else {
+            piOut[iOut++] = piIn[iMaxIndex];
+            piOut[iOut++] = piIn[iMinIndex];
+        }
+    }
+
+    return iOut;
+}
+
+
+esp_err_t Envelope_Init(void)
+{
+    // Creates the cache mutex and marks all entries empty
+    // Must run before the HTTP API serves ?points= requests
+    // Safe to call more than once
+
+    if (gsEnvelopeMutex == NULL) {
+        gsEnvelopeMutex = xSemaphoreCreateMutex();
+    }
+    if (gsEnvelopeMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int iIndex = 0; iIndex < iEnvelopeCacheEntries; iIndex++) {
+        gasEntries[iIndex].iPoints = 0;
+    }
+    giNextEntry = 0;
+
+    return ESP_OK;
+}
+
+
+int Envelope_GetMinMax(int64_t liTimestampUs, int iPoints,
+                       const int16_t *piChannelA_mV, const int16_t *piChannelB_mV, int iSamples,
+                       int16_t *piOutA_mV, int16_t *piOutB_mV)
+{
+    // Returns the min/max envelope of one capture for a requested point count
+    // Serves repeated requests for the same capture and count from the cache
+    // Copies the input unchanged when it already fits into iPoints
+
+    // Validate arguments
+    if (piChannelA_mV == NULL || piChannelB_mV == NULL || piOutA_mV == NULL || piOutB_mV == NULL ||
+        iSamples <= 0 || iSamples > iSamples_PerCh || iPoints < 2 || gsEnvelopeMutex == NULL) {
+        return -1;
+    }
+
+    // Small windows need no reduction
+    if (iPoints >= iSamples) {
+        memcpy(piOutA_mV, piChannelA_mV, (size_t)iSamples * sizeof(int16_t));
+        memcpy(piOutB_mV, piChannelB_mV, (size_t)iSamples * sizeof(int16_t));
+        return iSamples;
+    }
+
+    xSemaphoreTake(gsEnvelopeMutex, portMAX_DELAY);
+
+    // Look for a cached envelope of this capture
+    for (int iIndex = 0; iIndex < iEnvelopeCacheEntries; iIndex++) {
+        envelope_entry_t *psEntry = &gasEntries[iIndex];
+        if (psEntry->iPoints == iPoints && psEntry->liTimestampUs == liTimestampUs &&
+            psEntry->iSourceSamples == iSamples) {
+            int iCount = psEntry->iCount;
+            memcpy(piOutA_mV, psEntry->aiChannelA_mV, (size_t)iCount * sizeof(int16_t));
+            memcpy(piOutB_mV, psEntry->aiChannelB_mV, (size_t)iCount * sizeof(int16_t));
+            xSemaphoreGive(gsEnvelopeMutex);
+            return iCount;
+        }
+    }
+
+    // Compute into the oldest entry
+    envelope_entry_t *psEntry = &gasEntries[giNextEntry];
+    giNextEntry = (giNextEntry + 1) % iEnvelopeCacheEntries;
+
+    int iBuckets = iPoints / 2;
+    psEntry->iCount = Envelope_ReduceChannel(piChannelA_mV, iSamples, iBuckets, psEntry->aiChannelA_mV);
+    (void)Envelope_ReduceChannel(piChannelB_mV, iSamples, iBuckets, psEntry->aiChannelB_mV);
+    psEntry->liTimestampUs = liTimestampUs;
+    psEntry->iPoints = iPoints;
+    psEntry->iSourceSamples = iSamples;
+
+    int iCount = psEntry->iCount;
+    memcpy(piOutA_mV, psEntry->aiChannelA_mV, (size_t)iCount * sizeof(int16_t));
+    memcpy(piOutB_mV, psEntry->aiChannelB_mV, (size_t)iCount * sizeof(int16_t));
+
+    xSemaphoreGive(gsEnvelopeMutex);
+    return iCount;
+}
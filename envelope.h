@@ -0,0 +1,16 @@
+// Declares the min/max envelope decimator for waveform endpoints.
+// Reduces a capture window to a requested point count while keeping peaks visible.
+// Caches recent results per capture timestamp and point count.
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+esp_err_t Envelope_Init(void);
+
+// Writes at most iPoints samples per channel (min/max pairs in time order) and returns the count.
+// Returns iSamples with a plain copy when no reduction is needed, or -1 on invalid arguments.
+int Envelope_GetMinMax(int64_t liTimestampUs, int iPoints,
+                       const int16_t *piChannelA_mV, const int16_t *piChannelB_mV, int iSamples,
+                       int16_t *piOutA_mV, int16_t *piOutB_mV);
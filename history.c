@@ -0,0 +1,185 @@
+// Keeps recent RMS results in a fixed ring for bulk export.
+// Allocates the ring once at boot, from PSRAM when the board has it.
+// Readers copy small batches under the mutex and format them outside it.
+
+#include "history.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "adc.h"
+#include "app_config.h"
+
+static const char *gTag = "HISTORY";
+
+static SemaphoreHandle_t gsHistoryMutex = NULL;
+static history_record_t *gpasRing = NULL;
+static uint32_t guiCapacity = 0;
+static uint32_t guiCount = 0;
+static uint32_t guiNextSeq = 0;
+static bool gbInPsram = false;
+
+
+static void History_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Appends one published measurement to the ring
+    // Overwrites the oldest record once the ring is full
+    // Holds the mutex only for a 16-byte store
+
+    (void)pvCtx;
+
+    history_record_t sRecord = {
+        .liTimestampUs = psResult->liTimestampUs,
+        .fRmsVoltsChA = psResult->fRmsVoltsChA,
+        .fRmsVoltsChB = psResult->fRmsVoltsChB,
+    };
+
+    xSemaphoreTake(gsHistoryMutex, portMAX_DELAY);
+    gpasRing[guiNextSeq % guiCapacity] = sRecord;
+    guiNextSeq++;
+    if (guiCount < guiCapacity) {
+        guiCount++;
+    }
+    xSemaphoreGive(gsHistoryMutex);
+}
+
+
+esp_err_t History_Init(void)
+{
+    // Allocates the ring and registers it with the ADC publish path
+    // Prefers PSRAM for the full iHistoryCapacity and falls back to a smaller internal ring
+    // Must run after Adc_Init and before the first measurement
+
+    if (gpasRing != NULL) {
+        return ESP_OK;
+    }
+
+    gsHistoryMutex = xSemaphoreCreateMutex();
+    if (gsHistoryMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Try PSRAM first; it holds days of records without touching internal RAM
+#if CONFIG_SPIRAM
+    gpasRing = heap_caps_malloc(iHistoryCapacity * sizeof(history_record_t), MALLOC_CAP_SPIRAM);
+    if (gpasRing != NULL) {
+        guiCapacity = iHistoryCapacity;
+        gbInPsram = true;
+    }
+#endif
+
+    // Fall back to internal RAM with the reduced capacity
+    if (gpasRing == NULL) {
+        gpasRing = heap_caps_malloc(iHistoryCapacityInternal * sizeof(history_record_t),
+                                    MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        guiCapacity = iHistoryCapacityInternal;
+    }
+    if (gpasRing == NULL) {
+        ESP_LOGE(gTag, "No memory for %d records", iHistoryCapacityInternal);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(gTag, "%u records (%u bytes) in %s", (unsigned)guiCapacity,
+             (unsigned)(guiCapacity * sizeof(history_record_t)), gbInPsram ? "PSRAM" : "internal RAM");
+
+    return Adc_RegisterPublishHook(History_OnPublish, NULL);
+}
+
+
+int History_Read(uint32_t uiFromSeq, uint32_t uiEndSeq, history_record_t *pasOut, int iMax,
+                 uint32_t *puiFirstSeqOut)
+{
+    // Copies a run of consecutive records into the caller array
+    // Skips forward to the oldest kept record when the requested one was overwritten
+    // Uses wrap-safe sequence arithmetic throughout
+
+    if (gpasRing == NULL || pasOut == NULL || iMax <= 0) {
+        return 0;
+    }
+
+    int iCopied = 0;
+
+    xSemaphoreTake(gsHistoryMutex, portMAX_DELAY);
+
+    // Clamp the requested range to what the ring still holds
+    uint32_t uiOldestSeq = guiNextSeq - guiCount;
+    if ((int32_t)(uiFromSeq - uiOldestSeq) < 0) {
+        uiFromSeq = uiOldestSeq;
+    }
+    if ((int32_t)(uiEndSeq - guiNextSeq) > 0) {
+        uiEndSeq = guiNextSeq;
+    }
+
+    // Copy record by record; the batch is small and may wrap around the ring end
+    while (iCopied < iMax && (int32_t)(uiEndSeq - (uiFromSeq + (uint32_t)iCopied)) > 0) {
+        pasOut[iCopied] = gpasRing[(uiFromSeq + (uint32_t)iCopied) % guiCapacity];
+        iCopied++;
+    }
+
+    xSemaphoreGive(gsHistoryMutex);
+
+    if (puiFirstSeqOut != NULL) {
+        *puiFirstSeqOut = uiFromSeq;
+    }
+
+    return iCopied;
+}
+
+
+uint32_t History_FindSeq(int64_t liTimestampUs)
+{
+    // Finds the first kept record at or after a timestamp by binary search
+    // Relies on records being stored in measurement order
+    // Returns the next sequence when no kept record qualifies
+
+    if (gpasRing == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(gsHistoryMutex, portMAX_DELAY);
+
+    uint32_t uiLow = guiNextSeq - guiCount;
+    uint32_t uiHigh = guiNextSeq;
+    while (uiLow != uiHigh) {
+        uint32_t uiMid = uiLow + ((uiHigh - uiLow) / 2);
+        if (gpasRing[uiMid % guiCapacity].liTimestampUs < liTimestampUs) {
+            uiLow = uiMid + 1;
+        } else {
+            uiHigh = uiMid;
+        }
+    }
+
+    xSemaphoreGive(gsHistoryMutex);
+
+    return uiLow;
+}
+
+
+void History_GetStats(history_stats_t *psStatsOut)
+{
+    // Copies ring size and sequence bounds under the mutex
+    // Used by /metrics and by export response headers
+    // Reports zero capacity before History_Init succeeded
+
+    if (psStatsOut == NULL) {
+        return;
+    }
+
+    memset(psStatsOut, 0, sizeof(*psStatsOut));
+    if (gpasRing == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(gsHistoryMutex, portMAX_DELAY);
+    psStatsOut->uiCapacity = guiCapacity;
+    psStatsOut->uiCount = guiCount;
+    psStatsOut->uiOldestSeq = guiNextSeq - guiCount;
+    psStatsOut->uiNextSeq = guiNextSeq;
+    psStatsOut->bInPsram = gbInPsram;
+    xSemaphoreGive(gsHistoryMutex);
+}
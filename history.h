@@ -0,0 +1,32 @@
+// Declares the in-memory measurement history ring fed by the ADC publish hook.
+// Records are addressed by a sequence number that rises by one per measurement.
+// Sequence numbers double as export cursors, so downloads can resume after a break.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "history_format.h"
+
+typedef struct
+{
+    uint32_t uiCapacity;
+    uint32_t uiCount;
+    uint32_t uiOldestSeq;
+    uint32_t uiNextSeq;
+    bool bInPsram;
+} history_stats_t;
+
+esp_err_t History_Init(void);
+
+// Copies up to iMax records starting at uiFromSeq, or at the oldest kept record if that
+// one was already overwritten. Stops before uiEndSeq. Returns the count and first sequence.
+int History_Read(uint32_t uiFromSeq, uint32_t uiEndSeq, history_record_t *pasOut, int iMax,
+                 uint32_t *puiFirstSeqOut);
+
+// Returns the sequence of the first kept record at or after liTimestampUs,
+// or the next sequence to be written if every kept record is older
+uint32_t History_FindSeq(int64_t liTimestampUs);
+
+void History_GetStats(history_stats_t *psStatsOut);
@@ -0,0 +1,137 @@
+// Encodes history records as CSV, newline-delimited JSON or CBOR sequence rows.
+// Builds each row in a small local buffer and appends it with a single write.
+// NDJSON and CBOR rows come from one serializer so their members always match.
+
+#include "history_format.h"
+
+#include <string.h>
+
+// Decimals used for RMS volts, matching Proto_WriteRmsJson
+#define iHistoryFormatDecimals          6
+
+static const char gsCsvHeader[] = "seq,timestampUs,rmsA,rmsB\n";
+
+
+static void HistoryFormat_WriteRecord(json_writer_t *psWriter, uint32_t uiSeq, const history_record_t *psRecord)
+{
+    // Writes one record as an object; the schema shared by NDJSON and CBOR rows
+    // Member names match /api/rms so clients reuse their field mapping
+    // Uses the same six-decimal RMS precision as /api/rms
+
+    JsonWriter_BeginObject(psWriter);
+    JsonWriter_Key(psWriter, "seq");
+    JsonWriter_Uint(psWriter, uiSeq);
+    JsonWriter_Key(psWriter, "timestampUs");
+    JsonWriter_Int(psWriter, psRecord->liTimestampUs);
+    JsonWriter_Key(psWriter, "rmsA");
+    JsonWriter_Float(psWriter, psRecord->fRmsVoltsChA, iHistoryFormatDecimals);
+    JsonWriter_Key(psWriter, "rmsB");
+    JsonWriter_Float(psWriter, psRecord->fRmsVoltsChB, iHistoryFormatDecimals);
+    JsonWriter_EndObject(psWriter);
+}
+
+
+bool HistoryFormat_Parse(const char *sName, history_format_t *peFormatOut)
+{
+    // Maps the "format" query value to an encoder
+    // Accepts lower-case names only, as documented in the README
+    // Leaves the output untouched when the name is unknown
+
+    if (sName == NULL || peFormatOut == NULL) {
+        return false;
+    }
+
+    if (strcmp(sName, "csv") == 0) {
+        *peFormatOut = HISTORY_FORMAT_CSV;
+        return true;
+    }
+    if (strcmp(sName, "ndjson") == 0) {
+        *peFormatOut = HISTORY_FORMAT_NDJSON;
+        return true;
+    }
+    if (strcmp(sName, "cbor") == 0) {
+        *peFormatOut = HISTORY_FORMAT_CBOR;
+        return true;
+    }
+
+    return false;
+}
+
+
+const char *HistoryFormat_GetContentType(history_format_t eFormat)
+{
+    // Returns the HTTP media type of an encoding
+    // Falls back to plain text for out-of-range values
+    // Strings are static
+
+    switch (eFormat) {
+        case HISTORY_FORMAT_CSV:
+            return "text/csv";
+        case HISTORY_FORMAT_NDJSON:
+            return "application/x-ndjson";
+        case HISTORY_FORMAT_CBOR:
+            return "application/cbor-seq";
+        default:
+            return "text/plain";
+    }
+}
+
+
+void HistoryFormat_WriteHeader(json_writer_t *psWriter, history_format_t eFormat)
+{
+    // Writes the column names that start a CSV export
+    // Writes nothing for NDJSON and CBOR since every row names its fields
+    // Must be called once before the first row
+
+    if (eFormat == HISTORY_FORMAT_CSV) {
+        JsonWriter_Raw(psWriter, gsCsvHeader, sizeof(gsCsvHeader) - 1);
+    }
+}
+
+
+int HistoryFormat_FormatRow(char *psOut, history_format_t eFormat, uint32_t uiSeq, const history_record_t *psRecord)
+{
+    // Formats one record with its sequence number; text rows end with a newline
+    // Uses the JSON writer and its digit loops instead of snprintf
+    // Returns the row length; the output is not NUL terminated
+
+    int iLen = 0;
+
+    // Object rows share one serializer; the writer keeps a byte for its terminator
+    if (eFormat == HISTORY_FORMAT_NDJSON || eFormat == HISTORY_FORMAT_CBOR) {
+        json_writer_t sWriter;
+        JsonWriter_InitBuffer(&sWriter, psOut, iHistoryFormatRowMax);
+        if (eFormat == HISTORY_FORMAT_CBOR) {
+            JsonWriter_SetEncoding(&sWriter, JSON_WRITER_ENCODING_CBOR);
+        }
+        HistoryFormat_WriteRecord(&sWriter, uiSeq, psRecord);
+        if (eFormat == HISTORY_FORMAT_NDJSON) {
+            JsonWriter_Raw(&sWriter, "\n", 1);
+        }
+        iLen = JsonWriter_Finish(&sWriter);
+        return (iLen < iHistoryFormatRowMax) ? iLen : (iHistoryFormatRowMax - 1);
+    }
+
+    iLen += JsonWriter_FormatInt(psOut + iLen, uiSeq);
+    psOut[iLen++] = ',';
+    iLen += JsonWriter_FormatInt(psOut + iLen, psRecord->liTimestampUs);
+    psOut[iLen++] = ',';
+    iLen += JsonWriter_FormatFloat(psOut + iLen, psRecord->fRmsVoltsChA, iHistoryFormatDecimals);
+    psOut[iLen++] = ',';
+    iLen += JsonWriter_FormatFloat(psOut + iLen, psRecord->fRmsVoltsChB, iHistoryFormatDecimals);
+    psOut[iLen++] = '\n';
+    return iLen;
+}
+
+
+void HistoryFormat_WriteRow(json_writer_t *psWriter, history_format_t eFormat, uint32_t uiSeq,
+                            const history_record_t *psRecord)
+{
+    // Formats one row on the stack and appends it to the writer
+    // The writer flushes full chunks, so memory stays constant per export
+    // Rows never need escaping since every field is numeric
+
+    char acRow[iHistoryFormatRowMax];
+    int iLen = HistoryFormat_FormatRow(acRow, eFormat, uiSeq, psRecord);
+    JsonWriter_Raw(psWriter, acRow, (size_t)iLen);
+}
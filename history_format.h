@@ -0,0 +1,44 @@
+// Declares the history record and its CSV, NDJSON and CBOR row encoders.
+// Rows are formatted with the JSON writer, one append per row.
+// Has no ESP-IDF dependencies so tools/export_row_bench.c can time it on a host.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "json_writer.h"
+
+// One stored measurement; the sequence number is implied by the ring position
+typedef struct
+{
+    int64_t liTimestampUs;
+    float fRmsVoltsChA;
+    float fRmsVoltsChB;
+} history_record_t;
+
+typedef enum
+{
+    HISTORY_FORMAT_CSV = 0,
+    HISTORY_FORMAT_NDJSON,
+    HISTORY_FORMAT_CBOR,            // CBOR sequence (RFC 8742), one map per row
+    HISTORY_FORMAT_COUNT
+} history_format_t;
+
+// Longest row produced by HistoryFormat_WriteRow, including the newline
+#define iHistoryFormatRowMax            128
+
+// Maps "csv", "ndjson" or "cbor" to a format; returns false for anything else
+bool HistoryFormat_Parse(const char *sName, history_format_t *peFormatOut);
+
+const char *HistoryFormat_GetContentType(history_format_t eFormat);
+
+// Writes the CSV column header; NDJSON and CBOR have none
+void HistoryFormat_WriteHeader(json_writer_t *psWriter, history_format_t eFormat);
+
+// Formats one row into psOut (iHistoryFormatRowMax bytes) and returns its length
+int HistoryFormat_FormatRow(char *psOut, history_format_t eFormat, uint32_t uiSeq, const history_record_t *psRecord);
+
+// Formats one row and appends it to the writer
+void HistoryFormat_WriteRow(json_writer_t *psWriter, history_format_t eFormat, uint32_t uiSeq,
+                            const history_record_t *psRecord);
@@ -0,0 +1,281 @@
+// Runs slow or large HTTP responses on a small pool of worker tasks.
+// The httpd task only parses requests and hands them over, so one slow client
+// cannot stall every other API client behind a blocking send.
+
+#include "http_workers.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "rate_limit.h"
+#include "app_config.h"
+
+static const char *gTag = "HTTP_WORKERS";
+
+typedef struct
+{
+    httpd_req_t *psReq;
+    http_work_fn_t pfnWork;
+    http_work_class_t eClass;
+} http_work_item_t;
+
+static const char *const gasClassNames[HTTP_WORK_CLASS_COUNT] = {
+    [HTTP_WORK_SAMPLES] = "samples",
+    [HTTP_WORK_SNAPSHOT] = "snapshot",
+    [HTTP_WORK_METRICS] = "metrics",
+    [HTTP_WORK_EXPORT] = "export",
+    [HTTP_WORK_CAPTURE] = "capture",
+    [HTTP_WORK_RMS] = "rms",
+};
+
+static const uint16_t gauClassCaps[HTTP_WORK_CLASS_COUNT] = {
+    [HTTP_WORK_SAMPLES] = iHttpCapSamples,
+    [HTTP_WORK_SNAPSHOT] = iHttpCapSnapshot,
+    [HTTP_WORK_METRICS] = iHttpCapMetrics,
+    [HTTP_WORK_EXPORT] = iHttpCapExport,
+    [HTTP_WORK_CAPTURE] = iHttpCapCapture,
+    [HTTP_WORK_RMS] = iHttpCapRms,
+};
+
+static QueueHandle_t gsWorkQueue = NULL;
+static portMUX_TYPE gsStatsLock = portMUX_INITIALIZER_UNLOCKED;
+static http_work_stats_t gasStats[HTTP_WORK_CLASS_COUNT];
+
+
+static bool HttpWorkers_Acquire(http_work_class_t eClass)
+{
+    // Reserves one in-flight slot of an endpoint class
+    // Counts a rejection when the class is already at its cap
+    // Returns true when the caller may start the request
+
+    bool bOk = false;
+
+    portENTER_CRITICAL(&gsStatsLock);
+    http_work_stats_t *psStats = &gasStats[eClass];
+    if (psStats->uiActive < gauClassCaps[eClass]) {
+        psStats->uiActive++;
+        psStats->uiDispatched++;
+        if (psStats->uiActive > psStats->uiPeakActive) {
+            psStats->uiPeakActive = psStats->uiActive;
+        }
+        bOk = true;
+    } else {
+        psStats->uiRejected++;
+    }
+    portEXIT_CRITICAL(&gsStatsLock);
+
+    return bOk;
+}
+
+
+static void HttpWorkers_Release(http_work_class_t eClass, bool bRejected)
+{
+    // Frees the in-flight slot taken by HttpWorkers_Acquire
+    // Moves the request from dispatched to rejected when it never ran
+    // Called exactly once per successful acquire
+
+    portENTER_CRITICAL(&gsStatsLock);
+    gasStats[eClass].uiActive--;
+    if (bRejected) {
+        gasStats[eClass].uiDispatched--;
+        gasStats[eClass].uiRejected++;
+    }
+    portEXIT_CRITICAL(&gsStatsLock);
+}
+
+
+static esp_err_t HttpWorkers_SendBusy(httpd_req_t *psReq)
+{
+    // Answers 503 so the client backs off instead of queueing more work
+    // Uses a short Retry-After that matches the dashboard poll interval
+    // Sends a tiny JSON body that API clients can parse
+
+    httpd_resp_set_status(psReq, "503 Service Unavailable");
+    httpd_resp_set_type(psReq, "application/json");
+    httpd_resp_set_hdr(psReq, "Retry-After", "1");
+    return httpd_resp_sendstr(psReq, "{\"error\":\"busy\"}");
+}
+
+
+static void HttpWorkers_Run(const http_work_item_t *psItem)
+{
+    // Serves one detached request and hands it back to httpd
+    // Starts the response in the gap between ADC capture windows
+    // Closes the connection when the handler fails, then frees the class slot
+
+    RateLimit_DeferForAcquisition();
+    esp_err_t eErr = psItem->pfnWork(psItem->psReq);
+
+    // A failed handler may have left a response half sent, so the connection cannot be reused
+    if (eErr != ESP_OK) {
+        ESP_LOGW(gTag, "%s request failed: %s", gasClassNames[psItem->eClass], esp_err_to_name(eErr));
+        (void)httpd_sess_trigger_close(psItem->psReq->handle, httpd_req_to_sockfd(psItem->psReq));
+    }
+    (void)httpd_req_async_handler_complete(psItem->psReq);
+    HttpWorkers_Release(psItem->eClass, false);
+}
+
+
+static void HttpWorkers_Enqueue(const http_work_item_t *psItem)
+{
+    // Queues a detached request that already holds its class slot
+    // Queues without waiting; a full queue means every worker is already behind
+    // Answers 503 and completes the request itself when it cannot be queued
+
+    if (xQueueSend(gsWorkQueue, psItem, 0) != pdTRUE) {
+        (void)HttpWorkers_SendBusy(psItem->psReq);
+        (void)httpd_req_async_handler_complete(psItem->psReq);
+        HttpWorkers_Release(psItem->eClass, true);
+    }
+}
+
+
+static void HttpWorkers_Task(void *pvArg)
+{
+    // Serves detached requests from the shared queue
+    // Blocks on the queue between requests
+    // Never returns
+
+    (void)pvArg;
+
+    http_work_item_t sItem;
+
+    while (1) {
+        if (xQueueReceive(gsWorkQueue, &sItem, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        HttpWorkers_Run(&sItem);
+    }
+}
+
+
+esp_err_t HttpWorkers_Init(void)
+{
+    // Creates the work queue and iHttpWorkerCount worker tasks
+    // Must run before the first dispatch; later dispatches fall back to inline
+    // Safe to call more than once
+
+    if (gsWorkQueue != NULL) {
+        return ESP_OK;
+    }
+
+    gsWorkQueue = xQueueCreate(iHttpWorkQueueDepth, sizeof(http_work_item_t));
+    if (gsWorkQueue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int iIndex = 0; iIndex < iHttpWorkerCount; iIndex++) {
+        char sName[16];
+        snprintf(sName, sizeof(sName), "httpd_wk%d", iIndex);
+        BaseType_t bOk = xTaskCreate(HttpWorkers_Task, sName, iHttpWorkerStackBytes, NULL, iHttpTaskPriority, NULL);
+        if (bOk != pdPASS) {
+            ESP_LOGE(gTag, "Failed to start %s", sName);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    ESP_LOGI(gTag, "%d workers, queue depth %d", iHttpWorkerCount, iHttpWorkQueueDepth);
+    return ESP_OK;
+}
+
+
+esp_err_t HttpWorkers_Dispatch(httpd_req_t *psReq, http_work_class_t eClass, http_work_fn_t pfnWork)
+{
+    // Detaches the request and queues it for a worker
+    // Enforces the per-class cap before any work or copy is made
+    // Returns immediately so the httpd task can accept the next request
+
+    if (psReq == NULL || pfnWork == NULL || (int)eClass < 0 || eClass >= HTTP_WORK_CLASS_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Enforce the endpoint cap
+    if (!HttpWorkers_Acquire(eClass)) {
+        return HttpWorkers_SendBusy(psReq);
+    }
+
+    // Without a pool, serve on the calling task as before
+    if (gsWorkQueue == NULL) {
+        esp_err_t eErr = pfnWork(psReq);
+        HttpWorkers_Release(eClass, false);
+        return eErr;
+    }
+
+    // Detach from the httpd task
+    http_work_item_t sItem = { .psReq = NULL, .pfnWork = pfnWork, .eClass = eClass };
+    esp_err_t eErr = httpd_req_async_handler_begin(psReq, &sItem.psReq);
+    if (eErr != ESP_OK) {
+        HttpWorkers_Release(eClass, true);
+        ESP_LOGW(gTag, "async begin failed: %s", esp_err_to_name(eErr));
+        return HttpWorkers_SendBusy(psReq);
+    }
+
+    HttpWorkers_Enqueue(&sItem);
+    return ESP_OK;
+}
+
+
+esp_err_t HttpWorkers_DispatchDetached(httpd_req_t *psAsyncReq, http_work_class_t eClass, http_work_fn_t pfnWork)
+{
+    // Queues a request another module already detached, such as a woken long poll
+    // Applies the same class cap and queue-full 503 as HttpWorkers_Dispatch
+    // Takes ownership: the request is always completed here or by a worker
+
+    if (psAsyncReq == NULL || pfnWork == NULL || (int)eClass < 0 || eClass >= HTTP_WORK_CLASS_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Enforce the endpoint cap
+    if (!HttpWorkers_Acquire(eClass)) {
+        (void)HttpWorkers_SendBusy(psAsyncReq);
+        (void)httpd_req_async_handler_complete(psAsyncReq);
+        return ESP_OK;
+    }
+
+    // Without a pool, serve on the calling task as before
+    http_work_item_t sItem = { .psReq = psAsyncReq, .pfnWork = pfnWork, .eClass = eClass };
+    if (gsWorkQueue == NULL) {
+        HttpWorkers_Run(&sItem);
+        return ESP_OK;
+    }
+
+    HttpWorkers_Enqueue(&sItem);
+    return ESP_OK;
+}
+
+
+void HttpWorkers_GetStats(http_work_stats_t *pasStatsOut)
+{
+    // Copies per-class counters under the stats lock
+    // Gives /metrics a consistent view of active and peak counts
+    // Caller provides HTTP_WORK_CLASS_COUNT entries
+
+    if (pasStatsOut == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&gsStatsLock);
+    memcpy(pasStatsOut, gasStats, sizeof(gasStats));
+    portEXIT_CRITICAL(&gsStatsLock);
+}
+
+
+const char *HttpWorkers_GetClassName(http_work_class_t eClass)
+{
+    // Maps a work class to the label used in logs and metrics
+    // Returns "unknown" for out-of-range values
+    // Names are static strings
+
+    if ((int)eClass < 0 || eClass >= HTTP_WORK_CLASS_COUNT) {
+        return "unknown";
+    }
+
+    return gasClassNames[eClass];
+}
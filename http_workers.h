@@ -0,0 +1,46 @@
+// Declares the worker pool that runs slow HTTP handlers off the httpd task.
+// Requests are detached with the async handler API and served by a few workers.
+// Each endpoint class has its own concurrency cap and answers 503 when full.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+typedef enum
+{
+    HTTP_WORK_SAMPLES = 0,
+    HTTP_WORK_SNAPSHOT,
+    HTTP_WORK_METRICS,
+    HTTP_WORK_EXPORT,
+    HTTP_WORK_CAPTURE,
+    HTTP_WORK_RMS,
+    HTTP_WORK_CLASS_COUNT
+} http_work_class_t;
+
+typedef struct
+{
+    uint32_t uiDispatched;
+    uint32_t uiRejected;
+    uint16_t uiActive;
+    uint16_t uiPeakActive;
+} http_work_stats_t;
+
+typedef esp_err_t (*http_work_fn_t)(httpd_req_t *psReq);
+
+esp_err_t HttpWorkers_Init(void);
+
+// Runs pfnWork on a worker; runs it inline when the pool is not available.
+// Replies 503 with Retry-After when the class cap or the queue is full.
+esp_err_t HttpWorkers_Dispatch(httpd_req_t *psReq, http_work_class_t eClass, http_work_fn_t pfnWork);
+
+// Same as HttpWorkers_Dispatch for a request that is already detached (httpd_req_async_handler_begin).
+// Always completes psAsyncReq, either after pfnWork ran or after a 503.
+esp_err_t HttpWorkers_DispatchDetached(httpd_req_t *psAsyncReq, http_work_class_t eClass, http_work_fn_t pfnWork);
+
+// Copies per-class counters into an array of HTTP_WORK_CLASS_COUNT entries
+void HttpWorkers_GetStats(http_work_stats_t *pasStatsOut);
+
+const char *HttpWorkers_GetClassName(http_work_class_t eClass);
@@ -0,0 +1,653 @@
+// Implements a small streaming JSON writer without printf or heap allocations.
+// Tracks separators per nesting level so callers only emit keys and values.
+// In CBOR mode the same calls emit RFC 8949 items with indefinite-length containers.
+
+#include "json_writer.h"
+
+#include <math.h>
+#include <string.h>
+
+static const uint64_t gauPow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+    1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+
+static void JsonWriter_Flush(json_writer_t *psWriter)
+{
+    // Hands staged bytes to the flush callback in stream mode
+    // Marks the writer failed when the callback rejects the block
+    // Drops staged bytes after a failure so later writes stay cheap
+
+    if (psWriter->pfnFlush == NULL || psWriter->szUsed == 0) {
+        return;
+    }
+
+    // Forward the staged block unless an earlier flush already failed
+    if (!psWriter->bFailed) {
+        if (!psWriter->pfnFlush(psWriter->pvFlushCtx, psWriter->psBuffer, psWriter->szUsed)) {
+            psWriter->bFailed = true;
+        }
+    }
+
+    psWriter->szUsed = 0;
+}
+
+
+static void JsonWriter_Put(json_writer_t *psWriter, const char *psData, size_t szLen)
+{
+    // Appends raw bytes to the staging buffer or caller buffer
+    // Flushes full blocks in stream mode and truncates in buffer mode
+    // Counts every byte so buffer mode can report the required length
+
+    psWriter->szTotal += szLen;
+
+    // Buffer mode keeps one byte for the NUL terminator and truncates the rest
+    if (psWriter->pfnFlush == NULL) {
+        size_t szRoom = 0;
+        if (psWriter->szBuffer > psWriter->szUsed + 1) {
+            szRoom = psWriter->szBuffer - psWriter->szUsed - 1;
+        }
+        size_t szCopy = (szLen < szRoom) ? szLen : szRoom;
+        if (szCopy > 0) {
+            memcpy(psWriter->psBuffer + psWriter->szUsed, psData, szCopy);
+            psWriter->szUsed += szCopy;
+        }
+        return;
+    }
+
+    // Stream mode copies block-wise and flushes whenever the staging buffer fills
+    while (szLen > 0) {
+        size_t szRoom = psWriter->szBuffer - psWriter->szUsed;
+        if (szRoom == 0) {
+            JsonWriter_Flush(psWriter);
+            continue;
+        }
+        size_t szCopy = (szLen < szRoom) ? szLen : szRoom;
+        memcpy(psWriter->psBuffer + psWriter->szUsed, psData, szCopy);
+        psWriter->szUsed += szCopy;
+        psData += szCopy;
+        szLen -= szCopy;
+    }
+}
+
+
+static void JsonWriter_PutChar(json_writer_t *psWriter, char cValue)
+{
+    // Appends a single character through the common output path
+    // Keeps punctuation writes short at call sites
+    // Shares truncation and flush handling with JsonWriter_Put
+
+    JsonWriter_Put(psWriter, &cValue, 1);
+}
+
+
+static void JsonWriter_PutCborHead(json_writer_t *psWriter, uint8_t uMajor, uint64_t uliValue)
+{
+    // Writes a CBOR initial byte and its big-endian argument
+    // Picks the shortest argument size as required for preferred serialization
+    // Serves integers, lengths and tags alike
+
+    uint8_t auHead[9];
+    size_t szArgument = 0;
+
+    if (uliValue < 24) {
+        auHead[0] = (uint8_t)((uMajor << 5) | uliValue);
+    } else if (uliValue <= 0xFF) {
+        auHead[0] = (uint8_t)((uMajor << 5) | 24);
+        szArgument = 1;
+    } else if (uliValue <= 0xFFFF) {
+        auHead[0] = (uint8_t)((uMajor << 5) | 25);
+        szArgument = 2;
+    } else if (uliValue <= 0xFFFFFFFFULL) {
+        auHead[0] = (uint8_t)((uMajor << 5) | 26);
+        szArgument = 4;
+    } else {
+        auHead[0] = (uint8_t)((uMajor << 5) | 27);
+        szArgument = 8;
+    }
+
+    for (size_t szIndex = 0; szIndex < szArgument; szIndex++) {
+        auHead[1 + szIndex] = (uint8_t)(uliValue >> (8 * (szArgument - 1 - szIndex)));
+    }
+
+    JsonWriter_Put(psWriter, (const char *)auHead, 1 + szArgument);
+}
+
+
+static void JsonWriter_PutCborText(json_writer_t *psWriter, const char *sValue)
+{
+    // Writes a definite-length CBOR text string
+    // Needs no escaping since the length prefix delimits the bytes
+    // Used for both member names and string values
+
+    size_t szLen = strlen(sValue);
+
+    JsonWriter_PutCborHead(psWriter, 3, szLen);
+    JsonWriter_Put(psWriter, sValue, szLen);
+}
+
+
+static bool JsonWriter_IsCbor(const json_writer_t *psWriter)
+{
+    // Tells whether values are emitted as CBOR items
+    // Keeps the mode checks in the public functions short
+    // JSON is the default after init
+
+    return (psWriter->eEncoding == JSON_WRITER_ENCODING_CBOR);
+}
+
+
+static void JsonWriter_BeginValue(json_writer_t *psWriter)
+{
+    // Emits a comma when the current container already holds an item
+    // Skips the separator right after a key since the colon was just written
+    // Marks the current level as non-empty for the next value
+
+    if (psWriter->bAfterKey) {
+        psWriter->bAfterKey = false;
+        return;
+    }
+
+    if (psWriter->iDepth <= 0) {
+        return;
+    }
+
+    // Write separator when this level already has items
+    uint32_t uiLevelBit = 1UL << (psWriter->iDepth - 1);
+    if ((psWriter->uiHasItemBits & uiLevelBit) != 0) {
+        JsonWriter_PutChar(psWriter, ',');
+    }
+    psWriter->uiHasItemBits |= uiLevelBit;
+}
+
+
+static void JsonWriter_Open(json_writer_t *psWriter, char cOpen)
+{
+    // Opens an object or array and pushes a fresh nesting level
+    // Clears the item flag of the new level so the first member has no comma
+    // Marks the writer failed when nesting exceeds the supported depth
+
+    // CBOR opens an indefinite-length map (0xBF) or array (0x9F)
+    if (JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_PutChar(psWriter, (char)((cOpen == '{') ? 0xBF : 0x9F));
+    } else {
+        JsonWriter_BeginValue(psWriter);
+        JsonWriter_PutChar(psWriter, cOpen);
+    }
+
+    if (psWriter->iDepth >= iJsonWriterMaxDepth) {
+        psWriter->bFailed = true;
+        return;
+    }
+
+    psWriter->iDepth++;
+    psWriter->uiHasItemBits &= ~(1UL << (psWriter->iDepth - 1));
+}
+
+
+static void JsonWriter_Close(json_writer_t *psWriter, char cClose)
+{
+    // Closes the current object or array and pops one nesting level
+    // Leaves the parent level flags untouched so separators stay correct
+    // Ignores unbalanced closes beyond the top level
+
+    // CBOR ends either container with the break code
+    JsonWriter_PutChar(psWriter, JsonWriter_IsCbor(psWriter) ? (char)0xFF : cClose);
+    psWriter->bAfterKey = false;
+
+    if (psWriter->iDepth > 0) {
+        psWriter->iDepth--;
+    }
+}
+
+
+static void JsonWriter_PutEscaped(json_writer_t *psWriter, const char *sValue)
+{
+    // Writes a quoted JSON string with mandatory escapes applied
+    // Copies unescaped runs in one call to keep per-character overhead low
+    // Encodes remaining control characters as \u00XX sequences
+
+    static const char acHex[] = "0123456789abcdef";
+
+    JsonWriter_PutChar(psWriter, '"');
+
+    const char *psRun = sValue;
+    const char *psCursor = sValue;
+
+    // Scan for characters that need escaping and flush plain runs
+    while (*psCursor != '\0') {
+        unsigned char ucChar = (unsigned char)*psCursor;
+        if (ucChar >= 0x20 && ucChar != '"' && ucChar != '\\') {
+            psCursor++;
+            continue;
+        }
+
+        JsonWriter_Put(psWriter, psRun, (size_t)(psCursor - psRun));
+
+        char acEscape[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t szEscape = 2;
+        switch (ucChar) {
+            case '"':  acEscape[1] = '"'; break;
+            case '\\': acEscape[1] = '\\'; break;
+            case '\b': acEscape[1] = 'b'; break;
+            case '\f': acEscape[1] = 'f'; break;
+            case '\n': acEscape[1] = 'n'; break;
+            case '\r': acEscape[1] = 'r'; break;
+            case '\t': acEscape[1] = 't'; break;
+            default:
+                acEscape[1] = 'u';
+                acEscape[2] = '0';
+                acEscape[3] = '0';
+                acEscape[4] = acHex[ucChar >> 4];
+                acEscape[5] = acHex[ucChar & 0x0F];
+                szEscape = 6;
+                break;
+        }
+        JsonWriter_Put(psWriter, acEscape, szEscape);
+
+        psCursor++;
+        psRun = psCursor;
+    }
+
+    JsonWriter_Put(psWriter, psRun, (size_t)(psCursor - psRun));
+    JsonWriter_PutChar(psWriter, '"');
+}
+
+
+static int JsonWriter_FormatUintDigits(char *psOut, uint64_t uliValue, int iMinDigits)
+{
+    // Writes decimal digits of an unsigned value into psOut
+    // Pads with leading zeros up to iMinDigits for fractional parts
+    // Returns the number of characters written
+
+    char acDigits[20];
+    int iCount = 0;
+
+    // Produce digits in reverse order
+    do {
+        acDigits[iCount++] = (char)('0' + (uliValue % 10U));
+        uliValue /= 10U;
+    } while (uliValue != 0 && iCount < (int)sizeof(acDigits));
+
+    while (iCount < iMinDigits && iCount < (int)sizeof(acDigits)) {
+        acDigits[iCount++] = '0';
+    }
+
+    // Reverse into the output buffer
+    for (int iIndex = 0; iIndex < iCount; iIndex++) {
+        psOut[iIndex] = acDigits[iCount - 1 - iIndex];
+    }
+
+    return iCount;
+}
+
+
+int JsonWriter_FormatInt(char *psOut, int64_t liValue)
+{
+    // Formats a signed 64-bit integer in decimal
+    // Handles INT64_MIN without overflow by negating in unsigned space
+    // Returns the number of characters written
+
+    int iLen = 0;
+    uint64_t uliMagnitude = (uint64_t)liValue;
+
+    if (liValue < 0) {
+        psOut[iLen++] = '-';
+        uliMagnitude = 0U - uliMagnitude;
+    }
+
+    iLen += JsonWriter_FormatUintDigits(psOut + iLen, uliMagnitude, 1);
+    return iLen;
+}
+
+
+int JsonWriter_FormatFloat(char *psOut, double dValue, int iDecimals)
+{
+    // Formats a value with a fixed number of decimals like printf("%.Nf")
+    // Splits integer and fraction parts so rounding stays in integer space
+    // Emits "null" for NaN, infinity and magnitudes beyond 64-bit range
+
+    if (iDecimals < 0) iDecimals = 0;
+    if (iDecimals > 9) iDecimals = 9;
+
+    // Reject values JSON cannot represent as numbers
+    double dMagnitude = fabs(dValue);
+    if (isnan(dValue) || isinf(dValue) || dMagnitude >= 1.8e19) {
+        memcpy(psOut, "null", 4);
+        return 4;
+    }
+
+    // Split into integer and fraction parts; the scaled fraction of a float is exact in double
+    uint64_t uliScale = gauPow10[iDecimals];
+    uint64_t uliInteger = (uint64_t)dMagnitude;
+    double dScaled = (dMagnitude - (double)uliInteger) * (double)uliScale;
+    uint64_t uliFraction = (uint64_t)dScaled;
+    double dRemainder = dScaled - (double)uliFraction;
+
+    // Round half to even on the last printed digit, as printf does
+    uint64_t uliLastDigit = (iDecimals > 0) ? uliFraction : uliInteger;
+    if (dRemainder > 0.5 || (dRemainder == 0.5 && (uliLastDigit & 1U) != 0)) {
+        uliFraction += 1U;
+    }
+    if (uliFraction >= uliScale) {
+        uliInteger += 1U;
+        uliFraction -= uliScale;
+    }
+
+    // Write sign, integer part and fraction part
+    int iLen = 0;
+    if (signbit(dValue)) {
+        psOut[iLen++] = '-';
+    }
+    iLen += JsonWriter_FormatUintDigits(psOut + iLen, uliInteger, 1);
+    if (iDecimals > 0) {
+        psOut[iLen++] = '.';
+        iLen += JsonWriter_FormatUintDigits(psOut + iLen, uliFraction, iDecimals);
+    }
+
+    return iLen;
+}
+
+
+void JsonWriter_InitBuffer(json_writer_t *psWriter, char *psBuffer, size_t szBuffer)
+{
+    // Prepares the writer to render into a caller-owned buffer
+    // Keeps the buffer NUL terminated even when nothing is written
+    // Leaves truncation reporting to JsonWriter_Finish
+
+    memset(psWriter, 0, sizeof(*psWriter));
+    psWriter->psBuffer = psBuffer;
+    psWriter->szBuffer = szBuffer;
+
+    if (psBuffer != NULL && szBuffer > 0) {
+        psBuffer[0] = '\0';
+    }
+}
+
+
+void JsonWriter_InitStream(json_writer_t *psWriter, char *psBuffer, size_t szBuffer,
+                           json_flush_fn_t pfnFlush, void *pvCtx)
+{
+    // Prepares the writer to stage output and forward it through pfnFlush
+    // Uses psBuffer as the block size for each flush call
+    // Falls back to buffer mode when no callback is given
+
+    JsonWriter_InitBuffer(psWriter, psBuffer, szBuffer);
+
+    if (pfnFlush != NULL && psBuffer != NULL && szBuffer > 0) {
+        psWriter->pfnFlush = pfnFlush;
+        psWriter->pvFlushCtx = pvCtx;
+    }
+}
+
+
+void JsonWriter_SetEncoding(json_writer_t *psWriter, json_writer_encoding_t eEncoding)
+{
+    // Switches between JSON text and CBOR output
+    // Must be called before the first value so containers stay balanced
+    // Raw fragments are passed through unchanged in both encodings
+
+    psWriter->eEncoding = eEncoding;
+}
+
+
+void JsonWriter_BeginObject(json_writer_t *psWriter)
+{
+    // Opens a JSON object at the current position
+    // Inserts a separator when needed by the enclosing container
+    // Pushes a new nesting level for member tracking
+
+    JsonWriter_Open(psWriter, '{');
+}
+
+
+void JsonWriter_EndObject(json_writer_t *psWriter)
+{
+    // Closes the current JSON object
+    // Pops the nesting level opened by JsonWriter_BeginObject
+    // Leaves separator state of the parent container intact
+
+    JsonWriter_Close(psWriter, '}');
+}
+
+
+void JsonWriter_BeginArray(json_writer_t *psWriter)
+{
+    // Opens a JSON array at the current position
+    // Inserts a separator when needed by the enclosing container
+    // Pushes a new nesting level for element tracking
+
+    JsonWriter_Open(psWriter, '[');
+}
+
+
+void JsonWriter_EndArray(json_writer_t *psWriter)
+{
+    // Closes the current JSON array
+    // Pops the nesting level opened by JsonWriter_BeginArray
+    // Leaves separator state of the parent container intact
+
+    JsonWriter_Close(psWriter, ']');
+}
+
+
+void JsonWriter_Key(json_writer_t *psWriter, const char *sKey)
+{
+    // Writes an object member name followed by a colon
+    // Escapes the key so callers may pass arbitrary strings
+    // Suppresses the separator for the value that follows
+
+    if (JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_PutCborText(psWriter, sKey);
+        return;
+    }
+
+    JsonWriter_BeginValue(psWriter);
+    JsonWriter_PutEscaped(psWriter, sKey);
+    JsonWriter_PutChar(psWriter, ':');
+    psWriter->bAfterKey = true;
+}
+
+
+void JsonWriter_Int(json_writer_t *psWriter, int64_t liValue)
+{
+    // Writes a signed integer value
+    // Formats digits on the stack without printf
+    // Handles separators through the common value path
+
+    // CBOR stores negative n as major type 1 with argument -1 - n
+    if (JsonWriter_IsCbor(psWriter)) {
+        if (liValue >= 0) {
+            JsonWriter_PutCborHead(psWriter, 0, (uint64_t)liValue);
+        } else {
+            JsonWriter_PutCborHead(psWriter, 1, ~(uint64_t)liValue);
+        }
+        return;
+    }
+
+    char acNumber[iJsonWriterNumberMax];
+    int iLen = JsonWriter_FormatInt(acNumber, liValue);
+
+    JsonWriter_BeginValue(psWriter);
+    JsonWriter_Put(psWriter, acNumber, (size_t)iLen);
+}
+
+
+void JsonWriter_Uint(json_writer_t *psWriter, uint64_t uliValue)
+{
+    // Writes an unsigned integer value
+    // Covers counters that may exceed the signed 64-bit range
+    // Handles separators through the common value path
+
+    if (JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_PutCborHead(psWriter, 0, uliValue);
+        return;
+    }
+
+    char acNumber[iJsonWriterNumberMax];
+    int iLen = JsonWriter_FormatUintDigits(acNumber, uliValue, 1);
+
+    JsonWriter_BeginValue(psWriter);
+    JsonWriter_Put(psWriter, acNumber, (size_t)iLen);
+}
+
+
+void JsonWriter_Float(json_writer_t *psWriter, double dValue, int iDecimals)
+{
+    // Writes a fixed-precision number value
+    // Matches printf("%.Nf") output for finite values
+    // Writes null for values JSON cannot carry, in both encodings
+
+    if (JsonWriter_IsCbor(psWriter)) {
+        uint8_t auItem[9];
+        size_t szItem = 1;
+        float fValue = (float)dValue;
+        if (isnan(dValue) || isinf(dValue) || fabs(dValue) >= 1.8e19) {
+            auItem[0] = 0xF6;
+        } else if ((double)fValue == dValue) {
+            uint32_t uiBits = 0;
+            memcpy(&uiBits, &fValue, sizeof(uiBits));
+            auItem[0] = 0xFA;
+            for (szItem = 1; szItem <= 4; szItem++) {
+                auItem[szItem] = (uint8_t)(uiBits >> (8 * (4 - szItem)));
+            }
+        } else {
+            uint64_t uliBits = 0;
+            memcpy(&uliBits, &dValue, sizeof(uliBits));
+            auItem[0] = 0xFB;
+            for (szItem = 1; szItem <= 8; szItem++) {
+                auItem[szItem] = (uint8_t)(uliBits >> (8 * (8 - szItem)));
+            }
+        }
+        JsonWriter_Put(psWriter, (const char *)auItem, szItem);
+        return;
+    }
+
+    char acNumber[iJsonWriterNumberMax];
+    int iLen = JsonWriter_FormatFloat(acNumber, dValue, iDecimals);
+
+    JsonWriter_BeginValue(psWriter);
+    JsonWriter_Put(psWriter, acNumber, (size_t)iLen);
+}
+
+
+void JsonWriter_Bool(json_writer_t *psWriter, bool bValue)
+{
+    // Writes a JSON boolean literal
+    // Uses constant strings to avoid formatting work
+    // Handles separators through the common value path
+
+    if (JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_PutChar(psWriter, (char)(bValue ? 0xF5 : 0xF4));
+        return;
+    }
+
+    JsonWriter_BeginValue(psWriter);
+    if (bValue) {
+        JsonWriter_Put(psWriter, "true", 4);
+    } else {
+        JsonWriter_Put(psWriter, "false", 5);
+    }
+}
+
+
+void JsonWriter_Null(json_writer_t *psWriter)
+{
+    // Writes a JSON null literal
+    // Used for optional fields without a value
+    // Handles separators through the common value path
+
+    if (JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_PutChar(psWriter, (char)0xF6);
+        return;
+    }
+
+    JsonWriter_BeginValue(psWriter);
+    JsonWriter_Put(psWriter, "null", 4);
+}
+
+
+void JsonWriter_String(json_writer_t *psWriter, const char *sValue)
+{
+    // Writes a quoted and escaped string value
+    // Treats NULL as an empty string to keep output valid
+    // Handles separators through the common value path
+
+    if (JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_PutCborText(psWriter, (sValue != NULL) ? sValue : "");
+        return;
+    }
+
+    JsonWriter_BeginValue(psWriter);
+    JsonWriter_PutEscaped(psWriter, (sValue != NULL) ? sValue : "");
+}
+
+
+void JsonWriter_Int16Array(json_writer_t *psWriter, const int16_t *piValues, int iCount)
+{
+    // Writes an array of signed 16-bit values such as waveform samples
+    // JSON gets a plain number array; CBOR gets tag 77 over a little-endian byte string
+    // The typed array is 2 bytes per value and needs no per-element parsing
+
+    if (iCount < 0) {
+        iCount = 0;
+    }
+
+    if (!JsonWriter_IsCbor(psWriter)) {
+        JsonWriter_BeginArray(psWriter);
+        for (int iIndex = 0; iIndex < iCount; iIndex++) {
+            JsonWriter_Int(psWriter, piValues[iIndex]);
+        }
+        JsonWriter_EndArray(psWriter);
+        return;
+    }
+
+    // Tag and byte string head
+    JsonWriter_PutCborHead(psWriter, 6, 77);
+    JsonWriter_PutCborHead(psWriter, 2, (uint64_t)iCount * 2U);
+
+    // Stage values in little-endian order regardless of host byte order
+    uint8_t auStage[64];
+    size_t szStaged = 0;
+    for (int iIndex = 0; iIndex < iCount; iIndex++) {
+        uint16_t uiValue = (uint16_t)piValues[iIndex];
+        auStage[szStaged++] = (uint8_t)(uiValue & 0xFF);
+        auStage[szStaged++] = (uint8_t)(uiValue >> 8);
+        if (szStaged == sizeof(auStage)) {
+            JsonWriter_Put(psWriter, (const char *)auStage, szStaged);
+            szStaged = 0;
+        }
+    }
+    JsonWriter_Put(psWriter, (const char *)auStage, szStaged);
+}
+
+
+void JsonWriter_Raw(json_writer_t *psWriter, const char *psData, size_t szLen)
+{
+    // Appends pre-rendered bytes exactly as given
+    // Skips separator handling so callers control the surrounding syntax
+    // Used for cached fragments and non-JSON text formats
+
+    JsonWriter_Put(psWriter, psData, szLen);
+}
+
+
+int JsonWriter_Finish(json_writer_t *psWriter)
+{
+    // Completes the output and reports its total length
+    // Flushes remaining staged bytes in stream mode
+    // NUL terminates the caller buffer in buffer mode
+
+    if (psWriter->pfnFlush != NULL) {
+        JsonWriter_Flush(psWriter);
+    } else if (psWriter->psBuffer != NULL && psWriter->szBuffer > 0) {
+        psWriter->psBuffer[psWriter->szUsed] = '\0';
+    }
+
+    if (psWriter->bFailed) {
+        return -1;
+    }
+
+    return (int)psWriter->szTotal;
+}
@@ -0,0 +1,76 @@
+// Declares a small streaming JSON writer used by protocol serializers.
+// Writes into a caller buffer or forwards filled blocks to a flush callback.
+// Can emit the same calls as CBOR, so one serializer defines both encodings.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Maximum nesting depth of objects and arrays tracked by the writer
+#define iJsonWriterMaxDepth             16
+
+typedef enum
+{
+    JSON_WRITER_ENCODING_JSON = 0,
+    JSON_WRITER_ENCODING_CBOR,      // RFC 8949; objects and arrays use indefinite lengths
+} json_writer_encoding_t;
+
+// Flush callback used in stream mode; returns false to abort the output
+typedef bool (*json_flush_fn_t)(void *pvCtx, const char *psData, size_t szLen);
+
+typedef struct
+{
+    char *psBuffer;
+    size_t szBuffer;
+    size_t szUsed;
+    size_t szTotal;
+    json_flush_fn_t pfnFlush;
+    void *pvFlushCtx;
+    uint32_t uiHasItemBits;
+    int iDepth;
+    bool bAfterKey;
+    bool bFailed;
+    json_writer_encoding_t eEncoding;
+} json_writer_t;
+
+// Writes into psBuffer only; output is NUL terminated and truncated like snprintf
+void JsonWriter_InitBuffer(json_writer_t *psWriter, char *psBuffer, size_t szBuffer);
+
+// Uses psBuffer as a staging area and hands each filled block to pfnFlush
+void JsonWriter_InitStream(json_writer_t *psWriter, char *psBuffer, size_t szBuffer,
+                           json_flush_fn_t pfnFlush, void *pvCtx);
+
+// Selects the output encoding; call right after init, before the first value
+void JsonWriter_SetEncoding(json_writer_t *psWriter, json_writer_encoding_t eEncoding);
+
+void JsonWriter_BeginObject(json_writer_t *psWriter);
+void JsonWriter_EndObject(json_writer_t *psWriter);
+void JsonWriter_BeginArray(json_writer_t *psWriter);
+void JsonWriter_EndArray(json_writer_t *psWriter);
+
+void JsonWriter_Key(json_writer_t *psWriter, const char *sKey);
+void JsonWriter_Int(json_writer_t *psWriter, int64_t liValue);
+void JsonWriter_Uint(json_writer_t *psWriter, uint64_t uliValue);
+// iDecimals applies to JSON; CBOR stores a float32 when exact, otherwise a float64
+void JsonWriter_Float(json_writer_t *psWriter, double dValue, int iDecimals);
+void JsonWriter_Bool(json_writer_t *psWriter, bool bValue);
+void JsonWriter_Null(json_writer_t *psWriter);
+void JsonWriter_String(json_writer_t *psWriter, const char *sValue);
+
+// Writes a number array; CBOR uses an RFC 8746 typed array (tag 77, sint16 little-endian)
+void JsonWriter_Int16Array(json_writer_t *psWriter, const int16_t *piValues, int iCount);
+
+// Appends bytes verbatim without separators; used for pre-rendered fragments in either encoding
+void JsonWriter_Raw(json_writer_t *psWriter, const char *psData, size_t szLen);
+
+// Flushes pending bytes; returns total output length, or -1 if a flush failed
+int JsonWriter_Finish(json_writer_t *psWriter);
+
+// Formatting helpers shared with other text encoders; psOut must hold iJsonWriterNumberMax bytes
+// Both return the number of characters written and do not NUL terminate
+#define iJsonWriterNumberMax            48
+
+int JsonWriter_FormatInt(char *psOut, int64_t liValue);
+int JsonWriter_FormatFloat(char *psOut, double dValue, int iDecimals);
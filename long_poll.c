@@ -0,0 +1,211 @@
+// Parks /api/rms and /api/samples requests that ask for a measurement newer than "after".
+// Wakes the waiter task from the ADC publish hook with a task notification, never by polling.
+// Replies to each parked request exactly once, through a worker on a newer result or inline on timeout.
+
+#include "long_poll.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "adc.h"
+#include "app_config.h"
+
+static const char *gTag = "LONG_POLL";
+
+typedef struct
+{
+    httpd_req_t *psReq;
+    int64_t liAfterUs;
+    int64_t liDeadlineUs;
+    http_work_class_t eClass;
+    long_poll_reply_fn_t pfnReply;
+} long_poll_slot_t;
+
+static SemaphoreHandle_t gsPollMutex = NULL;
+static TaskHandle_t gsWaiterTask = NULL;
+static long_poll_slot_t gasSlots[iLongPollMaxClients];
+static int64_t gliLatestUs = 0;
+
+
+static void LongPoll_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Records the timestamp of each published measurement
+    // Runs after the result and waveform caches were updated
+    // Wakes the waiter task so parked requests are answered right away
+
+    (void)pvCtx;
+
+    xSemaphoreTake(gsPollMutex, portMAX_DELAY);
+    gliLatestUs = psResult->liTimestampUs;
+    xSemaphoreGive(gsPollMutex);
+
+    if (gsWaiterTask != NULL) {
+        xTaskNotifyGive(gsWaiterTask);
+    }
+}
+
+
+static void LongPoll_SendTimeout(httpd_req_t *psReq)
+{
+    // Answers an expired long poll with an empty 204 so the client polls again
+    // Fixed and tiny, so it is safe to send from the waiter task
+    // Completes the async request, closing the connection if the send failed
+
+    httpd_resp_set_status(psReq, "204 No Content");
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+    if (httpd_resp_send(psReq, NULL, 0) != ESP_OK) {
+        (void)httpd_sess_trigger_close(psReq->handle, httpd_req_to_sockfd(psReq));
+    }
+    (void)httpd_req_async_handler_complete(psReq);
+}
+
+
+static void LongPoll_WaiterTask(void *pvArg)
+{
+    // Sleeps until a publish notification or the nearest request deadline
+    // Collects ready requests under the mutex and releases them outside of it
+    // Never sends a measurement itself, so a slow reader cannot hold up other parked clients
+
+    (void)pvArg;
+
+    while (1) {
+
+        // Find the nearest deadline
+        int64_t liNowUs = esp_timer_get_time();
+        int64_t liNearestUs = INT64_MAX;
+        xSemaphoreTake(gsPollMutex, portMAX_DELAY);
+        for (int iIndex = 0; iIndex < iLongPollMaxClients; iIndex++) {
+            if (gasSlots[iIndex].psReq != NULL && gasSlots[iIndex].liDeadlineUs < liNearestUs) {
+                liNearestUs = gasSlots[iIndex].liDeadlineUs;
+            }
+        }
+        xSemaphoreGive(gsPollMutex);
+
+        // Sleep until notified or the nearest deadline passes
+        TickType_t uiWait = portMAX_DELAY;
+        if (liNearestUs != INT64_MAX) {
+            int64_t liWaitMs = (liNearestUs > liNowUs) ? ((liNearestUs - liNowUs + 999) / 1000) : 0;
+            uiWait = pdMS_TO_TICKS(liWaitMs);
+        }
+        (void)ulTaskNotifyTake(pdTRUE, uiWait);
+
+        // Take every request that is satisfied or expired
+        long_poll_slot_t asReady[iLongPollMaxClients];
+        bool abNewer[iLongPollMaxClients];
+        int iReadyCount = 0;
+        liNowUs = esp_timer_get_time();
+        xSemaphoreTake(gsPollMutex, portMAX_DELAY);
+        for (int iIndex = 0; iIndex < iLongPollMaxClients; iIndex++) {
+            long_poll_slot_t *psSlot = &gasSlots[iIndex];
+            if (psSlot->psReq == NULL) {
+                continue;
+            }
+            if (gliLatestUs > psSlot->liAfterUs || liNowUs >= psSlot->liDeadlineUs) {
+                abNewer[iReadyCount] = gliLatestUs > psSlot->liAfterUs;
+                asReady[iReadyCount++] = *psSlot;
+                psSlot->psReq = NULL;
+            }
+        }
+        xSemaphoreGive(gsPollMutex);
+
+        // Queue woken requests on the workers with their endpoint caps; answer expired ones here
+        for (int iIndex = 0; iIndex < iReadyCount; iIndex++) {
+            if (abNewer[iIndex]) {
+                (void)HttpWorkers_DispatchDetached(asReady[iIndex].psReq, asReady[iIndex].eClass,
+                                                   asReady[iIndex].pfnReply);
+            } else {
+                LongPoll_SendTimeout(asReady[iIndex].psReq);
+            }
+        }
+    }
+}
+
+
+esp_err_t LongPoll_Init(void)
+{
+    // Creates the parking lot mutex and waiter task
+    // Registers with the ADC publish path after the payload caches
+    // Must run after RmsCache_Init so woken requests read fresh cached bytes
+
+    if (gsPollMutex == NULL) {
+        gsPollMutex = xSemaphoreCreateMutex();
+    }
+    if (gsPollMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    (void)Adc_GetLastSamplesTimestamp(&gliLatestUs);
+
+    if (gsWaiterTask == NULL) {
+        BaseType_t bOk = xTaskCreate(LongPoll_WaiterTask, "long_poll", 4096, NULL, 4, &gsWaiterTask);
+        if (bOk != pdPASS) {
+            gsWaiterTask = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    return Adc_RegisterPublishHook(LongPoll_OnPublish, NULL);
+}
+
+
+bool LongPoll_Park(httpd_req_t *psReq, int64_t liAfterUs, int iTimeoutMs, http_work_class_t eClass,
+                   long_poll_reply_fn_t pfnReply)
+{
+    // Detaches the request from the httpd worker and stores it in a free slot
+    // Checks the latest timestamp under the same lock the publish hook uses
+    // Returns false without detaching when the caller should answer now
+
+    if (gsPollMutex == NULL || psReq == NULL || pfnReply == NULL) {
+        return false;
+    }
+
+    // Clamp the wait time
+    if (iTimeoutMs <= 0) {
+        iTimeoutMs = iLongPollDefaultTimeoutMs;
+    }
+    if (iTimeoutMs > iLongPollMaxTimeoutMs) {
+        iTimeoutMs = iLongPollMaxTimeoutMs;
+    }
+
+    // Reserve a slot unless a newer measurement already exists
+    xSemaphoreTake(gsPollMutex, portMAX_DELAY);
+    long_poll_slot_t *psSlot = NULL;
+    if (gliLatestUs <= liAfterUs) {
+        for (int iIndex = 0; iIndex < iLongPollMaxClients; iIndex++) {
+            if (gasSlots[iIndex].psReq == NULL) {
+                psSlot = &gasSlots[iIndex];
+                break;
+            }
+        }
+    }
+    if (psSlot == NULL) {
+        xSemaphoreGive(gsPollMutex);
+        return false;
+    }
+
+    // Detach the request while holding the slot
+    httpd_req_t *psAsyncReq = NULL;
+    esp_err_t eErr = httpd_req_async_handler_begin(psReq, &psAsyncReq);
+    if (eErr != ESP_OK) {
+        xSemaphoreGive(gsPollMutex);
+        ESP_LOGW(gTag, "async begin failed: %s", esp_err_to_name(eErr));
+        return false;
+    }
+
+    psSlot->psReq = psAsyncReq;
+    psSlot->liAfterUs = liAfterUs;
+    psSlot->liDeadlineUs = esp_timer_get_time() + ((int64_t)iTimeoutMs * 1000);
+    psSlot->eClass = eClass;
+    psSlot->pfnReply = pfnReply;
+    xSemaphoreGive(gsPollMutex);
+
+    // Let the waiter pick up the new deadline
+    xTaskNotifyGive(gsWaiterTask);
+    return true;
+}
@@ -0,0 +1,21 @@
+// Declares the long-poll parking lot for measurement endpoints.
+// Holds requests through async httpd handling until a newer measurement is published.
+// Hands woken requests to the worker pool and answers expired ones with 204 No Content.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "http_workers.h"
+
+typedef esp_err_t (*long_poll_reply_fn_t)(httpd_req_t *psReq);
+
+esp_err_t LongPoll_Init(void);
+
+// Parks psReq until a measurement newer than liAfterUs exists or iTimeoutMs passes.
+// A newer measurement runs pfnReply on a worker under eClass; a timeout replies 204 No Content.
+// Returns false when the caller should reply immediately (already newer, or no free slot).
+bool LongPoll_Park(httpd_req_t *psReq, int64_t liAfterUs, int iTimeoutMs, http_work_class_t eClass,
+                   long_poll_reply_fn_t pfnReply);
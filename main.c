@@ -1,19 +1,34 @@
 // Application entry point that initializes subsystems and starts runtime tasks.
-// Brings up storage, Wi-Fi, web services, and measurement components in order.
-// Owns the top-level startup sequence and overall application lifetime.
+// Declares storage, Wi-Fi, web services and measurement as phases with dependencies,
+// so measurement starts while the network is still coming up.
 
 #include <stdio.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "esp_event.h"
 #include "esp_log.h"
+#include "esp_netif.h"
 
 #include "adc.h"
+#include "boot_init.h"
+#include "boot_timeline.h"
 #include "wifi_mgr.h"
+#include "wifi_power.h"
 #include "api.h"
 #include "wifi_prov.h"
 #include "storage.h"
+#include "rms_cache.h"
+#include "long_poll.h"
+#include "envelope.h"
+#include "history.h"
+#include "udp_telemetry.h"
+#include "mqtt_pub.h"
+#include "modbus_tcp.h"
+#include "sse_stream.h"
+#include "ws_waveform.h"
+#include "metrics.h"
 #include "app_config.h"
 
 static const char *gTag = "MAIN";
@@ -23,17 +38,18 @@ static void AdcScheduler_Task(void *pvArg)
 {
     // Runs periodic ADC measurements at a coarse interval
     // Executes measurement and leaves results cached for API reads
-    // Continues regardless of Wi-Fi state to keep data fresh
+    // Starts once every publish hook is registered; Wi-Fi may still be connecting
 
     (void)pvArg;
 
-    // Delay before first measurement to allow boot services to start
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    BootTimeline_Mark(BOOT_STEP_FIRST_CAPTURE);
 
     while (1) {
 
         // Perform one measurement cycle
-        (void)Adc_MeasureNow();
+        if (Adc_MeasureNow() == ESP_OK) {
+            BootTimeline_Mark(BOOT_STEP_FIRST_MEASUREMENT);
+        }
 
         // Sleep until next scheduled measurement time
         vTaskDelay(pdMS_TO_TICKS(iMeasurePeriodSeconds * 1000));
@@ -41,32 +57,171 @@ static void AdcScheduler_Task(void *pvArg)
 }
 
 
-void app_main(void)
+static esp_err_t App_InitNetif(void)
 {
-    // Initializes storage, ADC subsystem, Wi-Fi manager, and HTTP API
-    // Starts periodic measurement task for cached RMS values
-    // Provides provisioning fallback when Wi-Fi credentials are missing
+    // Brings up the TCP/IP stack and the default event loop
+    // Split from WifiMgr_Start so sockets and the HTTP server need not wait for Wi-Fi
+    // WifiMgr_InitWifiStack repeats both calls and accepts ESP_ERR_INVALID_STATE
+
+    esp_err_t eErr = esp_netif_init();
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    eErr = esp_event_loop_create_default();
+    return (eErr == ESP_ERR_INVALID_STATE) ? ESP_OK : eErr;
+}
+
+
+static esp_err_t App_InitCaches(void)
+{
+    // Registers the caches on the ADC publish path, in publish order
+    // RMS payloads are rendered before long-poll wakes its waiters
+    // History keeps recent results for /api/export
+
+    // Pre-render RMS payloads on every published measurement
+    esp_err_t eErr = RmsCache_Init();
+
+    // Wake long-poll requests after the caches hold the new measurement
+    if (eErr == ESP_OK) {
+        eErr = LongPoll_Init();
+    }
+
+    // Prepare the waveform envelope cache used by ?points=N
+    if (eErr == ESP_OK) {
+        eErr = Envelope_Init();
+    }
+
+    // Keep recent results for /api/export
+    if (eErr == ESP_OK) {
+        eErr = History_Init();
+    }
+
+    return eErr;
+}
+
+
+static esp_err_t App_InitPublishers(void)
+{
+    // Starts the push transports that forward each measurement
+    // Each one only opens sockets or a client; none waits for an IP address
+    // MQTT reads its broker from NVS
+
+    // Start the optional UDP telemetry publisher
+    esp_err_t eErr = UdpTelemetry_Init();
+
+    // Start the MQTT publisher with the broker stored in NVS, if any
+    if (eErr == ESP_OK) {
+        eErr = MqttPub_Init();
+    }
+
+    // Start the Modbus TCP register server
+    if (eErr == ESP_OK) {
+        eErr = ModbusTcp_Init();
+    }
 
-    // Initialize storage early for Wi-Fi credential access
-    ESP_ERROR_CHECK(Storage_Init());
+    return eErr;
+}
 
-    // Initialize ADC subsystem
-    ESP_ERROR_CHECK(Adc_Init());
 
-    // Start Wi-Fi manager (connect or provisioning)
-    ESP_ERROR_CHECK(WifiMgr_Start());
+static esp_err_t App_InitHttp(void)
+{
+    // Starts the HTTP server and registers every endpoint on it
+    // Works before the station has an IP; the AP and later STA address both reach it
+    // Handler registration aborts on failure, as it did when app_main called it
 
     // Start API server (works in STA or AP mode)
-    ESP_ERROR_CHECK(Api_Start());
+    esp_err_t eErr = Api_Start();
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
 
     // Register provisioning endpoints on the shared HTTP server
     ESP_ERROR_CHECK(WifiProv_RegisterHandlers(Api_GetHttpServer()));
 
-    // Start periodic measurement task
+    // Register the measurement push stream
+    ESP_ERROR_CHECK(SseStream_RegisterHandlers(Api_GetHttpServer()));
+
+    // Register the live waveform WebSocket
+    ESP_ERROR_CHECK(WsWaveform_RegisterHandlers(Api_GetHttpServer()));
+
+    // Register the Prometheus scrape endpoint
+    ESP_ERROR_CHECK(Metrics_RegisterHandlers(Api_GetHttpServer()));
+
+    // Register the MQTT broker settings endpoint
+    ESP_ERROR_CHECK(MqttPub_RegisterHandlers(Api_GetHttpServer()));
+
+    // Register the boot timeline endpoint
+    ESP_ERROR_CHECK(BootTimeline_RegisterHandlers(Api_GetHttpServer()));
+
+    // Register the Wi-Fi power-save profile and benchmark endpoint
+    ESP_ERROR_CHECK(WifiPower_RegisterHandlers(Api_GetHttpServer()));
+
+    return ESP_OK;
+}
+
+
+static esp_err_t App_StartScheduler(void)
+{
+    // Starts the periodic measurement task
+    // Runs after the caches and publishers so the first result reaches all of them
+    // The first capture starts immediately instead of after a fixed delay
+
     BaseType_t bOk = xTaskCreate(AdcScheduler_Task, "adc_sched", 4096, NULL, 5, NULL);
     if (bOk != pdPASS) {
         ESP_LOGE(gTag, "Failed to start adc scheduler task");
+        return ESP_ERR_NO_MEM;
     }
 
+    return ESP_OK;
+}
+
+
+// Startup phases; BOOT_INIT_AFTER names earlier entries by index
+enum
+{
+    APP_PHASE_STORAGE = 0,
+    APP_PHASE_NETIF,
+    APP_PHASE_ADC,
+    APP_PHASE_CACHES,
+    APP_PHASE_PUBLISHERS,
+    APP_PHASE_SCHEDULER,
+    APP_PHASE_WIFI,
+    APP_PHASE_HTTP,
+    APP_PHASE_COUNT
+};
+
+static const boot_init_phase_t gasAppPhases[APP_PHASE_COUNT] = {
+    [APP_PHASE_STORAGE] = { "init_storage", Storage_Init, 0, BOOT_STEP_STORAGE },
+    [APP_PHASE_NETIF] = { "init_netif", App_InitNetif, 0, BOOT_STEP_NETIF },
+    [APP_PHASE_ADC] = { "init_adc", Adc_Init, 0, BOOT_STEP_ADC },
+    [APP_PHASE_CACHES] = { "init_caches", App_InitCaches, BOOT_INIT_AFTER(APP_PHASE_ADC), BOOT_STEP_CACHES },
+    [APP_PHASE_PUBLISHERS] = { "init_publish", App_InitPublishers,
+                               BOOT_INIT_AFTER(APP_PHASE_STORAGE) | BOOT_INIT_AFTER(APP_PHASE_NETIF) |
+                               BOOT_INIT_AFTER(APP_PHASE_ADC), BOOT_STEP_PUBLISHERS },
+    [APP_PHASE_SCHEDULER] = { "init_sched", App_StartScheduler,
+                              BOOT_INIT_AFTER(APP_PHASE_CACHES) | BOOT_INIT_AFTER(APP_PHASE_PUBLISHERS),
+                              BOOT_STEP_SCHEDULER },
+    [APP_PHASE_WIFI] = { "init_wifi", WifiMgr_Start,
+                         BOOT_INIT_AFTER(APP_PHASE_STORAGE) | BOOT_INIT_AFTER(APP_PHASE_NETIF), BOOT_STEP_WIFI },
+    [APP_PHASE_HTTP] = { "init_http", App_InitHttp,
+                         BOOT_INIT_AFTER(APP_PHASE_STORAGE) | BOOT_INIT_AFTER(APP_PHASE_NETIF) |
+                         BOOT_INIT_AFTER(APP_PHASE_CACHES) | BOOT_INIT_AFTER(APP_PHASE_PUBLISHERS), BOOT_STEP_HTTP },
+};
+
+
+void app_main(void)
+{
+    // Runs the startup phases, overlapping those that do not depend on each other
+    // ADC calibration and the first capture overlap Wi-Fi association and the HTTP server start
+    // Aborts on the first failed phase, as the sequential ESP_ERROR_CHECKs did
+
+    // Start the boot timeline before anything else takes time
+    BootTimeline_Begin();
+
+    // Bring up every subsystem; returns once all phases are done
+    ESP_ERROR_CHECK(BootInit_Run(gasAppPhases, APP_PHASE_COUNT));
+    BootTimeline_Mark(BOOT_STEP_READY);
+
     ESP_LOGI(gTag, "Boot complete");
 }
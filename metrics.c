@@ -0,0 +1,472 @@
+// Implements /metrics in the Prometheus text exposition format.
+// Formats numbers with the JSON writer helpers and streams them as HTTP chunks.
+// Keeps all scrape state in static storage so cost is bounded and heap-free.
+
+#include "metrics.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#include "adc.h"
+#include "boot_timeline.h"
+#include "wifi_mgr.h"
+#include "wifi_power.h"
+#include "json_writer.h"
+#include "sse_stream.h"
+#include "ws_waveform.h"
+#include "udp_telemetry.h"
+#include "mqtt_pub.h"
+#include "modbus_tcp.h"
+#include "http_workers.h"
+#include "rate_limit.h"
+#include "history.h"
+#include "app_config.h"
+
+static const char *gTag = "METRICS";
+
+// Chunk staging buffer; iHttpCapMetrics keeps scrapes from running concurrently
+static char gacMetricsChunk[iHttpChunkBufferBytes];
+
+// Cost of the previous scrape, reported by the next one
+static int64_t gliLastScrapeUs = 0;
+static int giLastScrapeBytes = 0;
+
+// Tasks whose stack headroom is exported
+static const char *const gasWatchedTasks[] = {
+    "adc_sched", "wifi_mgr", "httpd", "httpd_wk0", "httpd_wk1", "sse_send", "ws_wave", "long_poll",
+    "mqtt_pub", "modbus_tcp", "dns_captive"
+};
+
+
+static bool Metrics_SendChunk(void *pvCtx, const char *psData, size_t szLen)
+{
+    // Forwards one staged block as an HTTP chunk
+    // Skips empty blocks since a zero-length chunk ends the response
+    // Returns false so the writer stops producing output after socket errors
+
+    httpd_req_t *psReq = (httpd_req_t *)pvCtx;
+
+    if (szLen == 0) {
+        return true;
+    }
+
+    return (httpd_resp_send_chunk(psReq, psData, (ssize_t)szLen) == ESP_OK);
+}
+
+
+static void Metrics_WriteText(json_writer_t *psWriter, const char *sText)
+{
+    // Appends a NUL-terminated string without any escaping
+    // Metric names, help texts and label values are compile-time constants
+    // Thin wrapper to keep the family writers readable
+
+    JsonWriter_Raw(psWriter, sText, strlen(sText));
+}
+
+
+static void Metrics_WriteFamily(json_writer_t *psWriter, const char *sName, const char *sType, const char *sHelp)
+{
+    // Writes the HELP and TYPE lines that introduce one metric family
+    // Must precede all samples of that family
+    // Follows the Prometheus text format 0.0.4
+
+    Metrics_WriteText(psWriter, "# HELP ");
+    Metrics_WriteText(psWriter, sName);
+    Metrics_WriteText(psWriter, " ");
+    Metrics_WriteText(psWriter, sHelp);
+    Metrics_WriteText(psWriter, "\n# TYPE ");
+    Metrics_WriteText(psWriter, sName);
+    Metrics_WriteText(psWriter, " ");
+    Metrics_WriteText(psWriter, sType);
+    Metrics_WriteText(psWriter, "\n");
+}
+
+
+static void Metrics_WriteSampleStart(json_writer_t *psWriter, const char *sName,
+                                     const char *sLabelKey, const char *sLabelValue)
+{
+    // Writes the metric name and optional single label up to the value
+    // Passing a NULL label key writes an unlabeled sample
+    // Leaves the writer positioned for the number
+
+    Metrics_WriteText(psWriter, sName);
+    if (sLabelKey != NULL) {
+        Metrics_WriteText(psWriter, "{");
+        Metrics_WriteText(psWriter, sLabelKey);
+        Metrics_WriteText(psWriter, "=\"");
+        Metrics_WriteText(psWriter, sLabelValue);
+        Metrics_WriteText(psWriter, "\"}");
+    }
+    Metrics_WriteText(psWriter, " ");
+}
+
+
+static void Metrics_WriteInt(json_writer_t *psWriter, const char *sName,
+                             const char *sLabelKey, const char *sLabelValue, int64_t liValue)
+{
+    // Writes one integer sample line
+    // Formats digits with the writer helper instead of printf
+    // Terminates the line with a newline
+
+    char acNumber[iJsonWriterNumberMax];
+
+    Metrics_WriteSampleStart(psWriter, sName, sLabelKey, sLabelValue);
+    JsonWriter_Raw(psWriter, acNumber, (size_t)JsonWriter_FormatInt(acNumber, liValue));
+    Metrics_WriteText(psWriter, "\n");
+}
+
+
+static void Metrics_WriteFloat(json_writer_t *psWriter, const char *sName,
+                               const char *sLabelKey, const char *sLabelValue, double dValue)
+{
+    // Writes one floating point sample line with six decimals
+    // Formats digits with the writer helper instead of printf
+    // Terminates the line with a newline
+
+    char acNumber[iJsonWriterNumberMax];
+
+    Metrics_WriteSampleStart(psWriter, sName, sLabelKey, sLabelValue);
+    JsonWriter_Raw(psWriter, acNumber, (size_t)JsonWriter_FormatFloat(acNumber, dValue, 6));
+    Metrics_WriteText(psWriter, "\n");
+}
+
+
+static void Metrics_WriteMeasurement(json_writer_t *psWriter, int64_t liNowUs)
+{
+    // Writes RMS, attenuation, sample count and age of the latest measurement
+    // Exports has_measurement so dashboards can tell zero from missing
+    // Omits value families entirely before the first measurement
+
+    adc_result_t sResult;
+    bool bHasResult = Adc_GetLatest(&sResult);
+
+    Metrics_WriteFamily(psWriter, "adc_node_has_measurement", "gauge", "1 once a measurement exists.");
+    Metrics_WriteInt(psWriter, "adc_node_has_measurement", NULL, NULL, bHasResult ? 1 : 0);
+
+    if (!bHasResult) {
+        return;
+    }
+
+    Metrics_WriteFamily(psWriter, "adc_node_rms_volts", "gauge", "RMS voltage of the last window.");
+    Metrics_WriteFloat(psWriter, "adc_node_rms_volts", "channel", "a", sResult.fRmsVoltsChA);
+    Metrics_WriteFloat(psWriter, "adc_node_rms_volts", "channel", "b", sResult.fRmsVoltsChB);
+
+    Metrics_WriteFamily(psWriter, "adc_node_attenuation", "gauge", "ADC attenuation setting (adc_atten_t).");
+    Metrics_WriteInt(psWriter, "adc_node_attenuation", "channel", "a", (int64_t)sResult.eAttenChA);
+    Metrics_WriteInt(psWriter, "adc_node_attenuation", "channel", "b", (int64_t)sResult.eAttenChB);
+
+    Metrics_WriteFamily(psWriter, "adc_node_samples_per_channel", "gauge", "Samples per channel in the last window.");
+    Metrics_WriteInt(psWriter, "adc_node_samples_per_channel", NULL, NULL, sResult.iSamplesPerChannel);
+
+    Metrics_WriteFamily(psWriter, "adc_node_measurement_age_seconds", "gauge", "Time since the last measurement.");
+    Metrics_WriteFloat(psWriter, "adc_node_measurement_age_seconds", NULL, NULL,
+                       (double)(liNowUs - sResult.liTimestampUs) / 1e6);
+}
+
+
+static void Metrics_WriteSystem(json_writer_t *psWriter, int64_t liNowUs)
+{
+    // Writes uptime, boot steps, Wi-Fi, heap, task stack, streaming and UDP metrics
+    // Reads RSSI only while the station is associated
+    // Skips tasks that are not running in the current configuration
+
+    Metrics_WriteFamily(psWriter, "adc_node_uptime_seconds", "gauge", "Time since boot.");
+    Metrics_WriteFloat(psWriter, "adc_node_uptime_seconds", NULL, NULL, (double)liNowUs / 1e6);
+
+    // Boot timeline of this boot; steps not reached yet are left out
+    boot_timeline_t sBoot;
+    BootTimeline_GetCurrent(&sBoot);
+    Metrics_WriteFamily(psWriter, "adc_node_boot_step_seconds", "gauge",
+                        "Time from reset until each startup step was reached.");
+    for (int iStep = 0; iStep < BOOT_STEP_COUNT; iStep++) {
+        if (sBoot.aliStepUs[iStep] != 0) {
+            Metrics_WriteFloat(psWriter, "adc_node_boot_step_seconds", "step",
+                               BootTimeline_GetStepName((boot_step_t)iStep), (double)sBoot.aliStepUs[iStep] / 1e6);
+        }
+    }
+
+    // Wi-Fi
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_state", "gauge",
+                        "Wi-Fi manager state (0 init, 1 connecting, 2 connected, 3 provisioning).");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_state", NULL, NULL, (int64_t)WifiMgr_GetState());
+
+    wifi_ap_record_t sApInfo;
+    if (WifiMgr_IsConnected() && esp_wifi_sta_get_ap_info(&sApInfo) == ESP_OK) {
+        Metrics_WriteFamily(psWriter, "adc_node_wifi_rssi_dbm", "gauge", "Signal strength of the associated AP.");
+        Metrics_WriteInt(psWriter, "adc_node_wifi_rssi_dbm", NULL, NULL, sApInfo.rssi);
+    }
+
+    wifi_mgr_stats_t sWifiStats;
+    WifiMgr_GetStats(&sWifiStats);
+    if (sWifiStats.liBootToIpUs > 0) {
+        Metrics_WriteFamily(psWriter, "adc_node_wifi_boot_to_ip_seconds", "gauge", "Time from boot to the first STA IP.");
+        Metrics_WriteFloat(psWriter, "adc_node_wifi_boot_to_ip_seconds", NULL, NULL,
+                           (double)sWifiStats.liBootToIpUs / 1e6);
+        Metrics_WriteFamily(psWriter, "adc_node_wifi_connect_seconds", "gauge",
+                            "Outage start (or boot) to IP for the latest connection.");
+        Metrics_WriteFloat(psWriter, "adc_node_wifi_connect_seconds", NULL, NULL,
+                           (double)sWifiStats.liLastConnectUs / 1e6);
+    }
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_connects_total", "counter",
+                        "STA associations, on the cached AP or after a full channel scan.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_connects_total", "mode", "cached", sWifiStats.uiTargetedConnects);
+    Metrics_WriteInt(psWriter, "adc_node_wifi_connects_total", "mode", "scan", sWifiStats.uiScanConnects);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_cached_ap_fallbacks_total", "counter",
+                        "Times the cached AP failed and a full scan was used.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_cached_ap_fallbacks_total", NULL, NULL, sWifiStats.uiFallbacks);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_static_ip", "gauge", "1 while the stored static IPv4 config is in use.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_static_ip", NULL, NULL, sWifiStats.bStaticIp ? 1 : 0);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_static_ip_fallbacks_total", "counter",
+                        "Times the static gateway did not answer and DHCP took over.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_static_ip_fallbacks_total", NULL, NULL, sWifiStats.uiStaticIpFallbacks);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_reconnect_attempts_total", "counter",
+                        "esp_wifi_connect calls made by the retry task.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_reconnect_attempts_total", NULL, NULL, sWifiStats.uiReconnectAttempts);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_connect_timeouts_total", "counter",
+                        "Reconnect attempts that reached neither an IP nor a failure in time.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_connect_timeouts_total", NULL, NULL, sWifiStats.uiConnectTimeouts);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_reconnect_attempt_seconds", "gauge",
+                        "Duration of the latest reconnect attempt, until IP, failure or timeout.");
+    Metrics_WriteFloat(psWriter, "adc_node_wifi_reconnect_attempt_seconds", NULL, NULL,
+                       (double)sWifiStats.liLastAttemptUs / 1e6);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_backoff_seconds", "gauge", "Jittered delay before the latest attempt.");
+    Metrics_WriteFloat(psWriter, "adc_node_wifi_backoff_seconds", NULL, NULL, (double)sWifiStats.uiLastBackoffMs / 1e3);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_backoff_seconds_total", "counter",
+                        "Time spent waiting between reconnect attempts.");
+    Metrics_WriteFloat(psWriter, "adc_node_wifi_backoff_seconds_total", NULL, NULL,
+                       (double)sWifiStats.liBackoffTotalUs / 1e6);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_ap_active", "gauge", "1 while the provisioning AP is beaconing.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_ap_active", NULL, NULL, sWifiStats.bApActive ? 1 : 0);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_ap_switches_total", "counter",
+                        "Provisioning AP switched off (STA-only) or back on.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_ap_switches_total", "to", "off", sWifiStats.uiApStops);
+    Metrics_WriteInt(psWriter, "adc_node_wifi_ap_switches_total", "to", "on", sWifiStats.uiApRestores);
+
+    wifi_power_state_t sPowerState;
+    WifiPower_GetState(&sPowerState);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_power_save_applied", "gauge", "1 for the profile in the Wi-Fi driver.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_power_save_applied", "profile",
+                     WifiMgr_GetPowerSaveName(sPowerState.eApplied), 1);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_power_save_stored", "gauge", "1 for the profile chosen through the API.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_power_save_stored", "profile",
+                     WifiMgr_GetPowerSaveName(sPowerState.eConfigured), 1);
+    Metrics_WriteFamily(psWriter, "adc_node_wifi_power_save_streaming_hold", "gauge",
+                        "1 while a streaming client keeps power save off.");
+    Metrics_WriteInt(psWriter, "adc_node_wifi_power_save_streaming_hold", NULL, NULL, sPowerState.bStreamingHold ? 1 : 0);
+
+    // Heap
+    Metrics_WriteFamily(psWriter, "adc_node_heap_free_bytes", "gauge", "Free heap.");
+    Metrics_WriteInt(psWriter, "adc_node_heap_free_bytes", NULL, NULL, esp_get_free_heap_size());
+    Metrics_WriteFamily(psWriter, "adc_node_heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+    Metrics_WriteInt(psWriter, "adc_node_heap_min_free_bytes", NULL, NULL, esp_get_minimum_free_heap_size());
+
+    // Task stack headroom
+    Metrics_WriteFamily(psWriter, "adc_node_task_stack_free_bytes", "gauge", "Minimum unused stack per task.");
+    for (size_t szIndex = 0; szIndex < sizeof(gasWatchedTasks) / sizeof(gasWatchedTasks[0]); szIndex++) {
+        TaskHandle_t sTask = xTaskGetHandle(gasWatchedTasks[szIndex]);
+        if (sTask != NULL) {
+            Metrics_WriteInt(psWriter, "adc_node_task_stack_free_bytes", "task", gasWatchedTasks[szIndex],
+                             (int64_t)uxTaskGetStackHighWaterMark(sTask));
+        }
+    }
+
+    // Push clients
+    Metrics_WriteFamily(psWriter, "adc_node_stream_clients", "gauge", "Attached push subscribers.");
+    Metrics_WriteInt(psWriter, "adc_node_stream_clients", "transport", "sse", SseStream_GetClientCount());
+    Metrics_WriteInt(psWriter, "adc_node_stream_clients", "transport", "websocket", WsWaveform_GetClientCount());
+
+    // UDP telemetry
+    udp_telemetry_stats_t sUdpStats;
+    UdpTelemetry_GetStats(&sUdpStats);
+    Metrics_WriteFamily(psWriter, "adc_node_udp_datagrams_total", "counter", "UDP telemetry datagrams by result.");
+    Metrics_WriteInt(psWriter, "adc_node_udp_datagrams_total", "result", "sent", sUdpStats.uiSent);
+    Metrics_WriteInt(psWriter, "adc_node_udp_datagrams_total", "result", "failed", sUdpStats.uiFailed);
+
+    // MQTT publisher
+    mqtt_pub_stats_t sMqttStats;
+    MqttPub_GetStats(&sMqttStats);
+    Metrics_WriteFamily(psWriter, "adc_node_mqtt_connected", "gauge", "1 while connected to the MQTT broker.");
+    Metrics_WriteInt(psWriter, "adc_node_mqtt_connected", NULL, NULL, sMqttStats.bConnected ? 1 : 0);
+    Metrics_WriteFamily(psWriter, "adc_node_mqtt_results_total", "counter", "Measurements handled by the MQTT publisher by outcome.");
+    Metrics_WriteInt(psWriter, "adc_node_mqtt_results_total", "result", "published", sMqttStats.uiResults);
+    Metrics_WriteInt(psWriter, "adc_node_mqtt_results_total", "result", "dropped", sMqttStats.uiDropped);
+    Metrics_WriteInt(psWriter, "adc_node_mqtt_results_total", "result", "failed", sMqttStats.uiFailed);
+    Metrics_WriteFamily(psWriter, "adc_node_mqtt_messages_total", "counter", "MQTT messages published.");
+    Metrics_WriteInt(psWriter, "adc_node_mqtt_messages_total", NULL, NULL, sMqttStats.uiMessages);
+    Metrics_WriteFamily(psWriter, "adc_node_mqtt_queue_depth", "gauge", "Measurements waiting for the MQTT publisher.");
+    Metrics_WriteInt(psWriter, "adc_node_mqtt_queue_depth", NULL, NULL, sMqttStats.uiQueued);
+
+    // HTTP worker pool
+    http_work_stats_t asWorkStats[HTTP_WORK_CLASS_COUNT];
+    HttpWorkers_GetStats(asWorkStats);
+    Metrics_WriteFamily(psWriter, "adc_node_http_requests_total", "counter", "Worker-served HTTP requests by endpoint.");
+    for (int iIndex = 0; iIndex < HTTP_WORK_CLASS_COUNT; iIndex++) {
+        Metrics_WriteInt(psWriter, "adc_node_http_requests_total", "endpoint",
+                         HttpWorkers_GetClassName((http_work_class_t)iIndex), asWorkStats[iIndex].uiDispatched);
+    }
+    Metrics_WriteFamily(psWriter, "adc_node_http_rejected_total", "counter", "HTTP requests answered 503 at the endpoint cap.");
+    for (int iIndex = 0; iIndex < HTTP_WORK_CLASS_COUNT; iIndex++) {
+        Metrics_WriteInt(psWriter, "adc_node_http_rejected_total", "endpoint",
+                         HttpWorkers_GetClassName((http_work_class_t)iIndex), asWorkStats[iIndex].uiRejected);
+    }
+    Metrics_WriteFamily(psWriter, "adc_node_http_active", "gauge", "HTTP requests in flight on the worker pool.");
+    for (int iIndex = 0; iIndex < HTTP_WORK_CLASS_COUNT; iIndex++) {
+        Metrics_WriteInt(psWriter, "adc_node_http_active", "endpoint",
+                         HttpWorkers_GetClassName((http_work_class_t)iIndex), asWorkStats[iIndex].uiActive);
+    }
+
+    // Per-client rate limiter
+    rate_limit_stats_t sLimitStats;
+    RateLimit_GetStats(&sLimitStats);
+    Metrics_WriteFamily(psWriter, "adc_node_ratelimit_admitted_total", "counter", "API requests admitted by budget class.");
+    for (int iIndex = 0; iIndex < RATE_LIMIT_CLASS_COUNT; iIndex++) {
+        Metrics_WriteInt(psWriter, "adc_node_ratelimit_admitted_total", "class",
+                         RateLimit_GetClassName((rate_limit_class_t)iIndex), sLimitStats.auiAdmitted[iIndex]);
+    }
+    Metrics_WriteFamily(psWriter, "adc_node_ratelimit_limited_total", "counter", "API requests answered 429 by budget class.");
+    for (int iIndex = 0; iIndex < RATE_LIMIT_CLASS_COUNT; iIndex++) {
+        Metrics_WriteInt(psWriter, "adc_node_ratelimit_limited_total", "class",
+                         RateLimit_GetClassName((rate_limit_class_t)iIndex), sLimitStats.auiLimited[iIndex]);
+    }
+    Metrics_WriteFamily(psWriter, "adc_node_ratelimit_clients_evicted_total", "counter", "Client buckets recycled because the table was full.");
+    Metrics_WriteInt(psWriter, "adc_node_ratelimit_clients_evicted_total", NULL, NULL, sLimitStats.uiEvictions);
+    Metrics_WriteFamily(psWriter, "adc_node_ratelimit_clients", "gauge", "Client buckets in use.");
+    Metrics_WriteInt(psWriter, "adc_node_ratelimit_clients", NULL, NULL, sLimitStats.uiTrackedClients);
+    Metrics_WriteFamily(psWriter, "adc_node_acquisition_deferrals_total", "counter", "Responses held until a capture window closed.");
+    Metrics_WriteInt(psWriter, "adc_node_acquisition_deferrals_total", NULL, NULL, sLimitStats.uiDeferred);
+    Metrics_WriteFamily(psWriter, "adc_node_acquisition_deferral_timeouts_total", "counter", "Deferrals that gave up after iRateLimitDeferMaxMs.");
+    Metrics_WriteInt(psWriter, "adc_node_acquisition_deferral_timeouts_total", NULL, NULL, sLimitStats.uiDeferTimeouts);
+    Metrics_WriteFamily(psWriter, "adc_node_acquisition_deferral_seconds_total", "counter", "Total time responses were held for capture windows.");
+    Metrics_WriteFloat(psWriter, "adc_node_acquisition_deferral_seconds_total", NULL, NULL, (double)sLimitStats.uliDeferredUs / 1e6);
+
+    // Measurement history
+    history_stats_t sHistoryStats;
+    History_GetStats(&sHistoryStats);
+    Metrics_WriteFamily(psWriter, "adc_node_history_records", "gauge", "Measurements kept for /api/export.");
+    Metrics_WriteInt(psWriter, "adc_node_history_records", NULL, NULL, sHistoryStats.uiCount);
+    Metrics_WriteFamily(psWriter, "adc_node_history_capacity", "gauge", "Size of the history ring in records.");
+    Metrics_WriteInt(psWriter, "adc_node_history_capacity", NULL, NULL, sHistoryStats.uiCapacity);
+
+    // Modbus TCP server
+    modbus_tcp_stats_t sModbusStats;
+    ModbusTcp_GetStats(&sModbusStats);
+    Metrics_WriteFamily(psWriter, "adc_node_modbus_clients", "gauge", "Connected Modbus TCP clients.");
+    Metrics_WriteInt(psWriter, "adc_node_modbus_clients", NULL, NULL, sModbusStats.uiClients);
+    Metrics_WriteFamily(psWriter, "adc_node_modbus_requests_total", "counter", "Modbus TCP requests served.");
+    Metrics_WriteInt(psWriter, "adc_node_modbus_requests_total", NULL, NULL, sModbusStats.uiRequests);
+    Metrics_WriteFamily(psWriter, "adc_node_modbus_exceptions_total", "counter", "Modbus exception responses.");
+    Metrics_WriteInt(psWriter, "adc_node_modbus_exceptions_total", NULL, NULL, sModbusStats.uiExceptions);
+    Metrics_WriteFamily(psWriter, "adc_node_modbus_rejected_total", "counter", "Modbus connections refused at the client limit.");
+    Metrics_WriteInt(psWriter, "adc_node_modbus_rejected_total", NULL, NULL, sModbusStats.uiRejectedConnections);
+}
+
+
+static void Metrics_WriteStages(json_writer_t *psWriter)
+{
+    // Writes per-stage timings of Adc_MeasureNow
+    // Exposes a summary (sum and count) plus last and maximum gauges
+    // Uses seconds as the Prometheus base unit
+
+    adc_stage_stats_t asStats[ADC_STAGE_COUNT];
+    if (!Adc_GetStageStats(asStats)) {
+        return;
+    }
+
+    Metrics_WriteFamily(psWriter, "adc_node_stage_duration_seconds", "summary", "Measurement stage duration.");
+    for (int iStage = 0; iStage < ADC_STAGE_COUNT; iStage++) {
+        const char *sStage = Adc_GetStageName((adc_stage_t)iStage);
+        Metrics_WriteFloat(psWriter, "adc_node_stage_duration_seconds_sum", "stage", sStage,
+                           (double)asStats[iStage].uliTotalUs / 1e6);
+        Metrics_WriteInt(psWriter, "adc_node_stage_duration_seconds_count", "stage", sStage,
+                         asStats[iStage].uiCount);
+    }
+
+    Metrics_WriteFamily(psWriter, "adc_node_stage_last_seconds", "gauge", "Duration of the stage in the last measurement.");
+    for (int iStage = 0; iStage < ADC_STAGE_COUNT; iStage++) {
+        Metrics_WriteFloat(psWriter, "adc_node_stage_last_seconds", "stage", Adc_GetStageName((adc_stage_t)iStage),
+                           (double)asStats[iStage].uiLastUs / 1e6);
+    }
+
+    Metrics_WriteFamily(psWriter, "adc_node_stage_max_seconds", "gauge", "Longest observed stage duration.");
+    for (int iStage = 0; iStage < ADC_STAGE_COUNT; iStage++) {
+        Metrics_WriteFloat(psWriter, "adc_node_stage_max_seconds", "stage", Adc_GetStageName((adc_stage_t)iStage),
+                           (double)asStats[iStage].uiMaxUs / 1e6);
+    }
+}
+
+
+static esp_err_t Metrics_HandleScrape(httpd_req_t *psReq)
+{
+    // Streams all metric families as one chunked text response
+    // Reports the duration and size of the previous scrape as self-metrics
+    // Uses only the static chunk buffer and a few stack variables
+
+    int64_t liStartUs = esp_timer_get_time();
+
+    httpd_resp_set_type(psReq, "text/plain; version=0.0.4; charset=utf-8");
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+
+    json_writer_t sWriter;
+    JsonWriter_InitStream(&sWriter, gacMetricsChunk, sizeof(gacMetricsChunk), Metrics_SendChunk, psReq);
+
+    Metrics_WriteMeasurement(&sWriter, liStartUs);
+    Metrics_WriteStages(&sWriter);
+    Metrics_WriteSystem(&sWriter, liStartUs);
+
+    Metrics_WriteFamily(&sWriter, "adc_node_scrape_duration_seconds", "gauge", "Server time spent on the previous scrape.");
+    Metrics_WriteFloat(&sWriter, "adc_node_scrape_duration_seconds", NULL, NULL, (double)gliLastScrapeUs / 1e6);
+    Metrics_WriteFamily(&sWriter, "adc_node_scrape_bytes", "gauge", "Body size of the previous scrape.");
+    Metrics_WriteInt(&sWriter, "adc_node_scrape_bytes", NULL, NULL, giLastScrapeBytes);
+
+    int iBytes = JsonWriter_Finish(&sWriter);
+    if (iBytes < 0) {
+        return ESP_FAIL;
+    }
+
+    // Terminate the chunked response
+    httpd_resp_send_chunk(psReq, NULL, 0);
+
+    gliLastScrapeUs = esp_timer_get_time() - liStartUs;
+    giLastScrapeBytes = iBytes;
+    return ESP_OK;
+}
+
+
+static esp_err_t Metrics_HandleGet(httpd_req_t *psReq)
+{
+    // Handles GET /metrics on a worker task
+    // A scrape streams several kilobytes, too long to hold the httpd task
+    // The metrics class cap of one protects the static chunk buffer
+
+    return HttpWorkers_Dispatch(psReq, HTTP_WORK_METRICS, Metrics_HandleScrape);
+}
+
+
+esp_err_t Metrics_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Registers GET /metrics on the shared HTTP server
+    // Needs no task or allocation of its own
+    // Returns an error for a missing server handle
+
+    if (sHttpServer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_uri_t sMetricsUri = {
+        .uri = "/metrics",
+        .method = HTTP_GET,
+        .handler = Metrics_HandleGet,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sMetricsUri));
+
+    ESP_LOGI(gTag, "Metrics handler registered");
+    return ESP_OK;
+}
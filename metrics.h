@@ -0,0 +1,10 @@
+// Declares the Prometheus text-format /metrics endpoint.
+// Streams measurement, Wi-Fi, heap, task and ADC stage timing metrics.
+// Uses a static chunk buffer so a scrape never allocates from the heap.
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+esp_err_t Metrics_RegisterHandlers(httpd_handle_t sHttpServer);
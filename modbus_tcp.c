@@ -0,0 +1,364 @@
+// Implements a small Modbus TCP server for read-only measurement registers.
+// One task multiplexes a bounded set of client sockets with select().
+// Registers come from a snapshot copied under a spinlock at publish time.
+
+#include "modbus_tcp.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "lwip/sockets.h"
+
+#include "adc.h"
+#include "app_config.h"
+
+static const char *gTag = "MODBUS_TCP";
+
+// MBAP header (7 bytes) plus the largest PDU defined by the protocol
+#define iModbusMbapBytes                7
+#define iModbusFrameMaxBytes            260
+
+#define iModbusFuncReadHolding          0x03
+#define iModbusFuncReadInput            0x04
+#define iModbusMaxReadRegisters         125
+
+#define iModbusExIllegalFunction        0x01
+#define iModbusExIllegalAddress         0x02
+#define iModbusExIllegalValue           0x03
+
+typedef struct
+{
+    int iSocket;
+    int iRxLen;
+    int64_t liLastActivityUs;
+    uint8_t auRx[iModbusFrameMaxBytes];
+} modbus_client_t;
+
+// Register snapshot written by the publish hook and read by the server task
+static portMUX_TYPE gsSnapshotLock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t gauRegisters[iModbusRegisterCount];
+static int64_t gliSnapshotTimestampUs = 0;
+
+static modbus_client_t gasClients[iModbusMaxClients];
+static modbus_tcp_stats_t gsStats;
+static uint32_t guiSequence = 0;
+
+
+static void ModbusTcp_PutU32(uint16_t *puRegs, uint32_t uiValue)
+{
+    // Stores a 32-bit value as two registers, high word first
+    // Used for floats, counters and the halves of 64-bit values
+    // Matches the word order most Modbus masters assume by default
+
+    puRegs[0] = (uint16_t)(uiValue >> 16);
+    puRegs[1] = (uint16_t)(uiValue & 0xFFFF);
+}
+
+
+static void ModbusTcp_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Renders the published result into a register image on the stack
+    // Swaps the image into the snapshot inside a short critical section
+    // Keeps request handling independent of the ADC mutex
+
+    (void)pvCtx;
+
+    uint16_t auRegs[iModbusRegisterCount];
+    memset(auRegs, 0, sizeof(auRegs));
+
+    // Floats by bit pattern
+    uint32_t uiBits = 0;
+    memcpy(&uiBits, &psResult->fRmsVoltsChA, sizeof(uiBits));
+    ModbusTcp_PutU32(&auRegs[iModbusRegRmsA], uiBits);
+    memcpy(&uiBits, &psResult->fRmsVoltsChB, sizeof(uiBits));
+    ModbusTcp_PutU32(&auRegs[iModbusRegRmsB], uiBits);
+
+    auRegs[iModbusRegAttenA] = (uint16_t)psResult->eAttenChA;
+    auRegs[iModbusRegAttenB] = (uint16_t)psResult->eAttenChB;
+
+    uint64_t uliTimestamp = (uint64_t)psResult->liTimestampUs;
+    ModbusTcp_PutU32(&auRegs[iModbusRegTimestampUs], (uint32_t)(uliTimestamp >> 32));
+    ModbusTcp_PutU32(&auRegs[iModbusRegTimestampUs + 2], (uint32_t)(uliTimestamp & 0xFFFFFFFFu));
+
+    auRegs[iModbusRegSamples] = (uint16_t)psResult->iSamplesPerChannel;
+    auRegs[iModbusRegFlags] = 0x0001;
+    ModbusTcp_PutU32(&auRegs[iModbusRegSequence], ++guiSequence);
+
+    // Publish the image
+    portENTER_CRITICAL(&gsSnapshotLock);
+    memcpy(gauRegisters, auRegs, sizeof(gauRegisters));
+    gliSnapshotTimestampUs = psResult->liTimestampUs;
+    portEXIT_CRITICAL(&gsSnapshotLock);
+}
+
+
+static int ModbusTcp_BuildException(uint8_t *puOut, uint8_t uiFunction, uint8_t uiCode)
+{
+    // Writes an exception PDU after the MBAP header in puOut
+    // Sets the high bit of the function code as the protocol requires
+    // Returns the PDU length
+
+    puOut[iModbusMbapBytes] = (uint8_t)(uiFunction | 0x80);
+    puOut[iModbusMbapBytes + 1] = uiCode;
+    gsStats.uiExceptions++;
+    return 2;
+}
+
+
+static int ModbusTcp_HandlePdu(const uint8_t *puReq, int iPduLen, uint8_t *puOut)
+{
+    // Serves one request PDU and writes the response PDU after the MBAP header
+    // Supports reading holding and input registers from the same map
+    // Returns the response PDU length
+
+    uint8_t uiFunction = puReq[iModbusMbapBytes];
+
+    if (uiFunction != iModbusFuncReadHolding && uiFunction != iModbusFuncReadInput) {
+        return ModbusTcp_BuildException(puOut, uiFunction, iModbusExIllegalFunction);
+    }
+    if (iPduLen != 5) {
+        return ModbusTcp_BuildException(puOut, uiFunction, iModbusExIllegalValue);
+    }
+
+    // Validate the range
+    int iStart = (puReq[iModbusMbapBytes + 1] << 8) | puReq[iModbusMbapBytes + 2];
+    int iQuantity = (puReq[iModbusMbapBytes + 3] << 8) | puReq[iModbusMbapBytes + 4];
+    if (iQuantity < 1 || iQuantity > iModbusMaxReadRegisters) {
+        return ModbusTcp_BuildException(puOut, uiFunction, iModbusExIllegalValue);
+    }
+    if (iStart + iQuantity > iModbusRegisterCount) {
+        return ModbusTcp_BuildException(puOut, uiFunction, iModbusExIllegalAddress);
+    }
+
+    // Copy the snapshot
+    uint16_t auRegs[iModbusRegisterCount];
+    int64_t liTimestampUs = 0;
+    portENTER_CRITICAL(&gsSnapshotLock);
+    memcpy(auRegs, gauRegisters, sizeof(auRegs));
+    liTimestampUs = gliSnapshotTimestampUs;
+    portEXIT_CRITICAL(&gsSnapshotLock);
+
+    // Age is computed per request so pollers can detect a stalled node
+    if ((auRegs[iModbusRegFlags] & 0x0001) != 0) {
+        int64_t liAgeMs = (esp_timer_get_time() - liTimestampUs) / 1000;
+        ModbusTcp_PutU32(&auRegs[iModbusRegAgeMs], (liAgeMs > (int64_t)UINT32_MAX) ? UINT32_MAX : (uint32_t)liAgeMs);
+    }
+
+    // Byte count and big-endian register values
+    puOut[iModbusMbapBytes] = uiFunction;
+    puOut[iModbusMbapBytes + 1] = (uint8_t)(iQuantity * 2);
+    for (int iIndex = 0; iIndex < iQuantity; iIndex++) {
+        uint16_t uiValue = auRegs[iStart + iIndex];
+        puOut[iModbusMbapBytes + 2 + (iIndex * 2)] = (uint8_t)(uiValue >> 8);
+        puOut[iModbusMbapBytes + 3 + (iIndex * 2)] = (uint8_t)(uiValue & 0xFF);
+    }
+
+    return 2 + (iQuantity * 2);
+}
+
+
+static void ModbusTcp_CloseClient(modbus_client_t *psClient)
+{
+    // Closes a client socket and frees its slot
+    // Safe to call on an empty slot
+    // Keeps the connected-client gauge in step
+
+    if (psClient->iSocket >= 0) {
+        (void)close(psClient->iSocket);
+        psClient->iSocket = -1;
+        psClient->iRxLen = 0;
+        gsStats.uiClients--;
+    }
+}
+
+
+static bool ModbusTcp_ServeClient(modbus_client_t *psClient)
+{
+    // Reads available bytes and answers every complete frame in the buffer
+    // Handles requests split across segments and pipelined requests
+    // Returns false when the connection should be closed
+
+    int iRead = recv(psClient->iSocket, &psClient->auRx[psClient->iRxLen],
+                     sizeof(psClient->auRx) - (size_t)psClient->iRxLen, 0);
+    if (iRead <= 0) {
+        return false;
+    }
+    psClient->iRxLen += iRead;
+    psClient->liLastActivityUs = esp_timer_get_time();
+
+    while (psClient->iRxLen >= iModbusMbapBytes + 1) {
+
+        // MBAP: transaction, protocol (0), length (unit + PDU), unit
+        int iProtocol = (psClient->auRx[2] << 8) | psClient->auRx[3];
+        int iLength = (psClient->auRx[4] << 8) | psClient->auRx[5];
+        if (iProtocol != 0 || iLength < 2 || iLength > iModbusFrameMaxBytes - 6) {
+            return false;
+        }
+        int iFrameLen = 6 + iLength;
+        if (psClient->iRxLen < iFrameLen) {
+            break;
+        }
+
+        // Answer for any unit id; the node is the only device behind its IP
+        uint8_t auTx[iModbusMbapBytes + 2 + (iModbusMaxReadRegisters * 2)];
+        int iPduLen = ModbusTcp_HandlePdu(psClient->auRx, iLength - 1, auTx);
+        memcpy(auTx, psClient->auRx, 4);
+        auTx[4] = (uint8_t)((iPduLen + 1) >> 8);
+        auTx[5] = (uint8_t)((iPduLen + 1) & 0xFF);
+        auTx[6] = psClient->auRx[6];
+        gsStats.uiRequests++;
+
+        if (send(psClient->iSocket, auTx, (size_t)(iModbusMbapBytes + iPduLen), 0) < 0) {
+            return false;
+        }
+
+        // Drop the served frame
+        psClient->iRxLen -= iFrameLen;
+        memmove(psClient->auRx, &psClient->auRx[iFrameLen], (size_t)psClient->iRxLen);
+    }
+
+    return true;
+}
+
+
+static void ModbusTcp_Task(void *pvArg)
+{
+    // Accepts up to iModbusMaxClients connections and serves them in one loop
+    // Refuses extra connections immediately so they cannot starve the others
+    // Closes clients that stay silent for iModbusIdleTimeoutMs or stop reading for iModbusSendTimeoutMs
+
+    int iListenSocket = (int)(intptr_t)pvArg;
+
+    while (1) {
+
+        // Build the read set
+        fd_set sReadSet;
+        FD_ZERO(&sReadSet);
+        FD_SET(iListenSocket, &sReadSet);
+        int iMaxFd = iListenSocket;
+        for (int iIndex = 0; iIndex < iModbusMaxClients; iIndex++) {
+            if (gasClients[iIndex].iSocket >= 0) {
+                FD_SET(gasClients[iIndex].iSocket, &sReadSet);
+                if (gasClients[iIndex].iSocket > iMaxFd) {
+                    iMaxFd = gasClients[iIndex].iSocket;
+                }
+            }
+        }
+
+        struct timeval sTimeout = { .tv_sec = 1, .tv_usec = 0 };
+        int iReady = select(iMaxFd + 1, &sReadSet, NULL, NULL, &sTimeout);
+        if (iReady < 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        // New connection
+        if (FD_ISSET(iListenSocket, &sReadSet)) {
+            int iSocket = accept(iListenSocket, NULL, NULL);
+            if (iSocket >= 0) {
+                modbus_client_t *psFree = NULL;
+                for (int iIndex = 0; iIndex < iModbusMaxClients; iIndex++) {
+                    if (gasClients[iIndex].iSocket < 0) {
+                        psFree = &gasClients[iIndex];
+                        break;
+                    }
+                }
+                if (psFree == NULL) {
+                    gsStats.uiRejectedConnections++;
+                    (void)close(iSocket);
+                } else {
+                    int iNoDelay = 1;
+                    (void)setsockopt(iSocket, IPPROTO_TCP, TCP_NODELAY, &iNoDelay, sizeof(iNoDelay));
+
+                    // One task serves every client, so a blocked send must give up
+                    struct timeval sSendTimeout = { .tv_sec = iModbusSendTimeoutMs / 1000,
+                                                    .tv_usec = (iModbusSendTimeoutMs % 1000) * 1000 };
+                    (void)setsockopt(iSocket, SOL_SOCKET, SO_SNDTIMEO, &sSendTimeout, sizeof(sSendTimeout));
+                    psFree->iSocket = iSocket;
+                    psFree->iRxLen = 0;
+                    psFree->liLastActivityUs = esp_timer_get_time();
+                    gsStats.uiClients++;
+                }
+            }
+        }
+
+        // Requests and idle timeouts
+        int64_t liNowUs = esp_timer_get_time();
+        for (int iIndex = 0; iIndex < iModbusMaxClients; iIndex++) {
+            modbus_client_t *psClient = &gasClients[iIndex];
+            if (psClient->iSocket < 0) {
+                continue;
+            }
+            if (FD_ISSET(psClient->iSocket, &sReadSet)) {
+                if (!ModbusTcp_ServeClient(psClient)) {
+                    ModbusTcp_CloseClient(psClient);
+                }
+            } else if (liNowUs - psClient->liLastActivityUs > (int64_t)iModbusIdleTimeoutMs * 1000) {
+                ModbusTcp_CloseClient(psClient);
+            }
+        }
+    }
+}
+
+
+esp_err_t ModbusTcp_Init(void)
+{
+    // Opens the listening socket and starts the server task when enabled
+    // Registers the publish hook that keeps the register snapshot current
+    // Returns ESP_OK without doing anything when the server is disabled
+
+    if (!bModbusEnabled) {
+        return ESP_OK;
+    }
+
+    for (int iIndex = 0; iIndex < iModbusMaxClients; iIndex++) {
+        gasClients[iIndex].iSocket = -1;
+    }
+
+    // Listen on all interfaces so both STA and SoftAP clients can poll
+    int iListenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (iListenSocket < 0) {
+        ESP_LOGE(gTag, "socket failed (errno %d)", errno);
+        return ESP_FAIL;
+    }
+
+    int iReuse = 1;
+    (void)setsockopt(iListenSocket, SOL_SOCKET, SO_REUSEADDR, &iReuse, sizeof(iReuse));
+
+    struct sockaddr_in sBindAddr = {0};
+    sBindAddr.sin_family = AF_INET;
+    sBindAddr.sin_port = htons(iModbusPort);
+    sBindAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(iListenSocket, (struct sockaddr *)&sBindAddr, sizeof(sBindAddr)) != 0 ||
+        listen(iListenSocket, 2) != 0) {
+        ESP_LOGE(gTag, "bind/listen on port %d failed (errno %d)", iModbusPort, errno);
+        (void)close(iListenSocket);
+        return ESP_FAIL;
+    }
+
+    BaseType_t bOk = xTaskCreate(ModbusTcp_Task, "modbus_tcp", 4096, (void *)(intptr_t)iListenSocket, 4, NULL);
+    if (bOk != pdPASS) {
+        (void)close(iListenSocket);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(gTag, "Listening on port %d (max %d clients)", iModbusPort, iModbusMaxClients);
+    return Adc_RegisterPublishHook(ModbusTcp_OnPublish, NULL);
+}
+
+
+void ModbusTcp_GetStats(modbus_tcp_stats_t *psStatsOut)
+{
+    // Copies the server counters for diagnostics
+    // Counters are only written by the server task and the publish hook
+    // Torn reads across fields are acceptable for monitoring
+
+    if (psStatsOut != NULL) {
+        *psStatsOut = gsStats;
+    }
+}
@@ -0,0 +1,35 @@
+// Declares the Modbus TCP server that exposes measurements to PLCs and SCADA.
+// Serves read-only registers from a snapshot refreshed by the ADC publish hook.
+// Register reads never take the ADC mutex and never wait for a measurement.
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Register map, identical for holding (FC 03) and input (FC 04) registers.
+// 32-bit and 64-bit values are big-endian with the high word first, so floats
+// decode as "ABCD" in most masters. Writes are rejected with exception 01.
+#define iModbusRegRmsA                  0       // f32, volts
+#define iModbusRegRmsB                  2       // f32, volts
+#define iModbusRegAttenA                4       // u16, adc_atten_t value
+#define iModbusRegAttenB                5       // u16, adc_atten_t value
+#define iModbusRegTimestampUs           6       // u64, esp_timer time of capture
+#define iModbusRegSamples               10      // u16, samples per channel
+#define iModbusRegFlags                 11      // u16, bit0 = has value
+#define iModbusRegSequence              12      // u32, +1 per published measurement
+#define iModbusRegAgeMs                 14      // u32, age of the result when the snapshot was read
+// 16..31 are reserved for power and energy registers and read as 0
+#define iModbusRegisterCount            32
+
+typedef struct
+{
+    uint32_t uiRequests;
+    uint32_t uiExceptions;
+    uint32_t uiRejectedConnections;
+    uint32_t uiClients;
+} modbus_tcp_stats_t;
+
+esp_err_t ModbusTcp_Init(void);
+
+void ModbusTcp_GetStats(modbus_tcp_stats_t *psStatsOut);
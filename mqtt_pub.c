@@ -0,0 +1,447 @@
+// Publishes measurements to an MQTT broker with QoS 0 and optional batching.
+// The ADC publish hook only copies the result into a bounded queue, so a slow
+// or unreachable broker never delays acquisition; the oldest results are dropped.
+
+#include "mqtt_pub.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "mqtt_client.h"
+
+#include "adc.h"
+#include "proto.h"
+#include "storage.h"
+#include "rms_cache.h"
+#include "wifi_prov.h"
+#include "app_config.h"
+
+static const char *gTag = "MQTT_PUB";
+
+// Notification bits for the publisher task
+#define iMqttPubNotifyReconfigure       BIT0
+#define iMqttPubNotifyConnected         BIT1
+
+// Largest message: a full batch of RMS objects plus array brackets and commas
+#define iMqttMessageBytes               ((iMqttMaxBatchSize * (iRmsCacheMaxBytes + 1)) + 2)
+
+static QueueHandle_t gsResultQueue = NULL;
+static TaskHandle_t gsPublisherTask = NULL;
+static esp_mqtt_client_handle_t gsClient = NULL;
+static volatile bool gbConnected = false;
+static mqtt_pub_stats_t gsStats;
+
+// Active settings; only touched by the publisher task
+static mqtt_config_t gsConfig;
+static char gsStatusTopic[sizeof(gsConfig.sTopic) + 8];
+static int giBatchSize = iMqttDefaultBatchSize;
+
+// Message staging; only used by the publisher task
+static char gacMessage[iMqttMessageBytes];
+
+
+static void MqttPub_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Queues a copy of the published measurement without blocking
+    // Drops the oldest queued result when the queue is full
+    // Does nothing while no broker is configured
+
+    (void)pvCtx;
+
+    if (!gsStats.bEnabled) {
+        return;
+    }
+
+    if (xQueueSend(gsResultQueue, psResult, 0) != pdTRUE) {
+        adc_result_t sOldest;
+        if (xQueueReceive(gsResultQueue, &sOldest, 0) == pdTRUE) {
+            gsStats.uiDropped++;
+        }
+        if (xQueueSend(gsResultQueue, psResult, 0) != pdTRUE) {
+            gsStats.uiDropped++;
+            return;
+        }
+    }
+    gsStats.uiEnqueued++;
+}
+
+
+static void MqttPub_OnEvent(void *pvArg, esp_event_base_t sBase, int32_t iEventId, void *pvEventData)
+{
+    // Tracks the broker connection state reported by the MQTT client task
+    // Announces availability with a retained "online" on each connect
+    // Wakes the publisher so a backlog is sent right after reconnecting
+
+    (void)pvArg;
+    (void)sBase;
+
+    esp_mqtt_event_handle_t psEvent = (esp_mqtt_event_handle_t)pvEventData;
+
+    if (iEventId == MQTT_EVENT_CONNECTED) {
+        ESP_LOGI(gTag, "Connected to %s", gsConfig.sBrokerUri);
+        gbConnected = true;
+        (void)esp_mqtt_client_publish(psEvent->client, gsStatusTopic, "online", 0, 1, 1);
+        xTaskNotify(gsPublisherTask, iMqttPubNotifyConnected, eSetBits);
+    } else if (iEventId == MQTT_EVENT_DISCONNECTED) {
+        if (gbConnected) {
+            ESP_LOGW(gTag, "Disconnected");
+        }
+        gbConnected = false;
+    }
+}
+
+
+static void MqttPub_ApplyConfig(void)
+{
+    // Replaces the MQTT client with one built from the stored settings
+    // Leaves publishing disabled when no broker URI is stored
+    // Runs on the publisher task so no other task sees a half-built client
+
+    // Tear down the current client
+    if (gsClient != NULL) {
+        (void)esp_mqtt_client_stop(gsClient);
+        (void)esp_mqtt_client_destroy(gsClient);
+        gsClient = NULL;
+    }
+    gbConnected = false;
+
+    // Load settings
+    (void)Storage_LoadMqttConfig(&gsConfig);
+    gsStats.bEnabled = gsConfig.bValid;
+    if (!gsConfig.bValid) {
+        (void)xQueueReset(gsResultQueue);
+        ESP_LOGI(gTag, "No broker configured, publishing disabled");
+        return;
+    }
+
+    if (gsConfig.sTopic[0] == '\0') {
+        strncpy(gsConfig.sTopic, sMqttDefaultTopic, sizeof(gsConfig.sTopic) - 1);
+    }
+    snprintf(gsStatusTopic, sizeof(gsStatusTopic), "%s/status", gsConfig.sTopic);
+
+    giBatchSize = (gsConfig.uiBatchSize == 0) ? iMqttDefaultBatchSize : gsConfig.uiBatchSize;
+    if (giBatchSize > iMqttMaxBatchSize) {
+        giBatchSize = iMqttMaxBatchSize;
+    }
+
+    // Build and start the client; it reconnects on its own after outages
+    esp_mqtt_client_config_t sMqttCfg = {
+        .broker.address.uri = gsConfig.sBrokerUri,
+        .credentials.username = (gsConfig.sUsername[0] != '\0') ? gsConfig.sUsername : NULL,
+        .credentials.authentication.password = (gsConfig.sPassword[0] != '\0') ? gsConfig.sPassword : NULL,
+        .session.keepalive = iMqttKeepAliveSeconds,
+        .session.last_will.topic = gsStatusTopic,
+        .session.last_will.msg = "offline",
+        .session.last_will.qos = 1,
+        .session.last_will.retain = 1,
+        .network.reconnect_timeout_ms = iMqttReconnectMs,
+        .buffer.out_size = iMqttMessageBytes + 128,
+    };
+
+    gsClient = esp_mqtt_client_init(&sMqttCfg);
+    if (gsClient == NULL) {
+        ESP_LOGE(gTag, "Client init failed");
+        gsStats.bEnabled = false;
+        return;
+    }
+    (void)esp_mqtt_client_register_event(gsClient, MQTT_EVENT_ANY, MqttPub_OnEvent, NULL);
+
+    esp_err_t eErr = esp_mqtt_client_start(gsClient);
+    if (eErr != ESP_OK) {
+        ESP_LOGE(gTag, "Client start failed: %s", esp_err_to_name(eErr));
+    }
+
+    ESP_LOGI(gTag, "Publishing to %s topic %s (batch %d)", gsConfig.sBrokerUri, gsConfig.sTopic, giBatchSize);
+}
+
+
+static void MqttPub_SendBatch(const adc_result_t *psResults, int iCount)
+{
+    // Renders the collected results into one message and publishes it with QoS 0
+    // Sends a bare object for batch size 1 and an array otherwise
+    // Counts the results as failed if the client rejects the message
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, gacMessage, sizeof(gacMessage));
+
+    if (giBatchSize == 1) {
+        Proto_WriteRmsJson(&sWriter, &psResults[0], true);
+    } else {
+        JsonWriter_BeginArray(&sWriter);
+        for (int iIndex = 0; iIndex < iCount; iIndex++) {
+            Proto_WriteRmsJson(&sWriter, &psResults[iIndex], true);
+        }
+        JsonWriter_EndArray(&sWriter);
+    }
+
+    int iLen = JsonWriter_Finish(&sWriter);
+    if (iLen <= 0 || iLen >= (int)sizeof(gacMessage)) {
+        gsStats.uiFailed += (uint32_t)iCount;
+        return;
+    }
+
+    if (esp_mqtt_client_publish(gsClient, gsConfig.sTopic, gacMessage, iLen, 0, 0) < 0) {
+        gsStats.uiFailed += (uint32_t)iCount;
+        return;
+    }
+
+    gsStats.uiMessages++;
+    gsStats.uiResults += (uint32_t)iCount;
+}
+
+
+static void MqttPub_Task(void *pvArg)
+{
+    // Drains the result queue into batches while the broker is connected
+    // Sends a batch when it is full or its first result waited iMqttBatchMaxWaitMs
+    // Leaves results queued while offline so the newest survive an outage
+
+    (void)pvArg;
+
+    adc_result_t asBatch[iMqttMaxBatchSize];
+    int iBatchCount = 0;
+    int64_t liBatchStartUs = 0;
+
+    MqttPub_ApplyConfig();
+
+    while (1) {
+
+        // Handle reconfiguration; sleep here while offline
+        bool bOnline = (gsClient != NULL) && gbConnected;
+        uint32_t uiBits = 0;
+        (void)xTaskNotifyWait(0, UINT32_MAX, &uiBits, bOnline ? 0 : pdMS_TO_TICKS(1000));
+        if ((uiBits & iMqttPubNotifyReconfigure) != 0) {
+            MqttPub_ApplyConfig();
+            iBatchCount = 0;
+            continue;
+        }
+        if (!bOnline) {
+            continue;
+        }
+
+        // Wait for the next result, but not past the batch deadline
+        TickType_t uiWait = pdMS_TO_TICKS(1000);
+        if (iBatchCount > 0) {
+            int64_t liLeftUs = liBatchStartUs + ((int64_t)iMqttBatchMaxWaitMs * 1000) - esp_timer_get_time();
+            uiWait = (liLeftUs > 0) ? pdMS_TO_TICKS((liLeftUs + 999) / 1000) : 0;
+        }
+        if (xQueueReceive(gsResultQueue, &asBatch[iBatchCount], uiWait) == pdTRUE) {
+            if (iBatchCount++ == 0) {
+                liBatchStartUs = esp_timer_get_time();
+            }
+        }
+        gsStats.uiQueued = (uint32_t)uxQueueMessagesWaiting(gsResultQueue);
+
+        // Send when full or overdue
+        if (iBatchCount > 0 &&
+            (iBatchCount >= giBatchSize ||
+             esp_timer_get_time() - liBatchStartUs >= (int64_t)iMqttBatchMaxWaitMs * 1000)) {
+            MqttPub_SendBatch(asBatch, iBatchCount);
+            iBatchCount = 0;
+        }
+    }
+}
+
+
+static void MqttPub_WriteConfigJson(json_writer_t *psWriter)
+{
+    // Writes the stored broker settings and live counters as one JSON object
+    // Reads settings from NVS so the reply never races the publisher task
+    // Reports only whether a password is set, never the password itself
+
+    mqtt_config_t sConfig;
+    (void)Storage_LoadMqttConfig(&sConfig);
+
+    mqtt_pub_stats_t sStats;
+    MqttPub_GetStats(&sStats);
+
+    JsonWriter_BeginObject(psWriter);
+    JsonWriter_Key(psWriter, "uri");
+    JsonWriter_String(psWriter, sConfig.sBrokerUri);
+    JsonWriter_Key(psWriter, "user");
+    JsonWriter_String(psWriter, sConfig.sUsername);
+    JsonWriter_Key(psWriter, "hasPassword");
+    JsonWriter_Bool(psWriter, sConfig.sPassword[0] != '\0');
+    JsonWriter_Key(psWriter, "topic");
+    JsonWriter_String(psWriter, (sConfig.sTopic[0] != '\0') ? sConfig.sTopic : sMqttDefaultTopic);
+    JsonWriter_Key(psWriter, "batch");
+    JsonWriter_Int(psWriter, (sConfig.uiBatchSize != 0) ? sConfig.uiBatchSize : iMqttDefaultBatchSize);
+    JsonWriter_Key(psWriter, "enabled");
+    JsonWriter_Bool(psWriter, sStats.bEnabled);
+    JsonWriter_Key(psWriter, "connected");
+    JsonWriter_Bool(psWriter, sStats.bConnected);
+    JsonWriter_Key(psWriter, "queued");
+    JsonWriter_Uint(psWriter, sStats.uiQueued);
+    JsonWriter_Key(psWriter, "messages");
+    JsonWriter_Uint(psWriter, sStats.uiMessages);
+    JsonWriter_Key(psWriter, "results");
+    JsonWriter_Uint(psWriter, sStats.uiResults);
+    JsonWriter_Key(psWriter, "dropped");
+    JsonWriter_Uint(psWriter, sStats.uiDropped);
+    JsonWriter_Key(psWriter, "failed");
+    JsonWriter_Uint(psWriter, sStats.uiFailed);
+    JsonWriter_EndObject(psWriter);
+}
+
+
+static esp_err_t MqttPub_HandleGet(httpd_req_t *psReq)
+{
+    // Returns the broker settings and publisher counters
+    // Lets a commissioning tool verify the connection without a broker-side client
+    // Small enough to render into a stack buffer
+
+    char sJson[512];
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, sJson, sizeof(sJson));
+    MqttPub_WriteConfigJson(&sWriter);
+    int iLen = JsonWriter_Finish(&sWriter);
+    if (iLen < 0 || iLen >= (int)sizeof(sJson)) {
+        return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Render failed");
+    }
+
+    httpd_resp_set_type(psReq, "application/json");
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+    return httpd_resp_send(psReq, sJson, iLen);
+}
+
+
+static esp_err_t MqttPub_HandlePost(httpd_req_t *psReq)
+{
+    // Stores broker settings posted as a form and restarts the client
+    // Accepts uri, user, pass, topic and batch; an empty uri disables publishing
+    // Replies with the same document as GET /api/mqtt
+
+    // Read the request body
+    int iBodyLen = psReq->content_len;
+    if (iBodyLen < 0 || iBodyLen > 512) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "Bad request");
+    }
+
+    // A body can arrive split across TCP segments, so read until content_len bytes are in
+    char sBody[513];
+    int iReceivedLen = 0;
+    while (iReceivedLen < iBodyLen) {
+        int iChunkLen = httpd_req_recv(psReq, sBody + iReceivedLen, (size_t)(iBodyLen - iReceivedLen));
+        if (iChunkLen == HTTPD_SOCK_ERR_TIMEOUT) {
+            return httpd_resp_send_err(psReq, HTTPD_408_REQ_TIMEOUT, "Body timed out");
+        }
+        if (iChunkLen <= 0) {
+            return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Read failed");
+        }
+        iReceivedLen += iChunkLen;
+    }
+    sBody[iReceivedLen] = '\0';
+
+    // Parse fields
+    mqtt_config_t sConfig;
+    memset(&sConfig, 0, sizeof(sConfig));
+    char sBatch[8];
+    WifiProv_ExtractFormField(sBody, "uri", sConfig.sBrokerUri, sizeof(sConfig.sBrokerUri));
+    WifiProv_ExtractFormField(sBody, "user", sConfig.sUsername, sizeof(sConfig.sUsername));
+    WifiProv_ExtractFormField(sBody, "pass", sConfig.sPassword, sizeof(sConfig.sPassword));
+    WifiProv_ExtractFormField(sBody, "topic", sConfig.sTopic, sizeof(sConfig.sTopic));
+    WifiProv_ExtractFormField(sBody, "batch", sBatch, sizeof(sBatch));
+
+    // Validate
+    if (sConfig.sBrokerUri[0] != '\0' && strstr(sConfig.sBrokerUri, "://") == NULL) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "uri must look like mqtt://host:1883");
+    }
+    int iBatch = atoi(sBatch);
+    if (iBatch < 0 || iBatch > iMqttMaxBatchSize) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "batch out of range");
+    }
+    sConfig.uiBatchSize = (uint8_t)iBatch;
+    sConfig.bValid = (sConfig.sBrokerUri[0] != '\0');
+
+    // Persist and hand over to the publisher task
+    esp_err_t eErr = Storage_SaveMqttConfig(&sConfig);
+    if (eErr != ESP_OK) {
+        ESP_LOGE(gTag, "Save config failed (%s)", esp_err_to_name(eErr));
+        return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
+    }
+    xTaskNotify(gsPublisherTask, iMqttPubNotifyReconfigure, eSetBits);
+
+    return MqttPub_HandleGet(psReq);
+}
+
+
+esp_err_t MqttPub_Init(void)
+{
+    // Creates the result queue and publisher task and hooks the ADC publish path
+    // Connects to the stored broker, if any, from the publisher task
+    // Must run after Storage_Init since the settings are read from NVS
+
+    if (gsResultQueue == NULL) {
+        gsResultQueue = xQueueCreate(iMqttQueueDepth, sizeof(adc_result_t));
+    }
+    if (gsResultQueue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Enable the hook before the task connects so early results are queued
+    mqtt_config_t sConfig;
+    (void)Storage_LoadMqttConfig(&sConfig);
+    gsStats.bEnabled = sConfig.bValid;
+
+    if (gsPublisherTask == NULL) {
+        BaseType_t bOk = xTaskCreate(MqttPub_Task, "mqtt_pub", 4096, NULL, 3, &gsPublisherTask);
+        if (bOk != pdPASS) {
+            gsPublisherTask = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    return Adc_RegisterPublishHook(MqttPub_OnPublish, NULL);
+}
+
+
+esp_err_t MqttPub_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Registers GET and POST /api/mqtt on the shared HTTP server
+    // Lets the broker be configured from the LAN without reflashing
+    // Requires MqttPub_Init so POST can wake the publisher task
+
+    if (sHttpServer == NULL || gsPublisherTask == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Register GET /api/mqtt
+    httpd_uri_t sGetUri = {
+        .uri = "/api/mqtt",
+        .method = HTTP_GET,
+        .handler = MqttPub_HandleGet,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sGetUri));
+
+    // Register POST /api/mqtt
+    httpd_uri_t sPostUri = {
+        .uri = "/api/mqtt",
+        .method = HTTP_POST,
+        .handler = MqttPub_HandlePost,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sPostUri));
+
+    return ESP_OK;
+}
+
+
+void MqttPub_GetStats(mqtt_pub_stats_t *psStatsOut)
+{
+    // Copies the publisher counters for /api/mqtt and /metrics
+    // Counters are written by the measuring and publisher tasks without locks
+    // Torn reads across fields are acceptable for monitoring
+
+    if (psStatsOut != NULL) {
+        *psStatsOut = gsStats;
+        psStatsOut->bConnected = gbConnected;
+    }
+}
@@ -0,0 +1,33 @@
+// Declares the MQTT publisher that forwards measurements to a broker.
+// Broker settings live in NVS and are changed at runtime through /api/mqtt.
+// Results are queued by the publish hook and sent from a dedicated task.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Payload on the configured topic (QoS 0, not retained):
+//   batch size 1: one RMS object, identical to GET /api/rms
+//   batch size N: a JSON array of up to N RMS objects, oldest first
+// "<topic>/status" carries a retained "online", with "offline" as last will.
+
+typedef struct
+{
+    uint32_t uiEnqueued;
+    uint32_t uiDropped;
+    uint32_t uiMessages;
+    uint32_t uiResults;
+    uint32_t uiFailed;
+    uint32_t uiQueued;
+    bool bEnabled;
+    bool bConnected;
+} mqtt_pub_stats_t;
+
+esp_err_t MqttPub_Init(void);
+
+esp_err_t MqttPub_RegisterHandlers(httpd_handle_t sHttpServer);
+
+void MqttPub_GetStats(mqtt_pub_stats_t *psStatsOut);
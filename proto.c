@@ -1,60 +1,347 @@
-// Builds compact JSON payloads used by HTTP API endpoints.
+// Builds compact JSON and CBOR payloads used by HTTP API endpoints.
 // Encodes device status and measurement results for browser and client parsing.
 // Keeps formatting logic isolated from transport and measurement modules.
 
 #include "proto.h"
 
-#include <stdio.h>
-#include <inttypes.h>
+#include <string.h>
 
 
-int Proto_BuildStatusJson(char *psBuffer, size_t szBuffer, wifi_mgr_state_t eState)
+static void Proto_PutLe16(uint8_t *puOut, uint16_t usValue)
+{
+    // Stores a 16-bit value in little-endian byte order
+    // Keeps the binary layout independent of compiler struct packing
+    // Writes exactly two bytes
+
+    puOut[0] = (uint8_t)(usValue & 0xFF);
+    puOut[1] = (uint8_t)(usValue >> 8);
+}
+
+
+static void Proto_PutLe32(uint8_t *puOut, uint32_t uiValue)
+{
+    // Stores a 32-bit value in little-endian byte order
+    // Keeps the binary layout independent of compiler struct packing
+    // Writes exactly four bytes
+
+    for (int iIndex = 0; iIndex < 4; iIndex++) {
+        puOut[iIndex] = (uint8_t)(uiValue >> (8 * iIndex));
+    }
+}
+
+
+static void Proto_PutLe64(uint8_t *puOut, uint64_t uliValue)
+{
+    // Stores a 64-bit value in little-endian byte order
+    // Keeps the binary layout independent of compiler struct packing
+    // Writes exactly eight bytes
+
+    for (int iIndex = 0; iIndex < 8; iIndex++) {
+        puOut[iIndex] = (uint8_t)(uliValue >> (8 * iIndex));
+    }
+}
+
+
+void Proto_WriteStatusJson(json_writer_t *psWriter, wifi_mgr_state_t eState)
 {
-    // Builds JSON payload for device status endpoint
+    // Writes JSON object for device status endpoint
     // Encodes Wi-Fi state as integer for simple client parsing
     // Keeps output compact for small heap usage
 
-    // Format JSON output
-    int iWritten = snprintf(psBuffer, szBuffer,
-                            "{"
-                            "\"wifiState\":%d"
-                            "}",
-                            (int)eState);
-    return iWritten;
+    JsonWriter_BeginObject(psWriter);
+    JsonWriter_Key(psWriter, "wifiState");
+    JsonWriter_Int(psWriter, (int)eState);
+    JsonWriter_EndObject(psWriter);
 }
 
 
-int Proto_BuildRmsJson(char *psBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult)
+void Proto_WriteRmsJson(json_writer_t *psWriter, const adc_result_t *psResult, bool bHasResult)
 {
-    // Builds JSON payload for RMS endpoint
+    // Writes JSON object for RMS endpoint
     // Includes last measurement values and timestamp when available
-    // Returns a valid JSON object even when no measurement exists
+    // Writes a valid JSON object even when no measurement exists
+
+    JsonWriter_BeginObject(psWriter);
 
     // Handle missing measurement case
     if (!bHasResult || psResult == NULL) {
-        int iWritten = snprintf(psBuffer, szBuffer,
-                                "{"
-                                "\"hasValue\":false"
-                                "}");
-        return iWritten;
+        JsonWriter_Key(psWriter, "hasValue");
+        JsonWriter_Bool(psWriter, false);
+        JsonWriter_EndObject(psWriter);
+        return;
+    }
+
+    // Write RMS values and metadata
+    JsonWriter_Key(psWriter, "hasValue");
+    JsonWriter_Bool(psWriter, true);
+    JsonWriter_Key(psWriter, "rmsA");
+    JsonWriter_Float(psWriter, psResult->fRmsVoltsChA, 6);
+    JsonWriter_Key(psWriter, "rmsB");
+    JsonWriter_Float(psWriter, psResult->fRmsVoltsChB, 6);
+    JsonWriter_Key(psWriter, "timestampUs");
+    JsonWriter_Int(psWriter, psResult->liTimestampUs);
+    JsonWriter_Key(psWriter, "attenA");
+    JsonWriter_Int(psWriter, (int)psResult->eAttenChA);
+    JsonWriter_Key(psWriter, "attenB");
+    JsonWriter_Int(psWriter, (int)psResult->eAttenChB);
+    JsonWriter_Key(psWriter, "samples");
+    JsonWriter_Int(psWriter, psResult->iSamplesPerChannel);
+
+    JsonWriter_EndObject(psWriter);
+}
+
+
+void Proto_WriteStaIpJson(json_writer_t *psWriter, const char *sIp, bool bHasValue)
+{
+    // Writes JSON object for the STA IP endpoint
+    // Keeps v1 field "sta_ip" for the provisioning page and v2 field "ip"
+    // Writes empty strings when no address is assigned yet
+
+    const char *sValue = (bHasValue && sIp != NULL) ? sIp : "";
+
+    JsonWriter_BeginObject(psWriter);
+    JsonWriter_Key(psWriter, "hasValue");
+    JsonWriter_Bool(psWriter, bHasValue);
+    JsonWriter_Key(psWriter, "ip");
+    JsonWriter_String(psWriter, sValue);
+    JsonWriter_Key(psWriter, "sta_ip");
+    JsonWriter_String(psWriter, sValue);
+    JsonWriter_EndObject(psWriter);
+}
+
+
+static void Proto_WriteSampleArrays(json_writer_t *psWriter, const int16_t *piChannelA_mV,
+                                    const int16_t *piChannelB_mV, int iSamples)
+{
+    // Writes the chA and chB millivolt arrays of a waveform object
+    // Streams element by element in JSON and as typed arrays in CBOR
+    // Shared by the full-resolution and envelope serializers
+
+    JsonWriter_Key(psWriter, "chA");
+    JsonWriter_Int16Array(psWriter, piChannelA_mV, iSamples);
+    JsonWriter_Key(psWriter, "chB");
+    JsonWriter_Int16Array(psWriter, piChannelB_mV, iSamples);
+}
+
+
+void Proto_WriteSamplesJson(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                            int iSamples, int64_t liTimestampUs, int64_t liServerNowUs)
+{
+    // Writes JSON object for the cached waveform window in signed millivolts
+    // Adds server-side time so clients can compute capture age
+    // Streams sample arrays element by element to keep buffers small
+
+    JsonWriter_BeginObject(psWriter);
+
+    // Write metadata fields
+    JsonWriter_Key(psWriter, "hasValue");
+    JsonWriter_Bool(psWriter, true);
+    JsonWriter_Key(psWriter, "timestampUs");
+    JsonWriter_Int(psWriter, liTimestampUs);
+    JsonWriter_Key(psWriter, "serverNowUs");
+    JsonWriter_Int(psWriter, liServerNowUs);
+    JsonWriter_Key(psWriter, "samples");
+    JsonWriter_Int(psWriter, iSamples);
+    JsonWriter_Key(psWriter, "units");
+    JsonWriter_String(psWriter, "mV");
+
+    Proto_WriteSampleArrays(psWriter, piChannelA_mV, piChannelB_mV, iSamples);
+
+    JsonWriter_EndObject(psWriter);
+}
+
+
+void Proto_WriteEnvelopeJson(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                             int iPoints, int iSourceSamples, int64_t liTimestampUs, int64_t liServerNowUs)
+{
+    // Writes JSON object for a min/max reduced waveform
+    // Keeps the samples layout so plotting clients need no changes
+    // Adds the reduction mode and the original sample count
+
+    JsonWriter_BeginObject(psWriter);
+
+    // Write metadata fields
+    JsonWriter_Key(psWriter, "hasValue");
+    JsonWriter_Bool(psWriter, true);
+    JsonWriter_Key(psWriter, "timestampUs");
+    JsonWriter_Int(psWriter, liTimestampUs);
+    JsonWriter_Key(psWriter, "serverNowUs");
+    JsonWriter_Int(psWriter, liServerNowUs);
+    JsonWriter_Key(psWriter, "samples");
+    JsonWriter_Int(psWriter, iPoints);
+    JsonWriter_Key(psWriter, "sourceSamples");
+    JsonWriter_Int(psWriter, iSourceSamples);
+    JsonWriter_Key(psWriter, "envelope");
+    JsonWriter_String(psWriter, "minmax");
+    JsonWriter_Key(psWriter, "units");
+    JsonWriter_String(psWriter, "mV");
+
+    Proto_WriteSampleArrays(psWriter, piChannelA_mV, piChannelB_mV, iPoints);
+
+    JsonWriter_EndObject(psWriter);
+}
+
+
+void Proto_WriteCaptureJson(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                            int iSamples, const adc_trigger_t *psTrigger, const adc_capture_info_t *psInfo,
+                            int64_t liServerNowUs)
+{
+    // Writes JSON object for a triggered capture window
+    // Echoes the trigger settings and the trigger sample index next to the samples layout
+    // triggerIndex is -1 and triggered false when the window ran free after the timeout
+
+    JsonWriter_BeginObject(psWriter);
+
+    // Write metadata fields
+    JsonWriter_Key(psWriter, "hasValue");
+    JsonWriter_Bool(psWriter, true);
+    JsonWriter_Key(psWriter, "timestampUs");
+    JsonWriter_Int(psWriter, psInfo->liTimestampUs);
+    JsonWriter_Key(psWriter, "serverNowUs");
+    JsonWriter_Int(psWriter, liServerNowUs);
+    JsonWriter_Key(psWriter, "samples");
+    JsonWriter_Int(psWriter, iSamples);
+    JsonWriter_Key(psWriter, "units");
+    JsonWriter_String(psWriter, "mV");
+    JsonWriter_Key(psWriter, "attenA");
+    JsonWriter_Int(psWriter, (int)psInfo->eAttenChA);
+    JsonWriter_Key(psWriter, "attenB");
+    JsonWriter_Int(psWriter, (int)psInfo->eAttenChB);
+
+    // Write trigger settings and outcome
+    JsonWriter_Key(psWriter, "channel");
+    JsonWriter_String(psWriter, (psTrigger->iChannel == 1) ? "b" : "a");
+    JsonWriter_Key(psWriter, "edge");
+    JsonWriter_String(psWriter, (psTrigger->eEdge == ADC_TRIGGER_EDGE_FALLING) ? "falling" : "rising");
+    JsonWriter_Key(psWriter, "levelMv");
+    JsonWriter_Int(psWriter, psTrigger->iLevel_mV);
+    JsonWriter_Key(psWriter, "prePercent");
+    JsonWriter_Int(psWriter, psTrigger->iPreTriggerPercent);
+    JsonWriter_Key(psWriter, "triggered");
+    JsonWriter_Bool(psWriter, psInfo->bTriggered);
+    JsonWriter_Key(psWriter, "triggerIndex");
+    JsonWriter_Int(psWriter, psInfo->iTriggerIndex);
+    JsonWriter_Key(psWriter, "triggerUs");
+    JsonWriter_Int(psWriter, psInfo->liTriggerUs);
+
+    Proto_WriteSampleArrays(psWriter, piChannelA_mV, piChannelB_mV, iSamples);
+
+    JsonWriter_EndObject(psWriter);
+}
+
+
+int Proto_BuildStatusJson(char *psBuffer, size_t szBuffer, wifi_mgr_state_t eState)
+{
+    // Builds JSON payload for device status endpoint into a caller buffer
+    // Wraps the streaming serializer for fixed-size responses
+    // Returns the untruncated length so callers can detect overflow
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, psBuffer, szBuffer);
+    Proto_WriteStatusJson(&sWriter, eState);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+int Proto_BuildRmsJson(char *psBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult)
+{
+    // Builds JSON payload for RMS endpoint into a caller buffer
+    // Wraps the streaming serializer for fixed-size responses
+    // Returns the untruncated length so callers can detect overflow
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, psBuffer, szBuffer);
+    Proto_WriteRmsJson(&sWriter, psResult, bHasResult);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+int Proto_BuildStaIpJson(char *psBuffer, size_t szBuffer, const char *sIp, bool bHasValue)
+{
+    // Builds JSON payload for STA IP endpoint into a caller buffer
+    // Wraps the streaming serializer for fixed-size responses
+    // Returns the untruncated length so callers can detect overflow
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, psBuffer, szBuffer);
+    Proto_WriteStaIpJson(&sWriter, sIp, bHasValue);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+int Proto_BuildRmsBinary(uint8_t *puBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult)
+{
+    // Builds the compact binary RMS record described in proto.h
+    // Zeroes measurement fields when no result exists so the size stays fixed
+    // Returns the record size, or -1 when the buffer is too small
+
+    if (puBuffer == NULL || szBuffer < iProtoRmsBinaryBytes) {
+        return -1;
+    }
+
+    memset(puBuffer, 0, iProtoRmsBinaryBytes);
+    puBuffer[0] = iProtoRmsBinaryVersion;
+
+    // Leave only the header when no measurement exists
+    if (!bHasResult || psResult == NULL) {
+        return iProtoRmsBinaryBytes;
     }
 
-    // Format JSON output with RMS values
-    int iWritten = snprintf(psBuffer, szBuffer,
-                            "{"
-                            "\"hasValue\":true,"
-                            "\"rmsA\":%.6f,"
-                            "\"rmsB\":%.6f,"
-                            "\"timestampUs\":%" PRId64 ","
-                            "\"attenA\":%d,"
-                            "\"attenB\":%d,"
-                            "\"samples\":%d"
-                            "}",
-                            psResult->fRmsVoltsChA,
-                            psResult->fRmsVoltsChB,
-                            psResult->liTimestampUs,
-                            (int)psResult->eAttenChA,
-                            (int)psResult->eAttenChB,
-                            psResult->iSamplesPerChannel);
-    return iWritten;
+    // Copy float bit patterns to keep IEEE754 encoding intact
+    uint32_t uiRmsA = 0;
+    uint32_t uiRmsB = 0;
+    memcpy(&uiRmsA, &psResult->fRmsVoltsChA, sizeof(uiRmsA));
+    memcpy(&uiRmsB, &psResult->fRmsVoltsChB, sizeof(uiRmsB));
+
+    puBuffer[1] = 0x01;
+    puBuffer[2] = (uint8_t)psResult->eAttenChA;
+    puBuffer[3] = (uint8_t)psResult->eAttenChB;
+    Proto_PutLe64(&puBuffer[4], (uint64_t)psResult->liTimestampUs);
+    Proto_PutLe32(&puBuffer[12], uiRmsA);
+    Proto_PutLe32(&puBuffer[16], uiRmsB);
+    Proto_PutLe16(&puBuffer[20], (uint16_t)psResult->iSamplesPerChannel);
+
+    return iProtoRmsBinaryBytes;
+}
+
+
+int Proto_BuildStatusCbor(uint8_t *puBuffer, size_t szBuffer, wifi_mgr_state_t eState)
+{
+    // Builds the CBOR form of the status payload into a caller buffer
+    // Runs the same serializer as the JSON wrapper with the encoding switched
+    // Returns the untruncated length so callers can detect overflow
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, (char *)puBuffer, szBuffer);
+    JsonWriter_SetEncoding(&sWriter, JSON_WRITER_ENCODING_CBOR);
+    Proto_WriteStatusJson(&sWriter, eState);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+int Proto_BuildRmsCbor(uint8_t *puBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult)
+{
+    // Builds the CBOR form of the RMS payload into a caller buffer
+    // Runs the same serializer as the JSON wrapper with the encoding switched
+    // Returns the untruncated length so callers can detect overflow
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, (char *)puBuffer, szBuffer);
+    JsonWriter_SetEncoding(&sWriter, JSON_WRITER_ENCODING_CBOR);
+    Proto_WriteRmsJson(&sWriter, psResult, bHasResult);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+int Proto_BuildStaIpCbor(uint8_t *puBuffer, size_t szBuffer, const char *sIp, bool bHasValue)
+{
+    // Builds the CBOR form of the STA IP payload into a caller buffer
+    // Runs the same serializer as the JSON wrapper with the encoding switched
+    // Returns the untruncated length so callers can detect overflow
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, (char *)puBuffer, szBuffer);
+    JsonWriter_SetEncoding(&sWriter, JSON_WRITER_ENCODING_CBOR);
+    Proto_WriteStaIpJson(&sWriter, sIp, bHasValue);
+    return JsonWriter_Finish(&sWriter);
 }
@@ -1,12 +1,40 @@
-// Declares JSON builder functions used by HTTP API endpoints.
-// Defines interfaces for serializing status and measurement structures to JSON.
+// Declares JSON and CBOR builder functions used by HTTP API endpoints.
+// Defines interfaces for serializing status and measurement structures.
 // Keeps protocol formatting separated from web server and business logic.
 
 #pragma once
 
 #include <stddef.h>
 #include "adc.h"
+#include "json_writer.h"
 #include "wifi_mgr.h"
 
+// Streaming serializers that append one object to an existing writer.
+// Each one is the schema of its payload: the writer encoding alone decides whether
+// the same members come out as JSON or CBOR, so the two cannot drift apart.
+// CBOR differences: floats are float32, chA/chB are RFC 8746 sint16 LE typed arrays.
+void Proto_WriteStatusJson(json_writer_t *psWriter, wifi_mgr_state_t eState);
+void Proto_WriteRmsJson(json_writer_t *psWriter, const adc_result_t *psResult, bool bHasResult);
+void Proto_WriteStaIpJson(json_writer_t *psWriter, const char *sIp, bool bHasValue);
+void Proto_WriteSamplesJson(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                            int iSamples, int64_t liTimestampUs, int64_t liServerNowUs);
+void Proto_WriteEnvelopeJson(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                             int iPoints, int iSourceSamples, int64_t liTimestampUs, int64_t liServerNowUs);
+void Proto_WriteCaptureJson(json_writer_t *psWriter, const int16_t *piChannelA_mV, const int16_t *piChannelB_mV,
+                            int iSamples, const adc_trigger_t *psTrigger, const adc_capture_info_t *psInfo,
+                            int64_t liServerNowUs);
+
+// Compact little-endian RMS record:
+// u8 version, u8 flags (bit0 hasValue), u8 attenA, u8 attenB, i64 timestampUs,
+// f32 rmsA, f32 rmsB, u16 samples, u16 reserved
+#define iProtoRmsBinaryVersion          1
+#define iProtoRmsBinaryBytes            24
+
+// Buffer wrappers; return the full length like snprintf, or -1 on error
 int Proto_BuildStatusJson(char *psBuffer, size_t szBuffer, wifi_mgr_state_t eState);
 int Proto_BuildRmsJson(char *psBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult);
+int Proto_BuildStaIpJson(char *psBuffer, size_t szBuffer, const char *sIp, bool bHasValue);
+int Proto_BuildRmsBinary(uint8_t *puBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult);
+int Proto_BuildStatusCbor(uint8_t *puBuffer, size_t szBuffer, wifi_mgr_state_t eState);
+int Proto_BuildRmsCbor(uint8_t *puBuffer, size_t szBuffer, const adc_result_t *psResult, bool bHasResult);
+int Proto_BuildStaIpCbor(uint8_t *puBuffer, size_t szBuffer, const char *sIp, bool bHasValue);
@@ -0,0 +1,218 @@
+// Implements per-client token buckets for the HTTP API.
+// Buckets live in a small fixed table keyed by peer address and recycled LRU.
+// Uses integer milli-tokens so the hot path is a few additions under a spinlock.
+
+#include "rate_limit.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_timer.h"
+
+#include "lwip/sockets.h"
+
+#include "adc.h"
+#include "app_config.h"
+
+// One request costs this many milli-tokens
+#define iRateLimitCost                  1000
+
+typedef struct
+{
+    uint32_t uiKey;
+    int64_t liLastUs;
+    int32_t aiMilliTokens[RATE_LIMIT_CLASS_COUNT];
+} rate_limit_client_t;
+
+static const char *const gasClassNames[RATE_LIMIT_CLASS_COUNT] = {
+    [RATE_LIMIT_CHEAP] = "cheap",
+    [RATE_LIMIT_EXPENSIVE] = "expensive",
+};
+
+static const int32_t gaiRatePerSec[RATE_LIMIT_CLASS_COUNT] = {
+    [RATE_LIMIT_CHEAP] = iRateLimitCheapPerSec,
+    [RATE_LIMIT_EXPENSIVE] = iRateLimitExpensivePerSec,
+};
+
+static const int32_t gaiBurst[RATE_LIMIT_CLASS_COUNT] = {
+    [RATE_LIMIT_CHEAP] = iRateLimitCheapBurst,
+    [RATE_LIMIT_EXPENSIVE] = iRateLimitExpensiveBurst,
+};
+
+static portMUX_TYPE gsLimitLock = portMUX_INITIALIZER_UNLOCKED;
+static rate_limit_client_t gasClients[iRateLimitClients];
+static rate_limit_stats_t gsStats;
+
+
+static uint32_t RateLimit_GetClientKey(httpd_req_t *psReq)
+{
+    // Derives a 32-bit key from the peer address of the request socket
+    // Uses the IPv4 address directly and folds IPv6 (including mapped IPv4) by XOR
+    // Returns 0 when the peer cannot be determined; all such requests share a bucket
+
+    struct sockaddr_storage sAddr;
+    socklen_t szAddrLen = sizeof(sAddr);
+    int iSocket = httpd_req_to_sockfd(psReq);
+
+    if (iSocket < 0 || getpeername(iSocket, (struct sockaddr *)&sAddr, &szAddrLen) != 0) {
+        return 0;
+    }
+
+    if (sAddr.ss_family == AF_INET) {
+        return ((const struct sockaddr_in *)&sAddr)->sin_addr.s_addr;
+    }
+
+#if CONFIG_LWIP_IPV6
+    if (sAddr.ss_family == AF_INET6) {
+        uint32_t auWords[4];
+        memcpy(auWords, ((const struct sockaddr_in6 *)&sAddr)->sin6_addr.s6_addr, sizeof(auWords));
+        return auWords[0] ^ auWords[1] ^ auWords[2] ^ auWords[3];
+    }
+#endif
+
+    return 0;
+}
+
+
+static rate_limit_client_t *RateLimit_FindClientLocked(uint32_t uiKey, int64_t liNowUs)
+{
+    // Returns the bucket set for a client key, creating it if needed
+    // Recycles the least recently seen entry when the table is full
+    // New clients start with full buckets so a first page load is never limited
+
+    rate_limit_client_t *psOldest = &gasClients[0];
+
+    for (int iIndex = 0; iIndex < iRateLimitClients; iIndex++) {
+        rate_limit_client_t *psClient = &gasClients[iIndex];
+        if (psClient->liLastUs != 0 && psClient->uiKey == uiKey) {
+            return psClient;
+        }
+        if (psClient->liLastUs < psOldest->liLastUs) {
+            psOldest = psClient;
+        }
+    }
+
+    // Take a free or the oldest entry
+    if (psOldest->liLastUs != 0) {
+        gsStats.uiEvictions++;
+    } else {
+        gsStats.uiTrackedClients++;
+    }
+    psOldest->uiKey = uiKey;
+    psOldest->liLastUs = liNowUs;
+    for (int iClass = 0; iClass < RATE_LIMIT_CLASS_COUNT; iClass++) {
+        psOldest->aiMilliTokens[iClass] = gaiBurst[iClass] * iRateLimitCost;
+    }
+
+    return psOldest;
+}
+
+
+bool RateLimit_Admit(httpd_req_t *psReq, rate_limit_class_t eClass)
+{
+    // Refills the client's bucket for the elapsed time and charges one request
+    // Answers 429 with a Retry-After derived from the refill rate when empty
+    // Runs on the httpd task before any response work is done
+
+    if (psReq == NULL || (int)eClass < 0 || eClass >= RATE_LIMIT_CLASS_COUNT) {
+        return true;
+    }
+
+    uint32_t uiKey = RateLimit_GetClientKey(psReq);
+    int64_t liNowUs = esp_timer_get_time();
+    int32_t iMissing = 0;
+
+    portENTER_CRITICAL(&gsLimitLock);
+    rate_limit_client_t *psClient = RateLimit_FindClientLocked(uiKey, liNowUs);
+
+    // Refill every class so an idle client regains its full budgets
+    int64_t liElapsedUs = liNowUs - psClient->liLastUs;
+    psClient->liLastUs = liNowUs;
+    for (int iClass = 0; iClass < RATE_LIMIT_CLASS_COUNT; iClass++) {
+        int64_t liTokens = psClient->aiMilliTokens[iClass] + ((liElapsedUs * gaiRatePerSec[iClass]) / 1000);
+        int64_t liCap = (int64_t)gaiBurst[iClass] * iRateLimitCost;
+        psClient->aiMilliTokens[iClass] = (int32_t)((liTokens > liCap) ? liCap : liTokens);
+    }
+
+    // Charge the request
+    if (psClient->aiMilliTokens[eClass] >= iRateLimitCost) {
+        psClient->aiMilliTokens[eClass] -= iRateLimitCost;
+        gsStats.auiAdmitted[eClass]++;
+    } else {
+        iMissing = iRateLimitCost - psClient->aiMilliTokens[eClass];
+        gsStats.auiLimited[eClass]++;
+    }
+    portEXIT_CRITICAL(&gsLimitLock);
+
+    if (iMissing == 0) {
+        return true;
+    }
+
+    // Tell the client when one request will be affordable again
+    int iRetrySeconds = (int)((iMissing + (gaiRatePerSec[eClass] * 1000) - 1) / (gaiRatePerSec[eClass] * 1000));
+    char sRetry[12];
+    snprintf(sRetry, sizeof(sRetry), "%d", (iRetrySeconds < 1) ? 1 : iRetrySeconds);
+
+    httpd_resp_set_status(psReq, "429 Too Many Requests");
+    httpd_resp_set_type(psReq, "application/json");
+    httpd_resp_set_hdr(psReq, "Retry-After", sRetry);
+    httpd_resp_sendstr(psReq, "{\"error\":\"rate limited\"}");
+    return false;
+}
+
+
+void RateLimit_DeferForAcquisition(void)
+{
+    // Waits for the ADC to leave its capture window before heavy sending starts
+    // Keeps lwIP and the worker off the CPU while samples are being timed
+    // Bounded so a continuous WebSocket capture cannot starve the API
+
+    int64_t liStartUs = esp_timer_get_time();
+    bool bIdle = Adc_WaitAcquisitionIdle(0);
+    if (bIdle) {
+        return;
+    }
+
+    bIdle = Adc_WaitAcquisitionIdle(iRateLimitDeferMaxMs);
+    int64_t liWaitedUs = esp_timer_get_time() - liStartUs;
+
+    portENTER_CRITICAL(&gsLimitLock);
+    gsStats.uiDeferred++;
+    gsStats.uliDeferredUs += (uint64_t)liWaitedUs;
+    if (!bIdle) {
+        gsStats.uiDeferTimeouts++;
+    }
+    portEXIT_CRITICAL(&gsLimitLock);
+}
+
+
+void RateLimit_GetStats(rate_limit_stats_t *psStatsOut)
+{
+    // Copies limiter counters under the lock
+    // Used by /metrics to tune budgets against real traffic
+    // Counters wrap silently like every other counter in the firmware
+
+    if (psStatsOut == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&gsLimitLock);
+    *psStatsOut = gsStats;
+    portEXIT_CRITICAL(&gsLimitLock);
+}
+
+
+const char *RateLimit_GetClassName(rate_limit_class_t eClass)
+{
+    // Maps a budget class to the label used in metrics
+    // Returns "unknown" for out-of-range values
+    // Names are static strings
+
+    if ((int)eClass < 0 || eClass >= RATE_LIMIT_CLASS_COUNT) {
+        return "unknown";
+    }
+
+    return gasClassNames[eClass];
+}
@@ -0,0 +1,38 @@
+// Declares per-client token-bucket rate limiting for the HTTP API.
+// Cheap and expensive endpoints draw from separate budgets per client IP.
+// Also defers expensive responses while an ADC capture window is open.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_http_server.h"
+
+typedef enum
+{
+    RATE_LIMIT_CHEAP = 0,
+    RATE_LIMIT_EXPENSIVE,
+    RATE_LIMIT_CLASS_COUNT
+} rate_limit_class_t;
+
+typedef struct
+{
+    uint32_t auiAdmitted[RATE_LIMIT_CLASS_COUNT];
+    uint32_t auiLimited[RATE_LIMIT_CLASS_COUNT];
+    uint32_t uiTrackedClients;
+    uint32_t uiEvictions;
+    uint32_t uiDeferred;
+    uint32_t uiDeferTimeouts;
+    uint64_t uliDeferredUs;
+} rate_limit_stats_t;
+
+// Charges one request to the caller's bucket for eClass.
+// Replies 429 with Retry-After and returns false when the bucket is empty.
+bool RateLimit_Admit(httpd_req_t *psReq, rate_limit_class_t eClass);
+
+// Holds the calling task until the current capture window closes, at most iRateLimitDeferMaxMs
+void RateLimit_DeferForAcquisition(void);
+
+void RateLimit_GetStats(rate_limit_stats_t *psStatsOut);
+
+const char *RateLimit_GetClassName(rate_limit_class_t eClass);
@@ -0,0 +1,139 @@
+// Renders RMS payloads once per published measurement and caches the bytes.
+// Stores every supported encoding together with a monotonically rising version.
+// Serves readers with a short mutex-guarded memcpy instead of re-serializing.
+
+#include "rms_cache.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+
+#include "adc.h"
+#include "proto.h"
+
+static const char *gTag = "RMS_CACHE";
+
+typedef struct
+{
+    uint8_t auData[iRmsCacheMaxBytes];
+    size_t szLength;
+} rms_cache_slot_t;
+
+static SemaphoreHandle_t gsCacheMutex = NULL;
+static rms_cache_slot_t gasSlots[RMS_CACHE_FORMAT_COUNT];
+static uint32_t guiVersion = 0;
+static int64_t gliTimestampUs = 0;
+static bool gbHasValue = false;
+
+
+static void RmsCache_Render(const adc_result_t *psResult, bool bHasResult,
+                            rms_cache_slot_t *pasSlotsOut)
+{
+    // Renders every cached encoding for one measurement result
+    // Runs outside the cache mutex so readers never wait on formatting
+    // Stores zero length for encodings that do not fit the slot
+
+    // Render JSON text
+    int iJsonLen = Proto_BuildRmsJson((char *)pasSlotsOut[RMS_CACHE_FORMAT_JSON].auData,
+                                      sizeof(pasSlotsOut[RMS_CACHE_FORMAT_JSON].auData),
+                                      psResult, bHasResult);
+    if (iJsonLen < 0 || iJsonLen >= (int)sizeof(pasSlotsOut[RMS_CACHE_FORMAT_JSON].auData)) {
+        ESP_LOGE(gTag, "JSON rendering does not fit cache slot (%d)", iJsonLen);
+        iJsonLen = 0;
+    }
+    pasSlotsOut[RMS_CACHE_FORMAT_JSON].szLength = (size_t)iJsonLen;
+
+    // Render compact binary record
+    int iBinLen = Proto_BuildRmsBinary(pasSlotsOut[RMS_CACHE_FORMAT_BINARY].auData,
+                                       sizeof(pasSlotsOut[RMS_CACHE_FORMAT_BINARY].auData),
+                                       psResult, bHasResult);
+    pasSlotsOut[RMS_CACHE_FORMAT_BINARY].szLength = (iBinLen > 0) ? (size_t)iBinLen : 0;
+
+    // Render CBOR from the same serializer as the JSON text
+    int iCborLen = Proto_BuildRmsCbor(pasSlotsOut[RMS_CACHE_FORMAT_CBOR].auData,
+                                      sizeof(pasSlotsOut[RMS_CACHE_FORMAT_CBOR].auData),
+                                      psResult, bHasResult);
+    if (iCborLen < 0 || iCborLen >= (int)sizeof(pasSlotsOut[RMS_CACHE_FORMAT_CBOR].auData)) {
+        ESP_LOGE(gTag, "CBOR rendering does not fit cache slot (%d)", iCborLen);
+        iCborLen = 0;
+    }
+    pasSlotsOut[RMS_CACHE_FORMAT_CBOR].szLength = (size_t)iCborLen;
+}
+
+
+static void RmsCache_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Receives each published measurement from the ADC module
+    // Renders all encodings into a scratch copy before taking the mutex
+    // Swaps the new bytes in and bumps the version atomically for readers
+
+    (void)pvCtx;
+
+    // Render into scratch slots on the publisher stack
+    rms_cache_slot_t asScratch[RMS_CACHE_FORMAT_COUNT];
+    RmsCache_Render(psResult, true, asScratch);
+
+    // Publish rendered bytes under mutex
+    xSemaphoreTake(gsCacheMutex, portMAX_DELAY);
+    memcpy(gasSlots, asScratch, sizeof(gasSlots));
+    guiVersion++;
+    gliTimestampUs = psResult->liTimestampUs;
+    gbHasValue = true;
+    xSemaphoreGive(gsCacheMutex);
+}
+
+
+esp_err_t RmsCache_Init(void)
+{
+    // Creates the cache mutex and renders the "no value yet" payloads
+    // Registers with the ADC publish path so every new result is cached
+    // Must run after Adc_Init and before the first measurement
+
+    if (gsCacheMutex == NULL) {
+        gsCacheMutex = xSemaphoreCreateMutex();
+    }
+    if (gsCacheMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Pre-render payloads for the empty state
+    RmsCache_Render(NULL, false, gasSlots);
+    guiVersion = 0;
+    gliTimestampUs = 0;
+    gbHasValue = false;
+
+    return Adc_RegisterPublishHook(RmsCache_OnPublish, NULL);
+}
+
+
+bool RmsCache_Copy(rms_cache_format_t eFormat, void *pvOut, size_t szOut, rms_cache_info_t *psInfoOut)
+{
+    // Copies the pre-rendered bytes of one encoding into the caller buffer
+    // Returns metadata captured under the same lock so version and bytes match
+    // Returns false for unknown formats, missing init or a too small buffer
+
+    if ((int)eFormat < 0 || eFormat >= RMS_CACHE_FORMAT_COUNT || pvOut == NULL || gsCacheMutex == NULL) {
+        return false;
+    }
+
+    // Copy bytes and metadata under mutex
+    bool bOk = false;
+    xSemaphoreTake(gsCacheMutex, portMAX_DELAY);
+    const rms_cache_slot_t *psSlot = &gasSlots[eFormat];
+    if (psSlot->szLength > 0 && psSlot->szLength <= szOut) {
+        memcpy(pvOut, psSlot->auData, psSlot->szLength);
+        if (psInfoOut != NULL) {
+            psInfoOut->uiVersion = guiVersion;
+            psInfoOut->liTimestampUs = gliTimestampUs;
+            psInfoOut->bHasValue = gbHasValue;
+            psInfoOut->szLength = psSlot->szLength;
+        }
+        bOk = true;
+    }
+    xSemaphoreGive(gsCacheMutex);
+
+    return bOk;
+}
@@ -0,0 +1,34 @@
+// Declares the pre-rendered RMS payload cache fed by the ADC publish hook.
+// Serialized forms are rendered once per measurement and copied by handlers.
+// Keeps the hot /api/rms read path free of formatting work.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+    RMS_CACHE_FORMAT_JSON = 0,
+    RMS_CACHE_FORMAT_BINARY,
+    RMS_CACHE_FORMAT_CBOR,
+    RMS_CACHE_FORMAT_COUNT
+} rms_cache_format_t;
+
+typedef struct
+{
+    uint32_t uiVersion;
+    int64_t liTimestampUs;
+    bool bHasValue;
+    size_t szLength;
+} rms_cache_info_t;
+
+// Largest rendered payload across all formats
+#define iRmsCacheMaxBytes               192
+
+esp_err_t RmsCache_Init(void);
+
+// Copies the current rendering; returns false if psOut is too small
+bool RmsCache_Copy(rms_cache_format_t eFormat, void *pvOut, size_t szOut, rms_cache_info_t *psInfoOut);
@@ -0,0 +1,410 @@
+// Implements /api/stream, a Server-Sent Events push channel for measurements.
+// Renders rms and samples events once per published result and queues them per client.
+// Drains client buffers from one sender task and drops subscribers that fall behind.
+
+#include "sse_stream.h"
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "adc.h"
+#include "json_writer.h"
+#include "proto.h"
+#include "app_config.h"
+
+static const char *gTag = "SSE";
+
+typedef struct
+{
+    httpd_req_t *psReq;
+    bool bWantSamples;
+    bool bDrop;
+    size_t szPending;
+    char acPending[iSseClientBufferBytes];
+    size_t szChunkLen;              // Leading pending bytes sealed into the chunk on the wire, 0 when idle
+    size_t szChunkSent;             // Chunk bytes already sent, counting the size line and trailer
+    int iChunkHeaderLen;
+    char acChunkHeader[12];         // Hex size line of the sealed chunk
+} sse_client_t;
+
+typedef enum
+{
+    SSE_FLUSH_DONE = 0,
+    SSE_FLUSH_BLOCKED,
+    SSE_FLUSH_FAILED
+} sse_flush_t;
+
+static SemaphoreHandle_t gsSseMutex = NULL;
+static TaskHandle_t gsSenderTask = NULL;
+static sse_client_t gasClients[iSseMaxClients];
+static int giClientCount = 0;
+
+// Latest rendered events, replayed to new subscribers
+static char gacRmsEvent[256];
+static size_t gszRmsEvent = 0;
+static char gacSamplesEvent[iSseClientBufferBytes];
+static size_t gszSamplesEvent = 0;
+
+static const char gsEventPrefixRms[] = "event: rms\ndata: ";
+static const char gsEventPrefixSamples[] = "event: samples\ndata: ";
+static const char gsEventSuffix[] = "\n\n";
+static const char gsKeepAlive[] = ": keepalive\n\n";
+
+
+static void SseStream_AppendLocked(sse_client_t *psClient, const char *psData, size_t szLen)
+{
+    // Queues event bytes for one subscriber while the stream mutex is held
+    // Marks the subscriber for dropping when its bounded buffer would overflow
+    // Leaves already queued events intact so the client never sees partial events
+
+    if (psClient->psReq == NULL || psClient->bDrop || szLen == 0) {
+        return;
+    }
+
+    // Drop slow subscribers instead of growing memory
+    if (psClient->szPending + szLen > sizeof(psClient->acPending)) {
+        psClient->bDrop = true;
+        return;
+    }
+
+    memcpy(psClient->acPending + psClient->szPending, psData, szLen);
+    psClient->szPending += szLen;
+}
+
+
+static void SseStream_RenderLocked(const adc_result_t *psResult)
+{
+    // Renders the rms and samples events for the latest measurement
+    // Uses the streaming JSON writer in buffer mode around the proto serializers
+    // Clears an event when it does not fit so truncated JSON is never sent
+
+    json_writer_t sWriter;
+
+    // Render rms event
+    JsonWriter_InitBuffer(&sWriter, gacRmsEvent, sizeof(gacRmsEvent));
+    JsonWriter_Raw(&sWriter, gsEventPrefixRms, sizeof(gsEventPrefixRms) - 1);
+    Proto_WriteRmsJson(&sWriter, psResult, true);
+    JsonWriter_Raw(&sWriter, gsEventSuffix, sizeof(gsEventSuffix) - 1);
+    int iRmsLen = JsonWriter_Finish(&sWriter);
+    gszRmsEvent = (iRmsLen > 0 && iRmsLen < (int)sizeof(gacRmsEvent)) ? (size_t)iRmsLen : 0;
+
+    // Copy the waveform that belongs to this measurement
+    static int16_t aiChannelA_mV[iSamples_PerCh];
+    static int16_t aiChannelB_mV[iSamples_PerCh];
+    int iSamples = 0;
+    int64_t liTimestampUs = 0;
+    gszSamplesEvent = 0;
+    if (!Adc_GetLastSamplesMilliVolts(aiChannelA_mV, aiChannelB_mV, iSamples_PerCh,
+                                      &iSamples, &liTimestampUs, NULL, NULL)) {
+        return;
+    }
+
+    // Render samples event
+    JsonWriter_InitBuffer(&sWriter, gacSamplesEvent, sizeof(gacSamplesEvent));
+    JsonWriter_Raw(&sWriter, gsEventPrefixSamples, sizeof(gsEventPrefixSamples) - 1);
+    Proto_WriteSamplesJson(&sWriter, aiChannelA_mV, aiChannelB_mV, iSamples,
+                           liTimestampUs, esp_timer_get_time());
+    JsonWriter_Raw(&sWriter, gsEventSuffix, sizeof(gsEventSuffix) - 1);
+    int iSamplesLen = JsonWriter_Finish(&sWriter);
+    if (iSamplesLen > 0 && iSamplesLen < (int)sizeof(gacSamplesEvent)) {
+        gszSamplesEvent = (size_t)iSamplesLen;
+    } else {
+        ESP_LOGW(gTag, "Samples event too large (%d bytes), skipped", iSamplesLen);
+    }
+}
+
+
+static void SseStream_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Receives each published measurement from the ADC module
+    // Renders events once and fans the bytes out to every subscriber buffer
+    // Wakes the sender task instead of touching sockets in the measuring task
+
+    (void)pvCtx;
+
+    xSemaphoreTake(gsSseMutex, portMAX_DELAY);
+
+    SseStream_RenderLocked(psResult);
+
+    // Queue events for all subscribers
+    for (int iIndex = 0; iIndex < iSseMaxClients; iIndex++) {
+        sse_client_t *psClient = &gasClients[iIndex];
+        SseStream_AppendLocked(psClient, gacRmsEvent, gszRmsEvent);
+        if (psClient->bWantSamples) {
+            SseStream_AppendLocked(psClient, gacSamplesEvent, gszSamplesEvent);
+        }
+    }
+
+    xSemaphoreGive(gsSseMutex);
+
+    if (gsSenderTask != NULL) {
+        xTaskNotifyGive(gsSenderTask);
+    }
+}
+
+
+static void SseStream_CloseClient(sse_client_t *psClient)
+{
+    // Ends one subscriber and releases its async request
+    // Forces the socket closed since an event stream has no regular end
+    // Frees the slot for new subscribers
+
+    httpd_req_t *psReq = psClient->psReq;
+
+    (void)httpd_sess_trigger_close(psReq->handle, httpd_req_to_sockfd(psReq));
+    (void)httpd_req_async_handler_complete(psReq);
+
+    xSemaphoreTake(gsSseMutex, portMAX_DELAY);
+    psClient->psReq = NULL;
+    psClient->bDrop = false;
+    psClient->szPending = 0;
+    psClient->szChunkLen = 0;
+    giClientCount--;
+    xSemaphoreGive(gsSseMutex);
+}
+
+
+static sse_flush_t SseStream_FlushLocked(sse_client_t *psClient)
+{
+    // Writes queued bytes as HTTP chunks without ever blocking the sender task
+    // Seals the pending bytes into one chunk; events queued meanwhile wait for the next one
+    // Keeps the progress of a send that would block so the chunk resumes where it stopped
+
+    httpd_req_t *psReq = psClient->psReq;
+    int iSockFd = httpd_req_to_sockfd(psReq);
+
+    while (1) {
+
+        // Seal everything queued so far into a new chunk
+        if (psClient->szChunkLen == 0) {
+            if (psClient->szPending == 0) {
+                return SSE_FLUSH_DONE;
+            }
+            psClient->szChunkLen = psClient->szPending;
+            psClient->szChunkSent = 0;
+            psClient->iChunkHeaderLen = snprintf(psClient->acChunkHeader, sizeof(psClient->acChunkHeader),
+                                                 "%x\r\n", (unsigned int)psClient->szChunkLen);
+        }
+
+        // Send the size line, the data and the trailer from where the last attempt stopped
+        size_t szHeader = (size_t)psClient->iChunkHeaderLen;
+        size_t szDataEnd = szHeader + psClient->szChunkLen;
+        size_t szTotal = szDataEnd + 2;
+        while (psClient->szChunkSent < szTotal) {
+            size_t szOffset = psClient->szChunkSent;
+            const char *psData;
+            size_t szLen;
+            if (szOffset < szHeader) {
+                psData = psClient->acChunkHeader + szOffset;
+                szLen = szHeader - szOffset;
+            } else if (szOffset < szDataEnd) {
+                psData = psClient->acPending + (szOffset - szHeader);
+                szLen = szDataEnd - szOffset;
+            } else {
+                psData = "\r\n" + (szOffset - szDataEnd);
+                szLen = szTotal - szOffset;
+            }
+
+            int iSent = httpd_socket_send(psReq->handle, iSockFd, psData, szLen, MSG_DONTWAIT);
+            if (iSent == HTTPD_SOCK_ERR_TIMEOUT) {
+                return SSE_FLUSH_BLOCKED;
+            }
+            if (iSent <= 0) {
+                return SSE_FLUSH_FAILED;
+            }
+            psClient->szChunkSent += (size_t)iSent;
+        }
+
+        // Release the sent bytes and keep what was queued behind them
+        psClient->szPending -= psClient->szChunkLen;
+        memmove(psClient->acPending, psClient->acPending + psClient->szChunkLen, psClient->szPending);
+        psClient->szChunkLen = 0;
+    }
+}
+
+
+static void SseStream_SenderTask(void *pvArg)
+{
+    // Drains subscriber buffers into their held connections
+    // Sends keep-alive comments when no event was sent for a while
+    // Retries blocked subscribers shortly so one slow client never delays the others
+
+    (void)pvArg;
+
+    int64_t liLastSendUs = esp_timer_get_time();
+    bool bBacklog = false;
+
+    while (1) {
+
+        // Sleep until new events are queued, a blocked client is due for a retry or keep-alive is due
+        (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(bBacklog ? iSseSendRetryMs : iSseKeepAliveMs));
+
+        bool bKeepAlive = (esp_timer_get_time() - liLastSendUs) >= ((int64_t)iSseKeepAliveMs * 1000);
+        liLastSendUs = esp_timer_get_time();
+        bBacklog = false;
+
+        for (int iIndex = 0; iIndex < iSseMaxClients; iIndex++) {
+            sse_client_t *psClient = &gasClients[iIndex];
+
+            // Send queued events or a keep-alive comment; the sends never block, so the mutex stays short
+            xSemaphoreTake(gsSseMutex, portMAX_DELAY);
+            if (psClient->psReq == NULL) {
+                xSemaphoreGive(gsSseMutex);
+                continue;
+            }
+            if (bKeepAlive && psClient->szPending == 0) {
+                SseStream_AppendLocked(psClient, gsKeepAlive, sizeof(gsKeepAlive) - 1);
+            }
+            bool bDrop = psClient->bDrop;
+            sse_flush_t eFlush = bDrop ? SSE_FLUSH_FAILED : SseStream_FlushLocked(psClient);
+            xSemaphoreGive(gsSseMutex);
+
+            // Drop subscribers whose buffer filled up while their socket would not take more
+            if (bDrop) {
+                ESP_LOGW(gTag, "Dropping slow subscriber %d", iIndex);
+                SseStream_CloseClient(psClient);
+            } else if (eFlush == SSE_FLUSH_FAILED) {
+                ESP_LOGI(gTag, "Subscriber %d disconnected", iIndex);
+                SseStream_CloseClient(psClient);
+            } else if (eFlush == SSE_FLUSH_BLOCKED) {
+                bBacklog = true;
+            }
+        }
+    }
+}
+
+
+static esp_err_t SseStream_HandleStream(httpd_req_t *psReq)
+{
+    // Accepts a new SSE subscriber and hands its connection to the sender task
+    // Uses async request handling so the httpd worker returns immediately
+    // Replays the latest events so the client renders without waiting a period
+
+    // Parse optional samples subscription
+    bool bWantSamples = false;
+    char sQuery[32];
+    char sValue[4];
+    if (httpd_req_get_url_query_str(psReq, sQuery, sizeof(sQuery)) == ESP_OK &&
+        httpd_query_key_value(sQuery, "samples", sValue, sizeof(sValue)) == ESP_OK) {
+        bWantSamples = (sValue[0] == '1');
+    }
+
+    // Find a free subscriber slot
+    xSemaphoreTake(gsSseMutex, portMAX_DELAY);
+    sse_client_t *psClient = NULL;
+    for (int iIndex = 0; iIndex < iSseMaxClients; iIndex++) {
+        if (gasClients[iIndex].psReq == NULL) {
+            psClient = &gasClients[iIndex];
+            break;
+        }
+    }
+    xSemaphoreGive(gsSseMutex);
+
+    if (psClient == NULL) {
+        httpd_resp_set_status(psReq, "503 Service Unavailable");
+        httpd_resp_set_hdr(psReq, "Retry-After", "10");
+        httpd_resp_sendstr(psReq, "Too many stream clients");
+        return ESP_OK;
+    }
+
+    // Detach the request from the httpd worker
+    httpd_req_t *psAsyncReq = NULL;
+    esp_err_t eErr = httpd_req_async_handler_begin(psReq, &psAsyncReq);
+    if (eErr != ESP_OK) {
+        ESP_LOGE(gTag, "async begin failed: %s", esp_err_to_name(eErr));
+        return eErr;
+    }
+
+    httpd_resp_set_type(psAsyncReq, "text/event-stream");
+    httpd_resp_set_hdr(psAsyncReq, "Cache-Control", "no-cache");
+
+    // Send the headers with a reconnect hint; the sender task writes later chunks straight to the socket
+    static const char sRetryHint[] = "retry: 3000\n\n";
+    eErr = httpd_resp_send_chunk(psAsyncReq, sRetryHint, (ssize_t)(sizeof(sRetryHint) - 1));
+    if (eErr != ESP_OK) {
+        (void)httpd_sess_trigger_close(psAsyncReq->handle, httpd_req_to_sockfd(psAsyncReq));
+        (void)httpd_req_async_handler_complete(psAsyncReq);
+        return eErr;
+    }
+
+    // Publish the slot with the latest events
+    xSemaphoreTake(gsSseMutex, portMAX_DELAY);
+    psClient->psReq = psAsyncReq;
+    psClient->bWantSamples = bWantSamples;
+    psClient->bDrop = false;
+    psClient->szPending = 0;
+    psClient->szChunkLen = 0;
+    giClientCount++;
+    SseStream_AppendLocked(psClient, gacRmsEvent, gszRmsEvent);
+    if (bWantSamples) {
+        SseStream_AppendLocked(psClient, gacSamplesEvent, gszSamplesEvent);
+    }
+    xSemaphoreGive(gsSseMutex);
+
+    xTaskNotifyGive(gsSenderTask);
+    ESP_LOGI(gTag, "Subscriber joined (samples=%d)", (int)bWantSamples);
+    return ESP_OK;
+}
+
+
+esp_err_t SseStream_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Registers /api/stream on the shared HTTP server
+    // Creates the sender task and hooks into the ADC publish path
+    // Returns an error when resources cannot be allocated
+
+    if (sHttpServer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Create synchronization and sender task
+    if (gsSseMutex == NULL) {
+        gsSseMutex = xSemaphoreCreateMutex();
+    }
+    if (gsSseMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (gsSenderTask == NULL) {
+        BaseType_t bOk = xTaskCreate(SseStream_SenderTask, "sse_send", 4096, NULL, 4, &gsSenderTask);
+        if (bOk != pdPASS) {
+            gsSenderTask = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Render events on every published measurement
+    esp_err_t eErr = Adc_RegisterPublishHook(SseStream_OnPublish, NULL);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    // Register GET /api/stream
+    httpd_uri_t sStreamUri = {
+        .uri = "/api/stream",
+        .method = HTTP_GET,
+        .handler = SseStream_HandleStream,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sStreamUri));
+
+    ESP_LOGI(gTag, "SSE stream handler registered");
+    return ESP_OK;
+}
+
+
+int SseStream_GetClientCount(void)
+{
+    // Returns the number of currently attached SSE subscribers
+    // Lets power and diagnostics code react to active streaming clients
+    // Joins and CloseClient change the count under gsSseMutex; a stale read is harmless for power and metrics
+
+    return giClientCount;
+}
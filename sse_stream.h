@@ -0,0 +1,12 @@
+// Declares the Server-Sent Events endpoint that pushes measurements to browsers.
+// Holds subscriber connections through async httpd requests and a sender task.
+// Lets other modules query whether streaming clients are attached.
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+esp_err_t SseStream_RegisterHandlers(httpd_handle_t sHttpServer);
+
+int SseStream_GetClientCount(void);
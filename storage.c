@@ -14,6 +14,14 @@ static const char *gTag = "STORAGE";
 static const char *gsNamespace = "cfg";
 static const char *gsKeySsid = "wifi_ssid";
 static const char *gsKeyPass = "wifi_pass";
+static const char *gsKeyApHint = "wifi_ap_hint";
+static const char *gsKeyStaticIp = "sta_static_ip";
+static const char *gsKeyWifiPs = "wifi_ps";
+static const char *gsKeyMqttUri = "mqtt_uri";
+static const char *gsKeyMqttUser = "mqtt_user";
+static const char *gsKeyMqttPass = "mqtt_pass";
+static const char *gsKeyMqttTopic = "mqtt_topic";
+static const char *gsKeyMqttBatch = "mqtt_batch";
 
 
 esp_err_t Storage_Init(void)
@@ -96,11 +104,12 @@ esp_err_t Storage_SaveWifiCreds(const wifi_creds_t *psCreds)
         return eErr;
     }
 
-    // Write SSID and password
+    // Write SSID and password; the AP hint belonged to the old network
     eErr = nvs_set_str(sHandle, gsKeySsid, psCreds->sSsid);
     if (eErr == ESP_OK) {
         eErr = nvs_set_str(sHandle, gsKeyPass, psCreds->sPassword);
     }
+    (void)nvs_erase_key(sHandle, gsKeyApHint);
 
     // Commit changes
     if (eErr == ESP_OK) {
@@ -125,9 +134,11 @@ esp_err_t Storage_ClearWifiCreds(void)
         return eErr;
     }
 
-    // Erase SSID and password keys
+    // Erase SSID, password, AP hint and static IP keys
     (void)nvs_erase_key(sHandle, gsKeySsid);
     (void)nvs_erase_key(sHandle, gsKeyPass);
+    (void)nvs_erase_key(sHandle, gsKeyApHint);
+    (void)nvs_erase_key(sHandle, gsKeyStaticIp);
 
     // Commit erase operations
     eErr = nvs_commit(sHandle);
@@ -135,3 +146,314 @@ esp_err_t Storage_ClearWifiCreds(void)
 
     return eErr;
 }
+
+
+esp_err_t Storage_LoadWifiApHint(wifi_ap_hint_t *psHintOut)
+{
+    // Loads the BSSID, channel and auth mode of the last joined AP
+    // Marks the hint invalid when absent or when the blob size does not match
+    // Saving or clearing credentials erases the hint, so it always matches the stored SSID
+
+    // Validate output pointer
+    if (psHintOut == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Reset output defaults
+    memset(psHintOut, 0, sizeof(*psHintOut));
+    psHintOut->bValid = false;
+
+    // Open namespace for read
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READONLY, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    // Read the packed record: bssid[6], channel, auth mode
+    uint8_t auBlob[8];
+    size_t szLen = sizeof(auBlob);
+    eErr = nvs_get_blob(sHandle, gsKeyApHint, auBlob, &szLen);
+    nvs_close(sHandle);
+
+    if (eErr == ESP_OK && szLen == sizeof(auBlob) && auBlob[6] != 0) {
+        memcpy(psHintOut->auBssid, auBlob, sizeof(psHintOut->auBssid));
+        psHintOut->uiChannel = auBlob[6];
+        psHintOut->uiAuthMode = auBlob[7];
+        psHintOut->bValid = true;
+    }
+
+    return ESP_OK;
+}
+
+
+esp_err_t Storage_SaveWifiApHint(const wifi_ap_hint_t *psHint)
+{
+    // Saves the BSSID, channel and auth mode of the AP just joined
+    // Stores a fixed 8-byte blob so the layout does not depend on struct packing
+    // Callers write only when the AP changed to spare flash wear
+
+    // Validate input pointer and fields
+    if (psHint == NULL || psHint->uiChannel == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Open namespace for write
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READWRITE, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    // Pack and write the record
+    uint8_t auBlob[8];
+    memcpy(auBlob, psHint->auBssid, sizeof(psHint->auBssid));
+    auBlob[6] = psHint->uiChannel;
+    auBlob[7] = psHint->uiAuthMode;
+    eErr = nvs_set_blob(sHandle, gsKeyApHint, auBlob, sizeof(auBlob));
+
+    // Commit changes
+    if (eErr == ESP_OK) {
+        eErr = nvs_commit(sHandle);
+    }
+
+    nvs_close(sHandle);
+    return eErr;
+}
+
+
+esp_err_t Storage_LoadStaticIp(sta_ip_config_t *psConfigOut)
+{
+    // Loads the static IPv4 address, netmask, gateway and DNS server
+    // Marks the config invalid when absent, so the station uses DHCP
+    // Rejects a blob of the wrong size rather than guessing its layout
+
+    // Validate output pointer
+    if (psConfigOut == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Reset output defaults
+    memset(psConfigOut, 0, sizeof(*psConfigOut));
+    psConfigOut->bValid = false;
+
+    // Open namespace for read
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READONLY, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    // Read the packed record: ip, netmask, gateway, dns
+    uint32_t auiBlob[4];
+    size_t szLen = sizeof(auiBlob);
+    eErr = nvs_get_blob(sHandle, gsKeyStaticIp, auiBlob, &szLen);
+    nvs_close(sHandle);
+
+    if (eErr == ESP_OK && szLen == sizeof(auiBlob) && auiBlob[0] != 0) {
+        psConfigOut->uiIp = auiBlob[0];
+        psConfigOut->uiNetmask = auiBlob[1];
+        psConfigOut->uiGateway = auiBlob[2];
+        psConfigOut->uiDns = auiBlob[3];
+        psConfigOut->bValid = true;
+    }
+
+    return ESP_OK;
+}
+
+
+esp_err_t Storage_SaveStaticIp(const sta_ip_config_t *psConfig)
+{
+    // Saves static IPv4 settings for the station
+    // A zero address erases the record and returns the station to DHCP
+    // Stores a fixed 16-byte blob; callers validate the addresses first
+
+    // Validate input pointer
+    if (psConfig == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Open namespace for write
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READWRITE, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    if (psConfig->uiIp == 0) {
+
+        // Erase the record; a missing key is already DHCP
+        eErr = nvs_erase_key(sHandle, gsKeyStaticIp);
+        if (eErr == ESP_ERR_NVS_NOT_FOUND) {
+            eErr = ESP_OK;
+        }
+    } else {
+
+        // Pack and write the record
+        uint32_t auiBlob[4] = { psConfig->uiIp, psConfig->uiNetmask, psConfig->uiGateway, psConfig->uiDns };
+        eErr = nvs_set_blob(sHandle, gsKeyStaticIp, auiBlob, sizeof(auiBlob));
+    }
+
+    // Commit changes
+    if (eErr == ESP_OK) {
+        eErr = nvs_commit(sHandle);
+    }
+
+    nvs_close(sHandle);
+    return eErr;
+}
+
+
+esp_err_t Storage_LoadWifiPowerSave(uint8_t *puiProfileOut)
+{
+    // Loads the Wi-Fi power-save profile chosen through the API
+    // Returns ESP_ERR_NVS_NOT_FOUND when none was stored, so the caller applies its default
+    // The value is not range checked here; the Wi-Fi manager validates it
+
+    // Validate output pointer
+    if (puiProfileOut == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Open namespace for read
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READONLY, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    eErr = nvs_get_u8(sHandle, gsKeyWifiPs, puiProfileOut);
+    nvs_close(sHandle);
+    return eErr;
+}
+
+
+esp_err_t Storage_SaveWifiPowerSave(uint8_t uiProfile)
+{
+    // Saves the Wi-Fi power-save profile so it survives reboots
+    // Kept apart from the credentials; clearing them leaves the profile in place
+    // Written only on an explicit API change, never by the streaming override
+
+    // Open namespace for write
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READWRITE, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    eErr = nvs_set_u8(sHandle, gsKeyWifiPs, uiProfile);
+
+    // Commit changes
+    if (eErr == ESP_OK) {
+        eErr = nvs_commit(sHandle);
+    }
+
+    nvs_close(sHandle);
+    return eErr;
+}
+
+
+esp_err_t Storage_LoadMqttConfig(mqtt_config_t *psConfigOut)
+{
+    // Loads MQTT broker settings from NVS
+    // Marks the config invalid if no broker URI has been stored
+    // Leaves optional fields empty and the batch size at 0 when absent
+
+    // Validate output pointer
+    if (psConfigOut == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Reset output defaults
+    memset(psConfigOut, 0, sizeof(*psConfigOut));
+    psConfigOut->bValid = false;
+
+    // Open namespace for read
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READONLY, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    // Read broker URI, which decides validity
+    size_t szLen = sizeof(psConfigOut->sBrokerUri);
+    eErr = nvs_get_str(sHandle, gsKeyMqttUri, psConfigOut->sBrokerUri, &szLen);
+    if (eErr != ESP_OK) {
+        psConfigOut->sBrokerUri[0] = '\0';
+        nvs_close(sHandle);
+        return ESP_OK;
+    }
+
+    // Read optional fields; a missing key leaves the field empty
+    szLen = sizeof(psConfigOut->sUsername);
+    if (nvs_get_str(sHandle, gsKeyMqttUser, psConfigOut->sUsername, &szLen) != ESP_OK) {
+        psConfigOut->sUsername[0] = '\0';
+    }
+    szLen = sizeof(psConfigOut->sPassword);
+    if (nvs_get_str(sHandle, gsKeyMqttPass, psConfigOut->sPassword, &szLen) != ESP_OK) {
+        psConfigOut->sPassword[0] = '\0';
+    }
+    szLen = sizeof(psConfigOut->sTopic);
+    if (nvs_get_str(sHandle, gsKeyMqttTopic, psConfigOut->sTopic, &szLen) != ESP_OK) {
+        psConfigOut->sTopic[0] = '\0';
+    }
+    (void)nvs_get_u8(sHandle, gsKeyMqttBatch, &psConfigOut->uiBatchSize);
+    nvs_close(sHandle);
+
+    psConfigOut->bValid = true;
+    return ESP_OK;
+}
+
+
+esp_err_t Storage_SaveMqttConfig(const mqtt_config_t *psConfig)
+{
+    // Saves MQTT broker settings into NVS
+    // An empty broker URI erases the settings and disables publishing
+    // Commits all keys together so a reboot sees a consistent config
+
+    // Validate input pointer
+    if (psConfig == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Open namespace for write
+    nvs_handle_t sHandle = 0;
+    esp_err_t eErr = nvs_open(gsNamespace, NVS_READWRITE, &sHandle);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    if (psConfig->sBrokerUri[0] == '\0') {
+
+        // Erase all MQTT keys
+        (void)nvs_erase_key(sHandle, gsKeyMqttUri);
+        (void)nvs_erase_key(sHandle, gsKeyMqttUser);
+        (void)nvs_erase_key(sHandle, gsKeyMqttPass);
+        (void)nvs_erase_key(sHandle, gsKeyMqttTopic);
+        (void)nvs_erase_key(sHandle, gsKeyMqttBatch);
+    } else {
+
+        // Write every field
+        eErr = nvs_set_str(sHandle, gsKeyMqttUri, psConfig->sBrokerUri);
+        if (eErr == ESP_OK) {
+            eErr = nvs_set_str(sHandle, gsKeyMqttUser, psConfig->sUsername);
+        }
+        if (eErr == ESP_OK) {
+            eErr = nvs_set_str(sHandle, gsKeyMqttPass, psConfig->sPassword);
+        }
+        if (eErr == ESP_OK) {
+            eErr = nvs_set_str(sHandle, gsKeyMqttTopic, psConfig->sTopic);
+        }
+        if (eErr == ESP_OK) {
+            eErr = nvs_set_u8(sHandle, gsKeyMqttBatch, psConfig->uiBatchSize);
+        }
+    }
+
+    // Commit changes
+    if (eErr == ESP_OK) {
+        eErr = nvs_commit(sHandle);
+    }
+
+    nvs_close(sHandle);
+    return eErr;
+}
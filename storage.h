@@ -5,6 +5,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
 
 typedef struct
@@ -14,7 +15,44 @@ typedef struct
     bool bValid;
 } wifi_creds_t;
 
+// Last AP the station joined; lets reconnects skip the all-channel scan
+typedef struct
+{
+    uint8_t auBssid[6];
+    uint8_t uiChannel;
+    uint8_t uiAuthMode;             // wifi_auth_mode_t of the joined AP
+    bool bValid;
+} wifi_ap_hint_t;
+
+// Optional static IPv4 settings for the station; addresses in network byte order
+typedef struct
+{
+    uint32_t uiIp;
+    uint32_t uiNetmask;
+    uint32_t uiGateway;
+    uint32_t uiDns;
+    bool bValid;
+} sta_ip_config_t;
+
+typedef struct
+{
+    char sBrokerUri[128];
+    char sUsername[33];
+    char sPassword[65];
+    char sTopic[64];
+    uint8_t uiBatchSize;
+    bool bValid;
+} mqtt_config_t;
+
 esp_err_t Storage_Init(void);
 esp_err_t Storage_LoadWifiCreds(wifi_creds_t *psCredsOut);
 esp_err_t Storage_SaveWifiCreds(const wifi_creds_t *psCreds);
 esp_err_t Storage_ClearWifiCreds(void);
+esp_err_t Storage_LoadWifiApHint(wifi_ap_hint_t *psHintOut);
+esp_err_t Storage_SaveWifiApHint(const wifi_ap_hint_t *psHint);
+esp_err_t Storage_LoadStaticIp(sta_ip_config_t *psConfigOut);
+esp_err_t Storage_SaveStaticIp(const sta_ip_config_t *psConfig);
+esp_err_t Storage_LoadWifiPowerSave(uint8_t *puiProfileOut);
+esp_err_t Storage_SaveWifiPowerSave(uint8_t uiProfile);
+esp_err_t Storage_LoadMqttConfig(mqtt_config_t *psConfigOut);
+esp_err_t Storage_SaveMqttConfig(const mqtt_config_t *psConfig);
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+# Compares API round-trip time and throughput with the provisioning AP on and off.
+# Switches the AP through /api/cmd, waits for /metrics to confirm, then measures each mode.
+# Run against the station IP, not 192.168.4.1: tools/ap_mode_bench.py 192.168.1.50 -n 200
+
+import argparse
+import http.client
+import statistics
+import sys
+import time
+
+
+def request(oConn, sMethod, sPath, abBody=None, dictHeaders=None):
+    # Sends one request on a keep-alive connection and returns status, body and wall time in ms.
+    dStart = time.perf_counter()
+    oConn.request(sMethod, sPath, body=abBody, headers=dictHeaders or {})
+    oResp = oConn.getresponse()
+    abData = oResp.read()
+    return oResp.status, abData, (time.perf_counter() - dStart) * 1000.0
+
+
+def ap_active(oConn):
+    # Reads adc_node_wifi_ap_active from /metrics; None when the node does not export it.
+    _, abData, _ = request(oConn, 'GET', '/metrics')
+    for sLine in abData.decode('utf-8', 'replace').splitlines():
+        if sLine.startswith('adc_node_wifi_ap_active '):
+            return sLine.split()[1] == '1'
+    return None
+
+
+def switch_ap(oConn, bOn, dTimeout):
+    # Requests the mode and waits until the node reports it; the switch runs on the Wi-Fi task.
+    iStatus, abData, _ = request(oConn, 'POST', '/api/cmd', b'apOn' if bOn else b'apOff')
+    if iStatus != 200:
+        raise RuntimeError('AP %s refused: %d %s' % ('on' if bOn else 'off', iStatus, abData.decode()))
+    dDeadline = time.monotonic() + dTimeout
+    while time.monotonic() < dDeadline:
+        if ap_active(oConn) == bOn:
+            return
+        time.sleep(0.25)
+    raise RuntimeError('AP did not switch %s within %.0f s' % ('on' if bOn else 'off', dTimeout))
+
+
+def percentile(adValues, dShare):
+    adSorted = sorted(adValues)
+    return adSorted[min(len(adSorted) - 1, int(dShare * len(adSorted)))]
+
+
+def measure(oConn, iCount, dPace, iPages):
+    # RTT of small cached replies, paced below the cheap rate-limit budget,
+    # then throughput of back-to-back dashboard downloads, which are not rate limited.
+    adRtt = []
+    iLimited = 0
+    for _ in range(iCount):
+        iStatus, _, dMs = request(oConn, 'GET', '/api/rms')
+        if iStatus == 429:
+            iLimited += 1
+        else:
+            adRtt.append(dMs)
+        time.sleep(dPace)
+
+    iBytes = 0
+    dStart = time.perf_counter()
+    for _ in range(iPages):
+        _, abData, _ = request(oConn, 'GET', '/', dictHeaders={'Accept-Encoding': 'gzip'})
+        iBytes += len(abData)
+    dSeconds = time.perf_counter() - dStart
+
+    return {
+        'p50': statistics.median(adRtt) if adRtt else 0.0,
+        'p90': percentile(adRtt, 0.90) if adRtt else 0.0,
+        'p99': percentile(adRtt, 0.99) if adRtt else 0.0,
+        'max': max(adRtt) if adRtt else 0.0,
+        'limited': iLimited,
+        'kib_s': iBytes / 1024.0 / dSeconds if dSeconds > 0 else 0.0,
+    }
+
+
+def main():
+    oParser = argparse.ArgumentParser(description='Provisioning AP on/off API benchmark')
+    oParser.add_argument('host', help='station IP of the node')
+    oParser.add_argument('--port', type=int, default=80)
+    oParser.add_argument('-n', '--count', type=int, default=200, help='RTT samples per mode')
+    oParser.add_argument('--pace', type=float, default=0.06, help='seconds between RTT samples')
+    oParser.add_argument('--pages', type=int, default=50, help='dashboard downloads per mode')
+    oParser.add_argument('--settle', type=float, default=3.0, help='seconds to wait after each switch')
+    oArgs = oParser.parse_args()
+
+    oConn = http.client.HTTPConnection(oArgs.host, oArgs.port, timeout=10)
+    bInitial = ap_active(oConn)
+    if bInitial is None:
+        print('adc_node_wifi_ap_active missing from /metrics; firmware too old?')
+        return 1
+
+    dictResults = {}
+    try:
+        for bOn in (True, False):
+            switch_ap(oConn, bOn, 15.0)
+            time.sleep(oArgs.settle)
+            dictResults['on' if bOn else 'off'] = measure(oConn, oArgs.count, oArgs.pace, oArgs.pages)
+    finally:
+        # Leave the AP as it was; turning it on again starts a manual hold on the node
+        if bInitial:
+            switch_ap(oConn, True, 15.0)
+        oConn.close()
+
+    print('%-4s %8s %8s %8s %8s %8s %10s' % ('ap', 'p50 ms', 'p90 ms', 'p99 ms', 'max ms', '429s', 'KiB/s'))
+    for sMode, dictRow in dictResults.items():
+        print('%-4s %8.1f %8.1f %8.1f %8.1f %8d %10.1f' % (sMode, dictRow['p50'], dictRow['p90'], dictRow['p99'],
+                                                          dictRow['max'], dictRow['limited'], dictRow['kib_s']))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,215 @@
+// Checks the triggered-capture edge detector and ring indexing on synthetic signals.
+// Feeds samples the way the ADC loop does and compares the linearized window with the source signal.
+// Build: cc -O2 -Wall -Wextra -I. tools/capture_trigger_test.c capture_trigger.c -lm -o /tmp/capture_trigger_test
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture_trigger.h"
+
+#define iTestWindow                     512
+#define iTestMaxSamples                 20000
+#define iTestSamplePeriodUs             100     // 10 kS/s, like iPerChSampleRate_Hz
+#define iTestRandomCases                2000
+
+static int giFailures = 0;
+static uint16_t gauSignal[iTestMaxSamples];
+
+
+static void Test_Check(bool bOk, const char *sCase, const char *sWhat)
+{
+    if (!bOk && giFailures++ < 20) {
+        printf("FAIL %s: %s\n", sCase, sWhat);
+    }
+}
+
+
+typedef struct
+{
+    bool bComplete;
+    bool bTriggered;
+    int iPushed;                    // Samples consumed from gauSignal
+    int iStart;
+    uint16_t auWindow[iTestWindow];
+} test_capture_t;
+
+
+static void Test_Run(test_capture_t *psOut, int iCount, int iPreSamples, int32_t iLevel, int32_t iHysteresis,
+                     bool bRising, int iDeadlineSamples, int iSamples)
+{
+    // Stores each sample in the ring slot the detector asks for, then pushes it, like Capture_TriggeredSamples
+    uint16_t auRing[iTestWindow];
+    capture_trigger_t sDetector;
+    CaptureTrigger_Init(&sDetector, iCount, iPreSamples, iLevel, iHysteresis, bRising,
+                        (int64_t)iDeadlineSamples * iTestSamplePeriodUs);
+
+    memset(psOut, 0, sizeof(*psOut));
+    memset(auRing, 0, sizeof(auRing));
+    for (int iIndex = 0; iIndex < iSamples; iIndex++) {
+        int iSlot = CaptureTrigger_NextSlot(&sDetector);
+        auRing[iSlot] = gauSignal[iIndex];
+        psOut->iPushed++;
+        if (CaptureTrigger_Push(&sDetector, gauSignal[iIndex], (int64_t)iIndex * iTestSamplePeriodUs)) {
+            psOut->bComplete = true;
+            break;
+        }
+    }
+
+    psOut->bTriggered = sDetector.bTriggered;
+    psOut->iStart = sDetector.iStart;
+    if (psOut->bComplete) {
+        CaptureTrigger_Linearize(auRing, psOut->auWindow, iCount, sDetector.iStart);
+    }
+}
+
+
+static bool Test_WindowIsSource(const test_capture_t *psCapture, int iCount)
+{
+    // The window must be the last iCount source samples, in order
+    int iFirst = psCapture->iPushed - iCount;
+    return iFirst >= 0 && memcmp(psCapture->auWindow, &gauSignal[iFirst], (size_t)iCount * sizeof(uint16_t)) == 0;
+}
+
+
+static int Test_ReferenceTrigger(int iSamples, int iPreSamples, int32_t iLevel, int32_t iHysteresis, bool bRising)
+{
+    // Straight scan of the documented rule: arm past the level by the hysteresis, fire on reaching it,
+    // and ignore a crossing that comes before iPreSamples of history exist
+    bool bArmed = false;
+    for (int iIndex = 0; iIndex < iSamples; iIndex++) {
+        int32_t iValue = gauSignal[iIndex];
+        bool bPastArm = bRising ? (iValue <= iLevel - iHysteresis) : (iValue >= iLevel + iHysteresis);
+        bool bCrossed = bRising ? (iValue >= iLevel) : (iValue <= iLevel);
+        if (bPastArm) {
+            bArmed = true;
+        } else if (bArmed && bCrossed) {
+            bArmed = false;
+            if (iIndex >= iPreSamples) {
+                return iIndex;
+            }
+        }
+    }
+    return -1;
+}
+
+
+static void Test_PreSamples(void)
+{
+    Test_Check(CaptureTrigger_PreSamples(512, 0) == 0, "pre", "0 % is sample 0");
+    Test_Check(CaptureTrigger_PreSamples(512, 25) == 128, "pre", "25 % of 512 is 128");
+    Test_Check(CaptureTrigger_PreSamples(512, 100) == 511, "pre", "100 % keeps the trigger inside");
+    Test_Check(CaptureTrigger_PreSamples(3, 50) == 1, "pre", "rounds down");
+}
+
+
+static void Test_Step(const char *sCase, int iEdgeAt, int iPreSamples, bool bRising)
+{
+    // A clean step: the trigger sample lands at iPreSamples and the window is contiguous
+    uint16_t uLow = bRising ? 1000 : 3000;
+    uint16_t uHigh = bRising ? 3000 : 1000;
+    for (int iIndex = 0; iIndex < iTestMaxSamples; iIndex++) {
+        gauSignal[iIndex] = (iIndex < iEdgeAt) ? uLow : uHigh;
+    }
+
+    test_capture_t sCapture;
+    Test_Run(&sCapture, iTestWindow, iPreSamples, 2000, 20, bRising, iTestMaxSamples, iTestMaxSamples);
+    Test_Check(sCapture.bComplete && sCapture.bTriggered, sCase, "step triggers");
+    Test_Check(sCapture.iPushed == iEdgeAt - iPreSamples + iTestWindow, sCase, "stops after the post-trigger part");
+    Test_Check(Test_WindowIsSource(&sCapture, iTestWindow), sCase, "window is the source in order");
+    Test_Check(sCapture.auWindow[iPreSamples] == uHigh &&
+               (iPreSamples == 0 || sCapture.auWindow[iPreSamples - 1] == uLow), sCase, "edge at iPreSamples");
+}
+
+
+static void Test_EarlyEdge(void)
+{
+    // A crossing before the pre-trigger history is full re-arms; the next one is used
+    for (int iIndex = 0; iIndex < iTestMaxSamples; iIndex++) {
+        gauSignal[iIndex] = ((iIndex >= 50 && iIndex < 120) || iIndex >= 400) ? 3000 : 1000;
+    }
+    test_capture_t sCapture;
+    Test_Run(&sCapture, iTestWindow, 128, 2000, 20, true, iTestMaxSamples, iTestMaxSamples);
+    Test_Check(sCapture.bTriggered && sCapture.iPushed == 400 - 128 + iTestWindow, "early edge",
+               "first edge ignored, second used");
+    Test_Check(Test_WindowIsSource(&sCapture, iTestWindow) && sCapture.auWindow[128] == 3000 &&
+               sCapture.auWindow[127] == 1000, "early edge", "edge at iPreSamples");
+}
+
+
+static void Test_Hysteresis(void)
+{
+    // Noise around the level smaller than the hysteresis never arms; auto mode returns the latest ring
+    for (int iIndex = 0; iIndex < iTestMaxSamples; iIndex++) {
+        gauSignal[iIndex] = (uint16_t)(2000 + ((iIndex % 2) ? 15 : -15) + (iIndex % 7));
+    }
+    test_capture_t sCapture;
+    Test_Run(&sCapture, iTestWindow, 256, 2000, 20, true, 3000, iTestMaxSamples);
+    Test_Check(sCapture.bComplete && !sCapture.bTriggered, "hysteresis", "noise does not trigger");
+    Test_Check(sCapture.iPushed == 3001, "hysteresis", "stops at the first sample past the deadline");
+    Test_Check(Test_WindowIsSource(&sCapture, iTestWindow), "hysteresis", "auto window is the latest ring");
+
+    // The auto window never comes back before one full ring was captured
+    Test_Run(&sCapture, iTestWindow, 256, 2000, 20, true, 0, iTestMaxSamples);
+    Test_Check(sCapture.iPushed == iTestWindow && Test_WindowIsSource(&sCapture, iTestWindow), "hysteresis",
+               "expired deadline still fills one ring");
+}
+
+
+static void Test_RandomSignals(void)
+{
+    // Noisy sines at random level, hysteresis, pre-trigger and deadline against the reference scan
+    srand(4);
+    for (int iCase = 0; iCase < iTestRandomCases; iCase++) {
+        int iCount = 2 + rand() % (iTestWindow - 1);
+        int iPreSamples = CaptureTrigger_PreSamples(iCount, rand() % 101);
+        int32_t iLevel = 1000 + rand() % 2000;
+        int32_t iHysteresis = 1 + rand() % 60;
+        bool bRising = (rand() & 1) != 0;
+        int iDeadline = rand() % (iTestMaxSamples / 2);
+        double dPeriod = 20.0 + rand() % 400;
+        double dAmplitude = (rand() % 4 == 0) ? 10.0 : 200.0 + rand() % 1500;
+
+        for (int iIndex = 0; iIndex < iTestMaxSamples; iIndex++) {
+            double dValue = 2000.0 + dAmplitude * sin(2.0 * M_PI * iIndex / dPeriod) + (rand() % 41 - 20);
+            gauSignal[iIndex] = (uint16_t)lround(dValue);
+        }
+
+        test_capture_t sCapture;
+        Test_Run(&sCapture, iCount, iPreSamples, iLevel, iHysteresis, bRising, iDeadline, iTestMaxSamples);
+        if (!sCapture.bComplete) {
+            Test_Check(false, "random", "window never completed");
+            continue;
+        }
+        Test_Check(Test_WindowIsSource(&sCapture, iCount), "random", "window is the source in order");
+
+        // A trigger wins if it fires before the auto window would have been taken
+        int iAutoStop = (iDeadline > iCount - 1) ? iDeadline : iCount - 1;
+        int iRef = Test_ReferenceTrigger(iAutoStop + 1, iPreSamples, iLevel, iHysteresis, bRising);
+        if (iRef >= 0) {
+            Test_Check(sCapture.bTriggered, "random", "reference found an edge");
+            Test_Check(sCapture.iPushed == iRef - iPreSamples + iCount, "random", "trigger sample at iPreSamples");
+        } else {
+            Test_Check(!sCapture.bTriggered && sCapture.iPushed == iAutoStop + 1, "random",
+                       "auto window at the deadline");
+        }
+    }
+}
+
+
+int main(void)
+{
+    Test_PreSamples();
+    Test_Step("rising mid", 1000, 128, true);
+    Test_Step("falling mid", 1000, 128, false);
+    Test_Step("pre 0", 700, 0, true);
+    Test_Step("pre 100%", 700, iTestWindow - 1, true);
+    Test_Step("wrap", 5000, 300, false);
+    Test_EarlyEdge();
+    Test_Hysteresis();
+    Test_RandomSignals();
+
+    printf("%s: %d failure(s)\n", (giFailures == 0) ? "PASS" : "FAIL", giFailures);
+    return (giFailures == 0) ? 0 : 1;
+}
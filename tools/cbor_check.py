@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+# Fetches every data endpoint as JSON and as CBOR and checks that both decode to the same values.
+# Includes a small CBOR decoder (RFC 8949 plus RFC 8746 sint16 typed arrays), so no packages are needed.
+# Example: tools/cbor_check.py 192.168.1.50, or tools/cbor_check.py --file rms.cbor to dump a saved body
+
+import argparse
+import http.client
+import json
+import math
+import struct
+import sys
+import time
+
+
+class CborError(Exception):
+    pass
+
+
+BREAK = object()
+
+
+def decode_item(abData, iPos):
+    # Decodes one item at iPos and returns (value, next position); break codes return (BREAK, pos).
+    if iPos >= len(abData):
+        raise CborError('truncated at %d' % iPos)
+    iInitial = abData[iPos]
+    iMajor, iInfo = iInitial >> 5, iInitial & 0x1F
+    iPos += 1
+
+    if iMajor == 7:
+        if iInfo == 20:
+            return False, iPos
+        if iInfo == 21:
+            return True, iPos
+        if iInfo in (22, 23):
+            return None, iPos
+        if iInfo == 25:
+            return struct.unpack('>e', abData[iPos:iPos + 2])[0], iPos + 2
+        if iInfo == 26:
+            return struct.unpack('>f', abData[iPos:iPos + 4])[0], iPos + 4
+        if iInfo == 27:
+            return struct.unpack('>d', abData[iPos:iPos + 8])[0], iPos + 8
+        if iInfo == 31:
+            return BREAK, iPos
+        raise CborError('simple value %d' % iInfo)
+
+    # Argument, or None for indefinite length
+    if iInfo < 24:
+        iArg = iInfo
+    elif iInfo in (24, 25, 26, 27):
+        iSize = 1 << (iInfo - 24)
+        iArg = int.from_bytes(abData[iPos:iPos + iSize], 'big')
+        iPos += iSize
+    elif iInfo == 31 and iMajor in (2, 3, 4, 5):
+        iArg = None
+    else:
+        raise CborError('bad additional info %d' % iInfo)
+
+    if iMajor == 0:
+        return iArg, iPos
+    if iMajor == 1:
+        return -1 - iArg, iPos
+    if iMajor in (2, 3):
+        if iArg is None:
+            raise CborError('indefinite strings are not produced by the node')
+        abValue = abData[iPos:iPos + iArg]
+        return (abValue if iMajor == 2 else abValue.decode('utf-8')), iPos + iArg
+    if iMajor == 4:
+        aValue = []
+        while iArg is None or len(aValue) < iArg:
+            oItem, iPos = decode_item(abData, iPos)
+            if oItem is BREAK:
+                break
+            aValue.append(oItem)
+        return aValue, iPos
+    if iMajor == 5:
+        dictValue = {}
+        while iArg is None or len(dictValue) < iArg:
+            oKey, iPos = decode_item(abData, iPos)
+            if oKey is BREAK:
+                break
+            dictValue[oKey], iPos = decode_item(abData, iPos)
+        return dictValue, iPos
+    if iMajor == 6:
+        oValue, iPos = decode_item(abData, iPos)
+        if iArg == 77:
+            return list(struct.unpack('<%dh' % (len(oValue) // 2), oValue)), iPos
+        if iArg == 73:
+            return list(struct.unpack('>%dh' % (len(oValue) // 2), oValue)), iPos
+        return oValue, iPos
+    raise CborError('major type %d' % iMajor)
+
+
+def decode_all(abData):
+    # Decodes a CBOR sequence (RFC 8742); a single item is a sequence of one.
+    aItems = []
+    iPos = 0
+    while iPos < len(abData):
+        oItem, iPos = decode_item(abData, iPos)
+        aItems.append(oItem)
+    return aItems
+
+
+def same(oJson, oCbor, sPath=''):
+    # Compares decoded values; JSON floats carry 6 decimals, CBOR floats are exact float32.
+    if isinstance(oJson, dict):
+        if not isinstance(oCbor, dict) or set(oJson) != set(oCbor):
+            return '%s: members %s vs %s' % (sPath, sorted(oJson), sorted(oCbor) if isinstance(oCbor, dict) else oCbor)
+        for sKey in oJson:
+            sDiff = same(oJson[sKey], oCbor[sKey], sPath + '.' + sKey)
+            if sDiff:
+                return sDiff
+        return None
+    if isinstance(oJson, list):
+        if not isinstance(oCbor, list) or len(oJson) != len(oCbor):
+            return '%s: array length differs' % sPath
+        for iIndex, (oA, oB) in enumerate(zip(oJson, oCbor)):
+            sDiff = same(oA, oB, '%s[%d]' % (sPath, iIndex))
+            if sDiff:
+                return sDiff
+        return None
+    if isinstance(oJson, float) or isinstance(oCbor, float):
+        if oJson is None or oCbor is None or math.fabs(oJson - oCbor) > 1e-6:
+            return '%s: %r vs %r' % (sPath, oJson, oCbor)
+        return None
+    if oJson != oCbor:
+        return '%s: %r vs %r' % (sPath, oJson, oCbor)
+    return None
+
+
+def fetch(sHost, iPort, sPath, bCbor, bUseAccept):
+    # Requests one path; CBOR is asked for by header or by query to exercise both selectors.
+    dictHeaders = {}
+    if bCbor and bUseAccept:
+        dictHeaders['Accept'] = 'application/cbor'
+    elif bCbor:
+        sPath += ('&' if '?' in sPath else '?') + 'fmt=cbor'
+    oConn = http.client.HTTPConnection(sHost, iPort, timeout=10)
+    oConn.request('GET', sPath, headers=dictHeaders)
+    oResp = oConn.getresponse()
+    abBody = oResp.read()
+    sType = oResp.getheader('Content-Type', '')
+    oConn.close()
+    if oResp.status != 200:
+        raise CborError('%s: HTTP %d' % (sPath, oResp.status))
+    return sType, abBody
+
+
+def strip_server_time(oValue):
+    # serverNowUs is the time of each reply, so it always differs between the two requests.
+    if isinstance(oValue, dict):
+        return {sKey: strip_server_time(oItem) for sKey, oItem in oValue.items() if sKey != 'serverNowUs'}
+    if isinstance(oValue, list):
+        return [strip_server_time(oItem) for oItem in oValue]
+    return oValue
+
+
+def check_endpoint(sHost, iPort, sPath, bUseAccept, dPause):
+    # Retries when a new measurement lands between the two requests.
+    for _ in range(3):
+        sJsonType, abJson = fetch(sHost, iPort, sPath, False, bUseAccept)
+        time.sleep(dPause)
+        sCborType, abCbor = fetch(sHost, iPort, sPath, True, bUseAccept)
+        time.sleep(dPause)
+        if 'cbor' not in sCborType:
+            return '%s: CBOR request answered with %s' % (sPath, sCborType), len(abJson), len(abCbor)
+        sDiff = same(strip_server_time(json.loads(abJson)), strip_server_time(decode_all(abCbor)[0]), sPath)
+        if sDiff is None or 'timestampUs' not in sDiff:
+            break
+    return sDiff, len(abJson), len(abCbor)
+
+
+def main():
+    oParser = argparse.ArgumentParser(description='JSON/CBOR equivalence check')
+    oParser.add_argument('host', nargs='?', default='192.168.4.1')
+    oParser.add_argument('--port', type=int, default=80)
+    oParser.add_argument('--pause', type=float, default=0.6, help='seconds between requests (rate limit)')
+    oParser.add_argument('--file', help='decode a saved CBOR body and print it as JSON')
+    oArgs = oParser.parse_args()
+
+    if oArgs.file:
+        with open(oArgs.file, 'rb') as oFile:
+            for oItem in decode_all(oFile.read()):
+                print(json.dumps(oItem))
+        return 0
+
+    asPaths = [('/api/status', True), ('/api/sta_ip', False), ('/api/rms', True), ('/api/rms', False),
+               ('/api/samples', True), ('/api/samples?points=32', False), ('/api/snapshot', True),
+               ('/api/snapshot?fields=rms,samples&points=16', False)]
+    iFailures = 0
+    print('%-44s %8s %8s  %s' % ('endpoint', 'json', 'cbor', 'result'))
+    for sPath, bUseAccept in asPaths:
+        sDiff, iJson, iCbor = check_endpoint(oArgs.host, oArgs.port, sPath, bUseAccept, oArgs.pause)
+        sLabel = sPath + (' (Accept)' if bUseAccept else ' (fmt)')
+        print('%-44s %8d %8d  %s' % (sLabel, iJson, iCbor, sDiff or 'ok'))
+        iFailures += (sDiff is not None)
+
+    # Export: pin the range with cursor and to so both downloads cover the same rows
+    _, abRows = fetch(oArgs.host, oArgs.port, '/api/export?format=ndjson', False, False)
+    aRows = [json.loads(sLine) for sLine in abRows.decode().splitlines() if sLine][-200:]
+    if aRows:
+        sQuery = 'cursor=%d&to=%d' % (aRows[0]['seq'], aRows[-1]['timestampUs'])
+        time.sleep(oArgs.pause)
+        _, abJson = fetch(oArgs.host, oArgs.port, '/api/export?format=ndjson&' + sQuery, False, False)
+        time.sleep(oArgs.pause)
+        _, abCbor = fetch(oArgs.host, oArgs.port, '/api/export?format=cbor&' + sQuery, False, False)
+        aJson = [json.loads(sLine) for sLine in abJson.decode().splitlines() if sLine]
+        sDiff = same(aJson, decode_all(abCbor), '/api/export')
+        print('%-44s %8d %8d  %s' % ('/api/export (%d rows)' % len(aJson), len(abJson), len(abCbor), sDiff or 'ok'))
+        iFailures += (sDiff is not None)
+
+    print('%d mismatches' % iFailures)
+    return 1 if iFailures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
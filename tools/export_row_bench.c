@@ -0,0 +1,123 @@
+// Times history row serialization on a host against an snprintf baseline.
+// Checks that text rows match snprintf exactly before reporting nanoseconds per row.
+// Build: cc -O2 -I. tools/export_row_bench.c history_format.c json_writer.c -lm -o /tmp/export_row_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "history_format.h"
+
+#define iBenchRows                      200000
+#define iBenchChunkBytes                1024
+
+static size_t gszSinkBytes = 0;
+
+
+static double Bench_NowNs(void)
+{
+    struct timespec sNow;
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return (double)sNow.tv_sec * 1e9 + (double)sNow.tv_nsec;
+}
+
+
+static bool Bench_Sink(void *pvCtx, const char *psData, size_t szLen)
+{
+    // Stands in for httpd_resp_send_chunk; only counts bytes
+    (void)pvCtx;
+    (void)psData;
+    gszSinkBytes += szLen;
+    return true;
+}
+
+
+static int Bench_SnprintfRow(char *psOut, size_t szOut, history_format_t eFormat, uint32_t uiSeq,
+                             const history_record_t *psRecord)
+{
+    // The fixed-buffer snprintf approach the exporter replaces
+    if (eFormat == HISTORY_FORMAT_NDJSON) {
+        return snprintf(psOut, szOut, "{\"seq\":%lu,\"timestampUs\":%lld,\"rmsA\":%.6f,\"rmsB\":%.6f}\n",
+                        (unsigned long)uiSeq, (long long)psRecord->liTimestampUs,
+                        (double)psRecord->fRmsVoltsChA, (double)psRecord->fRmsVoltsChB);
+    }
+    return snprintf(psOut, szOut, "%lu,%lld,%.6f,%.6f\n", (unsigned long)uiSeq, (long long)psRecord->liTimestampUs,
+                    (double)psRecord->fRmsVoltsChA, (double)psRecord->fRmsVoltsChB);
+}
+
+
+int main(void)
+{
+    history_record_t *pasRecords = malloc(iBenchRows * sizeof(history_record_t));
+    if (pasRecords == NULL) {
+        return 1;
+    }
+
+    // Realistic values: 10 s spacing, RMS between 0 and 3.3 V
+    srand(42);
+    for (int iIndex = 0; iIndex < iBenchRows; iIndex++) {
+        pasRecords[iIndex].liTimestampUs = 2000000LL + (int64_t)iIndex * 10000000LL + (rand() % 5000);
+        pasRecords[iIndex].fRmsVoltsChA = (float)(rand() % 3300000) / 1e6f;
+        pasRecords[iIndex].fRmsVoltsChB = (float)(rand() % 3300000) / 1e6f;
+    }
+
+    static const char *const asNames[HISTORY_FORMAT_COUNT] = { "csv", "ndjson", "cbor" };
+    char acRow[iHistoryFormatRowMax];
+    char acRef[iHistoryFormatRowMax];
+    char acChunk[iBenchChunkBytes];
+    volatile size_t szGuard = 0;
+
+    printf("%-7s %12s %12s %12s %10s %10s\n", "format", "writer ns", "snprintf ns", "stream ns", "bytes/row",
+           "mismatch");
+    for (int iFormat = 0; iFormat < HISTORY_FORMAT_COUNT; iFormat++) {
+        history_format_t eFormat = (history_format_t)iFormat;
+        bool bText = (eFormat != HISTORY_FORMAT_CBOR);
+
+        // Text output must match the printf reference exactly
+        int iMismatch = 0;
+        for (int iIndex = 0; bText && iIndex < iBenchRows; iIndex++) {
+            int iLen = HistoryFormat_FormatRow(acRow, eFormat, (uint32_t)iIndex, &pasRecords[iIndex]);
+            int iRefLen = Bench_SnprintfRow(acRef, sizeof(acRef), eFormat, (uint32_t)iIndex, &pasRecords[iIndex]);
+            if (iLen != iRefLen || memcmp(acRow, acRef, (size_t)iLen) != 0) {
+                if (iMismatch++ == 0) {
+                    printf("first mismatch: %.*s vs %.*s", iLen, acRow, iRefLen, acRef);
+                }
+            }
+        }
+
+        // Row formatting alone
+        double dStart = Bench_NowNs();
+        for (int iIndex = 0; iIndex < iBenchRows; iIndex++) {
+            szGuard += (size_t)HistoryFormat_FormatRow(acRow, eFormat, (uint32_t)iIndex, &pasRecords[iIndex]);
+        }
+        double dWriterNs = (Bench_NowNs() - dStart) / iBenchRows;
+
+        dStart = Bench_NowNs();
+        for (int iIndex = 0; bText && iIndex < iBenchRows; iIndex++) {
+            szGuard += (size_t)Bench_SnprintfRow(acRef, sizeof(acRef), eFormat, (uint32_t)iIndex, &pasRecords[iIndex]);
+        }
+        double dSnprintfNs = (Bench_NowNs() - dStart) / iBenchRows;
+
+        // Full streaming path through the chunked writer
+        json_writer_t sWriter;
+        gszSinkBytes = 0;
+        dStart = Bench_NowNs();
+        JsonWriter_InitStream(&sWriter, acChunk, sizeof(acChunk), Bench_Sink, NULL);
+        HistoryFormat_WriteHeader(&sWriter, eFormat);
+        for (int iIndex = 0; iIndex < iBenchRows; iIndex++) {
+            HistoryFormat_WriteRow(&sWriter, eFormat, (uint32_t)iIndex, &pasRecords[iIndex]);
+        }
+        (void)JsonWriter_Finish(&sWriter);
+        double dStreamNs = (Bench_NowNs() - dStart) / iBenchRows;
+
+        if (!bText) {
+            dSnprintfNs = 0.0;
+        }
+        printf("%-7s %12.1f %12.1f %12.1f %10.1f %10d\n", asNames[iFormat], dWriterNs, dSnprintfNs, dStreamNs,
+               (double)gszSinkBytes / iBenchRows, iMismatch);
+    }
+
+    free(pasRecords);
+    return (szGuard == 0);
+}
@@ -0,0 +1,13 @@
+// Host stand-in for the ADC one-shot driver types referenced by adc.h.
+// Declares the attenuation enum only; host tests never touch the ADC.
+// Build host tests with -Itools/host; never add this directory to the firmware component.
+
+#pragma once
+
+typedef enum
+{
+    ADC_ATTEN_DB_0 = 0,
+    ADC_ATTEN_DB_2_5,
+    ADC_ATTEN_DB_6,
+    ADC_ATTEN_DB_12
+} adc_atten_t;
@@ -0,0 +1,16 @@
+// Host stand-in for the ESP-IDF error type so firmware headers compile in tools/ tests.
+// Only the codes the host-built sources return are defined.
+// Build host tests with -Itools/host; never add this directory to the firmware component.
+
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK                          0
+#define ESP_FAIL                        -1
+#define ESP_ERR_NO_MEM                  0x101
+#define ESP_ERR_INVALID_ARG             0x102
+#define ESP_ERR_INVALID_STATE           0x103
+#define ESP_ERR_INVALID_SIZE            0x104
+#define ESP_ERR_NOT_FOUND               0x105
+#define ESP_ERR_TIMEOUT                 0x107
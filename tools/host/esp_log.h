@@ -0,0 +1,13 @@
+// Host stand-in for ESP-IDF logging; every level goes to stderr with its tag.
+// Verbose and debug output is dropped like in a default release build.
+// Build host tests with -Itools/host.
+
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOGE(sTag, sFmt, ...)       fprintf(stderr, "E %s: " sFmt "\n", sTag, ##__VA_ARGS__)
+#define ESP_LOGW(sTag, sFmt, ...)       fprintf(stderr, "W %s: " sFmt "\n", sTag, ##__VA_ARGS__)
+#define ESP_LOGI(sTag, sFmt, ...)       fprintf(stderr, "I %s: " sFmt "\n", sTag, ##__VA_ARGS__)
+#define ESP_LOGD(sTag, sFmt, ...)       do { } while (0)
+#define ESP_LOGV(sTag, sFmt, ...)       do { } while (0)
@@ -0,0 +1,9 @@
+// Host stand-in for the ESP-IDF high-resolution clock.
+// Only esp_timer_get_time is provided; the host test defines it on CLOCK_MONOTONIC.
+// Build host tests with -Itools/host.
+
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
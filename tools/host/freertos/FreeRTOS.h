@@ -0,0 +1,19 @@
+// Host stand-in for the FreeRTOS base types and critical sections used by host-built sources.
+// Critical sections map to a pthread mutex; ticks are milliseconds.
+// Build host tests with -Itools/host -pthread; the test provides xTaskCreate and vTaskDelay.
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdPASS                          1
+#define pdMS_TO_TICKS(ms)               ((TickType_t)(ms))
+
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(psMux)       pthread_mutex_lock(psMux)
+#define portEXIT_CRITICAL(psMux)        pthread_mutex_unlock(psMux)
@@ -0,0 +1,14 @@
+// Host stand-in for the FreeRTOS task API; each task becomes a detached thread.
+// Priorities and stack sizes are accepted and ignored.
+// Definitions live in the host test that links the firmware source.
+
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *pvArg);
+typedef void *TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pfnTask, const char *sName, uint32_t uiStackBytes, void *pvArg,
+                       int iPriority, TaskHandle_t *psHandleOut);
+void vTaskDelay(TickType_t uiTicks);
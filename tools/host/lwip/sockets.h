@@ -0,0 +1,15 @@
+// Host stand-in for the lwIP BSD socket API, which mirrors POSIX closely enough to map directly.
+// Pulls in the POSIX headers for sockets, select, TCP options and close.
+// Build host tests with -Itools/host.
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
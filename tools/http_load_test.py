@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# Measures API latency with many concurrent pollers and a few slow clients.
+# Targets a device, a QEMU instance (idf.py qemu with port forwarding), or a built-in mock.
+# Example: tools/http_load_test.py 192.168.4.1 --pollers 50 --slow-clients 2 --seconds 30
+
+import argparse
+import http.client
+import http.server
+import socket
+import socketserver
+import statistics
+import sys
+import threading
+import time
+
+sRmsBody = b'{"hasValue":true,"rmsVoltsChA":0.1234,"rmsVoltsChB":0.5678,"timestampUs":1}'
+sSamplesBody = b'{"hasValue":true,"samples":120,"chA_mV":[' + b','.join([b'-1234'] * 120) + b']}'
+
+
+class MockState:
+    # Emulates the httpd task: one lock held while a request is served on it.
+    # In "single" mode every response is written on that task, as before the worker pool.
+    # In "pool" mode large responses run on capped workers outside the lock.
+    def __init__(self, sMode, iWorkers, iCap):
+        self.sMode = sMode
+        self.oHttpdLock = threading.Lock()
+        self.oWorkers = threading.Semaphore(iWorkers)
+        self.oCap = threading.BoundedSemaphore(iCap)
+
+
+class MockHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'
+    oState = None
+
+    def log_message(self, *args):
+        pass
+
+    def reply(self, iStatus, abBody, dAirtime):
+        # dAirtime stands in for a phone draining the response slowly over Wi-Fi
+        time.sleep(dAirtime)
+        self.send_response(iStatus)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(abBody)))
+        self.end_headers()
+        self.wfile.write(abBody)
+
+    def do_GET(self):
+        oState = self.oState
+        bLarge = self.path.startswith('/api/samples')
+        dAirtime = 0.5 if self.headers.get('X-Slow') else 0.002
+        abBody = sSamplesBody if bLarge else sRmsBody
+
+        if oState.sMode == 'single' or not bLarge:
+            with oState.oHttpdLock:
+                self.reply(200, abBody, dAirtime if bLarge else 0.001)
+            return
+
+        with oState.oHttpdLock:
+            bAdmitted = oState.oCap.acquire(blocking=False)
+        if not bAdmitted:
+            self.reply(503, b'{"error":"busy"}', 0)
+            return
+        try:
+            with oState.oWorkers:
+                self.reply(200, abBody, dAirtime)
+        finally:
+            oState.oCap.release()
+
+
+class ThreadingServer(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+    request_queue_size = 64
+
+
+def start_mock(sMode, iWorkers, iCap):
+    MockHandler.oState = MockState(sMode, iWorkers, iCap)
+    oServer = ThreadingServer(('127.0.0.1', 0), MockHandler)
+    threading.Thread(target=oServer.serve_forever, daemon=True).start()
+    return oServer.server_address[1]
+
+
+class Results:
+    def __init__(self):
+        self.oLock = threading.Lock()
+        self.adLatencyMs = []
+        self.dictStatus = {}
+        self.iErrors = 0
+
+    def add(self, iStatus, dMs):
+        with self.oLock:
+            self.dictStatus[iStatus] = self.dictStatus.get(iStatus, 0) + 1
+            if iStatus == 200:
+                self.adLatencyMs.append(dMs)
+
+    def error(self):
+        with self.oLock:
+            self.iErrors += 1
+
+
+def poller(sHost, iPort, sPath, dInterval, dDeadline, dictHeaders, oResults):
+    # Polls one path over a keep-alive connection, reconnecting when the server purges it.
+    # Slow clients shrink their receive window and drain the body in small pieces.
+    bSlow = 'X-Slow' in dictHeaders
+    oConn = None
+    while time.monotonic() < dDeadline:
+        try:
+            if oConn is None:
+                oConn = http.client.HTTPConnection(sHost, iPort, timeout=10)
+                if bSlow:
+                    oConn.connect()
+                    oConn.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1024)
+            dStart = time.perf_counter()
+            oConn.request('GET', sPath, headers=dictHeaders)
+            oResp = oConn.getresponse()
+            while oResp.read(256 if bSlow else 65536):
+                if bSlow:
+                    time.sleep(0.05)
+            oResults.add(oResp.status, (time.perf_counter() - dStart) * 1000.0)
+            if oResp.getheader('Connection', '').lower() == 'close':
+                oConn.close()
+                oConn = None
+        except (OSError, http.client.HTTPException):
+            oResults.error()
+            if oConn is not None:
+                oConn.close()
+            oConn = None
+            time.sleep(0.1)
+        time.sleep(dInterval)
+    if oConn is not None:
+        oConn.close()
+
+
+def percentile(adValues, dPct):
+    if not adValues:
+        return float('nan')
+    adSorted = sorted(adValues)
+    return adSorted[min(len(adSorted) - 1, int(round(dPct / 100.0 * (len(adSorted) - 1))))]
+
+
+def main():
+    oParser = argparse.ArgumentParser(description='Concurrent poller latency test')
+    oParser.add_argument('host', nargs='?', default='192.168.4.1')
+    oParser.add_argument('--port', type=int, default=80)
+    oParser.add_argument('--pollers', type=int, default=50)
+    oParser.add_argument('--path', default='/api/rms', help='path polled by the pollers')
+    oParser.add_argument('--interval', type=float, default=0.5, help='seconds between polls per poller')
+    oParser.add_argument('--slow-clients', type=int, default=0, help='clients fetching /api/samples slowly')
+    oParser.add_argument('--seconds', type=float, default=20)
+    oParser.add_argument('--mock', choices=['single', 'pool'], help='run against a local mock instead of a device')
+    oParser.add_argument('--mock-workers', type=int, default=2)
+    oParser.add_argument('--mock-cap', type=int, default=4)
+    oArgs = oParser.parse_args()
+
+    sHost, iPort = oArgs.host, oArgs.port
+    if oArgs.mock:
+        sHost, iPort = '127.0.0.1', start_mock(oArgs.mock, oArgs.mock_workers, oArgs.mock_cap)
+
+    oPollResults = Results()
+    oSlowResults = Results()
+    dDeadline = time.monotonic() + oArgs.seconds
+    aoThreads = []
+    for _ in range(oArgs.pollers):
+        aoThreads.append(threading.Thread(target=poller, args=(sHost, iPort, oArgs.path, oArgs.interval,
+                                                               dDeadline, {}, oPollResults)))
+    for _ in range(oArgs.slow_clients):
+        aoThreads.append(threading.Thread(target=poller, args=(sHost, iPort, '/api/samples', 0.0,
+                                                               dDeadline, {'X-Slow': '1'}, oSlowResults)))
+    for oThread in aoThreads:
+        oThread.start()
+    for oThread in aoThreads:
+        oThread.join()
+
+    for sLabel, oResults in (('pollers', oPollResults), ('slow', oSlowResults)):
+        if not oResults.dictStatus and not oResults.iErrors:
+            continue
+        adMs = oResults.adLatencyMs
+        print('%-8s %6d ok  p50 %7.1f ms  p99 %7.1f ms  max %7.1f ms  status %s  errors %d'
+              % (sLabel, len(adMs), percentile(adMs, 50), percentile(adMs, 99),
+                 max(adMs) if adMs else float('nan'), dict(sorted(oResults.dictStatus.items())),
+                 oResults.iErrors))
+    if oPollResults.adLatencyMs:
+        print('poller mean %.1f ms over %.0f s' % (statistics.mean(oPollResults.adLatencyMs), oArgs.seconds))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,122 @@
+// Times JSON writer number formatting and a full RMS object against snprintf on a host.
+// The baseline is the host libc; newlib on the ESP32 is slower still, so device gains are larger.
+// Build: cc -O2 -I. tools/json_writer_bench.c json_writer.c -lm -o /tmp/json_writer_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "json_writer.h"
+
+#define iBenchValues                    1000000
+
+
+static double Bench_NowNs(void)
+{
+    struct timespec sNow;
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return (double)sNow.tv_sec * 1e9 + (double)sNow.tv_nsec;
+}
+
+
+static int Bench_WriterRms(char *psOut, size_t szOut, float fChA, float fChB, int64_t liTimestampUs)
+{
+    // Same shape as the cached /api/rms payload
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, psOut, szOut);
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, "hasValue");
+    JsonWriter_Bool(&sWriter, true);
+    JsonWriter_Key(&sWriter, "rmsVoltsChA");
+    JsonWriter_Float(&sWriter, fChA, 6);
+    JsonWriter_Key(&sWriter, "rmsVoltsChB");
+    JsonWriter_Float(&sWriter, fChB, 6);
+    JsonWriter_Key(&sWriter, "timestampUs");
+    JsonWriter_Int(&sWriter, liTimestampUs);
+    JsonWriter_EndObject(&sWriter);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+static int Bench_SnprintfRms(char *psOut, size_t szOut, float fChA, float fChB, int64_t liTimestampUs)
+{
+    return snprintf(psOut, szOut, "{\"hasValue\":true,\"rmsVoltsChA\":%.6f,\"rmsVoltsChB\":%.6f,\"timestampUs\":%lld}",
+                    (double)fChA, (double)fChB, (long long)liTimestampUs);
+}
+
+
+int main(void)
+{
+    float *pafValues = malloc(iBenchValues * sizeof(float));
+    int64_t *paliValues = malloc(iBenchValues * sizeof(int64_t));
+    if (pafValues == NULL || paliValues == NULL) {
+        return 1;
+    }
+
+    // RMS volts between 0 and 3.3 V and µs timestamps up to a few days
+    srand(42);
+    for (int iIndex = 0; iIndex < iBenchValues; iIndex++) {
+        pafValues[iIndex] = (float)(rand() % 3300000) / 1e6f;
+        paliValues[iIndex] = (int64_t)rand() * 1000 + (rand() % 1000);
+    }
+
+    char acOut[128];
+    volatile size_t szGuard = 0;
+
+    printf("%-12s %12s %12s %8s\n", "case", "writer ns", "snprintf ns", "speedup");
+
+    // %.6f
+    double dStart = Bench_NowNs();
+    for (int iIndex = 0; iIndex < iBenchValues; iIndex++) {
+        szGuard += (size_t)JsonWriter_FormatFloat(acOut, pafValues[iIndex], 6);
+    }
+    double dWriterNs = (Bench_NowNs() - dStart) / iBenchValues;
+    dStart = Bench_NowNs();
+    for (int iIndex = 0; iIndex < iBenchValues; iIndex++) {
+        szGuard += (size_t)snprintf(acOut, sizeof(acOut), "%.6f", (double)pafValues[iIndex]);
+    }
+    double dPrintfNs = (Bench_NowNs() - dStart) / iBenchValues;
+    printf("%-12s %12.1f %12.1f %7.1fx\n", "float %.6f", dWriterNs, dPrintfNs, dPrintfNs / dWriterNs);
+
+    // %lld
+    dStart = Bench_NowNs();
+    for (int iIndex = 0; iIndex < iBenchValues; iIndex++) {
+        szGuard += (size_t)JsonWriter_FormatInt(acOut, paliValues[iIndex]);
+    }
+    dWriterNs = (Bench_NowNs() - dStart) / iBenchValues;
+    dStart = Bench_NowNs();
+    for (int iIndex = 0; iIndex < iBenchValues; iIndex++) {
+        szGuard += (size_t)snprintf(acOut, sizeof(acOut), "%lld", (long long)paliValues[iIndex]);
+    }
+    dPrintfNs = (Bench_NowNs() - dStart) / iBenchValues;
+    printf("%-12s %12.1f %12.1f %7.1fx\n", "int %lld", dWriterNs, dPrintfNs, dPrintfNs / dWriterNs);
+
+    // Whole RMS object, checked for identical bytes first
+    char acRef[128];
+    int iMismatch = 0;
+    for (int iIndex = 0; iIndex + 1 < iBenchValues; iIndex++) {
+        int iLen = Bench_WriterRms(acOut, sizeof(acOut), pafValues[iIndex], pafValues[iIndex + 1], paliValues[iIndex]);
+        int iRef = Bench_SnprintfRms(acRef, sizeof(acRef), pafValues[iIndex], pafValues[iIndex + 1],
+                                     paliValues[iIndex]);
+        iMismatch += (iLen != iRef || memcmp(acOut, acRef, (size_t)iLen) != 0);
+    }
+    dStart = Bench_NowNs();
+    for (int iIndex = 0; iIndex + 1 < iBenchValues; iIndex++) {
+        szGuard += (size_t)Bench_WriterRms(acOut, sizeof(acOut), pafValues[iIndex], pafValues[iIndex + 1],
+                                           paliValues[iIndex]);
+    }
+    dWriterNs = (Bench_NowNs() - dStart) / (iBenchValues - 1);
+    dStart = Bench_NowNs();
+    for (int iIndex = 0; iIndex + 1 < iBenchValues; iIndex++) {
+        szGuard += (size_t)Bench_SnprintfRms(acOut, sizeof(acOut), pafValues[iIndex], pafValues[iIndex + 1],
+                                             paliValues[iIndex]);
+    }
+    dPrintfNs = (Bench_NowNs() - dStart) / (iBenchValues - 1);
+    printf("%-12s %12.1f %12.1f %7.1fx  (%d mismatches)\n", "rms object", dWriterNs, dPrintfNs,
+           dPrintfNs / dWriterNs, iMismatch);
+
+    free(pafValues);
+    free(paliValues);
+    return (iMismatch != 0 || szGuard == 0);
+}
@@ -0,0 +1,247 @@
+// Checks JSON writer output byte for byte against snprintf and hand-written expectations.
+// Covers integers, fixed-precision floats, string escaping, separators, truncation and failures.
+// Build: cc -O2 -Wall -Wextra -I. tools/json_writer_test.c json_writer.c -lm -o /tmp/json_writer_test
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+#define iTestRandomValues               200000
+
+static int giFailures = 0;
+
+
+static void Test_Expect(const char *sName, const char *psGot, int iGotLen, const char *psWant, int iWantLen)
+{
+    // Reports the first few differences per check; every difference counts as a failure
+    if (iGotLen == iWantLen && memcmp(psGot, psWant, (size_t)iGotLen) == 0) {
+        return;
+    }
+    if (giFailures++ < 20) {
+        printf("FAIL %s: got \"%.*s\" (%d), want \"%.*s\" (%d)\n", sName, iGotLen, psGot, iGotLen,
+               iWantLen, psWant, iWantLen);
+    }
+}
+
+
+static void Test_ExpectInt(const char *sName, long long llGot, long long llWant)
+{
+    if (llGot == llWant) {
+        return;
+    }
+    if (giFailures++ < 20) {
+        printf("FAIL %s: got %lld, want %lld\n", sName, llGot, llWant);
+    }
+}
+
+
+static void Test_Integers(void)
+{
+    // Edge values and random 64-bit patterns against %lld / %llu
+    static const int64_t aliEdges[] = { 0, 1, -1, 9, 10, -10, 99, 100, INT32_MAX, INT32_MIN,
+                                        INT64_MAX, INT64_MIN, INT64_MIN + 1 };
+    char acGot[iJsonWriterNumberMax];
+    char acWant[64];
+
+    for (size_t szIndex = 0; szIndex < sizeof(aliEdges) / sizeof(aliEdges[0]); szIndex++) {
+        int iLen = JsonWriter_FormatInt(acGot, aliEdges[szIndex]);
+        int iWant = snprintf(acWant, sizeof(acWant), "%" PRId64, aliEdges[szIndex]);
+        Test_Expect("int edge", acGot, iLen, acWant, iWant);
+    }
+
+    srand(1);
+    for (int iIndex = 0; iIndex < iTestRandomValues; iIndex++) {
+        uint64_t uliBits = ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+        int64_t liValue = (int64_t)(uliBits >> (rand() % 64));
+        if (rand() & 1) {
+            liValue = -liValue;
+        }
+        int iLen = JsonWriter_FormatInt(acGot, liValue);
+        int iWant = snprintf(acWant, sizeof(acWant), "%" PRId64, liValue);
+        Test_Expect("int random", acGot, iLen, acWant, iWant);
+    }
+
+    // Unsigned values through the writer, including the top of the range
+    char acBuffer[64];
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, acBuffer, sizeof(acBuffer));
+    JsonWriter_Uint(&sWriter, UINT64_MAX);
+    int iLen = JsonWriter_Finish(&sWriter);
+    int iWant = snprintf(acWant, sizeof(acWant), "%" PRIu64, UINT64_MAX);
+    Test_Expect("uint max", acBuffer, iLen, acWant, iWant);
+}
+
+
+static void Test_Floats(void)
+{
+    // Float32 inputs, as every measurement is, at 0 to 9 decimals against %.Nf
+    // Includes exact halves, which printf rounds to even, and negative values rounding to zero
+    static const double adEdges[] = { 0.0, -0.0, 0.5, 1.5, 2.5, -2.5, 0.125, 0.375, 1e-7, -1e-7,
+                                      0.999999951, 3.3, 1234567.0, 16777216.0, 1e18, -1e18 };
+    char acGot[iJsonWriterNumberMax];
+    char acWant[64];
+
+    for (int iDecimals = 0; iDecimals <= 9; iDecimals++) {
+        for (size_t szIndex = 0; szIndex < sizeof(adEdges) / sizeof(adEdges[0]); szIndex++) {
+            double dValue = (double)(float)adEdges[szIndex];
+            int iLen = JsonWriter_FormatFloat(acGot, dValue, iDecimals);
+            int iWant = snprintf(acWant, sizeof(acWant), "%.*f", iDecimals, dValue);
+            Test_Expect("float edge", acGot, iLen, acWant, iWant);
+        }
+    }
+
+    srand(2);
+    for (int iIndex = 0; iIndex < iTestRandomValues; iIndex++) {
+        int iDecimals = rand() % 10;
+        double dMagnitude = pow(10.0, (rand() % 12) - 6);
+        float fValue = (float)(((double)rand() / RAND_MAX - 0.5) * 2.0 * dMagnitude);
+        int iLen = JsonWriter_FormatFloat(acGot, fValue, iDecimals);
+        int iWant = snprintf(acWant, sizeof(acWant), "%.*f", iDecimals, (double)fValue);
+        Test_Expect("float random", acGot, iLen, acWant, iWant);
+    }
+
+    // Values JSON cannot carry become null; decimals are clamped to 0..9
+    static const double adNull[] = { NAN, INFINITY, -INFINITY, 2e19, -2e19 };
+    for (size_t szIndex = 0; szIndex < sizeof(adNull) / sizeof(adNull[0]); szIndex++) {
+        int iLen = JsonWriter_FormatFloat(acGot, adNull[szIndex], 3);
+        Test_Expect("float null", acGot, iLen, "null", 4);
+    }
+    int iLen = JsonWriter_FormatFloat(acGot, 1.0, 12);
+    Test_Expect("float clamp", acGot, iLen, "1.000000000", 11);
+}
+
+
+static int Test_Render(char *psOut, size_t szOut, const char *sKey, const char *sValue)
+{
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, psOut, szOut);
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, sKey);
+    JsonWriter_String(&sWriter, sValue);
+    JsonWriter_EndObject(&sWriter);
+    return JsonWriter_Finish(&sWriter);
+}
+
+
+static void Test_Escaping(void)
+{
+    // Mandatory escapes, other control characters as \u00XX, everything else verbatim
+    char acBuffer[256];
+    int iLen = Test_Render(acBuffer, sizeof(acBuffer), "k\"ey", "a\"b\\c\b\f\n\r\t\x01\x1f\x7f/\xc3\xa9");
+    static const char sWant[] = "{\"k\\\"ey\":\"a\\\"b\\\\c\\b\\f\\n\\r\\t\\u0001\\u001f\x7f/\xc3\xa9\"}";
+    Test_Expect("escape", acBuffer, iLen, sWant, (int)sizeof(sWant) - 1);
+
+    iLen = Test_Render(acBuffer, sizeof(acBuffer), "", NULL);
+    Test_Expect("escape empty", acBuffer, iLen, "{\"\":\"\"}", 7);
+}
+
+
+static void Test_Structure(void)
+{
+    // Separators across nesting levels, keys and every value type
+    char acBuffer[256];
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, acBuffer, sizeof(acBuffer));
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, "a");
+    JsonWriter_BeginArray(&sWriter);
+    JsonWriter_Int(&sWriter, 1);
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_EndObject(&sWriter);
+    JsonWriter_BeginArray(&sWriter);
+    JsonWriter_EndArray(&sWriter);
+    JsonWriter_Null(&sWriter);
+    JsonWriter_EndArray(&sWriter);
+    JsonWriter_Key(&sWriter, "b");
+    JsonWriter_Bool(&sWriter, true);
+    JsonWriter_Key(&sWriter, "c");
+    JsonWriter_Float(&sWriter, 0.25, 3);
+    JsonWriter_Key(&sWriter, "d");
+    static const int16_t aiSamples[] = { -32768, 0, 32767 };
+    JsonWriter_Int16Array(&sWriter, aiSamples, 3);
+    JsonWriter_EndObject(&sWriter);
+    int iLen = JsonWriter_Finish(&sWriter);
+
+    static const char sWant[] = "{\"a\":[1,{},[],null],\"b\":true,\"c\":0.250,\"d\":[-32768,0,32767]}";
+    Test_Expect("structure", acBuffer, iLen, sWant, (int)sizeof(sWant) - 1);
+}
+
+
+static bool Test_Collect(void *pvCtx, const char *psData, size_t szLen)
+{
+    // Appends flushed blocks to a growing string
+    char *psOut = (char *)pvCtx;
+    size_t szUsed = strlen(psOut);
+    memcpy(psOut + szUsed, psData, szLen);
+    psOut[szUsed + szLen] = '\0';
+    return true;
+}
+
+
+static bool Test_Reject(void *pvCtx, const char *psData, size_t szLen)
+{
+    (void)pvCtx;
+    (void)psData;
+    (void)szLen;
+    return false;
+}
+
+
+static void Test_Truncation(void)
+{
+    // Buffer mode must truncate, terminate and report the full length exactly like snprintf
+    char acFull[128];
+    int iFull = Test_Render(acFull, sizeof(acFull), "name", "truncate \"me\" please");
+
+    for (size_t szOut = 0; szOut <= (size_t)iFull + 1; szOut++) {
+        char acGot[128];
+        char acWant[128];
+        memset(acGot, 'x', sizeof(acGot));
+        memset(acWant, 'x', sizeof(acWant));
+        int iLen = Test_Render((szOut > 0) ? acGot : NULL, szOut, "name", "truncate \"me\" please");
+        int iWant = snprintf((szOut > 0) ? acWant : NULL, szOut, "%s", acFull);
+        Test_ExpectInt("truncate length", iLen, iWant);
+        Test_Expect("truncate bytes", acGot, (int)sizeof(acGot), acWant, (int)sizeof(acWant));
+    }
+
+    // Stream mode with a tiny staging buffer produces the same bytes as buffer mode
+    char acStage[7];
+    char acStream[128] = {0};
+    json_writer_t sWriter;
+    JsonWriter_InitStream(&sWriter, acStage, sizeof(acStage), Test_Collect, acStream);
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, "name");
+    JsonWriter_String(&sWriter, "truncate \"me\" please");
+    JsonWriter_EndObject(&sWriter);
+    int iLen = JsonWriter_Finish(&sWriter);
+    Test_Expect("stream", acStream, iLen, acFull, iFull);
+
+    // A rejected flush fails the whole output
+    JsonWriter_InitStream(&sWriter, acStage, sizeof(acStage), Test_Reject, NULL);
+    JsonWriter_String(&sWriter, "longer than one staging block");
+    Test_ExpectInt("flush failure", JsonWriter_Finish(&sWriter), -1);
+
+    // Nesting beyond iJsonWriterMaxDepth fails instead of corrupting separators
+    JsonWriter_InitBuffer(&sWriter, acFull, sizeof(acFull));
+    for (int iDepth = 0; iDepth <= iJsonWriterMaxDepth; iDepth++) {
+        JsonWriter_BeginArray(&sWriter);
+    }
+    Test_ExpectInt("depth overflow", JsonWriter_Finish(&sWriter), -1);
+}
+
+
+int main(void)
+{
+    Test_Integers();
+    Test_Floats();
+    Test_Escaping();
+    Test_Structure();
+    Test_Truncation();
+
+    printf("%s: %d failure(s)\n", (giFailures == 0) ? "PASS" : "FAIL", giFailures);
+    return (giFailures == 0) ? 0 : 1;
+}
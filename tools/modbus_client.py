@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+# Reads and decodes the measurement registers of a node over Modbus TCP.
+# Uses raw sockets only, so it runs without pymodbus; checks the map in modbus_tcp.h.
+# Example: tools/modbus_client.py 192.168.1.50 --poll 1 --check-limit 3
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+iRegisterCount = 32
+
+
+class ModbusError(Exception):
+    pass
+
+
+class ModbusClient:
+    def __init__(self, sHost, iPort, iUnit=1, dTimeout=3.0):
+        self.oSock = socket.create_connection((sHost, iPort), timeout=dTimeout)
+        self.oSock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.iUnit = iUnit
+        self.iTransaction = 0
+
+    def close(self):
+        self.oSock.close()
+
+    def recv_exact(self, iLen):
+        abData = b''
+        while len(abData) < iLen:
+            abChunk = self.oSock.recv(iLen - len(abData))
+            if not abChunk:
+                raise ModbusError('connection closed by server')
+            abData += abChunk
+        return abData
+
+    def request(self, abPdu):
+        # Sends one PDU and returns the response PDU; raises on exception responses.
+        self.iTransaction = (self.iTransaction + 1) & 0xFFFF
+        self.oSock.sendall(struct.pack('>HHHB', self.iTransaction, 0, len(abPdu) + 1, self.iUnit) + abPdu)
+        iTransaction, iProtocol, iLength, _ = struct.unpack('>HHHB', self.recv_exact(7))
+        abResp = self.recv_exact(iLength - 1)
+        if iTransaction != self.iTransaction or iProtocol != 0:
+            raise ModbusError('MBAP mismatch')
+        if abResp[0] & 0x80:
+            raise ModbusError('exception %d for function %d' % (abResp[1], abResp[0] & 0x7F))
+        return abResp
+
+    def read_registers(self, iStart, iCount, iFunction=4):
+        abResp = self.request(struct.pack('>BHH', iFunction, iStart, iCount))
+        if abResp[1] != iCount * 2:
+            raise ModbusError('byte count %d, expected %d' % (abResp[1], iCount * 2))
+        return list(struct.unpack('>%dH' % iCount, abResp[2:]))
+
+
+def decode(aiRegs):
+    # Decodes the register image documented in modbus_tcp.h.
+    def u32(iAt):
+        return (aiRegs[iAt] << 16) | aiRegs[iAt + 1]
+
+    def f32(iAt):
+        return struct.unpack('>f', struct.pack('>I', u32(iAt)))[0]
+
+    return {
+        'rmsA': f32(0),
+        'rmsB': f32(2),
+        'attenA': aiRegs[4],
+        'attenB': aiRegs[5],
+        'timestampUs': (u32(6) << 32) | u32(8),
+        'samples': aiRegs[10],
+        'hasValue': bool(aiRegs[11] & 1),
+        'sequence': u32(12),
+        'ageMs': u32(14),
+    }
+
+
+def self_test(oClient):
+    # Checks function codes, the register map and exception handling.
+    aiHolding = oClient.read_registers(0, iRegisterCount, 3)
+    aiInput = oClient.read_registers(0, iRegisterCount, 4)
+    assert aiHolding[:14] == aiInput[:14], 'holding and input maps differ'
+    for abPdu, iCode in ((struct.pack('>BHH', 4, iRegisterCount - 1, 2), 2),
+                         (struct.pack('>BHH', 4, 0, 0), 3),
+                         (struct.pack('>BHH', 6, 0, 1), 1)):
+        try:
+            oClient.request(abPdu)
+            raise AssertionError('expected exception %d' % iCode)
+        except ModbusError as oErr:
+            assert ('exception %d' % iCode) in str(oErr), str(oErr)
+    print('self-test passed')
+
+
+def check_limit(sHost, iPort, iConnections):
+    # Opens several connections at once and reports how many the server keeps.
+    aoClients = []
+    iServed = 0
+    for _ in range(iConnections):
+        try:
+            oClient = ModbusClient(sHost, iPort, dTimeout=2.0)
+            aoClients.append(oClient)
+            oClient.read_registers(0, 2)
+            iServed += 1
+        except (OSError, ModbusError):
+            pass
+    for oClient in aoClients:
+        oClient.close()
+    print('%d of %d concurrent connections served' % (iServed, iConnections))
+
+
+def main():
+    oParser = argparse.ArgumentParser(description='Modbus TCP register reader')
+    oParser.add_argument('host', nargs='?', default='192.168.4.1')
+    oParser.add_argument('--port', type=int, default=502)
+    oParser.add_argument('--unit', type=int, default=1)
+    oParser.add_argument('--poll', type=float, default=0, help='repeat every N seconds (0 = once)')
+    oParser.add_argument('--self-test', action='store_true', help='verify map and exception handling')
+    oParser.add_argument('--check-limit', type=int, default=0, help='open N connections at once')
+    oArgs = oParser.parse_args()
+
+    if oArgs.check_limit:
+        check_limit(oArgs.host, oArgs.port, oArgs.check_limit)
+        return 0
+
+    oClient = ModbusClient(oArgs.host, oArgs.port, oArgs.unit)
+    try:
+        if oArgs.self_test:
+            self_test(oClient)
+        while True:
+            dStart = time.perf_counter()
+            dictValues = decode(oClient.read_registers(0, iRegisterCount))
+            dMs = (time.perf_counter() - dStart) * 1000.0
+            print('seq=%(sequence)d rmsA=%(rmsA).4f V rmsB=%(rmsB).4f V atten=%(attenA)d/%(attenB)d '
+                  'samples=%(samples)d age=%(ageMs)d ms' % dictValues + ' (%.1f ms)' % dMs)
+            if oArgs.poll <= 0:
+                break
+            time.sleep(oArgs.poll)
+    finally:
+        oClient.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
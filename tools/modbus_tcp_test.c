@@ -0,0 +1,367 @@
+// Builds modbus_tcp.c for the host on the shims in tools/host and exercises it over loopback.
+// Checks the register map, split and pipelined frames, exceptions, the connection cap and
+// that a master which stops reading is dropped after the send timeout instead of stalling others.
+// Build: cc -O2 -Wall -Wextra -I. -Itools/host tools/modbus_tcp_test.c -pthread -o /tmp/modbus_tcp_test
+// Run "/tmp/modbus_tcp_test serve" to keep the server up for tools/modbus_client.py --port 15020.
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Unprivileged port and a short send timeout keep the run quick; app_config.h is include-once
+#include "app_config.h"
+#undef iModbusPort
+#define iModbusPort                     15020
+#undef iModbusSendTimeoutMs
+#define iModbusSendTimeoutMs            500
+
+#include "modbus_tcp.c"
+
+static int giFailures = 0;
+static adc_publish_hook_t gpfnPublishHook = NULL;
+
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec sNow;
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return (int64_t)sNow.tv_sec * 1000000 + sNow.tv_nsec / 1000;
+}
+
+
+static void *Test_TaskEntry(void *pvArg)
+{
+    void **ppvTask = (void **)pvArg;
+    TaskFunction_t pfnTask = (TaskFunction_t)(uintptr_t)ppvTask[0];
+    void *pvTaskArg = ppvTask[1];
+    free(ppvTask);
+    pfnTask(pvTaskArg);
+    return NULL;
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t pfnTask, const char *sName, uint32_t uiStackBytes, void *pvArg,
+                       int iPriority, TaskHandle_t *psHandleOut)
+{
+    (void)sName;
+    (void)uiStackBytes;
+    (void)iPriority;
+    void **ppvTask = malloc(2 * sizeof(void *));
+    pthread_t sThread;
+    if (ppvTask == NULL) {
+        return 0;
+    }
+    ppvTask[0] = (void *)(uintptr_t)pfnTask;
+    ppvTask[1] = pvArg;
+    if (pthread_create(&sThread, NULL, Test_TaskEntry, ppvTask) != 0) {
+        free(ppvTask);
+        return 0;
+    }
+    pthread_detach(sThread);
+    if (psHandleOut != NULL) {
+        *psHandleOut = NULL;
+    }
+    return pdPASS;
+}
+
+
+void vTaskDelay(TickType_t uiTicks)
+{
+    usleep((useconds_t)uiTicks * 1000);
+}
+
+
+esp_err_t Adc_RegisterPublishHook(adc_publish_hook_t pfnHook, void *pvCtx)
+{
+    (void)pvCtx;
+    gpfnPublishHook = pfnHook;
+    return ESP_OK;
+}
+
+
+static void Test_Check(bool bOk, const char *sWhat)
+{
+    if (!bOk) {
+        giFailures++;
+        printf("FAIL %s\n", sWhat);
+    }
+}
+
+
+static int Test_Connect(int iRecvBufBytes)
+{
+    // Opens a client connection with a receive timeout so a missing reply fails instead of hanging
+    int iSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct timeval sTimeout = { .tv_sec = 3, .tv_usec = 0 };
+    (void)setsockopt(iSocket, SOL_SOCKET, SO_RCVTIMEO, &sTimeout, sizeof(sTimeout));
+    if (iRecvBufBytes > 0) {
+        (void)setsockopt(iSocket, SOL_SOCKET, SO_RCVBUF, &iRecvBufBytes, sizeof(iRecvBufBytes));
+    }
+
+    struct sockaddr_in sAddr = {0};
+    sAddr.sin_family = AF_INET;
+    sAddr.sin_port = htons(iModbusPort);
+    sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(iSocket, (struct sockaddr *)&sAddr, sizeof(sAddr)) != 0) {
+        (void)close(iSocket);
+        return -1;
+    }
+    return iSocket;
+}
+
+
+static int Test_BuildRequest(uint8_t *puOut, uint16_t uiTransaction, uint8_t uiFunction, int iStart, int iQuantity)
+{
+    // MBAP with length 6 (unit + 5-byte read PDU), unit 1
+    puOut[0] = (uint8_t)(uiTransaction >> 8);
+    puOut[1] = (uint8_t)(uiTransaction & 0xFF);
+    puOut[2] = 0;
+    puOut[3] = 0;
+    puOut[4] = 0;
+    puOut[5] = 6;
+    puOut[6] = 1;
+    puOut[7] = uiFunction;
+    puOut[8] = (uint8_t)(iStart >> 8);
+    puOut[9] = (uint8_t)(iStart & 0xFF);
+    puOut[10] = (uint8_t)(iQuantity >> 8);
+    puOut[11] = (uint8_t)(iQuantity & 0xFF);
+    return 12;
+}
+
+
+static bool Test_RecvAll(int iSocket, uint8_t *puOut, int iLen)
+{
+    for (int iGot = 0; iGot < iLen;) {
+        ssize_t iRead = recv(iSocket, &puOut[iGot], (size_t)(iLen - iGot), 0);
+        if (iRead <= 0) {
+            return false;
+        }
+        iGot += (int)iRead;
+    }
+    return true;
+}
+
+
+static int Test_ReadResponse(int iSocket, uint8_t *puOut)
+{
+    // Reads one MBAP frame and returns its total length, or -1 when the server closed or stalled
+    if (!Test_RecvAll(iSocket, puOut, iModbusMbapBytes)) {
+        return -1;
+    }
+    int iLength = (puOut[4] << 8) | puOut[5];
+    if (iLength < 2 || iLength > iModbusFrameMaxBytes - 6 || !Test_RecvAll(iSocket, &puOut[7], iLength - 1)) {
+        return -1;
+    }
+    return 6 + iLength;
+}
+
+
+static uint16_t Test_Reg(const uint8_t *puFrame, int iRegister)
+{
+    return (uint16_t)((puFrame[9 + (2 * iRegister)] << 8) | puFrame[10 + (2 * iRegister)]);
+}
+
+
+static void Test_RegisterMap(const adc_result_t *psResult)
+{
+    // Full map through FC 03 and FC 04, decoded back to the published values
+    uint8_t auReq[12];
+    uint8_t auResp[iModbusFrameMaxBytes];
+    int iSocket = Test_Connect(0);
+    Test_Check(iSocket >= 0, "connect");
+
+    for (uint8_t uiFunction = iModbusFuncReadHolding; uiFunction <= iModbusFuncReadInput; uiFunction++) {
+        send(iSocket, auReq, (size_t)Test_BuildRequest(auReq, 0x1234, uiFunction, 0, iModbusRegisterCount), 0);
+        int iLen = Test_ReadResponse(iSocket, auResp);
+        Test_Check(iLen == 9 + (2 * iModbusRegisterCount), "map length");
+        if (iLen != 9 + (2 * iModbusRegisterCount)) {
+            continue;
+        }
+        Test_Check(auResp[0] == 0x12 && auResp[1] == 0x34 && auResp[6] == 1, "MBAP echo");
+        Test_Check(auResp[7] == uiFunction && auResp[8] == 2 * iModbusRegisterCount, "function and byte count");
+
+        uint32_t uiBits = ((uint32_t)Test_Reg(auResp, iModbusRegRmsA) << 16) | Test_Reg(auResp, iModbusRegRmsA + 1);
+        float fRms = 0.0f;
+        memcpy(&fRms, &uiBits, sizeof(fRms));
+        Test_Check(fRms == psResult->fRmsVoltsChA, "rmsA float");
+        uiBits = ((uint32_t)Test_Reg(auResp, iModbusRegRmsB) << 16) | Test_Reg(auResp, iModbusRegRmsB + 1);
+        memcpy(&fRms, &uiBits, sizeof(fRms));
+        Test_Check(fRms == psResult->fRmsVoltsChB, "rmsB float");
+
+        uint64_t uliTimestamp = 0;
+        for (int iWord = 0; iWord < 4; iWord++) {
+            uliTimestamp = (uliTimestamp << 16) | Test_Reg(auResp, iModbusRegTimestampUs + iWord);
+        }
+        Test_Check(uliTimestamp == (uint64_t)psResult->liTimestampUs, "timestamp");
+        Test_Check(Test_Reg(auResp, iModbusRegAttenA) == psResult->eAttenChA, "attenA");
+        Test_Check(Test_Reg(auResp, iModbusRegAttenB) == psResult->eAttenChB, "attenB");
+        Test_Check(Test_Reg(auResp, iModbusRegSamples) == psResult->iSamplesPerChannel, "samples");
+        Test_Check(Test_Reg(auResp, iModbusRegFlags) == 1, "flags");
+        Test_Check(Test_Reg(auResp, iModbusRegSequence + 1) == 1, "sequence");
+        Test_Check(Test_Reg(auResp, iModbusRegAgeMs) == 0 && Test_Reg(auResp, iModbusRegAgeMs + 1) < 5000, "age");
+        Test_Check(Test_Reg(auResp, 16) == 0 && Test_Reg(auResp, 31) == 0, "reserved registers");
+    }
+    (void)close(iSocket);
+}
+
+
+static void Test_Framing(void)
+{
+    // A request split across segments, then two requests in one segment
+    uint8_t auReq[24];
+    uint8_t auResp[iModbusFrameMaxBytes];
+    int iSocket = Test_Connect(0);
+
+    Test_BuildRequest(auReq, 7, iModbusFuncReadHolding, 0, 2);
+    send(iSocket, auReq, 5, 0);
+    usleep(50000);
+    send(iSocket, &auReq[5], 7, 0);
+    int iLen = Test_ReadResponse(iSocket, auResp);
+    Test_Check(iLen == 13 && auResp[1] == 7, "split frame");
+
+    Test_BuildRequest(auReq, 10, iModbusFuncReadHolding, 0, 1);
+    Test_BuildRequest(&auReq[12], 11, iModbusFuncReadInput, 4, 2);
+    send(iSocket, auReq, 24, 0);
+    iLen = Test_ReadResponse(iSocket, auResp);
+    Test_Check(iLen == 11 && auResp[1] == 10, "pipelined frame 1");
+    iLen = Test_ReadResponse(iSocket, auResp);
+    Test_Check(iLen == 13 && auResp[1] == 11 && auResp[7] == iModbusFuncReadInput, "pipelined frame 2");
+    (void)close(iSocket);
+}
+
+
+static void Test_Exceptions(void)
+{
+    // Unsupported function, out-of-range address and bad quantities, then a protocol violation
+    static const struct { uint8_t uiFunction; int iStart; int iQuantity; uint8_t uiCode; } asCases[] = {
+        { 0x06, 0, 1, iModbusExIllegalFunction },
+        { iModbusFuncReadHolding, 30, 4, iModbusExIllegalAddress },
+        { iModbusFuncReadHolding, 0, 0, iModbusExIllegalValue },
+        { iModbusFuncReadInput, 0, iModbusMaxReadRegisters + 1, iModbusExIllegalValue },
+    };
+    uint8_t auReq[12];
+    uint8_t auResp[iModbusFrameMaxBytes];
+    int iSocket = Test_Connect(0);
+
+    for (size_t szIndex = 0; szIndex < sizeof(asCases) / sizeof(asCases[0]); szIndex++) {
+        Test_BuildRequest(auReq, (uint16_t)szIndex, asCases[szIndex].uiFunction, asCases[szIndex].iStart,
+                          asCases[szIndex].iQuantity);
+        send(iSocket, auReq, sizeof(auReq), 0);
+        int iLen = Test_ReadResponse(iSocket, auResp);
+        Test_Check(iLen == 9 && auResp[7] == (asCases[szIndex].uiFunction | 0x80) &&
+                   auResp[8] == asCases[szIndex].uiCode, "exception code");
+    }
+
+    auReq[2] = 1;
+    send(iSocket, auReq, sizeof(auReq), 0);
+    Test_Check(Test_ReadResponse(iSocket, auResp) < 0, "non-Modbus protocol id closes");
+    (void)close(iSocket);
+}
+
+
+static void Test_ConnectionCap(void)
+{
+    // One connection beyond iModbusMaxClients is refused; the others are served
+    int aiSockets[iModbusMaxClients + 1];
+    uint8_t auReq[12];
+    uint8_t auResp[iModbusFrameMaxBytes];
+    int iServed = 0;
+
+    for (int iIndex = 0; iIndex <= iModbusMaxClients; iIndex++) {
+        aiSockets[iIndex] = Test_Connect(0);
+        usleep(20000);
+    }
+    for (int iIndex = 0; iIndex <= iModbusMaxClients; iIndex++) {
+        send(aiSockets[iIndex], auReq, (size_t)Test_BuildRequest(auReq, 1, iModbusFuncReadHolding, 0, 1),
+             MSG_NOSIGNAL);
+        iServed += (Test_ReadResponse(aiSockets[iIndex], auResp) > 0);
+    }
+    Test_Check(iServed == iModbusMaxClients, "connection cap");
+    for (int iIndex = 0; iIndex <= iModbusMaxClients; iIndex++) {
+        (void)close(aiSockets[iIndex]);
+    }
+    usleep(100000);
+}
+
+
+static void Test_StalledReader(void)
+{
+    // A master that pipelines requests and never reads fills the server's send buffer.
+    // The send timeout must drop it so a second master is still answered.
+    uint8_t auReq[12];
+    uint8_t auResp[iModbusFrameMaxBytes];
+    int iStalled = Test_Connect(2048);
+    Test_BuildRequest(auReq, 1, iModbusFuncReadHolding, 0, iModbusMaxReadRegisters > iModbusRegisterCount ?
+                      iModbusRegisterCount : iModbusMaxReadRegisters);
+
+    // Keep writing until the server stops reading, which means it is blocked in send()
+    int64_t liDeadlineUs = esp_timer_get_time() + 5000000;
+    bool bBlocked = false;
+    while (!bBlocked && esp_timer_get_time() < liDeadlineUs) {
+        ssize_t iSent = send(iStalled, auReq, sizeof(auReq), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (iSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            usleep(100000);
+            bBlocked = (send(iStalled, auReq, sizeof(auReq), MSG_DONTWAIT | MSG_NOSIGNAL) < 0);
+        } else if (iSent < 0) {
+            break;
+        }
+    }
+    Test_Check(bBlocked, "stalled reader fills the server send buffer");
+
+    int64_t liStartUs = esp_timer_get_time();
+    int iOther = Test_Connect(0);
+    send(iOther, auReq, (size_t)Test_BuildRequest(auReq, 2, iModbusFuncReadHolding, 0, 1), 0);
+    int iLen = Test_ReadResponse(iOther, auResp);
+    int64_t liWaitMs = (esp_timer_get_time() - liStartUs) / 1000;
+    Test_Check(iLen == 11, "second master answered while the first is stalled");
+    Test_Check(liWaitMs < iModbusSendTimeoutMs + 1000, "second master waited at most the send timeout");
+
+    modbus_tcp_stats_t sStats;
+    ModbusTcp_GetStats(&sStats);
+    Test_Check(sStats.uiClients == 1, "stalled master was dropped");
+    printf("stalled master dropped, second master answered after %lld ms\n", (long long)liWaitMs);
+
+    (void)close(iOther);
+    (void)close(iStalled);
+}
+
+
+int main(int iArgc, char **ppsArgv)
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    if (ModbusTcp_Init() != ESP_OK || gpfnPublishHook == NULL) {
+        printf("FAIL server did not start on port %d\n", iModbusPort);
+        return 1;
+    }
+
+    adc_result_t sResult = {
+        .fRmsVoltsChA = 1.234567f,
+        .fRmsVoltsChB = 0.000321f,
+        .liTimestampUs = esp_timer_get_time(),
+        .eAttenChA = ADC_ATTEN_DB_12,
+        .eAttenChB = ADC_ATTEN_DB_2_5,
+        .iSamplesPerChannel = 2048,
+    };
+    gpfnPublishHook(&sResult, NULL);
+
+    if (iArgc > 1 && strcmp(ppsArgv[1], "serve") == 0) {
+        printf("Serving on port %d; Ctrl-C to stop\n", iModbusPort);
+        while (1) {
+            sleep(10);
+            sResult.liTimestampUs = esp_timer_get_time();
+            gpfnPublishHook(&sResult, NULL);
+        }
+    }
+
+    Test_RegisterMap(&sResult);
+    Test_Framing();
+    Test_Exceptions();
+    Test_ConnectionCap();
+    Test_StalledReader();
+
+    printf("%s: %d failure(s)\n", (giFailures == 0) ? "PASS" : "FAIL", giFailures);
+    return (giFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,64 @@
+#!/usr/bin/env python3
+# Measures page-load bytes and latency of the embedded web pages on a running device.
+# Compares a cold load, an ETag revalidation and the uncompressed size the page used to cost.
+# Run from a laptop joined to the SoftAP: tools/page_load_bench.py 192.168.4.1
+
+import argparse
+import gzip
+import http.client
+import statistics
+import sys
+import time
+
+asPages = ['/', '/provision', '/ips']
+
+
+def fetch(sHost, iPort, sPath, sEtag=None):
+    # Issues one GET on a fresh connection, like a browser after the SoftAP handshake.
+    # Returns status, wire body length, decoded length, ETag and wall time in ms.
+    oConn = http.client.HTTPConnection(sHost, iPort, timeout=10)
+    dictHeaders = {'Accept-Encoding': 'gzip'}
+    if sEtag:
+        dictHeaders['If-None-Match'] = sEtag
+    dStart = time.perf_counter()
+    oConn.request('GET', sPath, headers=dictHeaders)
+    oResp = oConn.getresponse()
+    abBody = oResp.read()
+    dMs = (time.perf_counter() - dStart) * 1000.0
+    oConn.close()
+
+    iDecoded = len(abBody)
+    if oResp.getheader('Content-Encoding') == 'gzip' and abBody:
+        iDecoded = len(gzip.decompress(abBody))
+    return oResp.status, len(abBody), iDecoded, oResp.getheader('ETag'), dMs
+
+
+def main():
+    oParser = argparse.ArgumentParser(description='Embedded page load benchmark')
+    oParser.add_argument('host', nargs='?', default='192.168.4.1')
+    oParser.add_argument('--port', type=int, default=80)
+    oParser.add_argument('-n', '--count', type=int, default=20)
+    oArgs = oParser.parse_args()
+
+    print('%-12s %8s %8s %10s %10s %10s' % ('page', 'wire', 'decoded', 'cold ms', '304 ms', '304 hits'))
+    for sPath in asPages:
+        adCold = []
+        adRevalidate = []
+        iHits = 0
+        iWire = iDecoded = 0
+        for _ in range(oArgs.count):
+            iStatus, iWire, iDecoded, sEtag, dMs = fetch(oArgs.host, oArgs.port, sPath)
+            if iStatus != 200:
+                print('%s: unexpected status %d' % (sPath, iStatus))
+                return 1
+            adCold.append(dMs)
+            iStatus, _, _, _, dMs = fetch(oArgs.host, oArgs.port, sPath, sEtag)
+            adRevalidate.append(dMs)
+            iHits += (iStatus == 304)
+        print('%-12s %8d %8d %10.1f %10.1f %7d/%d' % (sPath, iWire, iDecoded, statistics.median(adCold),
+                                                     statistics.median(adRevalidate), iHits, oArgs.count))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,592 @@
+// Runs every Proto_Write* serializer in JSON and in CBOR mode, decodes both and compares the fields.
+// Checks the tag-77 sint16 chA/chB arrays byte for byte and that floats travel as exact float32.
+// Build: cc -O2 -Wall -Wextra -I. -Itools/host tools/proto_roundtrip_test.c proto.c json_writer.c -lm -o /tmp/proto_roundtrip_test
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "proto.h"
+
+#define iTestRounds                     2000
+#define iTestMaxSamples                 512
+#define iTestMaxFields                  24
+#define iTestKeyMax                     24
+#define iTestTextMax                    48
+#define iTestOutputMax                  8192
+
+typedef enum
+{
+    TEST_VALUE_INT = 0,
+    TEST_VALUE_FLOAT,
+    TEST_VALUE_BOOL,
+    TEST_VALUE_NULL,
+    TEST_VALUE_TEXT,
+    TEST_VALUE_INT16_ARRAY
+} test_value_kind_t;
+
+// One member of a decoded top-level object; every payload is a flat map
+typedef struct
+{
+    char acKey[iTestKeyMax];
+    test_value_kind_t eKind;
+    int64_t liValue;
+    double dValue;
+    bool bFloat32;                  // CBOR only: the float was encoded as 0xFA
+    char acText[iTestTextMax];
+    int iCount;
+    int16_t aiValues[iTestMaxSamples];
+} test_field_t;
+
+typedef struct
+{
+    int iFields;
+    test_field_t asFields[iTestMaxFields];
+} test_object_t;
+
+static int giFailures = 0;
+static int16_t gaiChannelA[iTestMaxSamples];
+static int16_t gaiChannelB[iTestMaxSamples];
+
+
+static void Test_Fail(const char *sCase, const char *sKey, const char *sWhat)
+{
+    if (giFailures++ < 20) {
+        printf("FAIL %s.%s: %s\n", sCase, sKey, sWhat);
+    }
+}
+
+
+static bool Test_ParseJsonText(const char **ppsPos, char *psOut, size_t szOut)
+{
+    // Reads a JSON string; the serializers only emit escapes for quote and backslash here
+    const char *psPos = *ppsPos;
+    size_t szUsed = 0;
+    if (*psPos++ != '"') {
+        return false;
+    }
+    while (*psPos != '"') {
+        if (*psPos == '\0' || szUsed + 1 >= szOut) {
+            return false;
+        }
+        if (*psPos == '\\') {
+            psPos++;
+        }
+        psOut[szUsed++] = *psPos++;
+    }
+    psOut[szUsed] = '\0';
+    *ppsPos = psPos + 1;
+    return true;
+}
+
+
+static bool Test_ParseJson(const char *psText, test_object_t *psObject)
+{
+    // Parses one flat object whose values are numbers, literals, strings or integer arrays
+    const char *psPos = psText;
+    psObject->iFields = 0;
+    if (*psPos++ != '{') {
+        return false;
+    }
+
+    while (*psPos != '}') {
+        if (psObject->iFields == iTestMaxFields) {
+            return false;
+        }
+        test_field_t *psField = &psObject->asFields[psObject->iFields++];
+        memset(psField, 0, sizeof(*psField));
+        if (!Test_ParseJsonText(&psPos, psField->acKey, sizeof(psField->acKey)) || *psPos++ != ':') {
+            return false;
+        }
+
+        if (*psPos == '"') {
+            psField->eKind = TEST_VALUE_TEXT;
+            if (!Test_ParseJsonText(&psPos, psField->acText, sizeof(psField->acText))) {
+                return false;
+            }
+        } else if (strncmp(psPos, "true", 4) == 0 || strncmp(psPos, "false", 5) == 0) {
+            psField->eKind = TEST_VALUE_BOOL;
+            psField->liValue = (*psPos == 't');
+            psPos += (*psPos == 't') ? 4 : 5;
+        } else if (strncmp(psPos, "null", 4) == 0) {
+            psField->eKind = TEST_VALUE_NULL;
+            psPos += 4;
+        } else if (*psPos == '[') {
+            psField->eKind = TEST_VALUE_INT16_ARRAY;
+            psPos++;
+            while (*psPos != ']') {
+                char *psEnd = NULL;
+                long lValue = strtol(psPos, &psEnd, 10);
+                if (psEnd == psPos || psField->iCount == iTestMaxSamples || lValue < INT16_MIN || lValue > INT16_MAX) {
+                    return false;
+                }
+                psField->aiValues[psField->iCount++] = (int16_t)lValue;
+                psPos = psEnd;
+                if (*psPos == ',') {
+                    psPos++;
+                }
+            }
+            psPos++;
+        } else {
+            // Integers carry no fraction; every float is written with a decimal point
+            const char *psEnd = psPos + strspn(psPos, "-0123456789.");
+            if (memchr(psPos, '.', (size_t)(psEnd - psPos)) != NULL) {
+                psField->eKind = TEST_VALUE_FLOAT;
+                psField->dValue = strtod(psPos, NULL);
+            } else {
+                psField->eKind = TEST_VALUE_INT;
+                psField->liValue = strtoll(psPos, NULL, 10);
+            }
+            if (psEnd == psPos) {
+                return false;
+            }
+            psPos = psEnd;
+        }
+
+        if (*psPos == ',') {
+            psPos++;
+        }
+    }
+    return (psPos[1] == '\0');
+}
+
+
+static bool Test_CborHead(const uint8_t **ppuPos, const uint8_t *puEnd, uint8_t *puMajor, uint64_t *puliArg)
+{
+    // Reads an initial byte and its argument; indefinite lengths are left to the caller
+    const uint8_t *puPos = *ppuPos;
+    if (puPos >= puEnd) {
+        return false;
+    }
+    uint8_t uInfo = *puPos & 0x1F;
+    *puMajor = *puPos++ >> 5;
+    *puliArg = uInfo;
+    if (uInfo >= 24 && uInfo <= 27) {
+        size_t szBytes = (size_t)1 << (uInfo - 24);
+        if ((size_t)(puEnd - puPos) < szBytes) {
+            return false;
+        }
+        *puliArg = 0;
+        for (size_t szIndex = 0; szIndex < szBytes; szIndex++) {
+            *puliArg = (*puliArg << 8) | *puPos++;
+        }
+    } else if (uInfo > 27) {
+        return false;
+    }
+    *ppuPos = puPos;
+    return true;
+}
+
+
+static bool Test_CborText(const uint8_t **ppuPos, const uint8_t *puEnd, char *psOut, size_t szOut)
+{
+    uint8_t uMajor = 0;
+    uint64_t uliLen = 0;
+    if (!Test_CborHead(ppuPos, puEnd, &uMajor, &uliLen) || uMajor != 3 || uliLen >= szOut ||
+        uliLen > (uint64_t)(puEnd - *ppuPos)) {
+        return false;
+    }
+    memcpy(psOut, *ppuPos, (size_t)uliLen);
+    psOut[uliLen] = '\0';
+    *ppuPos += uliLen;
+    return true;
+}
+
+
+static bool Test_ParseCbor(const uint8_t *puData, size_t szData, test_object_t *psObject)
+{
+    // Parses one indefinite-length map holding the same value kinds as the JSON form
+    const uint8_t *puPos = puData;
+    const uint8_t *puEnd = puData + szData;
+    psObject->iFields = 0;
+    if (szData < 2 || *puPos++ != 0xBF) {
+        return false;
+    }
+
+    while (puPos < puEnd && *puPos != 0xFF) {
+        if (psObject->iFields == iTestMaxFields) {
+            return false;
+        }
+        test_field_t *psField = &psObject->asFields[psObject->iFields++];
+        memset(psField, 0, sizeof(*psField));
+        if (!Test_CborText(&puPos, puEnd, psField->acKey, sizeof(psField->acKey))) {
+            return false;
+        }
+
+        uint8_t uInitial = *puPos;
+        if (uInitial == 0xF4 || uInitial == 0xF5) {
+            psField->eKind = TEST_VALUE_BOOL;
+            psField->liValue = (uInitial == 0xF5);
+            puPos++;
+            continue;
+        }
+        if (uInitial == 0xF6) {
+            psField->eKind = TEST_VALUE_NULL;
+            puPos++;
+            continue;
+        }
+        if (uInitial == 0xFA && puEnd - puPos >= 5) {
+            uint32_t uiBits = ((uint32_t)puPos[1] << 24) | ((uint32_t)puPos[2] << 16) |
+                              ((uint32_t)puPos[3] << 8) | puPos[4];
+            float fValue = 0.0f;
+            memcpy(&fValue, &uiBits, sizeof(fValue));
+            psField->eKind = TEST_VALUE_FLOAT;
+            psField->dValue = fValue;
+            psField->bFloat32 = true;
+            puPos += 5;
+            continue;
+        }
+        if (uInitial == 0xFB && puEnd - puPos >= 9) {
+            uint64_t uliBits = 0;
+            for (int iIndex = 1; iIndex <= 8; iIndex++) {
+                uliBits = (uliBits << 8) | puPos[iIndex];
+            }
+            memcpy(&psField->dValue, &uliBits, sizeof(psField->dValue));
+            psField->eKind = TEST_VALUE_FLOAT;
+            puPos += 9;
+            continue;
+        }
+        if ((uInitial >> 5) == 3) {
+            psField->eKind = TEST_VALUE_TEXT;
+            if (!Test_CborText(&puPos, puEnd, psField->acText, sizeof(psField->acText))) {
+                return false;
+            }
+            continue;
+        }
+
+        uint8_t uMajor = 0;
+        uint64_t uliArg = 0;
+        if (!Test_CborHead(&puPos, puEnd, &uMajor, &uliArg)) {
+            return false;
+        }
+        if (uMajor == 0 || uMajor == 1) {
+            psField->eKind = TEST_VALUE_INT;
+            psField->liValue = (uMajor == 0) ? (int64_t)uliArg : (int64_t)~uliArg;
+        } else if (uMajor == 6 && uliArg == 77) {
+            // RFC 8746 sint16 little-endian typed array over a definite byte string
+            if (!Test_CborHead(&puPos, puEnd, &uMajor, &uliArg) || uMajor != 2 || (uliArg & 1) != 0 ||
+                uliArg / 2 > iTestMaxSamples || uliArg > (uint64_t)(puEnd - puPos)) {
+                return false;
+            }
+            psField->eKind = TEST_VALUE_INT16_ARRAY;
+            psField->iCount = (int)(uliArg / 2);
+            for (int iIndex = 0; iIndex < psField->iCount; iIndex++) {
+                psField->aiValues[iIndex] = (int16_t)(puPos[2 * iIndex] | (puPos[2 * iIndex + 1] << 8));
+            }
+            puPos += uliArg;
+        } else {
+            return false;
+        }
+    }
+    return (puPos + 1 == puEnd && *puPos == 0xFF);
+}
+
+
+static const test_field_t *Test_Find(const test_object_t *psObject, const char *sKey)
+{
+    for (int iIndex = 0; iIndex < psObject->iFields; iIndex++) {
+        if (strcmp(psObject->asFields[iIndex].acKey, sKey) == 0) {
+            return &psObject->asFields[iIndex];
+        }
+    }
+    return NULL;
+}
+
+
+static void Test_CompareObjects(const char *sCase, const test_object_t *psJson, const test_object_t *psCbor)
+{
+    // Same keys in the same order with equal values; floats are float32 in CBOR and %.6f in JSON
+    if (psJson->iFields != psCbor->iFields) {
+        Test_Fail(sCase, "*", "member count differs");
+        return;
+    }
+
+    for (int iIndex = 0; iIndex < psJson->iFields; iIndex++) {
+        const test_field_t *psA = &psJson->asFields[iIndex];
+        const test_field_t *psB = &psCbor->asFields[iIndex];
+        if (strcmp(psA->acKey, psB->acKey) != 0) {
+            Test_Fail(sCase, psA->acKey, "key order differs");
+            continue;
+        }
+        if (psA->eKind != psB->eKind) {
+            Test_Fail(sCase, psA->acKey, "value kind differs");
+            continue;
+        }
+
+        switch (psA->eKind) {
+            case TEST_VALUE_INT:
+            case TEST_VALUE_BOOL:
+                if (psA->liValue != psB->liValue) {
+                    Test_Fail(sCase, psA->acKey, "value differs");
+                }
+                break;
+            case TEST_VALUE_FLOAT:
+                if (!psB->bFloat32) {
+                    Test_Fail(sCase, psA->acKey, "CBOR float is not float32");
+                }
+                if (fabs(psA->dValue - psB->dValue) > 5.0e-7 + fabs(psB->dValue) * 1e-12) {
+                    Test_Fail(sCase, psA->acKey, "JSON float is not the CBOR value at 6 decimals");
+                }
+                break;
+            case TEST_VALUE_TEXT:
+                if (strcmp(psA->acText, psB->acText) != 0) {
+                    Test_Fail(sCase, psA->acKey, "text differs");
+                }
+                break;
+            case TEST_VALUE_INT16_ARRAY:
+                if (psA->iCount != psB->iCount ||
+                    memcmp(psA->aiValues, psB->aiValues, (size_t)psA->iCount * sizeof(int16_t)) != 0) {
+                    Test_Fail(sCase, psA->acKey, "array differs");
+                }
+                break;
+            case TEST_VALUE_NULL:
+                break;
+        }
+    }
+}
+
+
+static void Test_ExpectInt(const char *sCase, const test_object_t *psObject, const char *sKey, int64_t liWant)
+{
+    const test_field_t *psField = Test_Find(psObject, sKey);
+    if (psField == NULL || (psField->eKind != TEST_VALUE_INT && psField->eKind != TEST_VALUE_BOOL) ||
+        psField->liValue != liWant) {
+        Test_Fail(sCase, sKey, "missing or not the input value");
+    }
+}
+
+
+static void Test_ExpectFloat32(const char *sCase, const test_object_t *psObject, const char *sKey, float fWant)
+{
+    const test_field_t *psField = Test_Find(psObject, sKey);
+    if (psField == NULL || psField->eKind != TEST_VALUE_FLOAT || psField->dValue != (double)fWant) {
+        Test_Fail(sCase, sKey, "missing or not the input float32");
+    }
+}
+
+
+static void Test_ExpectText(const char *sCase, const test_object_t *psObject, const char *sKey, const char *sWant)
+{
+    const test_field_t *psField = Test_Find(psObject, sKey);
+    if (psField == NULL || psField->eKind != TEST_VALUE_TEXT || strcmp(psField->acText, sWant) != 0) {
+        Test_Fail(sCase, sKey, "missing or not the input text");
+    }
+}
+
+
+static void Test_ExpectSamples(const char *sCase, const test_object_t *psObject, int iCount)
+{
+    // Both channels decode to the exact input samples
+    static const char *const asKeys[] = { "chA", "chB" };
+    const int16_t *apiWant[] = { gaiChannelA, gaiChannelB };
+    for (int iChannel = 0; iChannel < 2; iChannel++) {
+        const test_field_t *psField = Test_Find(psObject, asKeys[iChannel]);
+        if (psField == NULL || psField->eKind != TEST_VALUE_INT16_ARRAY || psField->iCount != iCount ||
+            memcmp(psField->aiValues, apiWant[iChannel], (size_t)iCount * sizeof(int16_t)) != 0) {
+            Test_Fail(sCase, asKeys[iChannel], "samples differ from the input");
+        }
+    }
+}
+
+
+// Serializer under test, called once per encoding with the same inputs
+typedef void (*test_serializer_t)(json_writer_t *psWriter, const void *pvCtx);
+
+static bool Test_RoundTrip(const char *sCase, test_serializer_t pfnWrite, const void *pvCtx,
+                           test_object_t *psJson, test_object_t *psCbor)
+{
+    // Renders both encodings, decodes them and checks they carry the same members
+    static char acJson[iTestOutputMax];
+    static char acCbor[iTestOutputMax];
+    json_writer_t sWriter;
+
+    JsonWriter_InitBuffer(&sWriter, acJson, sizeof(acJson));
+    pfnWrite(&sWriter, pvCtx);
+    int iJsonLen = JsonWriter_Finish(&sWriter);
+
+    JsonWriter_InitBuffer(&sWriter, acCbor, sizeof(acCbor));
+    JsonWriter_SetEncoding(&sWriter, JSON_WRITER_ENCODING_CBOR);
+    pfnWrite(&sWriter, pvCtx);
+    int iCborLen = JsonWriter_Finish(&sWriter);
+
+    if (iJsonLen < 0 || iJsonLen >= (int)sizeof(acJson) || iCborLen < 0 || iCborLen >= (int)sizeof(acCbor)) {
+        Test_Fail(sCase, "*", "render failed");
+        return false;
+    }
+    if (!Test_ParseJson(acJson, psJson)) {
+        Test_Fail(sCase, "*", "JSON does not parse");
+        return false;
+    }
+    if (!Test_ParseCbor((const uint8_t *)acCbor, (size_t)iCborLen, psCbor)) {
+        Test_Fail(sCase, "*", "CBOR does not decode");
+        return false;
+    }
+    Test_CompareObjects(sCase, psJson, psCbor);
+    return true;
+}
+
+
+typedef struct
+{
+    wifi_mgr_state_t eState;
+    adc_result_t sResult;
+    bool bHasValue;
+    const char *sIp;
+    int iSamples;
+    int iSourceSamples;
+    int64_t liTimestampUs;
+    int64_t liServerNowUs;
+    adc_trigger_t sTrigger;
+    adc_capture_info_t sInfo;
+} test_inputs_t;
+
+
+static void Test_WriteStatus(json_writer_t *psWriter, const void *pvCtx)
+{
+    Proto_WriteStatusJson(psWriter, ((const test_inputs_t *)pvCtx)->eState);
+}
+
+
+static void Test_WriteRms(json_writer_t *psWriter, const void *pvCtx)
+{
+    const test_inputs_t *psIn = (const test_inputs_t *)pvCtx;
+    Proto_WriteRmsJson(psWriter, &psIn->sResult, psIn->bHasValue);
+}
+
+
+static void Test_WriteStaIp(json_writer_t *psWriter, const void *pvCtx)
+{
+    const test_inputs_t *psIn = (const test_inputs_t *)pvCtx;
+    Proto_WriteStaIpJson(psWriter, psIn->sIp, psIn->bHasValue);
+}
+
+
+static void Test_WriteSamples(json_writer_t *psWriter, const void *pvCtx)
+{
+    const test_inputs_t *psIn = (const test_inputs_t *)pvCtx;
+    Proto_WriteSamplesJson(psWriter, gaiChannelA, gaiChannelB, psIn->iSamples, psIn->liTimestampUs,
+                           psIn->liServerNowUs);
+}
+
+
+static void Test_WriteEnvelope(json_writer_t *psWriter, const void *pvCtx)
+{
+    const test_inputs_t *psIn = (const test_inputs_t *)pvCtx;
+    Proto_WriteEnvelopeJson(psWriter, gaiChannelA, gaiChannelB, psIn->iSamples, psIn->iSourceSamples,
+                            psIn->liTimestampUs, psIn->liServerNowUs);
+}
+
+
+static void Test_WriteCapture(json_writer_t *psWriter, const void *pvCtx)
+{
+    const test_inputs_t *psIn = (const test_inputs_t *)pvCtx;
+    Proto_WriteCaptureJson(psWriter, gaiChannelA, gaiChannelB, psIn->iSamples, &psIn->sTrigger, &psIn->sInfo,
+                           psIn->liServerNowUs);
+}
+
+
+static int64_t Test_Random64(void)
+{
+    return (int64_t)(((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ (uint64_t)rand());
+}
+
+
+static void Test_RandomInputs(test_inputs_t *psIn, int iRound)
+{
+    // Random measurements, with the int16 extremes and an empty window forced in some rounds
+    memset(psIn, 0, sizeof(*psIn));
+    psIn->eState = (wifi_mgr_state_t)(rand() % 4);
+    psIn->bHasValue = (iRound % 7) != 0;
+    psIn->sResult.fRmsVoltsChA = (float)rand() / (float)RAND_MAX * 3.3f;
+    psIn->sResult.fRmsVoltsChB = (iRound % 5 == 0) ? 0.0f : (float)rand() / (float)RAND_MAX * 1e-3f;
+    psIn->sResult.liTimestampUs = Test_Random64() >> (rand() % 40);
+    psIn->sResult.eAttenChA = (adc_atten_t)(rand() % 4);
+    psIn->sResult.eAttenChB = (adc_atten_t)(rand() % 4);
+    psIn->sResult.iSamplesPerChannel = rand() % 4096;
+    psIn->sIp = (iRound % 3 == 0) ? NULL : "192.168.1.50";
+    psIn->iSamples = (iRound % 11 == 0) ? 0 : 1 + rand() % iTestMaxSamples;
+    psIn->iSourceSamples = psIn->iSamples * (1 + rand() % 8);
+    psIn->liTimestampUs = Test_Random64() >> (rand() % 40);
+    psIn->liServerNowUs = psIn->liTimestampUs + rand() % 1000000;
+    psIn->sTrigger.iChannel = rand() % 2;
+    psIn->sTrigger.iLevel_mV = rand() % 2001 - 1000;
+    psIn->sTrigger.eEdge = (adc_trigger_edge_t)(rand() % 2);
+    psIn->sTrigger.iPreTriggerPercent = rand() % 101;
+    psIn->sInfo.bTriggered = (iRound % 4) != 0;
+    psIn->sInfo.iTriggerIndex = psIn->sInfo.bTriggered ? rand() % (psIn->iSamples + 1) : -1;
+    psIn->sInfo.liTimestampUs = psIn->liTimestampUs;
+    psIn->sInfo.liTriggerUs = psIn->sInfo.bTriggered ? psIn->liTimestampUs - rand() % 100000 : 0;
+    psIn->sInfo.eAttenChA = psIn->sResult.eAttenChA;
+    psIn->sInfo.eAttenChB = psIn->sResult.eAttenChB;
+
+    for (int iIndex = 0; iIndex < iTestMaxSamples; iIndex++) {
+        gaiChannelA[iIndex] = (int16_t)(rand() % 65536 - 32768);
+        gaiChannelB[iIndex] = (int16_t)(rand() % 2001 - 1000);
+    }
+    gaiChannelA[0] = INT16_MIN;
+    gaiChannelB[0] = INT16_MAX;
+}
+
+
+int main(void)
+{
+    static test_object_t sJson;
+    static test_object_t sCbor;
+    test_inputs_t sIn;
+
+    srand(3);
+    for (int iRound = 0; iRound < iTestRounds; iRound++) {
+        Test_RandomInputs(&sIn, iRound);
+
+        if (Test_RoundTrip("status", Test_WriteStatus, &sIn, &sJson, &sCbor)) {
+            Test_ExpectInt("status", &sCbor, "wifiState", sIn.eState);
+        }
+
+        if (Test_RoundTrip("rms", Test_WriteRms, &sIn, &sJson, &sCbor)) {
+            Test_ExpectInt("rms", &sCbor, "hasValue", sIn.bHasValue);
+            if (sIn.bHasValue) {
+                Test_ExpectFloat32("rms", &sCbor, "rmsA", sIn.sResult.fRmsVoltsChA);
+                Test_ExpectFloat32("rms", &sCbor, "rmsB", sIn.sResult.fRmsVoltsChB);
+                Test_ExpectInt("rms", &sCbor, "timestampUs", sIn.sResult.liTimestampUs);
+                Test_ExpectInt("rms", &sCbor, "attenA", sIn.sResult.eAttenChA);
+                Test_ExpectInt("rms", &sCbor, "attenB", sIn.sResult.eAttenChB);
+                Test_ExpectInt("rms", &sCbor, "samples", sIn.sResult.iSamplesPerChannel);
+            }
+        }
+
+        if (Test_RoundTrip("staIp", Test_WriteStaIp, &sIn, &sJson, &sCbor)) {
+            const char *sWant = (sIn.bHasValue && sIn.sIp != NULL) ? sIn.sIp : "";
+            Test_ExpectText("staIp", &sCbor, "ip", sWant);
+            Test_ExpectText("staIp", &sCbor, "sta_ip", sWant);
+        }
+
+        if (Test_RoundTrip("samples", Test_WriteSamples, &sIn, &sJson, &sCbor)) {
+            Test_ExpectInt("samples", &sCbor, "samples", sIn.iSamples);
+            Test_ExpectInt("samples", &sCbor, "timestampUs", sIn.liTimestampUs);
+            Test_ExpectInt("samples", &sCbor, "serverNowUs", sIn.liServerNowUs);
+            Test_ExpectSamples("samples", &sCbor, sIn.iSamples);
+            Test_ExpectSamples("samples", &sJson, sIn.iSamples);
+        }
+
+        if (Test_RoundTrip("envelope", Test_WriteEnvelope, &sIn, &sJson, &sCbor)) {
+            Test_ExpectInt("envelope", &sCbor, "sourceSamples", sIn.iSourceSamples);
+            Test_ExpectText("envelope", &sCbor, "envelope", "minmax");
+            Test_ExpectSamples("envelope", &sCbor, sIn.iSamples);
+        }
+
+        if (Test_RoundTrip("capture", Test_WriteCapture, &sIn, &sJson, &sCbor)) {
+            Test_ExpectInt("capture", &sCbor, "triggered", sIn.sInfo.bTriggered);
+            Test_ExpectInt("capture", &sCbor, "triggerIndex", sIn.sInfo.iTriggerIndex);
+            Test_ExpectInt("capture", &sCbor, "triggerUs", sIn.sInfo.liTriggerUs);
+            Test_ExpectInt("capture", &sCbor, "levelMv", sIn.sTrigger.iLevel_mV);
+            Test_ExpectText("capture", &sCbor, "edge",
+                            (sIn.sTrigger.eEdge == ADC_TRIGGER_EDGE_FALLING) ? "falling" : "rising");
+            Test_ExpectSamples("capture", &sCbor, sIn.iSamples);
+        }
+    }
+
+    printf("%s: %d failure(s) over %d rounds of 6 serializers\n", (giFailures == 0) ? "PASS" : "FAIL", giFailures,
+           iTestRounds);
+    return (giFailures == 0) ? 0 : 1;
+}
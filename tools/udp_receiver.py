@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# Receives UDP telemetry datagrams from one or more nodes and reports rate and loss.
+# Decodes the layout documented in udp_telemetry.h and tracks sequence gaps per sender.
+# Example: tools/udp_receiver.py --group 239.255.42.1 --port 5005 --seconds 60
+
+import argparse
+import socket
+import struct
+import sys
+import time
+
+iHeaderBytes = 8
+iRmsBytes = 24
+
+
+class SenderStats:
+    def __init__(self):
+        self.iReceived = 0
+        self.iLost = 0
+        self.iReordered = 0
+        self.iExpected = None
+        self.iBytes = 0
+        self.oLast = None
+
+    def update(self, iSequence, iLength):
+        self.iReceived += 1
+        self.iBytes += iLength
+        if self.iExpected is not None:
+            if iSequence > self.iExpected:
+                self.iLost += iSequence - self.iExpected
+            elif iSequence < self.iExpected:
+                self.iReordered += 1
+                self.iLost = max(0, self.iLost - 1)
+                return
+        self.iExpected = iSequence + 1
+
+
+def decode(abData):
+    # Returns (sequence, rms_a, rms_b, timestamp_us, samples) or None for foreign packets.
+    if len(abData) < iHeaderBytes + iRmsBytes or abData[0:2] != b'AU':
+        return None
+    iVersion, iFlags, iSequence = struct.unpack_from('<BBI', abData, 2)
+    if iVersion != 1:
+        return None
+    _, _, _, _, iTimestampUs, fRmsA, fRmsB, iSamples, _ = struct.unpack_from('<BBBBqffHH', abData, iHeaderBytes)
+    iWave = 0
+    if iFlags & 0x01:
+        (iWave,) = struct.unpack_from('<H', abData, iHeaderBytes + iRmsBytes)
+    return iSequence, fRmsA, fRmsB, iTimestampUs, iWave
+
+
+def main():
+    oParser = argparse.ArgumentParser(description='UDP telemetry receiver and loss benchmark')
+    oParser.add_argument('--group', default='239.255.42.1', help='multicast group, or empty for broadcast/unicast')
+    oParser.add_argument('--port', type=int, default=5005)
+    oParser.add_argument('--seconds', type=float, default=0, help='stop after this many seconds (0 = forever)')
+    oParser.add_argument('-v', '--verbose', action='store_true', help='print every datagram')
+    oArgs = oParser.parse_args()
+
+    oSock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM, socket.IPPROTO_UDP)
+    oSock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    oSock.bind(('', oArgs.port))
+    if oArgs.group:
+        abMreq = struct.pack('4s4s', socket.inet_aton(oArgs.group), socket.inet_aton('0.0.0.0'))
+        oSock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, abMreq)
+    oSock.settimeout(1.0)
+
+    dictStats = {}
+    dStart = time.monotonic()
+    dNextReport = dStart + 5.0
+
+    try:
+        while oArgs.seconds <= 0 or time.monotonic() - dStart < oArgs.seconds:
+            try:
+                abData, tAddr = oSock.recvfrom(2048)
+            except socket.timeout:
+                abData = None
+
+            if abData:
+                tDecoded = decode(abData)
+                if tDecoded is not None:
+                    oStats = dictStats.setdefault(tAddr[0], SenderStats())
+                    oStats.update(tDecoded[0], len(abData))
+                    if oArgs.verbose:
+                        print('%s seq=%d rmsA=%.4f rmsB=%.4f ts=%d wave=%d'
+                              % ((tAddr[0],) + tDecoded))
+
+            if time.monotonic() >= dNextReport:
+                dNextReport += 5.0
+                report(dictStats, time.monotonic() - dStart)
+    except KeyboardInterrupt:
+        pass
+
+    report(dictStats, time.monotonic() - dStart)
+    return 0
+
+
+def report(dictStats, dElapsed):
+    for sAddr, oStats in sorted(dictStats.items()):
+        iTotal = oStats.iReceived + oStats.iLost
+        dLossPct = 100.0 * oStats.iLost / iTotal if iTotal else 0.0
+        print('%-15s %6d rx %5d lost (%.2f%%) %4d reordered %.2f pkt/s %.0f B/s'
+              % (sAddr, oStats.iReceived, oStats.iLost, dLossPct, oStats.iReordered,
+                 oStats.iReceived / max(dElapsed, 1e-6), oStats.iBytes / max(dElapsed, 1e-6)))
+    sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
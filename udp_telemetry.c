@@ -0,0 +1,149 @@
+// Publishes every measurement as a compact UDP datagram to a configured group.
+// Builds the datagram once on the publisher stack and sends it without blocking.
+// Numbers datagrams so receivers can detect loss and reordering.
+
+#include "udp_telemetry.h"
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "lwip/inet.h"
+#include "lwip/sockets.h"
+
+#include "adc.h"
+#include "proto.h"
+#include "app_config.h"
+
+static const char *gTag = "UDP_TLM";
+
+#define iUdpTelemetryMaxBytes           (iUdpTelemetryHeaderBytes + iProtoRmsBinaryBytes + 4 + \
+                                         (2 * iSamples_PerCh * (int)sizeof(int16_t)))
+
+static int giSocket = -1;
+static struct sockaddr_in gsDestination;
+static udp_telemetry_stats_t gsStats;
+
+// Datagram staging; publish hooks run sequentially on the measuring task
+static uint8_t gauDatagram[iUdpTelemetryMaxBytes];
+static int16_t gaiChannelA_mV[iSamples_PerCh];
+static int16_t gaiChannelB_mV[iSamples_PerCh];
+
+
+static void UdpTelemetry_PutLe16(uint8_t *puOut, uint16_t uiValue)
+{
+    // Stores a 16-bit value in little-endian byte order
+    // Keeps the datagram layout independent of host endianness
+    // Writes exactly two bytes
+
+    puOut[0] = (uint8_t)(uiValue & 0xFF);
+    puOut[1] = (uint8_t)(uiValue >> 8);
+}
+
+
+static void UdpTelemetry_OnPublish(const adc_result_t *psResult, void *pvCtx)
+{
+    // Builds and sends one datagram for a published measurement
+    // Appends the matching waveform when enabled in app_config.h
+    // Counts failures instead of retrying so the measuring task never stalls
+
+    (void)pvCtx;
+
+    size_t szLen = 0;
+
+    // Header with sequence number
+    uint32_t uiSequence = gsStats.uiSequence++;
+    gauDatagram[0] = 'A';
+    gauDatagram[1] = 'U';
+    gauDatagram[2] = iUdpTelemetryVersion;
+    gauDatagram[3] = 0;
+    UdpTelemetry_PutLe16(&gauDatagram[4], (uint16_t)(uiSequence & 0xFFFF));
+    UdpTelemetry_PutLe16(&gauDatagram[6], (uint16_t)(uiSequence >> 16));
+    szLen = iUdpTelemetryHeaderBytes;
+
+    // RMS record shared with /api/rms?fmt=bin
+    int iRmsLen = Proto_BuildRmsBinary(&gauDatagram[szLen], sizeof(gauDatagram) - szLen, psResult, true);
+    if (iRmsLen != iProtoRmsBinaryBytes) {
+        gsStats.uiFailed++;
+        return;
+    }
+    szLen += (size_t)iRmsLen;
+
+    // Optional waveform block
+    int iSamples = 0;
+    if (bUdpTelemetryIncludeWaveform &&
+        Adc_GetLastSamplesMilliVolts(gaiChannelA_mV, gaiChannelB_mV, iSamples_PerCh,
+                                     &iSamples, NULL, NULL, NULL) && iSamples > 0) {
+        gauDatagram[3] |= 0x01;
+        UdpTelemetry_PutLe16(&gauDatagram[szLen], (uint16_t)iSamples);
+        UdpTelemetry_PutLe16(&gauDatagram[szLen + 2], 0);
+        szLen += 4;
+        for (int iIndex = 0; iIndex < iSamples; iIndex++, szLen += 2) {
+            UdpTelemetry_PutLe16(&gauDatagram[szLen], (uint16_t)gaiChannelA_mV[iIndex]);
+        }
+        for (int iIndex = 0; iIndex < iSamples; iIndex++, szLen += 2) {
+            UdpTelemetry_PutLe16(&gauDatagram[szLen], (uint16_t)gaiChannelB_mV[iIndex]);
+        }
+    }
+
+    // Fire and forget
+    int iSent = sendto(giSocket, gauDatagram, szLen, MSG_DONTWAIT,
+                       (const struct sockaddr *)&gsDestination, sizeof(gsDestination));
+    if (iSent == (int)szLen) {
+        gsStats.uiSent++;
+    } else {
+        // Log only the first failure of a run to avoid flooding the console
+        if (gsStats.uiFailed++ == 0) {
+            ESP_LOGW(gTag, "sendto failed (errno %d)", errno);
+        }
+    }
+}
+
+
+esp_err_t UdpTelemetry_Init(void)
+{
+    // Opens the UDP socket and registers the publish hook when enabled
+    // Configures multicast TTL and broadcast permission for the destination
+    // Returns ESP_OK without doing anything when the publisher is disabled
+
+    if (!bUdpTelemetryEnabled) {
+        return ESP_OK;
+    }
+
+    // Resolve the destination address
+    memset(&gsDestination, 0, sizeof(gsDestination));
+    gsDestination.sin_family = AF_INET;
+    gsDestination.sin_port = htons(iUdpTelemetryPort);
+    if (inet_aton(sUdpTelemetryAddress, &gsDestination.sin_addr) == 0) {
+        ESP_LOGE(gTag, "Invalid destination %s", sUdpTelemetryAddress);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Create the socket
+    giSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (giSocket < 0) {
+        ESP_LOGE(gTag, "socket failed (errno %d)", errno);
+        return ESP_FAIL;
+    }
+
+    uint8_t uiTtl = iUdpTelemetryTtl;
+    (void)setsockopt(giSocket, IPPROTO_IP, IP_MULTICAST_TTL, &uiTtl, sizeof(uiTtl));
+    int iBroadcast = 1;
+    (void)setsockopt(giSocket, SOL_SOCKET, SO_BROADCAST, &iBroadcast, sizeof(iBroadcast));
+
+    ESP_LOGI(gTag, "Publishing to %s:%d (waveform=%d)", sUdpTelemetryAddress, iUdpTelemetryPort,
+             (int)bUdpTelemetryIncludeWaveform);
+    return Adc_RegisterPublishHook(UdpTelemetry_OnPublish, NULL);
+}
+
+
+void UdpTelemetry_GetStats(udp_telemetry_stats_t *psStatsOut)
+{
+    // Copies the datagram counters for diagnostics
+    // Counters are only written by the measuring task
+    // Torn reads across fields are acceptable for monitoring
+
+    if (psStatsOut != NULL) {
+        *psStatsOut = gsStats;
+    }
+}
@@ -0,0 +1,29 @@
+// Declares the optional UDP telemetry publisher.
+// Sends each published measurement as one datagram to a multicast or broadcast address.
+// Device cost is one send per measurement regardless of the number of listeners.
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Datagram layout (all fields little-endian):
+//   u8  magic[2] = 'A','U'
+//   u8  version (iUdpTelemetryVersion)
+//   u8  flags (bit0 = waveform block present)
+//   u32 sequence number, +1 per datagram, for loss detection
+//   u8  rms[iProtoRmsBinaryBytes], the record built by Proto_BuildRmsBinary
+//   optional waveform block: u16 samples, u16 reserved, i16 chA[samples], i16 chB[samples] (mV)
+#define iUdpTelemetryVersion            1
+#define iUdpTelemetryHeaderBytes        8
+
+typedef struct
+{
+    uint32_t uiSent;
+    uint32_t uiFailed;
+    uint32_t uiSequence;
+} udp_telemetry_stats_t;
+
+esp_err_t UdpTelemetry_Init(void);
+
+void UdpTelemetry_GetStats(udp_telemetry_stats_t *psStatsOut);
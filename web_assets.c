@@ -0,0 +1,96 @@
+// Serves the web pages embedded from www/ as precompressed gzip blobs.
+// Computes a content-hash ETag once per page and answers revalidation with 304.
+// Lets browsers cache pages so reloads cost a few hundred bytes of airtime.
+
+#include "web_assets.h"
+
+#include <string.h>
+
+#include "app_config.h"
+
+// Blobs generated by tools/build_web_assets.py and embedded by CMakeLists.txt
+extern const uint8_t _binary_dashboard_html_gz_start[] asm("_binary_dashboard_html_gz_start");
+extern const uint8_t _binary_dashboard_html_gz_end[] asm("_binary_dashboard_html_gz_end");
+extern const uint8_t _binary_provision_html_gz_start[] asm("_binary_provision_html_gz_start");
+extern const uint8_t _binary_provision_html_gz_end[] asm("_binary_provision_html_gz_end");
+extern const uint8_t _binary_ips_html_gz_start[] asm("_binary_ips_html_gz_start");
+extern const uint8_t _binary_ips_html_gz_end[] asm("_binary_ips_html_gz_end");
+
+typedef struct
+{
+    const uint8_t *puStart;
+    const uint8_t *puEnd;
+    const char *sContentType;
+} web_asset_t;
+
+static const web_asset_t gasAssets[WEB_ASSET_COUNT] = {
+    [WEB_ASSET_DASHBOARD] = { _binary_dashboard_html_gz_start, _binary_dashboard_html_gz_end, "text/html; charset=utf-8" },
+    [WEB_ASSET_PROVISION] = { _binary_provision_html_gz_start, _binary_provision_html_gz_end, "text/html; charset=utf-8" },
+    [WEB_ASSET_IPS] = { _binary_ips_html_gz_start, _binary_ips_html_gz_end, "text/html; charset=utf-8" },
+};
+
+// Strong ETags, filled on first use
+static char gasEtags[WEB_ASSET_COUNT][12];
+
+
+static const char *WebAssets_GetEtag(web_asset_id_t eAsset)
+{
+    // Returns the quoted FNV-1a hash of the compressed page bytes
+    // Hashes once per boot; concurrent first calls produce the same string
+    // Changes whenever the page content changes with a firmware update
+
+    if (gasEtags[eAsset][0] == '\0') {
+        uint32_t uiHash = 2166136261u;
+        for (const uint8_t *puByte = gasAssets[eAsset].puStart; puByte < gasAssets[eAsset].puEnd; puByte++) {
+            uiHash = (uiHash ^ *puByte) * 16777619u;
+        }
+
+        // Quoted and zero-padded to eight hex digits
+        static const char acHex[] = "0123456789abcdef";
+        char sEtag[sizeof(gasEtags[0])];
+        sEtag[0] = '"';
+        for (int iDigit = 0; iDigit < 8; iDigit++) {
+            sEtag[8 - iDigit] = acHex[uiHash & 0x0F];
+            uiHash >>= 4;
+        }
+        sEtag[9] = '"';
+        sEtag[10] = '\0';
+        memcpy(gasEtags[eAsset], sEtag, sizeof(sEtag));
+    }
+
+    return gasEtags[eAsset];
+}
+
+
+esp_err_t WebAssets_Send(httpd_req_t *psReq, web_asset_id_t eAsset)
+{
+    // Sends one embedded page with gzip encoding and cache headers
+    // Replies 304 without a body when the browser already holds this version
+    // Assumes gzip support, which every browser and captive portal view provides
+
+    if ((int)eAsset < 0 || eAsset >= WEB_ASSET_COUNT) {
+        return httpd_resp_send_err(psReq, HTTPD_404_NOT_FOUND, "Unknown asset");
+    }
+
+    const web_asset_t *psAsset = &gasAssets[eAsset];
+    const char *sEtag = WebAssets_GetEtag(eAsset);
+
+    // Cache headers shared by 200 and 304 replies
+    httpd_resp_set_hdr(psReq, "ETag", sEtag);
+    httpd_resp_set_hdr(psReq, "Cache-Control", sWebAssetCacheControl);
+    httpd_resp_set_hdr(psReq, "Vary", "Accept-Encoding");
+
+    // Answer revalidation
+    char sIfNoneMatch[64];
+    if (httpd_req_get_hdr_value_len(psReq, "If-None-Match") < sizeof(sIfNoneMatch) &&
+        httpd_req_get_hdr_value_str(psReq, "If-None-Match", sIfNoneMatch, sizeof(sIfNoneMatch)) == ESP_OK &&
+        strstr(sIfNoneMatch, sEtag) != NULL) {
+        httpd_resp_set_status(psReq, "304 Not Modified");
+        return httpd_resp_send(psReq, NULL, 0);
+    }
+
+    // Send the compressed page
+    httpd_resp_set_type(psReq, psAsset->sContentType);
+    httpd_resp_set_hdr(psReq, "Content-Encoding", "gzip");
+    return httpd_resp_send(psReq, (const char *)psAsset->puStart, (ssize_t)(psAsset->puEnd - psAsset->puStart));
+}
@@ -0,0 +1,18 @@
+// Declares access to the gzip-compressed web pages embedded at build time.
+// Pages live in www/ and are minified and compressed by tools/build_web_assets.py.
+// Serves them with a content-hash ETag and long-lived cache headers.
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+typedef enum
+{
+    WEB_ASSET_DASHBOARD = 0,
+    WEB_ASSET_PROVISION,
+    WEB_ASSET_IPS,
+    WEB_ASSET_COUNT
+} web_asset_id_t;
+
+esp_err_t WebAssets_Send(httpd_req_t *psReq, web_asset_id_t eAsset);
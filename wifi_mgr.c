@@ -1,40 +1,55 @@
 // Manages Wi-Fi connectivity and exposes a persistent AP alongside STA.
-// Retries STA reconnects indefinitely while keeping the local AP available.
-// Integrates with provisioning by preserving stored credentials across reboots.
+// Retries STA reconnects indefinitely while keeping the local AP available unless the AP policy turns it off.
+// Applies stored credentials, the optional static IP and the power-save profile preserved across reboots.
 
 #include "wifi_mgr.h"
 
 #include <string.h>
 #include <stdio.h>
 
+#include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_mac.h"
 #include "esp_netif.h"
 #include "esp_netif_ip_addr.h"
+#include "esp_random.h"
 #include "esp_timer.h"
 #include "esp_wifi.h"
 
+#include "driver/gpio.h"
 #include "lwip/inet.h"
+#include "ping/ping_sock.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 #include "app_config.h"
+#include "boot_timeline.h"
 #include "dns_captive.h"
 #include "storage.h"
 
 #define WIFI_CONNECTED_BIT BIT0
+#define WIFI_DISCONNECTED_BIT BIT1
+
+// AP requests, served by the Wi-Fi task so mode changes never race its connect attempts
+#define WIFI_AP_STOP_BIT BIT2           // Stable-link timer fired
+#define WIFI_AP_RESTORE_BIT BIT3        // Outage timer fired
+#define WIFI_AP_MANUAL_ON_BIT BIT4      // API or button
+#define WIFI_AP_MANUAL_OFF_BIT BIT5     // API
+#define WIFI_AP_REQUEST_BITS (WIFI_AP_STOP_BIT | WIFI_AP_RESTORE_BIT | WIFI_AP_MANUAL_ON_BIT | WIFI_AP_MANUAL_OFF_BIT)
+
+// Static IP gateway probe got no reply; the Wi-Fi task switches to DHCP
+#define WIFI_GATEWAY_SILENT_BIT BIT6
+#define WIFI_TASK_REQUEST_BITS (WIFI_AP_REQUEST_BITS | WIFI_GATEWAY_SILENT_BIT)
 
 static const char *gTag = "WIFI_MGR";
 
 static EventGroupHandle_t gsWifiEventGroup = NULL;
 static wifi_mgr_state_t geWifiState = WIFI_MGR_STATE_INIT;
 
-static int32_t giRetryBackoffMs = 0;
-static int64_t gliLastConnectedMs = 0;
-
 static esp_netif_t *gsStaNetif = NULL;
 static esp_netif_t *gsApNetif = NULL;
 
@@ -46,8 +61,38 @@ static char gsStaIpStr[16] = {0};
 
 static int giApClientCount = 0;
 
+// Stored network and the AP last joined on it
+static wifi_creds_t gsStaCreds = {0};
+static wifi_ap_hint_t gsApHint = {0};
+static bool gbTargetedConnect = false;
+static int giTargetedFailures = 0;
+static bool gbStaLinkUp = false;
+
+// Connection timing, written from the event handler
+static int64_t gliConnectStartUs = 0;
+static wifi_mgr_stats_t gsWifiStats = {0};
+
+// Static IPv4 config; cleared for the rest of the boot when its gateway stays silent
+static sta_ip_config_t gsStaticIp = {0};
+static bool gbGatewayProbeRunning = false;
+
+// Provisioning AP state; only the Wi-Fi task changes the mode
+static bool gbApActive = false;
+static int64_t gliApHoldUntilUs = 0;
+static esp_timer_handle_t gsApStopTimer = NULL;
+static esp_timer_handle_t gsApRestoreTimer = NULL;
+
+// Power-save profile in the driver; the listen interval waits for a disconnect when changed while linked
+// gsStaConfigMutex serializes profile changes from the API, timer and bench tasks with the
+// event handler, and keeps their STA get_config/set_config pairs from interleaving
+static SemaphoreHandle_t gsStaConfigMutex = NULL;
+static wifi_mgr_ps_t gePowerSave = WIFI_MGR_PS_MIN_MODEM;
+static bool gbListenIntervalStale = false;
+
+static const char *gasPowerSaveNames[WIFI_MGR_PS_COUNT] = { "none", "min", "max" };
+
 static void WifiMgr_Task(void *pvArg);
-static void WifiMgr_ApplyBackoffDelay(void);
+static uint32_t WifiMgr_NextBackoffMs(uint32_t uiPreviousMs);
 static void WifiMgr_SetState(wifi_mgr_state_t eNewState);
 static void WifiMgr_EventHandler(void *pvArg,
                                 esp_event_base_t sEventBase,
@@ -60,6 +105,12 @@ static void WifiMgr_BuildApSsid(char *psSsid, size_t stSsidLen);
 static esp_err_t WifiMgr_InitWifiStack(void);
 static esp_err_t WifiMgr_StartWifiApSta(void);
 static esp_err_t WifiMgr_ConfigureStaIfValid(const wifi_creds_t *psCreds);
+static esp_err_t WifiMgr_ApplyStaConfig(bool bTargeted);
+static void WifiMgr_ApplyStaticIp(void);
+static void WifiMgr_StartGatewayProbe(void);
+static void WifiMgr_ArmApTimer(esp_timer_handle_t sTimer, int iDelayMs);
+static void WifiMgr_InitApPolicy(void);
+static void WifiMgr_ApplyListenInterval(void);
 
 
 static void WifiMgr_SetState(wifi_mgr_state_t eNewState)
@@ -122,6 +173,118 @@ bool WifiMgr_GetStaIp(char *psOutIp, size_t stOutLen)
 }
 
 
+void WifiMgr_GetStats(wifi_mgr_stats_t *psStatsOut)
+{
+    // Copies connection timing and targeted/scan connect counters
+    // Used by /metrics to compare boot-to-IP with and without the cached AP
+    // Fields are written by the event loop; a torn read only skews one scrape
+
+    if (psStatsOut == NULL) {
+        return;
+    }
+
+    *psStatsOut = gsWifiStats;
+}
+
+
+esp_err_t WifiMgr_RequestAp(bool bOn)
+{
+    // Asks the Wi-Fi task to turn the provisioning AP on or off
+    // On holds the AP for iProvApManualHoldMs before the stable-link policy may stop it again
+    // Off is refused without a station IP, since the node would then be unreachable
+
+    if (gsWifiEventGroup == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!bOn && !WifiMgr_IsConnected()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xEventGroupSetBits(gsWifiEventGroup, bOn ? WIFI_AP_MANUAL_ON_BIT : WIFI_AP_MANUAL_OFF_BIT);
+    return ESP_OK;
+}
+
+
+bool WifiMgr_IsApActive(void)
+{
+    // Reports whether the provisioning AP is currently beaconing
+    // Follows mode changes made by the Wi-Fi task
+    // Used by the API and /metrics
+
+    return gbApActive;
+}
+
+
+wifi_mgr_ps_t WifiMgr_LoadPowerSave(void)
+{
+    // Returns the profile stored through the API, or the build default
+    // Out-of-range values from an older layout fall back to the default as well
+    // Reads NVS, so callers keep the result rather than polling
+
+    uint8_t uiProfile = 0;
+    if (Storage_LoadWifiPowerSave(&uiProfile) != ESP_OK || uiProfile >= WIFI_MGR_PS_COUNT) {
+        uiProfile = iWifiPsDefaultProfile;
+    }
+
+    return (wifi_mgr_ps_t)uiProfile;
+}
+
+
+esp_err_t WifiMgr_SetPowerSave(wifi_mgr_ps_t ePowerSave)
+{
+    // Hands the profile to the driver, which applies modem sleep at once
+    // The listen interval is part of the association, so it is written now only while unlinked
+    // Safe from any task; modem sleep stays inactive while the provisioning AP runs
+
+    if (ePowerSave >= WIFI_MGR_PS_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gsStaConfigMutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(gsStaConfigMutex, portMAX_DELAY);
+
+    static const wifi_ps_type_t aeDriverPs[WIFI_MGR_PS_COUNT] = { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM };
+    esp_err_t eErr = esp_wifi_set_ps(aeDriverPs[ePowerSave]);
+    if (eErr == ESP_OK) {
+        bool bIntervalChanged = (ePowerSave == WIFI_MGR_PS_MAX_MODEM) != (gePowerSave == WIFI_MGR_PS_MAX_MODEM);
+        gePowerSave = ePowerSave;
+
+        if (bIntervalChanged && gbStaConfigured) {
+            if (gbStaLinkUp) {
+                gbListenIntervalStale = true;
+            } else {
+                WifiMgr_ApplyListenInterval();
+            }
+        }
+    }
+
+    xSemaphoreGive(gsStaConfigMutex);
+    return eErr;
+}
+
+
+wifi_mgr_ps_t WifiMgr_GetPowerSave(void)
+{
+    // Returns the profile last handed to the driver
+    // May differ from the stored one while a streaming client or benchmark overrides it
+    // Plain read of an enum written by the caller of WifiMgr_SetPowerSave
+
+    return gePowerSave;
+}
+
+
+const char *WifiMgr_GetPowerSaveName(wifi_mgr_ps_t ePowerSave)
+{
+    // Returns the API name of a profile: "none", "min" or "max"
+    // Used by the power API and /metrics labels
+    // Returns "unknown" for out-of-range values
+
+    return (ePowerSave < WIFI_MGR_PS_COUNT) ? gasPowerSaveNames[ePowerSave] : "unknown";
+}
+
+
 static void WifiMgr_BuildApSsid(char *psSsid, size_t stSsidLen)
 {
     // Builds a stable AP SSID based on a fixed prefix and the device MAC suffix
@@ -145,7 +308,7 @@ static void WifiMgr_EnsureApIp(void)
     // Restores AP IP after STA events that may disturb routing on some phones
     // Ensures DHCP advertises AP IP as DNS for captive portal hostname redirection
 
-    if (gsApNetif == NULL) {
+    if (gsApNetif == NULL || !gbApActive) {
         return;
     }
 
@@ -205,6 +368,7 @@ static esp_err_t WifiMgr_InitWifiStack(void)
 
     if (gsStaNetif == NULL) {
         gsStaNetif = esp_netif_create_default_wifi_sta();
+        WifiMgr_ApplyStaticIp();
     }
 
     if (gsApNetif == NULL) {
@@ -214,6 +378,15 @@ static esp_err_t WifiMgr_InitWifiStack(void)
     wifi_init_config_t sCfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&sCfg));
 
+    // Credentials live in our own NVS namespace; keeps set_config from rewriting the driver's flash copy
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+
+    // Modem sleep from the stored profile; the listen interval goes into the STA config
+    eResult = WifiMgr_SetPowerSave(WifiMgr_LoadPowerSave());
+    if (eResult != ESP_OK) {
+        ESP_LOGW(gTag, "Power save not applied (%s)", esp_err_to_name(eResult));
+    }
+
     ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
                                                &WifiMgr_EventHandler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
@@ -223,6 +396,139 @@ static esp_err_t WifiMgr_InitWifiStack(void)
 }
 
 
+static void WifiMgr_ApplyStaticIp(void)
+{
+    // Loads the stored static IPv4 config and applies it to the STA netif
+    // Stops the DHCP client first; esp_netif then posts STA_GOT_IP on link-up as DHCP would
+    // Leaves DHCP running when no config is stored or applying it fails
+
+    if (Storage_LoadStaticIp(&gsStaticIp) != ESP_OK || !gsStaticIp.bValid) {
+        gsStaticIp.bValid = false;
+        return;
+    }
+
+    // Address, netmask and gateway replace the DHCP lease
+    esp_netif_ip_info_t sIpInfo = {0};
+    sIpInfo.ip.addr = gsStaticIp.uiIp;
+    sIpInfo.netmask.addr = gsStaticIp.uiNetmask;
+    sIpInfo.gw.addr = gsStaticIp.uiGateway;
+
+    esp_err_t eErr = esp_netif_dhcpc_stop(gsStaNetif);
+    if (eErr == ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        eErr = ESP_OK;
+    }
+    if (eErr == ESP_OK) {
+        eErr = esp_netif_set_ip_info(gsStaNetif, &sIpInfo);
+    }
+
+    // Without DHCP nobody else sets the resolver
+    if (eErr == ESP_OK) {
+        esp_netif_dns_info_t sDnsInfo = {0};
+        sDnsInfo.ip.u_addr.ip4.addr = gsStaticIp.uiDns;
+        sDnsInfo.ip.type = ESP_IPADDR_TYPE_V4;
+        eErr = esp_netif_set_dns_info(gsStaNetif, ESP_NETIF_DNS_MAIN, &sDnsInfo);
+    }
+
+    if (eErr != ESP_OK) {
+        ESP_LOGW(gTag, "Static IP not applied (%s), using DHCP", esp_err_to_name(eErr));
+        gsStaticIp.bValid = false;
+        (void)esp_netif_dhcpc_start(gsStaNetif);
+        return;
+    }
+
+    gsWifiStats.bStaticIp = true;
+    ESP_LOGI(gTag, "Static IP " IPSTR " gw " IPSTR, IP2STR(&sIpInfo.ip), IP2STR(&sIpInfo.gw));
+}
+
+
+static void WifiMgr_OnGatewayProbeEnd(esp_ping_handle_t sPing, void *pvArg)
+{
+    // Runs on the ping task once all gateway probes have answered or timed out
+    // Any reply keeps the static config; silence is handed to the Wi-Fi task
+    // Only ends the session here, so no connection state is written off the Wi-Fi task
+
+    (void)pvArg;
+
+    uint32_t uiReplies = 0;
+    (void)esp_ping_get_profile(sPing, ESP_PING_PROF_REPLY, &uiReplies, sizeof(uiReplies));
+    (void)esp_ping_delete_session(sPing);
+    gbGatewayProbeRunning = false;
+
+    if (uiReplies == 0 && gsWifiEventGroup != NULL) {
+        xEventGroupSetBits(gsWifiEventGroup, WIFI_GATEWAY_SILENT_BIT);
+    }
+}
+
+
+static void WifiMgr_FallBackToDhcp(void)
+{
+    // Runs on the Wi-Fi task after a silent gateway probe and restarts DHCP for the rest of this boot
+    // Reports the station as disconnected so the retry loop times the lease like any connect attempt
+    // The stored config is kept, so the next boot tries the static address again
+
+    if (!gsStaticIp.bValid) {
+        return;
+    }
+
+    ESP_LOGW(gTag, "Gateway silent on static IP, falling back to DHCP");
+    gsStaticIp.bValid = false;
+    gsWifiStats.bStaticIp = false;
+    gsWifiStats.uiStaticIpFallbacks++;
+
+    // The DHCP client clears the static address; report no IP until the lease arrives
+    gbStaIpValid = false;
+    gsStaIpStr[0] = '\0';
+    WifiMgr_SetState(WIFI_MGR_STATE_CONNECTING);
+
+    esp_err_t eErr = esp_netif_dhcpc_start(gsStaNetif);
+    if (eErr != ESP_OK) {
+        ESP_LOGE(gTag, "DHCP start failed (%s)", esp_err_to_name(eErr));
+    }
+
+    // No lease within iWifiConnectTimeoutMs makes the retry loop restart the link
+    xEventGroupClearBits(gsWifiEventGroup, WIFI_CONNECTED_BIT);
+    xEventGroupSetBits(gsWifiEventGroup, WIFI_DISCONNECTED_BIT);
+}
+
+
+static void WifiMgr_StartGatewayProbe(void)
+{
+    // Pings the static gateway a few times from the STA interface
+    // Catches a static address that does not match the network it was saved for
+    // One session at a time; a session that cannot start keeps the static config
+
+    if (iWifiStaticIpGatewayProbes <= 0 || gbGatewayProbeRunning) {
+        return;
+    }
+
+    esp_ping_config_t sPingConfig = ESP_PING_DEFAULT_CONFIG();
+    ip_addr_set_ip4_u32_val(sPingConfig.target_addr, gsStaticIp.uiGateway);
+    sPingConfig.count = iWifiStaticIpGatewayProbes;
+    sPingConfig.timeout_ms = iWifiStaticIpProbeTimeoutMs;
+    sPingConfig.interval_ms = 200;
+    sPingConfig.interface = (uint32_t)esp_netif_get_netif_impl_index(gsStaNetif);
+
+    esp_ping_callbacks_t sCallbacks = {
+        .cb_args = NULL,
+        .on_ping_success = NULL,
+        .on_ping_timeout = NULL,
+        .on_ping_end = WifiMgr_OnGatewayProbeEnd,
+    };
+
+    esp_ping_handle_t sPing = NULL;
+    if (esp_ping_new_session(&sPingConfig, &sCallbacks, &sPing) != ESP_OK) {
+        ESP_LOGW(gTag, "Gateway probe not started");
+        return;
+    }
+
+    gbGatewayProbeRunning = true;
+    if (esp_ping_start(sPing) != ESP_OK) {
+        gbGatewayProbeRunning = false;
+        (void)esp_ping_delete_session(sPing);
+    }
+}
+
+
 static esp_err_t WifiMgr_StartWifiApSta(void)
 {
     // Starts Wi-Fi in APSTA mode with a persistent AP and optional STA
@@ -249,6 +555,8 @@ static esp_err_t WifiMgr_StartWifiApSta(void)
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &sApConfig));
     ESP_ERROR_CHECK(esp_wifi_start());
+    gbApActive = true;
+    gsWifiStats.bApActive = true;
 
     // Re-apply AP IP to avoid losing access after STA changes
     WifiMgr_EnsureApIp();
@@ -259,26 +567,305 @@ static esp_err_t WifiMgr_StartWifiApSta(void)
 }
 
 
-static esp_err_t WifiMgr_ConfigureStaIfValid(const wifi_creds_t *psCreds)
+static void WifiMgr_OnApTimer(void *pvArg)
 {
-    // Applies STA configuration when stored credentials are available
-    // Prepares Wi-Fi driver for a station connection attempt
-    // Keeps provisioning AP enabled regardless of STA configuration
+    // Runs on the esp_timer task when a stable-link or outage timer expires
+    // Only posts the request bit; the mode change itself happens on the Wi-Fi task
+    // pvArg carries the bit to set
 
-    if (psCreds == NULL || !psCreds->bValid) {
-        return ESP_ERR_INVALID_ARG;
+    if (gsWifiEventGroup != NULL) {
+        xEventGroupSetBits(gsWifiEventGroup, (EventBits_t)(uintptr_t)pvArg);
+    }
+}
+
+
+#if iProvApButtonGpio >= 0
+static void IRAM_ATTR WifiMgr_OnApButton(void *pvArg)
+{
+    // GPIO interrupt for the AP button; contact bounce only repeats the same request
+    // Posts through the timer daemon since event group bits cannot be set directly from an ISR
+    // Yields if that woke a higher-priority task
+
+    (void)pvArg;
+
+    BaseType_t xWoken = pdFALSE;
+    if (gsWifiEventGroup != NULL) {
+        (void)xEventGroupSetBitsFromISR(gsWifiEventGroup, WIFI_AP_MANUAL_ON_BIT, &xWoken);
+    }
+    portYIELD_FROM_ISR(xWoken);
+}
+#endif
+
+
+static void WifiMgr_ArmApTimer(esp_timer_handle_t sTimer, int iDelayMs)
+{
+    // (Re)starts a one-shot AP timer; a running one is restarted with the new delay
+    // A delay of 0 or less leaves the timer stopped, which disables that part of the policy
+    // Safe from the event loop and the Wi-Fi task
+
+    if (sTimer == NULL) {
+        return;
+    }
+
+    (void)esp_timer_stop(sTimer);
+    if (iDelayMs > 0) {
+        (void)esp_timer_start_once(sTimer, (uint64_t)iDelayMs * 1000);
     }
+}
+
+
+static void WifiMgr_InitApPolicy(void)
+{
+    // Creates the stable-link and outage timers and hooks up the optional AP button
+    // A missing timer only disables its half of the policy; the AP then simply stays as it is
+    // The button is active low with the internal pull-up, like the BOOT button on dev boards
+
+    esp_timer_create_args_t sTimerArgs = {
+        .callback = WifiMgr_OnApTimer,
+        .arg = (void *)(uintptr_t)WIFI_AP_STOP_BIT,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "ap_stop",
+        .skip_unhandled_events = true,
+    };
+    if (esp_timer_create(&sTimerArgs, &gsApStopTimer) != ESP_OK) {
+        gsApStopTimer = NULL;
+    }
+
+    sTimerArgs.arg = (void *)(uintptr_t)WIFI_AP_RESTORE_BIT;
+    sTimerArgs.name = "ap_restore";
+    if (esp_timer_create(&sTimerArgs, &gsApRestoreTimer) != ESP_OK) {
+        gsApRestoreTimer = NULL;
+    }
+
+#if iProvApButtonGpio >= 0
+    gpio_config_t sButton = {
+        .pin_bit_mask = 1ULL << iProvApButtonGpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+
+    // The ISR service may already be installed by another driver
+    esp_err_t eErr = gpio_config(&sButton);
+    if (eErr == ESP_OK) {
+        eErr = gpio_install_isr_service(0);
+        if (eErr == ESP_ERR_INVALID_STATE) {
+            eErr = ESP_OK;
+        }
+    }
+    if (eErr == ESP_OK) {
+        eErr = gpio_isr_handler_add((gpio_num_t)iProvApButtonGpio, WifiMgr_OnApButton, NULL);
+    }
+    if (eErr != ESP_OK) {
+        ESP_LOGW(gTag, "AP button on GPIO %d unavailable (%s)", iProvApButtonGpio, esp_err_to_name(eErr));
+    }
+#endif
+}
+
+
+static void WifiMgr_SetApActive(bool bActive, const char *sReason)
+{
+    // Switches between APSTA and STA-only mode; the STA link stays up across the switch
+    // STA-only frees the airtime of the AP beacons and lets the station follow its AP's channel alone
+    // Runs on the Wi-Fi task only
+
+    if (bActive == gbApActive) {
+        return;
+    }
+
+    esp_err_t eErr = esp_wifi_set_mode(bActive ? WIFI_MODE_APSTA : WIFI_MODE_STA);
+    if (eErr != ESP_OK) {
+        ESP_LOGW(gTag, "AP %s failed (%s)", bActive ? "start" : "stop", esp_err_to_name(eErr));
+        return;
+    }
+
+    gbApActive = bActive;
+    gsWifiStats.bApActive = bActive;
+    if (bActive) {
+        gsWifiStats.uiApRestores++;
+
+        // The driver keeps the AP config; the netif addressing is re-applied on AP start
+        WifiMgr_EnsureApIp();
+    } else {
+        gsWifiStats.uiApStops++;
+
+        // Stations were dropped with the AP
+        giApClientCount = 0;
+        (void)DnsCaptive_Stop();
+    }
+
+    ESP_LOGI(gTag, "Provisioning AP %s (%s)", bActive ? "on" : "off", sReason);
+}
+
+
+static void WifiMgr_ServiceApRequests(EventBits_t uiRequests)
+{
+    // Applies pending AP requests from the timers, the API and the button
+    // The AP only goes off while the station has an IP, so the node always stays reachable
+    // The policy stop waits for AP clients to leave and for a manual hold to run out
+
+    int64_t liNowUs = esp_timer_get_time();
+
+    if ((uiRequests & WIFI_AP_MANUAL_ON_BIT) != 0) {
+        gliApHoldUntilUs = liNowUs + (int64_t)iProvApManualHoldMs * 1000;
+        WifiMgr_SetApActive(true, "requested");
+
+        // Let the policy take it down again once the hold is over
+        if (iProvApStopAfterConnectedMs > 0 && WifiMgr_IsConnected()) {
+            WifiMgr_ArmApTimer(gsApStopTimer, iProvApManualHoldMs);
+        }
+    } else if ((uiRequests & WIFI_AP_RESTORE_BIT) != 0 && !WifiMgr_IsConnected()) {
+        WifiMgr_SetApActive(true, "station outage");
+    }
+
+    if ((uiRequests & WIFI_AP_MANUAL_OFF_BIT) != 0) {
+        gliApHoldUntilUs = 0;
+        WifiMgr_ArmApTimer(gsApStopTimer, 0);
+        if (WifiMgr_IsConnected()) {
+            WifiMgr_SetApActive(false, "requested");
+        }
+    }
+
+    if ((uiRequests & WIFI_AP_STOP_BIT) != 0 && gbApActive && WifiMgr_IsConnected()) {
+        if (giApClientCount > 0 || liNowUs < gliApHoldUntilUs) {
+
+            // Busy or held: look again after another stable period or when the hold ends
+            int iDelayMs = iProvApStopAfterConnectedMs;
+            int64_t liHoldLeftMs = (gliApHoldUntilUs - liNowUs) / 1000;
+            if (liHoldLeftMs > iDelayMs) {
+                iDelayMs = (int)liHoldLeftMs;
+            }
+            WifiMgr_ArmApTimer(gsApStopTimer, iDelayMs);
+        } else {
+            WifiMgr_SetApActive(false, "station stable");
+        }
+    }
+}
+
+
+static EventBits_t WifiMgr_WaitBits(EventBits_t uiWaitBits, TickType_t xTimeout)
+{
+    // Waits like xEventGroupWaitBits (any bit, no clear) and serves AP and DHCP fallback requests meanwhile
+    // A request does not end the wait early unless it sets an awaited bit itself
+    // Returns the awaited bits that are set, 0 on timeout
+
+    TickType_t xStart = xTaskGetTickCount();
+
+    while (1) {
+        TickType_t xLeft = portMAX_DELAY;
+        if (xTimeout != portMAX_DELAY) {
+            TickType_t xElapsed = xTaskGetTickCount() - xStart;
+            xLeft = (xElapsed < xTimeout) ? (xTimeout - xElapsed) : 0;
+        }
+
+        EventBits_t uiBits = xEventGroupWaitBits(gsWifiEventGroup, uiWaitBits | WIFI_TASK_REQUEST_BITS,
+                                                 pdFALSE, pdFALSE, xLeft);
+        EventBits_t uiRequests = uiBits & WIFI_TASK_REQUEST_BITS;
+        if (uiRequests != 0) {
+            xEventGroupClearBits(gsWifiEventGroup, uiRequests);
+            if ((uiRequests & WIFI_AP_REQUEST_BITS) != 0) {
+                WifiMgr_ServiceApRequests(uiRequests);
+            }
+            if ((uiRequests & WIFI_GATEWAY_SILENT_BIT) != 0) {
+                WifiMgr_FallBackToDhcp();
+                uiBits = xEventGroupGetBits(gsWifiEventGroup);
+            }
+        }
+
+        if ((uiBits & uiWaitBits) != 0 || xLeft == 0) {
+            return uiBits & uiWaitBits;
+        }
+    }
+}
+
+
+static esp_err_t WifiMgr_ApplyStaConfig(bool bTargeted)
+{
+    // Writes the station config for the stored network
+    // Targeted mode pins the cached BSSID and channel; the event handler drops to a full scan if that AP fails
+    // Runs from the event handler too, so a driver error is logged and returned, never fatal
 
     wifi_config_t sStaConfig = {0};
 
     // Copy SSID and password into ESP-IDF station config
-    (void)strncpy((char *)sStaConfig.sta.ssid, psCreds->sSsid,
+    (void)strncpy((char *)sStaConfig.sta.ssid, gsStaCreds.sSsid,
                   sizeof(sStaConfig.sta.ssid) - 1);
-    (void)strncpy((char *)sStaConfig.sta.password, psCreds->sPassword,
+    (void)strncpy((char *)sStaConfig.sta.password, gsStaCreds.sPassword,
                   sizeof(sStaConfig.sta.password) - 1);
 
+    // Pin the cached AP; its auth mode doubles as the minimum accepted
+    bTargeted = bTargeted && gsApHint.bValid && (iWifiTargetedConnectAttempts > 0);
+    if (bTargeted) {
+        sStaConfig.sta.bssid_set = true;
+        memcpy(sStaConfig.sta.bssid, gsApHint.auBssid, sizeof(sStaConfig.sta.bssid));
+        sStaConfig.sta.channel = gsApHint.uiChannel;
+        sStaConfig.sta.threshold.authmode = (wifi_auth_mode_t)gsApHint.uiAuthMode;
+    }
+
+    // 0 lets the driver use its default of 3 beacons
+    xSemaphoreTake(gsStaConfigMutex, portMAX_DELAY);
+    sStaConfig.sta.listen_interval = (gePowerSave == WIFI_MGR_PS_MAX_MODEM) ? iWifiPsListenInterval : 0;
+
+    esp_err_t eErr = esp_wifi_set_config(WIFI_IF_STA, &sStaConfig);
+    if (eErr == ESP_OK) {
+        gbListenIntervalStale = false;
+    }
+    xSemaphoreGive(gsStaConfigMutex);
+
+    if (eErr != ESP_OK) {
+        ESP_LOGE(gTag, "STA config not applied (%s)", esp_err_to_name(eErr));
+        return eErr;
+    }
+    gbTargetedConnect = bTargeted;
+    giTargetedFailures = 0;
+    return ESP_OK;
+}
+
+
+static void WifiMgr_ApplyListenInterval(void)
+{
+    // Rewrites only the listen interval of the current station config
+    // Keeps the BSSID pin and targeted-connect state chosen by WifiMgr_ApplyStaConfig
+    // Call while unlinked and holding gsStaConfigMutex; the driver reads the interval when it associates
+
+    wifi_config_t sStaConfig = {0};
+    if (esp_wifi_get_config(WIFI_IF_STA, &sStaConfig) != ESP_OK) {
+        return;
+    }
+
+    sStaConfig.sta.listen_interval = (gePowerSave == WIFI_MGR_PS_MAX_MODEM) ? iWifiPsListenInterval : 0;
+    if (esp_wifi_set_config(WIFI_IF_STA, &sStaConfig) == ESP_OK) {
+        gbListenIntervalStale = false;
+    }
+}
+
+
+static esp_err_t WifiMgr_ConfigureStaIfValid(const wifi_creds_t *psCreds)
+{
+    // Applies STA configuration when stored credentials are available
+    // Prepares Wi-Fi driver for a station connection attempt, on the cached AP when known
+    // Keeps provisioning AP enabled regardless of STA configuration
+
+    if (psCreds == NULL || !psCreds->bValid) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Keep the credentials for later scan fallbacks and load the AP hint
+    gsStaCreds = *psCreds;
+    if (Storage_LoadWifiApHint(&gsApHint) != ESP_OK) {
+        gsApHint.bValid = false;
+    }
+    if (gsApHint.bValid) {
+        ESP_LOGI(gTag, "Cached AP " MACSTR " on channel %u", MAC2STR(gsApHint.auBssid),
+                 (unsigned)gsApHint.uiChannel);
+    }
+
     // Apply STA configuration
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &sStaConfig));
+    esp_err_t eErr = WifiMgr_ApplyStaConfig(true);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
     gbStaConfigured = true;
 
     // Mark state as connecting for UI/API
@@ -307,22 +894,21 @@ static esp_err_t WifiMgr_ConnectStaIfConfigured(void)
 }
 
 
-static void WifiMgr_ApplyBackoffDelay(void)
+static uint32_t WifiMgr_NextBackoffMs(uint32_t uiPreviousMs)
 {
-    // Implements exponential backoff between STA reconnect attempts
-    // Reduces Wi-Fi driver load and avoids tight reconnect loops
-    // Caps delay to keep eventual recovery reasonable
+    // Picks the next reconnect delay with decorrelated jitter
+    // Draws uniformly between the minimum and three times the previous delay, capped at the maximum
+    // Nodes that lost the same AP drift apart instead of retrying in lockstep
 
-    if (giRetryBackoffMs == 0) {
-        giRetryBackoffMs = 500;
-    } else {
-        giRetryBackoffMs *= 2;
-        if (giRetryBackoffMs > 10000) {
-            giRetryBackoffMs = 10000;
-        }
+    uint32_t uiUpperMs = uiPreviousMs * 3;
+    if (uiUpperMs > iWifiRetryBackoffMaxMs) {
+        uiUpperMs = iWifiRetryBackoffMaxMs;
+    }
+    if (uiUpperMs <= iWifiRetryBackoffMinMs) {
+        return iWifiRetryBackoffMinMs;
     }
 
-    vTaskDelay(pdMS_TO_TICKS(giRetryBackoffMs));
+    return iWifiRetryBackoffMinMs + (esp_random() % (uiUpperMs - iWifiRetryBackoffMinMs + 1));
 }
 
 
@@ -365,19 +951,89 @@ static void WifiMgr_EventHandler(void *pvArg,
             }
         }
 
+        // AP (re)started: the netif comes up with default addressing
+        if (iEventId == WIFI_EVENT_AP_START) {
+            WifiMgr_EnsureApIp();
+        }
+
         // STA started: attempt connect if configured
         if (iEventId == WIFI_EVENT_STA_START) {
             (void)WifiMgr_ConnectStaIfConfigured();
         }
 
+        // STA associated: remember the AP so the next reconnect can skip the scan
+        if (iEventId == WIFI_EVENT_STA_CONNECTED) {
+            wifi_event_sta_connected_t *psEvent = (wifi_event_sta_connected_t *)pvEventData;
+            wifi_ap_hint_t sHint = {
+                .uiChannel = psEvent->channel,
+                .uiAuthMode = (uint8_t)psEvent->authmode,
+                .bValid = true,
+            };
+            memcpy(sHint.auBssid, psEvent->bssid, sizeof(sHint.auBssid));
+
+            gbStaLinkUp = true;
+            if (gbTargetedConnect) {
+                gsWifiStats.uiTargetedConnects++;
+            } else {
+                gsWifiStats.uiScanConnects++;
+            }
+
+            // Write flash only when the AP or its channel changed
+            if (!gsApHint.bValid || gsApHint.uiChannel != sHint.uiChannel ||
+                gsApHint.uiAuthMode != sHint.uiAuthMode ||
+                memcmp(gsApHint.auBssid, sHint.auBssid, sizeof(sHint.auBssid)) != 0) {
+                gsApHint = sHint;
+                if (Storage_SaveWifiApHint(&sHint) != ESP_OK) {
+                    ESP_LOGW(gTag, "AP hint not saved");
+                }
+            }
+        }
+
         // STA disconnected: clear state and allow reconnect attempts
         if (iEventId == WIFI_EVENT_STA_DISCONNECTED) {
+            wifi_event_sta_disconnected_t *psEvent = (wifi_event_sta_disconnected_t *)pvEventData;
+
+            if (gbStaLinkUp) {
+
+                // A new outage: time it and start again on the cached AP
+                gbStaLinkUp = false;
+                gliConnectStartUs = esp_timer_get_time();
+
+                // Bring the AP back if the outage lasts
+                WifiMgr_ArmApTimer(gsApStopTimer, 0);
+                if (!gbApActive) {
+                    WifiMgr_ArmApTimer(gsApRestoreTimer, iProvApRestoreAfterOutageMs);
+                }
+                if (gbStaConfigured && !gbTargetedConnect && gsApHint.bValid) {
+                    (void)WifiMgr_ApplyStaConfig(true);
+                }
+            } else if (gbTargetedConnect) {
+
+                // The cached AP did not answer; fall back to a full scan
+                giTargetedFailures++;
+                if (giTargetedFailures >= iWifiTargetedConnectAttempts ||
+                    psEvent->reason == WIFI_REASON_NO_AP_FOUND) {
+                    ESP_LOGW(gTag, "Cached AP failed (reason %d), scanning all channels", (int)psEvent->reason);
+                    gsWifiStats.uiFallbacks++;
+                    (void)WifiMgr_ApplyStaConfig(false);
+                }
+            }
+
+            // A listen interval changed while linked is due now, before the next association
+            xSemaphoreTake(gsStaConfigMutex, portMAX_DELAY);
+            if (gbListenIntervalStale) {
+                WifiMgr_ApplyListenInterval();
+            }
+            xSemaphoreGive(gsStaConfigMutex);
+
             gbStaConnectInProgress = false;
             gbStaIpValid = false;
             gsStaIpStr[0] = '\0';
 
+            // Wake the retry task
             if (gsWifiEventGroup != NULL) {
                 xEventGroupClearBits(gsWifiEventGroup, WIFI_CONNECTED_BIT);
+                xEventGroupSetBits(gsWifiEventGroup, WIFI_DISCONNECTED_BIT);
             }
 
             WifiMgr_SetState(gbStaConfigured ? WIFI_MGR_STATE_CONNECTING : WIFI_MGR_STATE_PROVISIONING);
@@ -397,11 +1053,33 @@ static void WifiMgr_EventHandler(void *pvArg,
                        IPSTR, IP2STR(&psEvent->ip_info.ip));
         gbStaIpValid = true;
 
+        // Record how long this connection took, from boot or from the outage start
+        int64_t liNowUs = esp_timer_get_time();
+        gsWifiStats.liLastConnectUs = liNowUs - gliConnectStartUs;
+        if (gsWifiStats.liBootToIpUs == 0) {
+            gsWifiStats.liBootToIpUs = liNowUs;
+            BootTimeline_Mark(BOOT_STEP_FIRST_IP);
+        }
+        ESP_LOGI(gTag, "Got IP %s after %lld ms (%s, %s)", gsStaIpStr,
+                 (long long)(gsWifiStats.liLastConnectUs / 1000), gbTargetedConnect ? "cached AP" : "full scan",
+                 gsStaticIp.bValid ? "static" : "DHCP");
+
+        // A static address is only trusted once its gateway answers
+        if (gsStaticIp.bValid) {
+            WifiMgr_StartGatewayProbe();
+        }
+
         // Mark connected state for other modules
         if (gsWifiEventGroup != NULL) {
             xEventGroupSetBits(gsWifiEventGroup, WIFI_CONNECTED_BIT);
         }
 
+        // Outage over; the AP may go once the link has been stable for a while
+        WifiMgr_ArmApTimer(gsApRestoreTimer, 0);
+        if (gbApActive) {
+            WifiMgr_ArmApTimer(gsApStopTimer, iProvApStopAfterConnectedMs);
+        }
+
         WifiMgr_SetState(WIFI_MGR_STATE_CONNECTED);
 
         // Preserve AP access while STA is connected
@@ -420,9 +1098,10 @@ esp_err_t WifiMgr_Start(void)
     if (gsWifiEventGroup == NULL) {
         gsWifiEventGroup = xEventGroupCreate();
     }
+    if (gsStaConfigMutex == NULL) {
+        gsStaConfigMutex = xSemaphoreCreateMutex();
+    }
 
-    giRetryBackoffMs = 0;
-    gliLastConnectedMs = esp_timer_get_time() / 1000;
     giApClientCount = 0;
 
     // Ensure captive DNS is disabled until an AP client connects
@@ -432,6 +1111,7 @@ esp_err_t WifiMgr_Start(void)
 
     // Initialize Wi-Fi stack and start persistent AP
     ESP_ERROR_CHECK(WifiMgr_InitWifiStack());
+    WifiMgr_InitApPolicy();
     ESP_ERROR_CHECK(WifiMgr_StartWifiApSta());
 
     // Load credentials and configure STA if present
@@ -461,36 +1141,51 @@ esp_err_t WifiMgr_Start(void)
 
 static void WifiMgr_Task(void *pvArg)
 {
-    // Runs STA retry logic while keeping AP available at all times
-    // Avoids redundant connect calls when the driver is already connecting
-    // Remains resident so disconnect events can be recovered without reboot
+    // Reconnects the station after the driver reports a disconnect
+    // Blocks on event group bits and wakes only for a disconnect or an AP request
+    // Gives each attempt iWifiConnectTimeoutMs to reach an IP before forcing a fresh one
 
     (void)pvArg;
 
+    uint32_t uiBackoffMs = iWifiRetryBackoffMinMs;
+
     while (1) {
 
-        // Idle when connected to keep CPU usage low
-        if (WifiMgr_IsConnected()) {
+        // Sleep until the station drops or a connect attempt fails
+        (void)WifiMgr_WaitBits(WIFI_DISCONNECTED_BIT, portMAX_DELAY);
 
-            // Reset backoff while connected
-            giRetryBackoffMs = 0;
-            vTaskDelay(pdMS_TO_TICKS(1000));
+        while (!WifiMgr_IsConnected()) {
 
-        } else if (gbStaConfigured) {
+            // Back off, but stop early if the driver got connected meanwhile
+            uiBackoffMs = WifiMgr_NextBackoffMs(uiBackoffMs);
+            gsWifiStats.uiLastBackoffMs = uiBackoffMs;
+            gsWifiStats.liBackoffTotalUs += (int64_t)uiBackoffMs * 1000;
+            EventBits_t uiBits = WifiMgr_WaitBits(WIFI_CONNECTED_BIT, pdMS_TO_TICKS(uiBackoffMs));
+            if ((uiBits & WIFI_CONNECTED_BIT) != 0) {
+                break;
+            }
 
-            // Retry station connection with exponential backoff
-            ESP_LOGI(gTag, "Retry connect");
+            // Start one attempt and wait for its outcome
+            ESP_LOGI(gTag, "Retry connect after %lu ms", (unsigned long)uiBackoffMs);
+            xEventGroupClearBits(gsWifiEventGroup, WIFI_DISCONNECTED_BIT);
+            gsWifiStats.uiReconnectAttempts++;
             gbStaConnectInProgress = true;
+            int64_t liAttemptStartUs = esp_timer_get_time();
             (void)esp_wifi_connect();
-            WifiMgr_ApplyBackoffDelay();
 
-        } else {
+            uiBits = WifiMgr_WaitBits(WIFI_CONNECTED_BIT | WIFI_DISCONNECTED_BIT, pdMS_TO_TICKS(iWifiConnectTimeoutMs));
+            gsWifiStats.liLastAttemptUs = esp_timer_get_time() - liAttemptStartUs;
 
-            // Wait when connecting or when link exists but IP is not yet assigned
-            vTaskDelay(pdMS_TO_TICKS(500));
+            // Neither an IP nor a failure: drop the link so the next attempt starts clean
+            if ((uiBits & (WIFI_CONNECTED_BIT | WIFI_DISCONNECTED_BIT)) == 0) {
+                ESP_LOGW(gTag, "No IP after %d ms, restarting connection", iWifiConnectTimeoutMs);
+                gsWifiStats.uiConnectTimeouts++;
+                (void)esp_wifi_disconnect();
+            }
         }
 
-        // Maintain last-connected timestamp for future diagnostics
-        (void)gliLastConnectedMs;
+        // Connected: the next outage starts from the minimum delay again
+        xEventGroupClearBits(gsWifiEventGroup, WIFI_DISCONNECTED_BIT);
+        uiBackoffMs = iWifiRetryBackoffMinMs;
     }
 }
@@ -6,6 +6,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
 
 typedef enum
@@ -16,6 +17,35 @@ typedef enum
     WIFI_MGR_STATE_PROVISIONING
 } wifi_mgr_state_t;
 
+// Modem power-save profiles, in wifi_ps_type_t order; listen interval only matters for max-modem
+typedef enum
+{
+    WIFI_MGR_PS_NONE = 0,           // Radio always on; lowest latency
+    WIFI_MGR_PS_MIN_MODEM,          // Wakes for every DTIM beacon
+    WIFI_MGR_PS_MAX_MODEM,          // Wakes every iWifiPsListenInterval beacons
+    WIFI_MGR_PS_COUNT
+} wifi_mgr_ps_t;
+
+// Connection timing; targeted connects reuse the cached BSSID and channel
+typedef struct
+{
+    int64_t liBootToIpUs;           // Time from boot to the first IP, 0 until then
+    int64_t liLastConnectUs;        // Outage start (or boot) to IP for the latest connection
+    uint32_t uiTargetedConnects;    // Connections made on the cached AP without a scan
+    uint32_t uiScanConnects;        // Connections that needed the all-channel scan
+    uint32_t uiFallbacks;           // Times the cached AP failed and a full scan was used
+    bool bStaticIp;                 // The stored static IPv4 config is in use
+    uint32_t uiStaticIpFallbacks;   // Times the static gateway did not answer and DHCP took over
+    uint32_t uiReconnectAttempts;   // esp_wifi_connect calls made by the retry task
+    uint32_t uiConnectTimeouts;     // Attempts that reached neither an IP nor a failure in time
+    uint32_t uiLastBackoffMs;       // Delay before the latest attempt
+    int64_t liBackoffTotalUs;       // Time spent waiting between attempts since boot
+    int64_t liLastAttemptUs;        // esp_wifi_connect to IP, failure or timeout for the latest attempt
+    bool bApActive;                 // Provisioning AP is beaconing (APSTA rather than STA-only mode)
+    uint32_t uiApStops;             // Switches to STA-only mode
+    uint32_t uiApRestores;          // Switches back to APSTA after an outage or a request
+} wifi_mgr_stats_t;
+
 esp_err_t WifiMgr_Start(void);
 wifi_mgr_state_t WifiMgr_GetState(void);
 bool WifiMgr_IsConnected(void);
@@ -24,3 +54,17 @@ bool WifiMgr_IsConnected(void);
 // Returns current STA IPv4 address as dotted string. Returns true if valid.
 bool WifiMgr_GetStaIp(char *psOutIp, size_t stOutLen);
 
+void WifiMgr_GetStats(wifi_mgr_stats_t *psStatsOut);
+
+// Turns the provisioning AP on (held for iProvApManualHoldMs) or off; off needs a station IP.
+// The switch happens shortly after on the Wi-Fi task.
+esp_err_t WifiMgr_RequestAp(bool bOn);
+bool WifiMgr_IsApActive(void);
+
+// Applies a power-save profile now; the max-modem listen interval takes effect at the next association.
+// Does not store it; WifiMgr_LoadPowerSave returns the stored profile or iWifiPsDefaultProfile.
+esp_err_t WifiMgr_SetPowerSave(wifi_mgr_ps_t ePowerSave);
+wifi_mgr_ps_t WifiMgr_GetPowerSave(void);
+wifi_mgr_ps_t WifiMgr_LoadPowerSave(void);
+const char *WifiMgr_GetPowerSaveName(wifi_mgr_ps_t ePowerSave);
+
@@ -0,0 +1,567 @@
+// Chooses the Wi-Fi modem power-save profile at runtime and measures what each one costs in latency.
+// SSE and WebSocket subscribers hold the radio in no power save while attached, when enabled.
+// The benchmark pings the STA gateway under every profile in turn, then restores the chosen one.
+
+#include "wifi_power.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
+
+#include "lwip/inet.h"
+#include "ping/ping_sock.h"
+
+#include "json_writer.h"
+#include "rate_limit.h"
+#include "sse_stream.h"
+#include "storage.h"
+#include "wifi_prov.h"
+#include "ws_waveform.h"
+#include "app_config.h"
+
+static const char *gTag = "WIFI_PWR";
+
+// Upper bounds of the histogram buckets; the last bucket takes everything above
+static const uint32_t gauiBucketMs[iWifiPowerHistogramBuckets - 1] = { 5, 10, 20, 50, 100, 200, 500 };
+
+static wifi_mgr_ps_t geConfigured = WIFI_MGR_PS_MIN_MODEM;
+static volatile bool gbStreamingHold = false;
+static esp_timer_handle_t gsStreamTimer = NULL;
+
+// Benchmark state; results are copied in and out under the lock
+static portMUX_TYPE gsBenchLock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool gbBenchRunning = false;
+static TaskHandle_t gsBenchTask = NULL;
+static int giBenchCount = 0;
+static uint32_t guiBenchGateway = 0;
+static bool gbBenchApActive = false;
+static int64_t gliBenchStartedUs = 0;
+static wifi_power_bench_result_t gasBenchResults[WIFI_MGR_PS_COUNT];
+
+// Replies of the running ping session, written on the ping task until its end callback clears the flag
+static volatile bool gbBenchPingActive = false;
+static uint16_t gauiBenchRttMs[iWifiPsBenchMaxPings];
+static int giBenchReplies = 0;
+static uint32_t guiBenchSent = 0;
+
+// Rendered on the httpd task only, so one static buffer is enough
+static char gacPowerJson[1536];
+
+
+static void WifiPower_Apply(void)
+{
+    // Brings the driver to the stored profile, or to no power save while a subscriber streams
+    // Leaves the driver alone while the benchmark steps through the profiles
+    // A failed switch is retried on the next streaming check
+
+    if (gbBenchRunning) {
+        return;
+    }
+
+    wifi_mgr_ps_t eTarget = gbStreamingHold ? WIFI_MGR_PS_NONE : geConfigured;
+    if (eTarget == WifiMgr_GetPowerSave()) {
+        return;
+    }
+
+    esp_err_t eErr = WifiMgr_SetPowerSave(eTarget);
+    if (eErr != ESP_OK) {
+        ESP_LOGW(gTag, "Power save %s not applied (%s)", WifiMgr_GetPowerSaveName(eTarget), esp_err_to_name(eErr));
+        return;
+    }
+
+    ESP_LOGI(gTag, "Power save %s%s", WifiMgr_GetPowerSaveName(eTarget), gbStreamingHold ? " (streaming)" : "");
+}
+
+
+static void WifiPower_OnStreamCheck(void *pvArg)
+{
+    // Runs on the esp_timer task every iWifiPsStreamCheckMs
+    // Reads the subscriber counts that the stream modules keep for this purpose
+    // Switching happens only when the hold changes or a previous switch failed
+
+    (void)pvArg;
+
+    gbStreamingHold = (SseStream_GetClientCount() + WsWaveform_GetClientCount()) > 0;
+    WifiPower_Apply();
+}
+
+
+static void WifiPower_OnPingSuccess(esp_ping_handle_t sPing, void *pvArg)
+{
+    // Records one echo reply's round-trip time
+    // The ping task reports whole milliseconds
+    // Replies beyond the sample buffer are counted by the session but not kept
+
+    (void)pvArg;
+
+    uint32_t uiGapMs = 0;
+    (void)esp_ping_get_profile(sPing, ESP_PING_PROF_TIMEGAP, &uiGapMs, sizeof(uiGapMs));
+    if (giBenchReplies < iWifiPsBenchMaxPings) {
+        gauiBenchRttMs[giBenchReplies++] = (uint16_t)((uiGapMs > UINT16_MAX) ? UINT16_MAX : uiGapMs);
+    }
+}
+
+
+static void WifiPower_OnPingEnd(esp_ping_handle_t sPing, void *pvArg)
+{
+    // Runs on the ping task once every request has been answered or timed out
+    // Takes the request count and ends the session; also runs after esp_ping_stop
+    // Wakes the benchmark task to summarise this profile
+
+    (void)pvArg;
+
+    (void)esp_ping_get_profile(sPing, ESP_PING_PROF_REQUEST, &guiBenchSent, sizeof(guiBenchSent));
+    (void)esp_ping_delete_session(sPing);
+    gbBenchPingActive = false;
+
+    if (gsBenchTask != NULL) {
+        xTaskNotifyGive(gsBenchTask);
+    }
+}
+
+
+static int WifiPower_CompareRtt(const void *pvA, const void *pvB)
+{
+    // Orders RTT samples for the percentiles
+
+    return (int)*(const uint16_t *)pvA - (int)*(const uint16_t *)pvB;
+}
+
+
+static void WifiPower_Summarize(wifi_power_bench_result_t *psResult)
+{
+    // Turns the replies of one session into min, percentiles, max, mean and histogram
+    // Percentiles are nearest-rank over the replies; lost requests only lower the received count
+    // Sorts the sample buffer in place
+
+    memset(psResult, 0, sizeof(*psResult));
+    psResult->bMeasured = true;
+    psResult->uiSent = guiBenchSent;
+    psResult->uiReceived = (uint32_t)giBenchReplies;
+
+    int iCount = giBenchReplies;
+    if (iCount == 0) {
+        return;
+    }
+
+    qsort(gauiBenchRttMs, (size_t)iCount, sizeof(gauiBenchRttMs[0]), WifiPower_CompareRtt);
+
+    uint32_t uiTotalMs = 0;
+    for (int iIndex = 0; iIndex < iCount; iIndex++) {
+        uint32_t uiRttMs = gauiBenchRttMs[iIndex];
+        uiTotalMs += uiRttMs;
+
+        int iBucket = 0;
+        while (iBucket < iWifiPowerHistogramBuckets - 1 && uiRttMs > gauiBucketMs[iBucket]) {
+            iBucket++;
+        }
+        psResult->auiHistogram[iBucket]++;
+    }
+
+    psResult->uiMinMs = gauiBenchRttMs[0];
+    psResult->uiP50Ms = gauiBenchRttMs[(iCount * 50) / 100];
+    psResult->uiP90Ms = gauiBenchRttMs[(iCount * 90) / 100];
+    psResult->uiP99Ms = gauiBenchRttMs[(iCount * 99) / 100];
+    psResult->uiMaxMs = gauiBenchRttMs[iCount - 1];
+    psResult->fMeanMs = (float)uiTotalMs / (float)iCount;
+}
+
+
+static void WifiPower_BenchTask(void *pvArg)
+{
+    // Pings the gateway under none, min-modem and max-modem in turn
+    // Waits iWifiPsBenchSettleMs after each switch so the AP learns the new sleep state
+    // Restores the stored or streaming profile and deletes itself
+
+    (void)pvArg;
+
+    esp_netif_t *psStaNetif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    uint32_t uiWaitMs = (uint32_t)giBenchCount * (iWifiPsBenchIntervalMs + iWifiPsBenchTimeoutMs) + 5000;
+
+    for (int iProfile = 0; iProfile < WIFI_MGR_PS_COUNT; iProfile++) {
+        wifi_mgr_ps_t eProfile = (wifi_mgr_ps_t)iProfile;
+        if (WifiMgr_SetPowerSave(eProfile) != ESP_OK) {
+            continue;
+        }
+        vTaskDelay(pdMS_TO_TICKS(iWifiPsBenchSettleMs));
+
+        esp_ping_config_t sPingConfig = ESP_PING_DEFAULT_CONFIG();
+        ip_addr_set_ip4_u32_val(sPingConfig.target_addr, guiBenchGateway);
+        sPingConfig.count = (uint32_t)giBenchCount;
+        sPingConfig.interval_ms = iWifiPsBenchIntervalMs;
+        sPingConfig.timeout_ms = iWifiPsBenchTimeoutMs;
+        if (psStaNetif != NULL) {
+            sPingConfig.interface = (uint32_t)esp_netif_get_netif_impl_index(psStaNetif);
+        }
+
+        esp_ping_callbacks_t sCallbacks = {
+            .cb_args = NULL,
+            .on_ping_success = WifiPower_OnPingSuccess,
+            .on_ping_timeout = NULL,
+            .on_ping_end = WifiPower_OnPingEnd,
+        };
+
+        giBenchReplies = 0;
+        guiBenchSent = 0;
+        esp_ping_handle_t sPing = NULL;
+        if (esp_ping_new_session(&sPingConfig, &sCallbacks, &sPing) != ESP_OK) {
+            ESP_LOGW(gTag, "Benchmark ping not started");
+            break;
+        }
+        gbBenchPingActive = true;
+        if (esp_ping_start(sPing) != ESP_OK) {
+            (void)esp_ping_delete_session(sPing);
+            gbBenchPingActive = false;
+            break;
+        }
+
+        // Stop an overdue session; its end callback deletes it and frees the reply buffer
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(uiWaitMs)) == 0) {
+            ESP_LOGW(gTag, "Benchmark ping on %s did not finish, stopping it", WifiMgr_GetPowerSaveName(eProfile));
+            (void)esp_ping_stop(sPing);
+            if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(iWifiPsBenchIntervalMs + iWifiPsBenchTimeoutMs + 1000)) == 0) {
+                // Still writing replies; StartBench refuses new runs until the end callback arrives
+                ESP_LOGW(gTag, "Benchmark ping did not stop, run aborted");
+                break;
+            }
+            continue;
+        }
+
+        wifi_power_bench_result_t sResult;
+        WifiPower_Summarize(&sResult);
+        ESP_LOGI(gTag, "%s: %lu/%lu replies, p50 %lu ms, p99 %lu ms", WifiMgr_GetPowerSaveName(eProfile),
+                 (unsigned long)sResult.uiReceived, (unsigned long)sResult.uiSent,
+                 (unsigned long)sResult.uiP50Ms, (unsigned long)sResult.uiP99Ms);
+
+        portENTER_CRITICAL(&gsBenchLock);
+        gasBenchResults[iProfile] = sResult;
+        portEXIT_CRITICAL(&gsBenchLock);
+    }
+
+    gsBenchTask = NULL;
+    gbBenchRunning = false;
+    WifiPower_Apply();
+    vTaskDelete(NULL);
+}
+
+
+static esp_err_t WifiPower_StartBench(int iCount)
+{
+    // Starts a benchmark run with iCount pings per profile
+    // Needs a station IP, since the gateway is the ping target
+    // Clears the previous results so a partial run is never mixed with an old one
+
+    // A session left over from an aborted run may still write the reply buffer
+    if (gbBenchRunning || gbBenchPingActive) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_netif_t *psStaNetif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_ip_info_t sIpInfo = {0};
+    if (!WifiMgr_IsConnected() || psStaNetif == NULL || esp_netif_get_ip_info(psStaNetif, &sIpInfo) != ESP_OK ||
+        sIpInfo.gw.addr == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&gsBenchLock);
+    memset(gasBenchResults, 0, sizeof(gasBenchResults));
+    giBenchCount = iCount;
+    guiBenchGateway = sIpInfo.gw.addr;
+    gbBenchApActive = WifiMgr_IsApActive();
+    gliBenchStartedUs = esp_timer_get_time();
+    portEXIT_CRITICAL(&gsBenchLock);
+
+    gbBenchRunning = true;
+    if (xTaskCreate(WifiPower_BenchTask, "wifi_bench", 3072, NULL, 3, &gsBenchTask) != pdPASS) {
+        gsBenchTask = NULL;
+        gbBenchRunning = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(gTag, "Benchmark: %d pings per profile to " IPSTR, iCount, IP2STR(&sIpInfo.gw));
+    return ESP_OK;
+}
+
+
+static void WifiPower_WriteBench(json_writer_t *psWriter)
+{
+    // Writes the latest benchmark, or null before the first run
+    // Profiles not reached yet, or skipped, are left out of the array
+    // Histogram counts line up with bucketsMs plus one open-ended bucket
+
+    wifi_power_bench_result_t asResults[WIFI_MGR_PS_COUNT];
+    portENTER_CRITICAL(&gsBenchLock);
+    memcpy(asResults, gasBenchResults, sizeof(asResults));
+    int iCount = giBenchCount;
+    uint32_t uiGateway = guiBenchGateway;
+    bool bApActive = gbBenchApActive;
+    int64_t liStartedUs = gliBenchStartedUs;
+    portEXIT_CRITICAL(&gsBenchLock);
+
+    if (iCount == 0) {
+        JsonWriter_Null(psWriter);
+        return;
+    }
+
+    char sGateway[16];
+    esp_ip4_addr_t sGatewayAddr = { .addr = uiGateway };
+    (void)snprintf(sGateway, sizeof(sGateway), IPSTR, IP2STR(&sGatewayAddr));
+
+    JsonWriter_BeginObject(psWriter);
+    JsonWriter_Key(psWriter, "running");
+    JsonWriter_Bool(psWriter, gbBenchRunning);
+    JsonWriter_Key(psWriter, "startedUs");
+    JsonWriter_Int(psWriter, liStartedUs);
+    JsonWriter_Key(psWriter, "count");
+    JsonWriter_Int(psWriter, iCount);
+    JsonWriter_Key(psWriter, "target");
+    JsonWriter_String(psWriter, sGateway);
+    JsonWriter_Key(psWriter, "apActive");
+    JsonWriter_Bool(psWriter, bApActive);
+    JsonWriter_Key(psWriter, "bucketsMs");
+    JsonWriter_BeginArray(psWriter);
+    for (int iBucket = 0; iBucket < iWifiPowerHistogramBuckets - 1; iBucket++) {
+        JsonWriter_Uint(psWriter, gauiBucketMs[iBucket]);
+    }
+    JsonWriter_EndArray(psWriter);
+
+    JsonWriter_Key(psWriter, "profiles");
+    JsonWriter_BeginArray(psWriter);
+    for (int iProfile = 0; iProfile < WIFI_MGR_PS_COUNT; iProfile++) {
+        const wifi_power_bench_result_t *psResult = &asResults[iProfile];
+        if (!psResult->bMeasured) {
+            continue;
+        }
+
+        JsonWriter_BeginObject(psWriter);
+        JsonWriter_Key(psWriter, "profile");
+        JsonWriter_String(psWriter, WifiMgr_GetPowerSaveName((wifi_mgr_ps_t)iProfile));
+        JsonWriter_Key(psWriter, "sent");
+        JsonWriter_Uint(psWriter, psResult->uiSent);
+        JsonWriter_Key(psWriter, "received");
+        JsonWriter_Uint(psWriter, psResult->uiReceived);
+        JsonWriter_Key(psWriter, "minMs");
+        JsonWriter_Uint(psWriter, psResult->uiMinMs);
+        JsonWriter_Key(psWriter, "p50Ms");
+        JsonWriter_Uint(psWriter, psResult->uiP50Ms);
+        JsonWriter_Key(psWriter, "p90Ms");
+        JsonWriter_Uint(psWriter, psResult->uiP90Ms);
+        JsonWriter_Key(psWriter, "p99Ms");
+        JsonWriter_Uint(psWriter, psResult->uiP99Ms);
+        JsonWriter_Key(psWriter, "maxMs");
+        JsonWriter_Uint(psWriter, psResult->uiMaxMs);
+        JsonWriter_Key(psWriter, "meanMs");
+        JsonWriter_Float(psWriter, psResult->fMeanMs, 1);
+        JsonWriter_Key(psWriter, "histogram");
+        JsonWriter_BeginArray(psWriter);
+        for (int iBucket = 0; iBucket < iWifiPowerHistogramBuckets; iBucket++) {
+            JsonWriter_Uint(psWriter, psResult->auiHistogram[iBucket]);
+        }
+        JsonWriter_EndArray(psWriter);
+        JsonWriter_EndObject(psWriter);
+    }
+    JsonWriter_EndArray(psWriter);
+    JsonWriter_EndObject(psWriter);
+}
+
+
+static esp_err_t WifiPower_SendState(httpd_req_t *psReq)
+{
+    // Renders the profile state and the latest benchmark
+    // "sleeping" tells whether modem sleep can act at all, which needs the AP off
+    // Shared by GET and POST
+
+    wifi_power_state_t sState;
+    WifiPower_GetState(&sState);
+    bool bApActive = WifiMgr_IsApActive();
+
+    json_writer_t sWriter;
+    JsonWriter_InitBuffer(&sWriter, gacPowerJson, sizeof(gacPowerJson));
+    JsonWriter_BeginObject(&sWriter);
+    JsonWriter_Key(&sWriter, "profile");
+    JsonWriter_String(&sWriter, WifiMgr_GetPowerSaveName(sState.eConfigured));
+    JsonWriter_Key(&sWriter, "applied");
+    JsonWriter_String(&sWriter, WifiMgr_GetPowerSaveName(sState.eApplied));
+    JsonWriter_Key(&sWriter, "listenInterval");
+    JsonWriter_Int(&sWriter, iWifiPsListenInterval);
+    JsonWriter_Key(&sWriter, "streamingHold");
+    JsonWriter_Bool(&sWriter, sState.bStreamingHold);
+    JsonWriter_Key(&sWriter, "apActive");
+    JsonWriter_Bool(&sWriter, bApActive);
+    JsonWriter_Key(&sWriter, "sleeping");
+    JsonWriter_Bool(&sWriter, !bApActive && sState.eApplied != WIFI_MGR_PS_NONE);
+    JsonWriter_Key(&sWriter, "bench");
+    WifiPower_WriteBench(&sWriter);
+    JsonWriter_EndObject(&sWriter);
+
+    int iLen = JsonWriter_Finish(&sWriter);
+    if (iLen < 0 || iLen >= (int)sizeof(gacPowerJson)) {
+        return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Render failed");
+    }
+
+    httpd_resp_set_type(psReq, "application/json");
+    httpd_resp_set_hdr(psReq, "Cache-Control", "no-store");
+    return httpd_resp_send(psReq, gacPowerJson, iLen);
+}
+
+
+static esp_err_t WifiPower_HandleGet(httpd_req_t *psReq)
+{
+    // Returns the stored and applied profile and the latest benchmark
+    // Poll it while a benchmark runs; profiles appear as they finish
+    // Small and cheap, so it is charged to the cheap rate-limit class
+
+    if (!RateLimit_Admit(psReq, RATE_LIMIT_CHEAP)) {
+        return ESP_OK;
+    }
+
+    return WifiPower_SendState(psReq);
+}
+
+
+static esp_err_t WifiPower_HandlePost(httpd_req_t *psReq)
+{
+    // Accepts a form with profile=none|min|max and/or bench=<pings per profile>
+    // A new profile is stored and applied unless a streaming client or the benchmark holds the radio
+    // Replies with the same document as GET /api/wifi/power
+
+    // Read the request body
+    int iBodyLen = psReq->content_len;
+    if (iBodyLen < 0 || iBodyLen > 64) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "Bad request");
+    }
+
+    // A body can arrive split across TCP segments, so read until content_len bytes are in
+    char sBody[65];
+    int iReceivedLen = 0;
+    while (iReceivedLen < iBodyLen) {
+        int iChunkLen = httpd_req_recv(psReq, sBody + iReceivedLen, (size_t)(iBodyLen - iReceivedLen));
+        if (iChunkLen == HTTPD_SOCK_ERR_TIMEOUT) {
+            return httpd_resp_send_err(psReq, HTTPD_408_REQ_TIMEOUT, "Body timed out");
+        }
+        if (iChunkLen <= 0) {
+            return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Read failed");
+        }
+        iReceivedLen += iChunkLen;
+    }
+    sBody[iReceivedLen] = '\0';
+
+    // Parse fields
+    char sProfile[8];
+    char sBench[8];
+    WifiProv_ExtractFormField(sBody, "profile", sProfile, sizeof(sProfile));
+    WifiProv_ExtractFormField(sBody, "bench", sBench, sizeof(sBench));
+
+    // Validate
+    int iProfile = -1;
+    for (int iIndex = 0; iIndex < WIFI_MGR_PS_COUNT && sProfile[0] != '\0'; iIndex++) {
+        if (strcmp(sProfile, WifiMgr_GetPowerSaveName((wifi_mgr_ps_t)iIndex)) == 0) {
+            iProfile = iIndex;
+        }
+    }
+    if (sProfile[0] != '\0' && iProfile < 0) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "profile must be none, min or max");
+    }
+    int iBench = atoi(sBench);
+    if (sBench[0] != '\0' && (iBench <= 0 || iBench > iWifiPsBenchMaxPings)) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "bench out of range");
+    }
+
+    // Persist and apply the profile
+    if (iProfile >= 0) {
+        esp_err_t eErr = Storage_SaveWifiPowerSave((uint8_t)iProfile);
+        if (eErr != ESP_OK) {
+            ESP_LOGE(gTag, "Save profile failed (%s)", esp_err_to_name(eErr));
+            return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
+        }
+        geConfigured = (wifi_mgr_ps_t)iProfile;
+        WifiPower_Apply();
+    }
+
+    if (iBench > 0) {
+        esp_err_t eErr = WifiPower_StartBench(iBench);
+        if (eErr != ESP_OK) {
+            httpd_resp_set_status(psReq, "409 Conflict");
+            httpd_resp_set_type(psReq, "application/json");
+            return httpd_resp_sendstr(psReq, gbBenchRunning ? "{\"error\":\"benchmark already running\"}"
+                                                            : "{\"error\":\"no station IP\"}");
+        }
+    }
+
+    return WifiPower_SendState(psReq);
+}
+
+
+esp_err_t WifiPower_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Registers GET and POST /api/wifi/power on the shared HTTP server
+    // Takes over the stored profile that WifiMgr applied at driver init
+    // Starts the periodic subscriber check when the streaming override is enabled
+
+    if (sHttpServer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    geConfigured = WifiMgr_LoadPowerSave();
+
+    if (bWifiPsLowLatencyWhileStreaming && gsStreamTimer == NULL) {
+        esp_timer_create_args_t sTimerArgs = {
+            .callback = WifiPower_OnStreamCheck,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "wifi_ps",
+            .skip_unhandled_events = true,
+        };
+        esp_err_t eErr = esp_timer_create(&sTimerArgs, &gsStreamTimer);
+        if (eErr == ESP_OK) {
+            eErr = esp_timer_start_periodic(gsStreamTimer, (uint64_t)iWifiPsStreamCheckMs * 1000);
+        }
+        if (eErr != ESP_OK) {
+            return eErr;
+        }
+    }
+
+    // Register GET /api/wifi/power
+    httpd_uri_t sGetUri = {
+        .uri = "/api/wifi/power",
+        .method = HTTP_GET,
+        .handler = WifiPower_HandleGet,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sGetUri));
+
+    // Register POST /api/wifi/power
+    httpd_uri_t sPostUri = {
+        .uri = "/api/wifi/power",
+        .method = HTTP_POST,
+        .handler = WifiPower_HandlePost,
+        .user_ctx = NULL
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sPostUri));
+
+    return ESP_OK;
+}
+
+
+void WifiPower_GetState(wifi_power_state_t *psStateOut)
+{
+    // Copies the stored and applied profile and what currently overrides it
+    // Used by the API and /metrics
+    // Plain reads; a torn read only skews one scrape
+
+    if (psStateOut == NULL) {
+        return;
+    }
+
+    psStateOut->eConfigured = geConfigured;
+    psStateOut->eApplied = WifiMgr_GetPowerSave();
+    psStateOut->bStreamingHold = gbStreamingHold;
+    psStateOut->bBenchRunning = gbBenchRunning;
+}
@@ -0,0 +1,42 @@
+// Declares the Wi-Fi power-save controller and its round-trip benchmark.
+// The stored profile is switched at runtime through /api/wifi/power and overridden while streaming.
+// The benchmark pings the STA gateway under every profile and keeps the RTT distribution.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+#include "wifi_mgr.h"
+
+// RTT histogram buckets: <= 5, 10, 20, 50, 100, 200, 500 ms and above
+#define iWifiPowerHistogramBuckets      8
+
+typedef struct
+{
+    wifi_mgr_ps_t eConfigured;      // Stored profile chosen through the API or the build default
+    wifi_mgr_ps_t eApplied;         // Profile in the driver right now
+    bool bStreamingHold;            // A streaming client forces no power save
+    bool bBenchRunning;
+} wifi_power_state_t;
+
+// RTT distribution of one profile from the latest benchmark
+typedef struct
+{
+    bool bMeasured;
+    uint32_t uiSent;
+    uint32_t uiReceived;
+    uint32_t uiMinMs;
+    uint32_t uiP50Ms;
+    uint32_t uiP90Ms;
+    uint32_t uiP99Ms;
+    uint32_t uiMaxMs;
+    float fMeanMs;
+    uint32_t auiHistogram[iWifiPowerHistogramBuckets];
+} wifi_power_bench_result_t;
+
+// Loads the stored profile, starts the streaming check and registers GET and POST /api/wifi/power
+esp_err_t WifiPower_RegisterHandlers(httpd_handle_t sHttpServer);
+
+void WifiPower_GetState(wifi_power_state_t *psStateOut);
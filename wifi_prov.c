@@ -7,6 +7,7 @@
 #include <string.h>
 
 #include "esp_log.h"
+#include "esp_netif.h"
 #include "esp_system.h"
 
 #include "freertos/FreeRTOS.h"
@@ -14,6 +15,7 @@
 
 #include "storage.h"
 #include "wifi_mgr.h"
+#include "web_assets.h"
 
 static const char *gTag = "WIFI_PROV";
 
@@ -61,8 +63,8 @@ static void WifiProv_UrlDecode(const char *sSrc, char *sDst, size_t iDstSize)
 }
 
 
-static void WifiProv_ExtractFormField(const char *sBody, const char *sKey,
-                                      char *sOutVal, size_t iOutSize)
+void WifiProv_ExtractFormField(const char *sBody, const char *sKey,
+                               char *sOutVal, size_t iOutSize)
 {
     // Extracts a single key=value field from an HTTP form body
     // Performs URL decoding into the provided output buffer
@@ -102,65 +104,85 @@ static void WifiProv_ExtractFormField(const char *sBody, const char *sKey,
 }
 
 
+static const char *WifiProv_ParseStaticIp(const char *sBody, sta_ip_config_t *psConfigOut)
+{
+    // Reads the optional static IP fields from the form body
+    // An empty address selects DHCP; otherwise netmask and gateway are required
+    // Returns a message for the 400 response, or NULL when the fields are usable
+
+    char sIp[16];
+    char sMask[16];
+    char sGateway[16];
+    char sDns[16];
+    WifiProv_ExtractFormField(sBody, "static_ip", sIp, sizeof(sIp));
+    WifiProv_ExtractFormField(sBody, "static_mask", sMask, sizeof(sMask));
+    WifiProv_ExtractFormField(sBody, "static_gw", sGateway, sizeof(sGateway));
+    WifiProv_ExtractFormField(sBody, "static_dns", sDns, sizeof(sDns));
+
+    memset(psConfigOut, 0, sizeof(*psConfigOut));
+    if (sIp[0] == '\0') {
+        return NULL;
+    }
+
+    // Parse the dotted-quad addresses
+    esp_ip4_addr_t sIpAddr;
+    esp_ip4_addr_t sMaskAddr;
+    esp_ip4_addr_t sGatewayAddr;
+    esp_ip4_addr_t sDnsAddr;
+    if (esp_netif_str_to_ip4(sIp, &sIpAddr) != ESP_OK || sIpAddr.addr == 0) {
+        return "Static IP is not a valid address";
+    }
+    if (esp_netif_str_to_ip4(sMask, &sMaskAddr) != ESP_OK) {
+        return "Netmask required with a static IP";
+    }
+    if (esp_netif_str_to_ip4(sGateway, &sGatewayAddr) != ESP_OK) {
+        return "Gateway required with a static IP";
+    }
+
+    // DNS is optional; routers usually answer on the gateway address
+    sDnsAddr = sGatewayAddr;
+    if (sDns[0] != '\0' && esp_netif_str_to_ip4(sDns, &sDnsAddr) != ESP_OK) {
+        return "DNS is not a valid address";
+    }
+
+    // The mask must be contiguous and leave room for hosts (at most /30)
+    uint32_t uiHostBits = ~esp_netif_htonl(sMaskAddr.addr);
+    if ((uiHostBits & (uiHostBits + 1)) != 0 || uiHostBits < 3) {
+        return "Netmask is not valid";
+    }
+
+    // The address must be a host on the gateway's subnet
+    uint32_t uiIpHost = esp_netif_htonl(sIpAddr.addr) & uiHostBits;
+    if (uiIpHost == 0 || uiIpHost == uiHostBits) {
+        return "Static IP is the network or broadcast address";
+    }
+    if ((sIpAddr.addr & sMaskAddr.addr) != (sGatewayAddr.addr & sMaskAddr.addr) ||
+        sGatewayAddr.addr == sIpAddr.addr) {
+        return "Gateway must be another address on the same subnet";
+    }
+
+    psConfigOut->uiIp = sIpAddr.addr;
+    psConfigOut->uiNetmask = sMaskAddr.addr;
+    psConfigOut->uiGateway = sGatewayAddr.addr;
+    psConfigOut->uiDns = sDnsAddr.addr;
+    psConfigOut->bValid = true;
+    return NULL;
+}
+
+
 static esp_err_t WifiProv_HandleGet(httpd_req_t *psReq)
 {
-    // Serves the provisioning HTML form
+    // Serves the provisioning form embedded from www/provision.html
     // Provides a mobile-friendly layout and password visibility toggle
     // Guides the user through saving credentials and rebooting
 
-    // Responsive and self-contained HTML/CSS/JS
-    const char *sHtml =
-        "<!doctype html><html><head>"
-        "<meta name='viewport' content='width=device-width,initial-scale=1'>"
-        "<title>WiFi Provision</title>"
-        "<style>"
-        "body{margin:0;font-family:system-ui,-apple-system,Segoe UI,Roboto,Arial;"
-        "background:#0b0f14;color:#e9eef6;display:flex;min-height:100vh;align-items:center;"
-        "justify-content:center;padding:24px}"
-        ".card{width:min(520px,100%);background:#121a24;border:1px solid #1f2b3a;"
-        "border-radius:18px;box-shadow:0 12px 30px rgba(0,0,0,.35);padding:22px}"
-        "h1{font-size:clamp(20px,4.5vw,28px);margin:0 0 10px}"
-        ".muted{color:#a9b4c2;font-size:clamp(13px,3.4vw,14px);line-height:1.35}"
-        "label{display:block;margin:16px 0 6px;font-size:14px;color:#cfd8e5}"
-        "input{width:100%;box-sizing:border-box;padding:14px 12px;border-radius:12px;"
-        "border:1px solid #2a3a50;background:#0f1620;color:#e9eef6;font-size:16px}"
-        ".row{display:flex;gap:10px;align-items:stretch}"
-        ".row input{flex:1}"
-        ".btn{border:0;border-radius:12px;padding:14px 14px;font-size:16px;"
-        "cursor:pointer;color:#0b0f14;background:#7dd3fc;white-space:nowrap}"
-        ".btn2{background:#1f2b3a;color:#e9eef6;border:1px solid #2a3a50}"
-        ".actions{display:flex;gap:10px;margin-top:18px}"
-        "small{display:block;margin-top:12px;color:#9fb0c6}"
-        "</style></head><body><div class='card'>"
-        "<h1>Configure WiFi</h1>"
-        "<div class='muted'>Enter your router SSID and password. The device will connect in the background after saving.</div>"
-        "<form method='POST' action='/provision' autocomplete='off'>"
-        "<label for='ssid'>SSID</label>"
-        "<input id='ssid' name='ssid' maxlength='32' placeholder='Your WiFi name' required>"
-        "<label for='pass'>Password</label>"
-        "<div class='row'>"
-        "<input id='pass' name='pass' type='password' maxlength='64' placeholder='WiFi password'>"
-        "<button class='btn btn2' type='button' onclick='t()' id='tbtn'>Show</button>"
-        "</div>"
-        "<div class='actions'>"
-        "<button class='btn' type='submit'>Save</button>"
-        "</div>"
-        "<small>Tip: The device will get an IP from your router once connected.</small>"
-        "</form>"
-        "<script>function t(){const p=document.getElementById('pass');"
-        "const b=document.getElementById('tbtn');"
-        "if(p.type==='password'){p.type='text';b.textContent='Hide';}"
-        "else{p.type='password';b.textContent='Show';}};</script>"
-        "</div></body></html>";
-
-    httpd_resp_set_type(psReq, "text/html");
-    return httpd_resp_send(psReq, sHtml, HTTPD_RESP_USE_STRLEN);
+    return WebAssets_Send(psReq, WEB_ASSET_PROVISION);
 }
 
 
 static esp_err_t WifiProv_HandlePost(httpd_req_t *psReq)
 {
-    // Saves posted Wi-Fi credentials to non-volatile storage.
+    // Saves posted Wi-Fi credentials and optional static IP settings to non-volatile storage.
     // Redirects the browser to an IP status page to avoid form resubmits.
     // Leaves STA connection handling to the background Wi-Fi manager.
 
@@ -186,6 +208,13 @@ static esp_err_t WifiProv_HandlePost(httpd_req_t *psReq)
         return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, "SSID required");
     }
 
+    // Validate static IP fields before anything is written
+    sta_ip_config_t sStaticIp;
+    const char *sIpError = WifiProv_ParseStaticIp(sBody, &sStaticIp);
+    if (sIpError != NULL) {
+        return httpd_resp_send_err(psReq, HTTPD_400_BAD_REQUEST, sIpError);
+    }
+
     // Store credentials into NVS
     wifi_creds_t sCreds;
     memset(&sCreds, 0, sizeof(sCreds));
@@ -199,6 +228,13 @@ static esp_err_t WifiProv_HandlePost(httpd_req_t *psReq)
         return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
     }
 
+    // Store or erase the static IP; it applies from the next boot like the credentials
+    eSaveErr = Storage_SaveStaticIp(&sStaticIp);
+    if (eSaveErr != ESP_OK) {
+        ESP_LOGE(gTag, "Save static IP failed (%s)", esp_err_to_name(eSaveErr));
+        return httpd_resp_send_err(psReq, HTTPD_500_INTERNAL_SERVER_ERROR, "Save failed");
+    }
+
     // Redirect to the IP status page
     httpd_resp_set_status(psReq, "303 See Other");
     httpd_resp_set_hdr(psReq, "Location", "/api/ips");
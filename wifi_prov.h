@@ -4,7 +4,12 @@
 
 #pragma once
 
+#include <stddef.h>
 #include "esp_err.h"
 #include "esp_http_server.h"
 
 esp_err_t WifiProv_RegisterHandlers(httpd_handle_t sHttpServer);
+
+// Extracts one URL-decoded field from an application/x-www-form-urlencoded body
+void WifiProv_ExtractFormField(const char *sBody, const char *sKey,
+                               char *sOutVal, size_t iOutSize);
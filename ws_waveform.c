@@ -0,0 +1,477 @@
+// Implements /ws/waveform, a WebSocket stream of every captured ADC window.
+// Captures windows at a fixed rate while subscribers exist and renders one frame per profile.
+// Shares refcounted frame buffers between clients and drops frames for clients still sending.
+
+#include "ws_waveform.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "adc.h"
+#include "app_config.h"
+
+static const char *gTag = "WS_WAVE";
+
+#if CONFIG_HTTPD_WS_SUPPORT
+
+#define iWsFrameMaxBytes                (iWsFrameHeaderBytes + (2 * iSamples_PerCh * (int)sizeof(int16_t)))
+#define iWsChannelMaskAll               0x03
+
+typedef struct
+{
+    uint8_t auData[iWsFrameMaxBytes];
+    size_t szLength;
+    int iRefCount;
+    uint8_t uiChannelMask;
+    uint16_t uiDecimation;
+} ws_frame_t;
+
+typedef struct
+{
+    int iSockFd;
+    uint8_t uiChannelMask;
+    uint16_t uiDecimation;
+    ws_frame_t *psInFlight;
+    uint32_t uiDroppedFrames;
+} ws_client_t;
+
+typedef struct
+{
+    ws_client_t *psClient;
+    ws_frame_t *psFrame;
+    int iSockFd;
+} ws_send_t;
+
+static httpd_handle_t gsHttpServer = NULL;
+static SemaphoreHandle_t gsWsMutex = NULL;
+static TaskHandle_t gsStreamTask = NULL;
+static ws_client_t gasClients[iWsMaxClients];
+static ws_frame_t gasFrames[iWsFramePoolSize];
+static int giClientCount = 0;
+
+// Stream-task capture buffers for one full window
+static int16_t gaiChannelA_mV[iSamples_PerCh];
+static int16_t gaiChannelB_mV[iSamples_PerCh];
+
+
+static void WsWaveform_PutLe16(uint8_t *puOut, uint16_t uiValue)
+{
+    // Stores a 16-bit value in little-endian byte order
+    // Keeps the frame layout independent of host endianness
+    // Writes exactly two bytes
+
+    puOut[0] = (uint8_t)(uiValue & 0xFF);
+    puOut[1] = (uint8_t)(uiValue >> 8);
+}
+
+
+static void WsWaveform_ParseSettings(const char *sQuery, uint16_t *puiDecimation, uint8_t *puiChannelMask)
+{
+    // Reads decim and mask from a query-style string such as "decim=4&mask=3"
+    // Leaves a setting unchanged when its key is missing
+    // Clamps values into the supported ranges
+
+    char sValue[8];
+
+    if (httpd_query_key_value(sQuery, "decim", sValue, sizeof(sValue)) == ESP_OK) {
+        long lDecimation = strtol(sValue, NULL, 10);
+        if (lDecimation < 1) lDecimation = 1;
+        if (lDecimation > iWsMaxDecimation) lDecimation = iWsMaxDecimation;
+        *puiDecimation = (uint16_t)lDecimation;
+    }
+
+    if (httpd_query_key_value(sQuery, "mask", sValue, sizeof(sValue)) == ESP_OK) {
+        long lMask = strtol(sValue, NULL, 10) & iWsChannelMaskAll;
+        *puiChannelMask = (uint8_t)((lMask == 0) ? iWsChannelMaskAll : lMask);
+    }
+}
+
+
+static void WsWaveform_RenderFrame(ws_frame_t *psFrame, uint8_t uiChannelMask, uint16_t uiDecimation,
+                                   int iSamples, int64_t liTimestampUs)
+{
+    // Renders one binary frame for a decimation and channel mask profile
+    // Picks every Nth sample of the filtered window for each selected channel
+    // Writes the header and samples little-endian into the frame buffer
+
+    int iOutSamples = (iSamples + uiDecimation - 1) / uiDecimation;
+    uint8_t *puOut = psFrame->auData;
+
+    // Header
+    puOut[0] = iWsFrameVersion;
+    puOut[1] = uiChannelMask;
+    WsWaveform_PutLe16(&puOut[2], uiDecimation);
+    WsWaveform_PutLe16(&puOut[4], (uint16_t)iOutSamples);
+    WsWaveform_PutLe16(&puOut[6], 0);
+    uint64_t uliTimestamp = (uint64_t)liTimestampUs;
+    for (int iByte = 0; iByte < 8; iByte++) {
+        puOut[8 + iByte] = (uint8_t)(uliTimestamp >> (8 * iByte));
+    }
+    puOut += iWsFrameHeaderBytes;
+
+    // Channel blocks
+    const int16_t *apiChannels[2] = { gaiChannelA_mV, gaiChannelB_mV };
+    for (int iChannel = 0; iChannel < 2; iChannel++) {
+        if ((uiChannelMask & (1u << iChannel)) == 0) {
+            continue;
+        }
+        for (int iIndex = 0; iIndex < iSamples; iIndex += uiDecimation) {
+            WsWaveform_PutLe16(puOut, (uint16_t)apiChannels[iChannel][iIndex]);
+            puOut += 2;
+        }
+    }
+
+    psFrame->szLength = (size_t)(puOut - psFrame->auData);
+    psFrame->uiChannelMask = uiChannelMask;
+    psFrame->uiDecimation = uiDecimation;
+}
+
+
+static void WsWaveform_ReleaseLocked(ws_client_t *psClient, bool bRemove)
+{
+    // Drops the in-flight frame reference held by one client
+    // Frees the client slot as well when the connection is gone
+    // Must be called with the stream mutex held
+
+    if (psClient->psInFlight != NULL) {
+        psClient->psInFlight->iRefCount--;
+        psClient->psInFlight = NULL;
+    }
+
+    if (bRemove && psClient->iSockFd >= 0) {
+        ESP_LOGI(gTag, "Subscriber on socket %d left (%u frames dropped)",
+                 psClient->iSockFd, (unsigned)psClient->uiDroppedFrames);
+        psClient->iSockFd = -1;
+        giClientCount--;
+    }
+}
+
+
+static void WsWaveform_OnSent(esp_err_t eErr, int iSockFd, void *pvArg)
+{
+    // Runs on the httpd task once an async frame send has finished
+    // Returns the shared frame reference so the buffer can be reused
+    // Removes the client when the send failed
+
+    ws_client_t *psClient = (ws_client_t *)pvArg;
+
+    xSemaphoreTake(gsWsMutex, portMAX_DELAY);
+    bool bSameClient = (psClient->iSockFd == iSockFd);
+    WsWaveform_ReleaseLocked(psClient, (eErr != ESP_OK) && bSameClient);
+    xSemaphoreGive(gsWsMutex);
+}
+
+
+static ws_frame_t *WsWaveform_AcquireFrameLocked(void)
+{
+    // Finds a pooled frame that no client references any more
+    // Returns NULL when every buffer is still queued on some socket
+    // Must be called with the stream mutex held
+
+    for (int iIndex = 0; iIndex < iWsFramePoolSize; iIndex++) {
+        if (gasFrames[iIndex].iRefCount == 0) {
+            return &gasFrames[iIndex];
+        }
+    }
+    return NULL;
+}
+
+
+static void WsWaveform_Broadcast(int iSamples, int64_t liTimestampUs)
+{
+    // Hands the freshly captured window to every ready subscriber
+    // Renders each distinct decimation/mask profile once and shares it by refcount
+    // Drops the frame for clients whose previous frame is still being sent
+
+    ws_send_t asSends[iWsMaxClients];
+    ws_frame_t *apsRound[iWsMaxClients];
+    int iSendCount = 0;
+    int iRoundCount = 0;
+
+    xSemaphoreTake(gsWsMutex, portMAX_DELAY);
+
+    for (int iIndex = 0; iIndex < iWsMaxClients; iIndex++) {
+        ws_client_t *psClient = &gasClients[iIndex];
+        if (psClient->iSockFd < 0) {
+            continue;
+        }
+
+        // Forget clients whose socket is no longer a WebSocket
+        if (httpd_ws_get_fd_info(gsHttpServer, psClient->iSockFd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+            if (psClient->psInFlight == NULL) {
+                WsWaveform_ReleaseLocked(psClient, true);
+            }
+            continue;
+        }
+
+        // Back-pressure: never queue more than one frame per client
+        if (psClient->psInFlight != NULL) {
+            psClient->uiDroppedFrames++;
+            continue;
+        }
+
+        // Reuse a frame rendered this round for the same profile
+        ws_frame_t *psFrame = NULL;
+        for (int iRound = 0; iRound < iRoundCount; iRound++) {
+            if (apsRound[iRound]->uiChannelMask == psClient->uiChannelMask &&
+                apsRound[iRound]->uiDecimation == psClient->uiDecimation) {
+                psFrame = apsRound[iRound];
+                break;
+            }
+        }
+
+        if (psFrame == NULL) {
+            psFrame = WsWaveform_AcquireFrameLocked();
+            if (psFrame == NULL) {
+                psClient->uiDroppedFrames++;
+                continue;
+            }
+            WsWaveform_RenderFrame(psFrame, psClient->uiChannelMask, psClient->uiDecimation,
+                                   iSamples, liTimestampUs);
+            apsRound[iRoundCount++] = psFrame;
+        }
+
+        psFrame->iRefCount++;
+        psClient->psInFlight = psFrame;
+        asSends[iSendCount].psClient = psClient;
+        asSends[iSendCount].psFrame = psFrame;
+        asSends[iSendCount].iSockFd = psClient->iSockFd;
+        iSendCount++;
+    }
+
+    xSemaphoreGive(gsWsMutex);
+
+    // Queue sends outside the lock; completion runs WsWaveform_OnSent
+    for (int iIndex = 0; iIndex < iSendCount; iIndex++) {
+        httpd_ws_frame_t sFrame = {
+            .final = true,
+            .fragmented = false,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = asSends[iIndex].psFrame->auData,
+            .len = asSends[iIndex].psFrame->szLength
+        };
+
+        esp_err_t eErr = httpd_ws_send_data_async(gsHttpServer, asSends[iIndex].iSockFd, &sFrame,
+                                                  WsWaveform_OnSent, asSends[iIndex].psClient);
+        if (eErr != ESP_OK) {
+            xSemaphoreTake(gsWsMutex, portMAX_DELAY);
+            WsWaveform_ReleaseLocked(asSends[iIndex].psClient, true);
+            xSemaphoreGive(gsWsMutex);
+        }
+    }
+}
+
+
+static void WsWaveform_StreamTask(void *pvArg)
+{
+    // Captures windows at iWsFrameIntervalMs, or slower to respect iWsMaxCaptureDutyPercent
+    // Sleeps on a task notification while nobody is listening
+    // Leaves the periodic RMS measurement and its caches untouched
+
+    (void)pvArg;
+
+    TickType_t uiLastWake = xTaskGetTickCount();
+    TickType_t uiPeriod = pdMS_TO_TICKS(iWsFrameIntervalMs);
+
+    while (1) {
+
+        // Idle until the first subscriber connects
+        if (giClientCount == 0) {
+            (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            uiLastWake = xTaskGetTickCount();
+            continue;
+        }
+
+        vTaskDelayUntil(&uiLastWake, uiPeriod);
+
+        // Capture one window and fan it out
+        int64_t liTimestampUs = 0;
+        TickType_t uiCaptureStart = xTaskGetTickCount();
+        esp_err_t eErr = Adc_CaptureWindowMilliVolts(gaiChannelA_mV, gaiChannelB_mV, iSamples_PerCh,
+                                                     &liTimestampUs);
+
+        // Stretch the period so capture windows stay within iWsMaxCaptureDutyPercent
+        TickType_t uiCaptureTicks = xTaskGetTickCount() - uiCaptureStart;
+        uiPeriod = (uiCaptureTicks * 100U) / iWsMaxCaptureDutyPercent;
+        if (uiPeriod < pdMS_TO_TICKS(iWsFrameIntervalMs)) {
+            uiPeriod = pdMS_TO_TICKS(iWsFrameIntervalMs);
+        }
+
+        if (eErr != ESP_OK) {
+            ESP_LOGW(gTag, "Capture failed: %s", esp_err_to_name(eErr));
+            continue;
+        }
+
+        WsWaveform_Broadcast(iSamples_PerCh, liTimestampUs);
+    }
+}
+
+
+static esp_err_t WsWaveform_HandleSocket(httpd_req_t *psReq)
+{
+    // Handles the WebSocket handshake and incoming client frames
+    // Registers the socket with settings taken from the handshake query
+    // Applies "decim=N&mask=M" text messages to the client settings later on
+
+    int iSockFd = httpd_req_to_sockfd(psReq);
+
+    // Handshake: register a new subscriber
+    if (psReq->method == HTTP_GET) {
+
+        uint16_t uiDecimation = 1;
+        uint8_t uiChannelMask = iWsChannelMaskAll;
+        char sQuery[48];
+        if (httpd_req_get_url_query_str(psReq, sQuery, sizeof(sQuery)) == ESP_OK) {
+            WsWaveform_ParseSettings(sQuery, &uiDecimation, &uiChannelMask);
+        }
+
+        xSemaphoreTake(gsWsMutex, portMAX_DELAY);
+        ws_client_t *psClient = NULL;
+        for (int iIndex = 0; iIndex < iWsMaxClients; iIndex++) {
+            if (gasClients[iIndex].iSockFd == iSockFd) {
+                psClient = &gasClients[iIndex];
+                giClientCount--;
+                break;
+            }
+            if (psClient == NULL && gasClients[iIndex].iSockFd < 0 && gasClients[iIndex].psInFlight == NULL) {
+                psClient = &gasClients[iIndex];
+            }
+        }
+        if (psClient != NULL) {
+            psClient->iSockFd = iSockFd;
+            psClient->uiDecimation = uiDecimation;
+            psClient->uiChannelMask = uiChannelMask;
+            psClient->uiDroppedFrames = 0;
+            giClientCount++;
+        }
+        xSemaphoreGive(gsWsMutex);
+
+        if (psClient == NULL) {
+            ESP_LOGW(gTag, "Too many waveform subscribers, refusing socket %d", iSockFd);
+            return ESP_FAIL;
+        }
+
+        xTaskNotifyGive(gsStreamTask);
+        ESP_LOGI(gTag, "Subscriber on socket %d joined (decim=%u mask=%u)",
+                 iSockFd, (unsigned)uiDecimation, (unsigned)uiChannelMask);
+        return ESP_OK;
+    }
+
+    // Data frame: read length first, then the payload
+    httpd_ws_frame_t sFrame;
+    memset(&sFrame, 0, sizeof(sFrame));
+    esp_err_t eErr = httpd_ws_recv_frame(psReq, &sFrame, 0);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+
+    char acText[48];
+    if (sFrame.len >= sizeof(acText)) {
+        ESP_LOGW(gTag, "Ignoring oversized control message (%u bytes)", (unsigned)sFrame.len);
+        return ESP_FAIL;
+    }
+    sFrame.payload = (uint8_t *)acText;
+    eErr = httpd_ws_recv_frame(psReq, &sFrame, sizeof(acText) - 1);
+    if (eErr != ESP_OK) {
+        return eErr;
+    }
+    acText[sFrame.len] = '\0';
+
+    if (sFrame.type != HTTPD_WS_TYPE_TEXT) {
+        return ESP_OK;
+    }
+
+    // Apply new settings to this subscriber
+    xSemaphoreTake(gsWsMutex, portMAX_DELAY);
+    for (int iIndex = 0; iIndex < iWsMaxClients; iIndex++) {
+        ws_client_t *psClient = &gasClients[iIndex];
+        if (psClient->iSockFd == iSockFd) {
+            WsWaveform_ParseSettings(acText, &psClient->uiDecimation, &psClient->uiChannelMask);
+            break;
+        }
+    }
+    xSemaphoreGive(gsWsMutex);
+
+    return ESP_OK;
+}
+
+
+esp_err_t WsWaveform_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Registers /ws/waveform on the shared HTTP server
+    // Creates the stream task that captures and sends windows
+    // Returns an error when resources cannot be allocated
+
+    if (sHttpServer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gsHttpServer = sHttpServer;
+
+    // Create synchronization and reset client slots
+    if (gsWsMutex == NULL) {
+        gsWsMutex = xSemaphoreCreateMutex();
+    }
+    if (gsWsMutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int iIndex = 0; iIndex < iWsMaxClients; iIndex++) {
+        gasClients[iIndex].iSockFd = -1;
+        gasClients[iIndex].psInFlight = NULL;
+    }
+
+    if (gsStreamTask == NULL) {
+        BaseType_t bOk = xTaskCreate(WsWaveform_StreamTask, "ws_wave", 4096, NULL, 4, &gsStreamTask);
+        if (bOk != pdPASS) {
+            gsStreamTask = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Register the WebSocket URI
+    httpd_uri_t sWsUri = {
+        .uri = "/ws/waveform",
+        .method = HTTP_GET,
+        .handler = WsWaveform_HandleSocket,
+        .user_ctx = NULL,
+        .is_websocket = true
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(sHttpServer, &sWsUri));
+
+    ESP_LOGI(gTag, "WebSocket waveform handler registered");
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t WsWaveform_RegisterHandlers(httpd_handle_t sHttpServer)
+{
+    // Keeps the build working when httpd WebSocket support is disabled
+    // Logs once so the missing endpoint is easy to diagnose
+    // Enable CONFIG_HTTPD_WS_SUPPORT to get /ws/waveform
+
+    (void)sHttpServer;
+    ESP_LOGW(gTag, "CONFIG_HTTPD_WS_SUPPORT disabled, /ws/waveform not available");
+    return ESP_OK;
+}
+
+static int giClientCount = 0;
+
+#endif
+
+
+int WsWaveform_GetClientCount(void)
+{
+    // Returns the number of currently attached waveform subscribers
+    // Lets power and diagnostics code react to active streaming clients
+    // The handshake and send-completion paths update the count under gsWsMutex; stays 0 without WS support
+
+    return giClientCount;
+}
@@ -0,0 +1,23 @@
+// Declares the /ws/waveform WebSocket endpoint that streams every captured window.
+// Frames are binary: a 16-byte little-endian header followed by int16 millivolt samples.
+// Lets other modules query whether waveform subscribers are attached.
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Frame header layout (all fields little-endian):
+//   u8  version (iWsFrameVersion)
+//   u8  channel mask (bit0 = channel A, bit1 = channel B)
+//   u16 decimation factor
+//   u16 samples per included channel
+//   u16 reserved (0)
+//   i64 capture timestamp in microseconds since boot
+// Followed by the channel A block, then the channel B block, for each channel in the mask.
+#define iWsFrameVersion                 1
+#define iWsFrameHeaderBytes             16
+
+esp_err_t WsWaveform_RegisterHandlers(httpd_handle_t sHttpServer);
+
+int WsWaveform_GetClientCount(void);